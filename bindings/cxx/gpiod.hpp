@@ -18,6 +18,7 @@ class line_bulk;
 class line_iter;
 class chip_iter;
 struct line_event;
+class line_measurement;
 
 /**
  * @file gpiod.hpp
@@ -225,6 +226,18 @@ struct line_request
 	static const ::std::bitset<32> FLAG_BIAS_PULL_UP;
 	/**< The line has a configurable pull-up resistor enabled. */
 
+	static const ::std::bitset<32> FLAG_OUTPUT_CACHE;
+	/**< Skip writing values the line is already known to hold. */
+
+	static const ::std::bitset<32> FLAG_INPUT_CACHE;
+	/**< Track the value of a line watched for both edges from its events. */
+
+	static const ::std::bitset<32> FLAG_SHARED_EVENT_FD;
+	/**< Request event lines together so that they share a single fd. */
+
+	static const ::std::bitset<32> FLAG_EVENT_NONBLOCK;
+	/**< Open the event file descriptors in non-blocking mode. */
+
 	::std::string consumer;
 	/**< Consumer name to pass to the request. */
 	int request_type;
@@ -511,6 +524,7 @@ private:
 	friend chip;
 	friend line_bulk;
 	friend line_iter;
+	friend line_measurement;
 };
 
 /**
@@ -536,6 +550,91 @@ struct line_event
 	/**< Line object referencing the GPIO line on which the event occurred. */
 };
 
+/**
+ * @brief Measures the frequency and duty cycle of the signal on a line.
+ *
+ * The statistics are derived from the edge events of the line, which must
+ * not be read in any other way while this object exists.
+ */
+class line_measurement
+{
+public:
+
+	/**
+	 * @brief Signal parameters measured over the window.
+	 */
+	struct data
+	{
+		unsigned long long num_periods;
+		/**< Number of full periods in the window. */
+		::std::chrono::nanoseconds period_min;
+		/**< Shortest period. */
+		::std::chrono::nanoseconds period_max;
+		/**< Longest period. */
+		::std::chrono::nanoseconds period_avg;
+		/**< Average period. */
+		double frequency;
+		/**< Average frequency in Hz. */
+		double duty_cycle;
+		/**< Fraction of the period the line spent active. */
+	};
+
+	/**
+	 * @brief Constructor. Starts measuring the signal on a line.
+	 * @param line Line requested for edge events.
+	 * @param window Length of the window covered by the statistics.
+	 */
+	line_measurement(const line& line,
+			 const ::std::chrono::nanoseconds& window);
+
+	line_measurement(const line_measurement& other) = delete;
+
+	/**
+	 * @brief Move constructor.
+	 * @param other Other line_measurement object.
+	 */
+	line_measurement(line_measurement&& other) = default;
+
+	line_measurement& operator=(const line_measurement& other) = delete;
+
+	/**
+	 * @brief Move assignment operator.
+	 * @param other Other line_measurement object.
+	 * @return Reference to this object.
+	 */
+	line_measurement& operator=(line_measurement&& other) = default;
+
+	/**
+	 * @brief Destructor.
+	 */
+	~line_measurement(void) = default;
+
+	/**
+	 * @brief Consume all pending events without blocking.
+	 * @return Number of events consumed.
+	 */
+	int update(void);
+
+	/**
+	 * @brief Consume all pending events and get the current statistics.
+	 * @return Statistics over the window.
+	 */
+	data read(void);
+
+private:
+
+	struct measurement_deleter
+	{
+		void operator()(::gpiod_line_measurement *meas);
+	};
+
+	using measurement_ptr = ::std::unique_ptr<::gpiod_line_measurement,
+						  measurement_deleter>;
+
+	line _m_line;
+	measurement_ptr _m_meas;
+};
+
 /**
  * @brief Represents a set of GPIO lines.
  *
@@ -318,4 +318,65 @@ GPIOD_CXX_API line::chip_guard::chip_guard(const line& line)
 
 }
 
+GPIOD_CXX_API line_measurement::line_measurement(const line& line,
+				const ::std::chrono::nanoseconds& window)
+	: _m_line(line),
+	  _m_meas()
+{
+	line.throw_if_null();
+	line::chip_guard lock_chip(line);
+
+	::timespec ts;
+
+	ts.tv_sec = window.count() / 1000000000ULL;
+	ts.tv_nsec = window.count() % 1000000000ULL;
+
+	this->_m_meas.reset(::gpiod_line_measurement_new(line._m_line, &ts));
+	if (!this->_m_meas)
+		throw ::std::system_error(errno, ::std::system_category(),
+					  "unable to create the line measurement");
+}
+
+GPIOD_CXX_API int line_measurement::update(void)
+{
+	line::chip_guard lock_chip(this->_m_line);
+
+	int rv = ::gpiod_line_measurement_update(this->_m_meas.get());
+	if (rv < 0)
+		throw ::std::system_error(errno, ::std::system_category(),
+					  "error reading line events");
+
+	return rv;
+}
+
+GPIOD_CXX_API line_measurement::data line_measurement::read(void)
+{
+	line::chip_guard lock_chip(this->_m_line);
+
+	::gpiod_line_measurement_data buf;
+	data ret;
+	int rv;
+
+	rv = ::gpiod_line_measurement_read(this->_m_meas.get(),
+					   ::std::addressof(buf));
+	if (rv < 0)
+		throw ::std::system_error(errno, ::std::system_category(),
+					  "error reading line events");
+
+	ret.num_periods = buf.num_periods;
+	ret.period_min = ::std::chrono::nanoseconds(buf.period_min_ns);
+	ret.period_max = ::std::chrono::nanoseconds(buf.period_max_ns);
+	ret.period_avg = ::std::chrono::nanoseconds(buf.period_avg_ns);
+	ret.frequency = buf.frequency;
+	ret.duty_cycle = buf.duty_cycle;
+
+	return ret;
+}
+
+GPIOD_CXX_API void
+line_measurement::measurement_deleter::operator()(::gpiod_line_measurement *meas)
+{
+	::gpiod_line_measurement_free(meas);
+}
+
 } /* namespace gpiod */
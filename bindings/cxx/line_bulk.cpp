@@ -15,6 +15,10 @@ GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_OPEN_DRAIN(GPIOD_BIT(2)
 GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_BIAS_DISABLED(GPIOD_BIT(3));
 GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_BIAS_PULL_DOWN(GPIOD_BIT(4));
 GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_BIAS_PULL_UP(GPIOD_BIT(5));
+GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_OUTPUT_CACHE(GPIOD_BIT(6));
+GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_INPUT_CACHE(GPIOD_BIT(7));
+GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_SHARED_EVENT_FD(GPIOD_BIT(8));
+GPIOD_CXX_API const ::std::bitset<32> line_request::FLAG_EVENT_NONBLOCK(GPIOD_BIT(9));
 
 namespace {
 
@@ -42,6 +46,10 @@ const ::std::map<::std::bitset<32>, int, bitset_cmp> reqflag_mapping = {
 	{ line_request::FLAG_BIAS_DISABLED,	GPIOD_LINE_REQUEST_FLAG_BIAS_DISABLED, },
 	{ line_request::FLAG_BIAS_PULL_DOWN,	GPIOD_LINE_REQUEST_FLAG_BIAS_PULL_DOWN, },
 	{ line_request::FLAG_BIAS_PULL_UP,	GPIOD_LINE_REQUEST_FLAG_BIAS_PULL_UP, },
+	{ line_request::FLAG_OUTPUT_CACHE,	GPIOD_LINE_REQUEST_FLAG_OUTPUT_CACHE, },
+	{ line_request::FLAG_INPUT_CACHE,	GPIOD_LINE_REQUEST_FLAG_INPUT_CACHE, },
+	{ line_request::FLAG_SHARED_EVENT_FD,	GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD, },
+	{ line_request::FLAG_EVENT_NONBLOCK,	GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK, },
 };
 
 } /* namespace */
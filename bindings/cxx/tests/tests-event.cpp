@@ -278,3 +278,36 @@ TEST_CASE("It's possible to read more than one line event", "[event][line]")
 	REQUIRE(events.at(1).source == line);
 	REQUIRE(events.at(2).source == line);
 }
+
+TEST_CASE("Frequency and duty cycle can be measured from line events", "[event][line]")
+{
+	mockup::probe_guard mockup_chips({ 8 });
+	::gpiod::chip chip(mockup::instance().chip_path(0));
+	auto line = chip.get_line(4);
+	::gpiod::line_request config;
+
+	config.consumer = consumer.c_str();
+	config.request_type = ::gpiod::line_request::EVENT_BOTH_EDGES;
+
+	line.request(config);
+
+	::gpiod::line_measurement meas(line, ::std::chrono::seconds(10));
+
+	for (int i = 0; i < 3; i++) {
+		mockup::instance().chip_set_pull(0, 4, 1);
+		::std::this_thread::sleep_for(::std::chrono::milliseconds(10));
+		mockup::instance().chip_set_pull(0, 4, 0);
+		::std::this_thread::sleep_for(::std::chrono::milliseconds(10));
+	}
+
+	auto data = meas.read();
+
+	REQUIRE(data.num_periods == 2);
+	REQUIRE(data.period_min >= ::std::chrono::milliseconds(20));
+	REQUIRE(data.period_min <= data.period_avg);
+	REQUIRE(data.period_avg <= data.period_max);
+	REQUIRE(data.frequency > 0);
+	REQUIRE(data.frequency <= 50);
+	REQUIRE(data.duty_cycle > 0);
+	REQUIRE(data.duty_cycle < 1);
+}
@@ -23,6 +23,12 @@ typedef struct {
 	gpiod_LineObject *source;
 } gpiod_LineEventObject;
 
+typedef struct {
+	PyObject_HEAD;
+	struct gpiod_line_measurement *meas;
+	gpiod_LineObject *line;
+} gpiod_LineMeasurementObject;
+
 typedef struct {
 	PyObject_HEAD;
 	PyObject **lines;
@@ -56,6 +62,10 @@ enum {
 	gpiod_LINE_REQ_FLAG_BIAS_DISABLED	= GPIOD_BIT(3),
 	gpiod_LINE_REQ_FLAG_BIAS_PULL_DOWN	= GPIOD_BIT(4),
 	gpiod_LINE_REQ_FLAG_BIAS_PULL_UP	= GPIOD_BIT(5),
+	gpiod_LINE_REQ_FLAG_OUTPUT_CACHE	= GPIOD_BIT(6),
+	gpiod_LINE_REQ_FLAG_INPUT_CACHE		= GPIOD_BIT(7),
+	gpiod_LINE_REQ_FLAG_SHARED_EVENT_FD	= GPIOD_BIT(8),
+	gpiod_LINE_REQ_FLAG_EVENT_NONBLOCK	= GPIOD_BIT(9),
 };
 
 enum {
@@ -1040,6 +1050,167 @@ static PyTypeObject gpiod_LineType = {
 	.tp_methods = gpiod_Line_methods,
 };
 
+static int gpiod_LineMeasurement_init(gpiod_LineMeasurementObject *self,
+				      PyObject *args, PyObject *kwds)
+{
+	static char *kwlist[] = { "line", "sec", "nsec", NULL };
+
+	gpiod_LineObject *line_obj;
+	long sec = 0, nsec = 0;
+	struct timespec ts;
+	int rv;
+
+	rv = PyArg_ParseTupleAndKeywords(args, kwds, "O!|ll", kwlist,
+					 &gpiod_LineType,
+					 (PyObject *)&line_obj, &sec, &nsec);
+	if (!rv)
+		return -1;
+
+	if (gpiod_ChipIsClosed(line_obj->owner))
+		return -1;
+
+	ts.tv_sec = sec;
+	ts.tv_nsec = nsec;
+
+	self->meas = gpiod_line_measurement_new(line_obj->line, &ts);
+	if (!self->meas) {
+		PyErr_SetFromErrno(PyExc_OSError);
+		return -1;
+	}
+
+	self->line = line_obj;
+	Py_INCREF(line_obj);
+
+	return 0;
+}
+
+static void gpiod_LineMeasurement_dealloc(gpiod_LineMeasurementObject *self)
+{
+	if (self->meas)
+		gpiod_line_measurement_free(self->meas);
+
+	if (self->line)
+		Py_DECREF(self->line);
+
+	PyObject_Del(self);
+}
+
+PyDoc_STRVAR(gpiod_LineMeasurement_update_doc,
+"update() -> integer\n"
+"\n"
+"Consume all pending events of the line without blocking and return their\n"
+"number. Only needed if events can pile up faster than the kernel buffer\n"
+"holds them between two calls to read().");
+
+static PyObject *
+gpiod_LineMeasurement_update(gpiod_LineMeasurementObject *self,
+			     PyObject *Py_UNUSED(ignored))
+{
+	int rv;
+
+	if (gpiod_ChipIsClosed(self->line->owner))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS;
+	rv = gpiod_line_measurement_update(self->meas);
+	Py_END_ALLOW_THREADS;
+	if (rv < 0)
+		return PyErr_SetFromErrno(PyExc_OSError);
+
+	return Py_BuildValue("i", rv);
+}
+
+PyDoc_STRVAR(gpiod_LineMeasurement_read_doc,
+"read() -> dictionary\n"
+"\n"
+"Consume all pending events of the line and return the statistics over the\n"
+"window as a dictionary with the following keys:\n"
+"\n"
+"  num_periods\n"
+"    Number of full periods in the window.\n"
+"  period_min_ns, period_max_ns, period_avg_ns\n"
+"    Shortest, longest and average period in nanoseconds.\n"
+"  frequency\n"
+"    Average frequency in Hz.\n"
+"  duty_cycle\n"
+"    Fraction of the period the line spent active. Always 0 unless the\n"
+"    line is requested for both edges.");
+
+static PyObject *
+gpiod_LineMeasurement_read(gpiod_LineMeasurementObject *self,
+			   PyObject *Py_UNUSED(ignored))
+{
+	struct gpiod_line_measurement_data data;
+	int rv;
+
+	if (gpiod_ChipIsClosed(self->line->owner))
+		return NULL;
+
+	Py_BEGIN_ALLOW_THREADS;
+	rv = gpiod_line_measurement_read(self->meas, &data);
+	Py_END_ALLOW_THREADS;
+	if (rv < 0)
+		return PyErr_SetFromErrno(PyExc_OSError);
+
+	return Py_BuildValue("{s:K,s:K,s:K,s:K,s:d,s:d}",
+			     "num_periods", data.num_periods,
+			     "period_min_ns", data.period_min_ns,
+			     "period_max_ns", data.period_max_ns,
+			     "period_avg_ns", data.period_avg_ns,
+			     "frequency", data.frequency,
+			     "duty_cycle", data.duty_cycle);
+}
+
+static PyMethodDef gpiod_LineMeasurement_methods[] = {
+	{
+		.ml_name = "update",
+		.ml_meth = (PyCFunction)gpiod_LineMeasurement_update,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = gpiod_LineMeasurement_update_doc,
+	},
+	{
+		.ml_name = "read",
+		.ml_meth = (PyCFunction)gpiod_LineMeasurement_read,
+		.ml_flags = METH_NOARGS,
+		.ml_doc = gpiod_LineMeasurement_read_doc,
+	},
+	{ }
+};
+
+PyDoc_STRVAR(gpiod_LineMeasurementType_doc,
+"Measures the frequency, the period and the duty cycle of the signal on a\n"
+"line from its edge events.\n"
+"\n"
+"  line\n"
+"    Line requested for edge events.\n"
+"  sec\n"
+"    Number of seconds in the window covered by the statistics.\n"
+"  nsec\n"
+"    Number of nanoseconds in the window.\n"
+"\n"
+"The events of the line must not be read in any other way while this object\n"
+"exists.\n"
+"\n"
+"Example:\n"
+"\n"
+"    line.request(consumer='tacho', type=gpiod.LINE_REQ_EV_BOTH_EDGES)\n"
+"    meas = gpiod.LineMeasurement(line, sec=1)\n"
+"    while True:\n"
+"        time.sleep(0.5)\n"
+"        print(meas.read()['frequency'])");
+
+static PyTypeObject gpiod_LineMeasurementType = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "gpiod.LineMeasurement",
+	.tp_basicsize = sizeof(gpiod_LineMeasurementObject),
+	.tp_flags = Py_TPFLAGS_DEFAULT,
+	.tp_doc = gpiod_LineMeasurementType_doc,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc)gpiod_LineMeasurement_init,
+	.tp_dealloc = (destructor)gpiod_LineMeasurement_dealloc,
+	.tp_methods = gpiod_LineMeasurement_methods,
+};
+
 static bool gpiod_LineBulkOwnerIsClosed(gpiod_LineBulkObject *self)
 {
 	gpiod_LineObject *line = (gpiod_LineObject *)self->lines[0];
@@ -1234,6 +1405,14 @@ static void gpiod_MakeRequestConfig(struct gpiod_line_request_config *conf,
 		conf->flags |= GPIOD_LINE_REQUEST_FLAG_BIAS_PULL_DOWN;
 	if (flags & gpiod_LINE_REQ_FLAG_BIAS_PULL_UP)
 		conf->flags |= GPIOD_LINE_REQUEST_FLAG_BIAS_PULL_UP;
+	if (flags & gpiod_LINE_REQ_FLAG_OUTPUT_CACHE)
+		conf->flags |= GPIOD_LINE_REQUEST_FLAG_OUTPUT_CACHE;
+	if (flags & gpiod_LINE_REQ_FLAG_INPUT_CACHE)
+		conf->flags |= GPIOD_LINE_REQUEST_FLAG_INPUT_CACHE;
+	if (flags & gpiod_LINE_REQ_FLAG_SHARED_EVENT_FD)
+		conf->flags |= GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD;
+	if (flags & gpiod_LINE_REQ_FLAG_EVENT_NONBLOCK)
+		conf->flags |= GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK;
 }
 
 PyDoc_STRVAR(gpiod_LineBulk_request_doc,
@@ -2430,6 +2609,8 @@ static gpiod_PyType gpiod_PyType_list[] = {
 	{ .name = "LineEvent",	.typeobj = &gpiod_LineEventType,	},
 	{ .name = "LineBulk",	.typeobj = &gpiod_LineBulkType,		},
 	{ .name = "LineIter",	.typeobj = &gpiod_LineIterType,		},
+	{ .name = "LineMeasurement",
+	  .typeobj = &gpiod_LineMeasurementType,			},
 	{ }
 };
 
@@ -2600,6 +2781,22 @@ static gpiod_ModuleConst gpiod_ModuleConsts[] = {
 		.name = "LINE_REQ_FLAG_BIAS_PULL_UP",
 		.value = gpiod_LINE_REQ_FLAG_BIAS_PULL_UP,
 	},
+	{
+		.name = "LINE_REQ_FLAG_OUTPUT_CACHE",
+		.value = gpiod_LINE_REQ_FLAG_OUTPUT_CACHE,
+	},
+	{
+		.name = "LINE_REQ_FLAG_INPUT_CACHE",
+		.value = gpiod_LINE_REQ_FLAG_INPUT_CACHE,
+	},
+	{
+		.name = "LINE_REQ_FLAG_SHARED_EVENT_FD",
+		.value = gpiod_LINE_REQ_FLAG_SHARED_EVENT_FD,
+	},
+	{
+		.name = "LINE_REQ_FLAG_EVENT_NONBLOCK",
+		.value = gpiod_LINE_REQ_FLAG_EVENT_NONBLOCK,
+	},
 	{ }
 };
 
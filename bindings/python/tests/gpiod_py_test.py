@@ -822,6 +822,41 @@ class EventFileDescriptor(MockupTestCase):
                 self.assertEqual(event.type, gpiod.LineEvent.RISING_EDGE)
                 self.assertEqual(event.source.offset(), 2)
 
+class EventMeasurement(MockupTestCase):
+
+    chip_sizes = ( 8, )
+
+    def test_measure_frequency_and_duty_cycle(self):
+        with gpiod.Chip(mockup.chip_path(0)) as chip:
+            line = chip.get_line(4)
+            line.request(consumer=default_consumer,
+                         type=gpiod.LINE_REQ_EV_BOTH_EDGES)
+            meas = gpiod.LineMeasurement(line, sec=10)
+            for i in range(3):
+                mockup.chip_set_pull(0, 4, 1)
+                time.sleep(0.01)
+                mockup.chip_set_pull(0, 4, 0)
+                time.sleep(0.01)
+            data = meas.read()
+            self.assertEqual(data['num_periods'], 2)
+            self.assertGreaterEqual(data['period_min_ns'], 20000000)
+            self.assertLessEqual(data['period_min_ns'], data['period_avg_ns'])
+            self.assertLessEqual(data['period_avg_ns'], data['period_max_ns'])
+            self.assertGreater(data['frequency'], 0)
+            self.assertLessEqual(data['frequency'], 50)
+            self.assertGreater(data['duty_cycle'], 0)
+            self.assertLess(data['duty_cycle'], 1)
+
+    def test_measure_line_not_requested_for_events(self):
+        with gpiod.Chip(mockup.chip_path(0)) as chip:
+            line = chip.get_line(4)
+            line.request(consumer=default_consumer,
+                         type=gpiod.LINE_REQ_DIR_IN)
+            with self.assertRaises(OSError) as err_ctx:
+                meas = gpiod.LineMeasurement(line, sec=1)
+
+            self.assertEqual(err_ctx.exception.errno, errno.EPERM)
+
 #
 # Main
 #
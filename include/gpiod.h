@@ -31,6 +31,22 @@ extern "C" {
  * but in general a function that returns an int, returns -1 on error, while
  * a function returning a pointer bails out on error condition by returning
  * a NULL pointer.
+ *
+ * <p>Thread safety: chip objects are reference counted atomically, so
+ * gpiod_chip_ref() and gpiod_chip_unref() may be called concurrently from
+ * different threads as long as the caller holding the last reference doesn't
+ * race with the others. Looking up line objects with gpiod_chip_get_line()
+ * and friends is safe from multiple threads too - all callers get the same
+ * line object for the same offset. Every lookup refreshes the line info
+ * though, so it must not race with reading the info of that line (its name,
+ * consumer, direction etc.) in another thread. Everything else (requesting,
+ * releasing, reading and setting values, reading events) operates on line
+ * state that isn't protected by the library: calls for the same line or any
+ * line of the same request must be serialized by the user. The only
+ * exception is releasing: different lines of a request may be released from
+ * different threads at once as long as nothing else is being done with the
+ * request. Different requests can be driven from different threads without
+ * any locking.
  */
 
 struct gpiod_chip;
@@ -79,6 +95,7 @@ struct gpiod_chip *gpiod_chip_open(const char *path);
  * @brief Increase the refcount on this GPIO object.
  * @param chip The GPIO chip object.
  * @return Passed reference to the GPIO chip.
+ * @note This function is thread-safe.
  */
 struct gpiod_chip *gpiod_chip_ref(struct gpiod_chip *chip);
 
@@ -86,6 +103,7 @@ struct gpiod_chip *gpiod_chip_ref(struct gpiod_chip *chip);
  * @brief Decrease the refcount on this GPIO object. If the refcount reaches 0,
  *        close the chip device and free all associated resources.
  * @param chip The GPIO chip object.
+ * @note This function is thread-safe.
  */
 void gpiod_chip_unref(struct gpiod_chip *chip);
 
@@ -115,6 +133,10 @@ unsigned int gpiod_chip_get_num_lines(struct gpiod_chip *chip);
  * @param chip The GPIO chip object.
  * @param offset The offset of the GPIO line.
  * @return Pointer to the GPIO line handle or NULL if an error occured.
+ * @note This function is thread-safe. Concurrent callers asking for the same
+ *       offset get the same line handle. The line info is re-read from the
+ *       kernel on every call, so reading the info of the line in another
+ *       thread at the same time is not safe.
  */
 struct gpiod_line *
 gpiod_chip_get_line(struct gpiod_chip *chip, unsigned int offset);
@@ -403,6 +425,14 @@ enum {
 	/**< The line has pull-down resistor enabled. */
 	GPIOD_LINE_REQUEST_FLAG_BIAS_PULL_UP	= GPIOD_BIT(5),
 	/**< The line has pull-up resistor enabled. */
+	GPIOD_LINE_REQUEST_FLAG_OUTPUT_CACHE	= GPIOD_BIT(6),
+	/**< Don't write output values the line is already known to hold. */
+	GPIOD_LINE_REQUEST_FLAG_INPUT_CACHE	= GPIOD_BIT(7),
+	/**< Track the value of a line requested for both edges from events. */
+	GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD	= GPIOD_BIT(8),
+	/**< Request event lines together so that they share a single fd. */
+	GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK	= GPIOD_BIT(9),
+	/**< Open the event file descriptors in non-blocking mode. */
 };
 
 /**
@@ -695,6 +725,14 @@ int gpiod_line_get_value(struct gpiod_line *line);
  * If succeeds, this routine fills the values array with a set of values in
  * the same order, the lines are added to line_bulk. If the lines were not
  * previously requested together, the behavior is undefined.
+ *
+ * For lines requested for both edge events with
+ * GPIOD_LINE_REQUEST_FLAG_INPUT_CACHE, the value is derived from the events
+ * read with ::gpiod_line_event_read_multiple and friends without making
+ * a system call. It reflects the most recent event consumed by the caller.
+ * The kernel is only queried to initialize the cache and whenever a gap in
+ * event sequence numbers shows that events were lost or read behind the
+ * library's back (e.g. with ::gpiod_line_event_read_fd_multiple).
  */
 int gpiod_line_get_value_bulk(struct gpiod_line_bulk *bulk, int *values);
 
@@ -715,11 +753,58 @@ int gpiod_line_set_value(struct gpiod_line *line, int value);
  * @return 0 is the operation succeeds. In case of an error this routine
  *         returns -1 and sets the last error number.
  *
- * If the lines were not previously requested together, the behavior is
- * undefined.
+ * The bulk may hold any subset of the lines requested together - only the
+ * lines it contains are modified. If the lines were not previously requested
+ * together, the behavior is undefined.
+ *
+ * For lines requested with GPIOD_LINE_REQUEST_FLAG_OUTPUT_CACHE, values equal
+ * to the ones last written are not passed to the kernel. If no line changes,
+ * no system call is made at all.
  */
 int gpiod_line_set_value_bulk(struct gpiod_line_bulk *bulk, const int *values);
 
+/**
+ * @brief Set the values of a subset of a set of GPIO lines.
+ * @param bulk Set of GPIO lines requested together.
+ * @param mask Bit N selects line N of the bulk for modification.
+ * @param bits Bit N holds the new value of line N of the bulk.
+ * @return 0 is the operation succeeds. In case of an error this routine
+ *         returns -1 and sets the last error number.
+ *
+ * All selected lines are updated with a single system call and the lines not
+ * selected keep their current values. Only the first 64 lines of the bulk can
+ * be addressed. The output cache is honored the same way as in
+ * ::gpiod_line_set_value_bulk.
+ */
+int gpiod_line_set_value_bulk_mask(struct gpiod_line_bulk *bulk,
+				   unsigned long long mask,
+				   unsigned long long bits);
+
+/**
+ * @brief Statistics of output writes performed on a line request.
+ */
+struct gpiod_line_output_stats {
+	unsigned long long writes_issued;
+	/**< Number of calls setting line values which reached the kernel. */
+	unsigned long long writes_skipped;
+	/**< Number of calls setting line values which didn't reach the kernel
+	 *   because the output cache found all of them unchanged. */
+};
+
+/**
+ * @brief Read the output write statistics of the request a line belongs to.
+ * @param line GPIO line object.
+ * @param stats Buffer in which the statistics will be stored.
+ * @return 0 if the operation succeeds, -1 if the line is not requested.
+ *
+ * The counters are shared by all lines requested together. Both count calls,
+ * so their ratio tells how many writes the cache saved. A bulk write in which
+ * only some of the lines are unchanged counts as one write issued. This
+ * function is safe to call while other threads set the values of the lines.
+ */
+int gpiod_line_get_output_stats(struct gpiod_line *line,
+				struct gpiod_line_output_stats *stats);
+
 /**
  * @}
  *
@@ -867,6 +952,31 @@ struct gpiod_line_event {
 	/**< Offset of line on which the event occurred. */
 };
 
+/**
+ * @brief Structure holding event info along with its sequence numbers.
+ *
+ * The first members are the same as in ::gpiod_line_event. This is the
+ * format used by the event loop, the event readers and buffers, event
+ * publishing and captures.
+ */
+struct gpiod_line_event_ext {
+	struct timespec ts;
+	/**< Best estimate of time of event occurrence. */
+	int event_type;
+	/**< Type of the event that occurred. */
+	int offset;
+	/**< Offset of line on which the event occurred. */
+	unsigned long seqno;
+	/**< Sequence number of the event among all lines of the request. */
+	unsigned long line_seqno;
+	/**< Sequence number of the event on this line. */
+	struct timespec first_ts;
+	/**< Time of the first edge a coalesced event stands for. Same as ts
+	 *   for regular events. */
+	unsigned long num_events;
+	/**< Number of edges this event stands for. 1 unless coalesced. */
+};
+
 /**
  * @brief Wait for an event on a single line.
  * @param line GPIO line object.
@@ -890,12 +1000,104 @@ int gpiod_line_event_wait_bulk(struct gpiod_line_bulk *bulk,
 			       const struct timespec *timeout,
 			       struct gpiod_line_bulk *event_bulk);
 
+/**
+ * @brief Wait for events on a set of lines and read them in one go.
+ * @param bulk Set of GPIO lines to monitor.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return Number of events stored in the buffer, 0 if the wait timed out or
+ *         -1 if an error occurred.
+ *
+ * This routine waits once for all file descriptors associated with the bulk
+ * and then reads the pending events from each one that became ready. If all
+ * lines share a single file descriptor (see
+ * GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD) and timeout is NULL, the events
+ * are read with a single blocking read() without polling first.
+ *
+ * Events are grouped by the file descriptor they were read from - the
+ * offset field tells which line each one occurred on.
+ */
+int gpiod_line_event_read_bulk(struct gpiod_line_bulk *bulk,
+			       const struct timespec *timeout,
+			       struct gpiod_line_event *events,
+			       unsigned int num_events);
+
+/**
+ * @brief Wait for events on a set of lines and read them along with their
+ *        sequence numbers.
+ * @param bulk Set of GPIO lines to monitor.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return Number of events stored in the buffer, 0 if the wait timed out or
+ *         -1 if an error occurred.
+ *
+ * Same as ::gpiod_line_event_read_bulk except for the event format.
+ */
+int gpiod_line_event_read_bulk_ext(struct gpiod_line_bulk *bulk,
+				   const struct timespec *timeout,
+				   struct gpiod_line_event_ext *events,
+				   unsigned int num_events);
+
+/**
+ * @brief Wait until a set of lines reaches a given pattern of values.
+ * @param bulk Set of GPIO lines requested for both edge events.
+ * @param mask Bitmap of the lines in the bulk whose values matter - bit N
+ *             corresponds to line N of the bulk.
+ * @param bits Values the lines selected by mask must have.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @param ts Pointer to a structure in which to store the timestamp of the
+ *           edge which completed the pattern. Can be NULL.
+ * @return 1 once the pattern matched, 0 if the wait timed out or -1 if an
+ *         error occurred.
+ *
+ * The values are read once and then followed from the edge events, so the
+ * caller sleeps until the pattern is reached. If it matches right away, ts
+ * is set to the time of the initial read. Events of all lines are consumed,
+ * including those after the one completing the pattern if they were read
+ * together with it.
+ */
+int gpiod_line_wait_pattern_bulk(struct gpiod_line_bulk *bulk,
+				 unsigned long long mask,
+				 unsigned long long bits,
+				 const struct timespec *timeout,
+				 struct timespec *ts);
+
+/**
+ * @brief Busy-poll a set of lines for events before falling back to waiting.
+ * @param bulk Set of GPIO lines to monitor. All lines must have been
+ *             requested with GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK.
+ * @param spin For how long to spin on non-blocking reads before sleeping.
+ * @param timeout Total wait time limit including the spin time. NULL means
+ *                wait forever.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return Number of events stored in the buffer, 0 if the wait timed out or
+ *         -1 if an error occurred.
+ *
+ * This routine trades CPU time for reaction latency: as long as the spin
+ * budget lasts, the calling thread never sleeps so an event is picked up
+ * without the scheduler wake-up delay of a blocking wait. It's meant to be
+ * called from a thread that has a CPU core to itself.
+ */
+int gpiod_line_event_read_bulk_busy_poll(struct gpiod_line_bulk *bulk,
+					 const struct timespec *spin,
+					 const struct timespec *timeout,
+					 struct gpiod_line_event *events,
+					 unsigned int num_events);
+
 /**
  * @brief Read next pending event from the GPIO line.
  * @param line GPIO line object.
  * @param event Buffer to which the event data will be copied.
  * @return 0 if the event was read correctly, -1 on error.
- * @note This function will block if no event was queued for this line.
+ * @note This function will block if no event was queued for this line
+ *       unless it was requested with GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK
+ *       in which case it fails with errno set to EAGAIN.
  */
 int gpiod_line_event_read(struct gpiod_line *line,
 			  struct gpiod_line_event *event);
@@ -913,6 +1115,20 @@ int gpiod_line_event_read_multiple(struct gpiod_line *line,
 				   struct gpiod_line_event *events,
 				   unsigned int num_events);
 
+/**
+ * @brief Read up to a certain number of events from the GPIO line along with
+ *        their sequence numbers.
+ * @param line GPIO line object.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return On success returns the number of events stored in the buffer, on
+ *         failure -1 is returned.
+ */
+int gpiod_line_event_read_multiple_ext(struct gpiod_line *line,
+				       struct gpiod_line_event_ext *events,
+				       unsigned int num_events);
+
 /**
  * @brief Get the event file descriptor.
  * @param line GPIO line object.
@@ -922,6 +1138,9 @@ int gpiod_line_event_read_multiple(struct gpiod_line *line,
  *
  * Users may want to poll the event file descriptor on their own. This routine
  * allows to access it.
+ *
+ * Lines requested with GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD all return
+ * the same descriptor and events read from it may come from any of them.
  */
 int gpiod_line_event_get_fd(struct gpiod_line *line);
 
@@ -949,9 +1168,2028 @@ int gpiod_line_event_read_fd(int fd, struct gpiod_line_event *event);
 int gpiod_line_event_read_fd_multiple(int fd, struct gpiod_line_event *events,
 				      unsigned int num_events);
 
+/**
+ * @brief Software event filter statistics.
+ */
+struct gpiod_line_event_filter_stats {
+	unsigned long long num_bounces;
+	/**< Number of edges swallowed because the line hadn't settled. */
+	unsigned long long num_glitches;
+	/**< Number of edges swallowed as parts of pulses shorter than the
+	 *   minimum pulse width. */
+};
+
+/**
+ * @brief Filter the edge events of a line in software.
+ * @param line GPIO line object requested for events.
+ * @param stable Time the line must stay at a new level before the edge that
+ *               brought it there is reported. NULL or zero disables
+ *               debouncing.
+ * @param min_pulse Pulses shorter than this are dropped altogether. NULL or
+ *                  zero disables the glitch filter.
+ * @return 0 on success, -1 on failure.
+ *
+ * This is meant for lines whose driver doesn't support hardware debouncing.
+ * Edges closer to each other than the longer of the two periods form a burst
+ * which is held back until the line settles. The burst is then reported as a
+ * single event for its last edge, with the timestamp and sequence numbers of
+ * that edge, or swallowed entirely if the line ended up at the level it had
+ * before. If only one kind of edge was requested, the level can't be
+ * tracked and every burst is reported.
+ *
+ * Filtering is done by ::gpiod_line_event_read_multiple and everything built
+ * on top of it. As edges are only reported once they have settled, nothing
+ * makes the event file descriptor readable when a held back edge becomes
+ * due: blocking reads and the library's event loops wait for that, callers
+ * polling the descriptor themselves must also wake up at the time returned
+ * by ::gpiod_line_event_get_filter_deadline. Reading in non-blocking mode
+ * never waits and fails with EAGAIN if nothing is due yet. Filtered events
+ * may be reported after unfiltered events from other lines of the same
+ * request that occurred later. Events read with
+ * ::gpiod_line_event_read_fd_multiple are never filtered.
+ *
+ * Passing NULL for both periods disables the filter. The filter is also
+ * removed when the line is released.
+ */
+int gpiod_line_set_event_filter(struct gpiod_line *line,
+				const struct timespec *stable,
+				const struct timespec *min_pulse);
+
+/**
+ * @brief Get the statistics of the software event filter of a line.
+ * @param line GPIO line object.
+ * @param stats Structure in which to store the statistics. Zeroed if the line
+ *              has no filter.
+ * @note This function is safe to call while another thread reads events.
+ */
+void
+gpiod_line_get_event_filter_stats(struct gpiod_line *line,
+				  struct gpiod_line_event_filter_stats *stats);
+
+/**
+ * @brief Event rate limit and coalescing statistics.
+ */
+struct gpiod_line_event_limit_stats {
+	unsigned long long num_passed;
+	/**< Number of events handed to the user. */
+	unsigned long long num_dropped;
+	/**< Number of edges dropped because the rate limit was exceeded. */
+	unsigned long long num_coalesced;
+	/**< Number of edges merged into the events of coalesced runs. */
+};
+
+/**
+ * @brief Limit the rate of edge events reported for a line.
+ * @param line GPIO line object requested for events.
+ * @param rate Number of events per second allowed on average. 0 disables
+ *             the rate limit.
+ * @param burst Number of events allowed in a row before the rate limit
+ *              kicks in. Must not be 0 if rate isn't.
+ * @return 0 on success, -1 on failure.
+ *
+ * The limit is a token bucket refilled according to the kernel timestamps of
+ * the events. Events exceeding it are dropped and counted. As the sequence
+ * numbers of the events that get through are left as they are, the user can
+ * also tell from the gaps in line_seqno of ::gpiod_line_event_ext where
+ * events were dropped.
+ *
+ * Like the software event filter, the rate limit is applied by
+ * ::gpiod_line_event_read_multiple and everything built on top of it, after
+ * the filter, and is removed when the line is released.
+ */
+int gpiod_line_set_event_rate_limit(struct gpiod_line *line,
+				    unsigned int rate, unsigned int burst);
+
+/**
+ * @brief Collapse runs of edge events of a line into summary events.
+ * @param line GPIO line object requested for events.
+ * @param window All edges occurring within this period from the first edge
+ *               of a run are reported as a single event. NULL or zero
+ *               disables coalescing.
+ * @return 0 on success, -1 on failure.
+ *
+ * The event reported for a run has the type, timestamp and sequence numbers
+ * of its last edge, the timestamp of its first edge in first_ts and the
+ * number of edges in num_events of ::gpiod_line_event_ext. Runs are reported
+ * once their window has passed so, as with the software event filter, they
+ * are held back until then. If the rate limit is enabled too, it applies to
+ * the events of the runs.
+ */
+int gpiod_line_set_event_coalescing(struct gpiod_line *line,
+				    const struct timespec *window);
+
+/**
+ * @brief Get the rate limit and coalescing statistics of a line.
+ * @param line GPIO line object.
+ * @param stats Structure in which to store the statistics. Zeroed if neither
+ *              the rate limit nor coalescing is enabled.
+ * @note This function is safe to call while another thread reads events.
+ */
+void
+gpiod_line_get_event_limit_stats(struct gpiod_line *line,
+				 struct gpiod_line_event_limit_stats *stats);
+
+/**
+ * @brief Get the time at which the next event held back by the software
+ *        filters or the coalescing of a request becomes due.
+ * @param line GPIO line object requested for events.
+ * @param deadline Buffer in which to store the absolute CLOCK_MONOTONIC time
+ *                 at which to read from the line again.
+ * @return 1 if events are held back, 0 if not and -1 on error.
+ *
+ * The deadline covers all lines sharing the event file descriptor with this
+ * one. It may be in the past if a held back event is due already.
+ */
+int gpiod_line_event_get_filter_deadline(struct gpiod_line *line,
+					 struct timespec *deadline);
+
+/**
+ * @}
+ *
+ * @}
+ *
+ * @defgroup event_loop Event loop
+ * @{
+ *
+ * An event loop watches event file descriptors of any number of line requests
+ * - possibly coming from different chips - and dispatches the events read from
+ * them to per-request callbacks. The descriptors are registered once in a
+ * persistent epoll set so the cost of a wake-up depends on the number of
+ * descriptors that became ready, not on the number of watched lines.
+ */
+
+struct gpiod_event_loop;
+
+/**
+ * @brief Values returned by the callback passed to ::gpiod_event_loop_add.
+ */
+enum {
+	GPIOD_EVENT_LOOP_CB_NEXT = 0,
+	/**< Continue dispatching events. */
+	GPIOD_EVENT_LOOP_CB_STOP,
+	/**< Make ::gpiod_event_loop_dispatch return after this callback. */
+};
+
+/**
+ * @brief Values returned by ::gpiod_event_loop_dispatch on success.
+ */
+enum {
+	GPIOD_EVENT_LOOP_TIMEOUT = 0,
+	/**< Nothing happened before the wait timed out. */
+	GPIOD_EVENT_LOOP_DISPATCHED,
+	/**< All events read were passed to the callbacks. There may have been
+	 *   none if software event filters swallowed or held back all of
+	 *   them. */
+	GPIOD_EVENT_LOOP_STOPPED,
+	/**< A callback returned GPIOD_EVENT_LOOP_CB_STOP. Events of the
+	 *   descriptors not handled yet are left for the next call. */
+};
+
+/**
+ * @brief Signature of the callback passed to ::gpiod_event_loop_add.
+ *
+ * Takes the events read from a single file descriptor, their number and the
+ * user data pointer associated with the request as arguments.
+ */
+typedef int (*gpiod_event_loop_cb)(const struct gpiod_line_event_ext *,
+				   unsigned int, void *);
+
+/**
+ * @brief Create a new event loop.
+ * @return New event loop object or NULL on error.
+ */
+struct gpiod_event_loop *gpiod_event_loop_new(void);
+
+/**
+ * @brief Release all resources allocated for this event loop.
+ * @param loop Event loop object to free.
+ *
+ * Lines registered with the loop are not released.
+ */
+void gpiod_event_loop_free(struct gpiod_event_loop *loop);
+
+/**
+ * @brief Register a set of lines with the event loop.
+ * @param loop Event loop object.
+ * @param bulk Set of lines requested for events.
+ * @param cb Callback invoked with the events read for any of these lines.
+ * @param data User data pointer passed to the callback.
+ * @return 0 on success, -1 on error. If any of the lines is already watched
+ *         by the loop, errno is set to EBUSY.
+ *
+ * Lines sharing an event file descriptor (see
+ * GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD) are watched through a single epoll
+ * entry. The lines must be removed from the loop before being released.
+ */
+int gpiod_event_loop_add(struct gpiod_event_loop *loop,
+			 struct gpiod_line_bulk *bulk,
+			 gpiod_event_loop_cb cb, void *data);
+
+/**
+ * @brief Stop watching a set of lines.
+ * @param loop Event loop object.
+ * @param bulk Set of lines previously registered with this loop.
+ * @return 0 on success, -1 on error.
+ * @note This function must not be called from within a callback.
+ */
+int gpiod_event_loop_remove(struct gpiod_event_loop *loop,
+			    struct gpiod_line_bulk *bulk);
+
+/**
+ * @brief Get the file descriptor of the event loop.
+ * @param loop Event loop object.
+ * @return Descriptor that becomes readable whenever any of the watched lines
+ *         has pending events.
+ *
+ * This allows to embed the event loop in a foreign one: poll the returned
+ * descriptor and call ::gpiod_event_loop_dispatch with a zero timeout when it
+ * becomes readable.
+ */
+int gpiod_event_loop_get_fd(struct gpiod_event_loop *loop);
+
+/**
+ * @brief Wait for events and dispatch them to the registered callbacks.
+ * @param loop Event loop object.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @return GPIOD_EVENT_LOOP_TIMEOUT, GPIOD_EVENT_LOOP_DISPATCHED or
+ *         GPIOD_EVENT_LOOP_STOPPED on success, -1 if an error occurred.
+ */
+int gpiod_event_loop_dispatch(struct gpiod_event_loop *loop,
+			      const struct timespec *timeout);
+
+/**
+ * @}
+ *
+ * @defgroup event_reader Batched event reader
+ * @{
+ *
+ * An event reader collects events from the event file descriptors of any
+ * number of line requests. If libgpiod was built with io_uring support and
+ * the running kernel allows it, a read is kept outstanding on every watched
+ * descriptor and completions are harvested in batches so that the cost of
+ * collecting events doesn't grow with the number of descriptors. Otherwise
+ * the reader falls back to poll() and read().
+ *
+ * Line event descriptors don't support non-blocking reads in the io_uring
+ * sense (FMODE_NOWAIT) but they can be polled. Recent kernels wait for such
+ * descriptors to become readable before issuing the read so no kernel worker
+ * threads are involved. Older kernels hand every outstanding read to an io-wq
+ * worker thread which then sleeps in read() - one thread per watched
+ * descriptor.
+ */
+
+struct gpiod_event_reader;
+
+/**
+ * @brief Mechanisms an event reader can use to collect events.
+ */
+enum {
+	GPIOD_EVENT_READER_BACKEND_READ = 1,
+	/**< Descriptors are polled and then read one by one. */
+	GPIOD_EVENT_READER_BACKEND_IO_URING,
+	/**< Reads are queued and completed through io_uring. */
+};
+
+/**
+ * @brief Create a new event reader.
+ * @return New event reader object or NULL on error.
+ *
+ * The backend is chosen at creation time: io_uring is used if available,
+ * failing to set it up is not an error.
+ */
+struct gpiod_event_reader *gpiod_event_reader_new(void);
+
+/**
+ * @brief Release all resources allocated for this event reader.
+ * @param reader Event reader object to free.
+ *
+ * Lines watched by the reader are not released but they must not be
+ * released before the reader is freed either.
+ */
+void gpiod_event_reader_free(struct gpiod_event_reader *reader);
+
+/**
+ * @brief Start watching a set of lines.
+ * @param reader Event reader object.
+ * @param bulk Set of lines requested for events.
+ * @return 0 on success, -1 on error.
+ *
+ * With the io_uring backend, lines requested with
+ * GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK are rejected with errno set to
+ * EINVAL.
+ */
+int gpiod_event_reader_add(struct gpiod_event_reader *reader,
+			   struct gpiod_line_bulk *bulk);
+
+/**
+ * @brief Get the backend used by this event reader.
+ * @param reader Event reader object.
+ * @return GPIOD_EVENT_READER_BACKEND_IO_URING or
+ *         GPIOD_EVENT_READER_BACKEND_READ.
+ */
+int gpiod_event_reader_backend(struct gpiod_event_reader *reader);
+
+/**
+ * @brief Wait for events on any of the watched lines and read them.
+ * @param reader Event reader object.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return Number of events stored in the buffer, 0 if the wait timed out or
+ *         -1 if an error occurred.
+ */
+int gpiod_event_reader_read(struct gpiod_event_reader *reader,
+			    const struct timespec *timeout,
+			    struct gpiod_line_event_ext *events,
+			    unsigned int num_events);
+
+/**
+ * @}
+ *
+ * @defgroup event_merger Chronologically merged events
+ * @{
+ *
+ * Events read in bulk are grouped by the file descriptor they came from so
+ * when several requests - possibly on different chips - see activity at the
+ * same time, the resulting stream is not ordered by timestamp. An event merger
+ * reads events from any number of requests and returns them sorted by their
+ * timestamp and sequence number.
+ *
+ * To that end each event is held back for up to the duration of the reorder
+ * window, waiting for earlier events that may still be on their way from
+ * other requests. An event is released early if every watched request already
+ * has a later event pending, as nothing earlier can arrive anymore. The
+ * number of held-back events is limited: when the limit is reached, the oldest
+ * events are released regardless of the window.
+ */
+
+struct gpiod_event_merger;
+
+/**
+ * @brief Create a new event merger.
+ * @param window Maximum time an event is held back while waiting for earlier
+ *               events from other requests. NULL means no delay - events
+ *               read in a single wake-up are still returned in order.
+ * @return New event merger object or NULL on error.
+ */
+struct gpiod_event_merger *
+gpiod_event_merger_new(const struct timespec *window);
+
+/**
+ * @brief Release all resources allocated for this event merger.
+ * @param merger Event merger object to free.
+ *
+ * Lines watched by the merger are not released but they must not be released
+ * before the merger is freed either. Events still held back are lost.
+ */
+void gpiod_event_merger_free(struct gpiod_event_merger *merger);
+
+/**
+ * @brief Start watching a set of lines.
+ * @param merger Event merger object.
+ * @param bulk Set of lines requested for events.
+ * @return 0 on success, -1 on error.
+ */
+int gpiod_event_merger_add(struct gpiod_event_merger *merger,
+			   struct gpiod_line_bulk *bulk);
+
+/**
+ * @brief Read events from all watched lines in chronological order.
+ * @param merger Event merger object.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return Number of events stored in the buffer, 0 if the wait timed out or
+ *         -1 if an error occurred.
+ */
+int gpiod_event_merger_read(struct gpiod_event_merger *merger,
+			    const struct timespec *timeout,
+			    struct gpiod_line_event_ext *events,
+			    unsigned int num_events);
+
 /**
  * @}
  *
+ * @defgroup event_buffer Buffered events
+ * @{
+ *
+ * The kernel keeps only a small number of events per request. If the consumer
+ * doesn't read them in time - because it's busy, descheduled or waiting for
+ * a garbage collector - newer events are lost. An event buffer starts a
+ * library thread that drains the event file descriptors of the watched
+ * requests as soon as events arrive and stores them in a large lock-free ring
+ * from which the application reads at its own pace.
+ */
+
+struct gpiod_event_buffer;
+
+/**
+ * @brief What to do when the ring of an event buffer is full.
+ */
+enum {
+	GPIOD_EVENT_BUFFER_DROP_OLDEST = 1,
+	/**< Discard the oldest buffered event to make room for the new one. */
+	GPIOD_EVENT_BUFFER_DROP_NEWEST,
+	/**< Discard the new event. */
+	GPIOD_EVENT_BUFFER_BLOCK,
+	/**< Stop draining the kernel until the consumer makes room. */
+};
+
+/**
+ * @brief Event buffer statistics.
+ */
+struct gpiod_event_buffer_stats {
+	unsigned long capacity;
+	/**< Number of events the ring can hold. */
+	unsigned long num_pending;
+	/**< Number of events currently waiting to be read. */
+	unsigned long high_watermark;
+	/**< Highest number of events that were ever waiting to be read. */
+	unsigned long long num_buffered;
+	/**< Total number of events stored in the ring. */
+	unsigned long long num_dropped;
+	/**< Total number of events discarded because the ring was full. */
+};
+
+/**
+ * @brief Create a new event buffer.
+ * @param size Minimum number of events the ring must be able to hold. The
+ *             actual capacity is rounded up to a power of two.
+ * @param policy What to do when the ring is full.
+ * @return New event buffer object or NULL on error.
+ */
+struct gpiod_event_buffer *gpiod_event_buffer_new(unsigned int size,
+						  int policy);
+
+/**
+ * @brief Stop the drain thread and release all resources allocated for this
+ *        event buffer.
+ * @param buf Event buffer object to free.
+ *
+ * Lines watched by the buffer are not released but they must not be released
+ * before the buffer is freed either.
+ */
+void gpiod_event_buffer_free(struct gpiod_event_buffer *buf);
+
+/**
+ * @brief Add a set of lines to drain.
+ * @param buf Event buffer object.
+ * @param bulk Set of lines requested for events.
+ * @return 0 on success, -1 on error. Lines can't be added while the drain
+ *         thread is running - errno is set to EBUSY in that case.
+ */
+int gpiod_event_buffer_add(struct gpiod_event_buffer *buf,
+			   struct gpiod_line_bulk *bulk);
+
+/**
+ * @brief Start the drain thread.
+ * @param buf Event buffer object.
+ * @return 0 on success, -1 on error.
+ */
+int gpiod_event_buffer_start(struct gpiod_event_buffer *buf);
+
+/**
+ * @brief Stop the drain thread.
+ * @param buf Event buffer object.
+ *
+ * Events already in the ring can still be read.
+ */
+void gpiod_event_buffer_stop(struct gpiod_event_buffer *buf);
+
+/**
+ * @brief Get the notification file descriptor of the event buffer.
+ * @param buf Event buffer object.
+ * @return File descriptor which becomes readable when new events have been
+ *         stored in the ring.
+ *
+ * The descriptor is meant to be polled, not read from. Read the events with
+ * ::gpiod_event_buffer_read.
+ */
+int gpiod_event_buffer_get_fd(struct gpiod_event_buffer *buf);
+
+/**
+ * @brief Read events from the ring.
+ * @param buf Event buffer object.
+ * @param timeout Wait time limit if the ring is empty. NULL means wait
+ *                forever.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return Number of events stored in the buffer, 0 if the wait timed out or
+ *         -1 if an error occurred. If the drain thread failed, its error is
+ *         reported once the ring has been emptied.
+ * @note Only one thread at a time may read from an event buffer.
+ */
+int gpiod_event_buffer_read(struct gpiod_event_buffer *buf,
+			    const struct timespec *timeout,
+			    struct gpiod_line_event_ext *events,
+			    unsigned int num_events);
+
+/**
+ * @brief Get the statistics of the event buffer.
+ * @param buf Event buffer object.
+ * @param stats Structure in which to store the statistics.
+ */
+void gpiod_event_buffer_get_stats(struct gpiod_event_buffer *buf,
+				  struct gpiod_event_buffer_stats *stats);
+
+/**
+ * @}
+ *
+ * @defgroup event_shm Sharing events with other processes
+ * @{
+ *
+ * Only the process that requested a line can read its events. An event
+ * publisher writes the events of its requests into a ring buffer in POSIX
+ * shared memory (visible under /dev/shm) from which any number of local
+ * subscriber processes can read them. Subscribers map the ring read-only,
+ * keep their own read position and sleep on a futex stored in the shared
+ * mapping while there's nothing to read.
+ *
+ * The publisher never waits for subscribers: a subscriber that falls behind
+ * by more than the size of the ring loses the oldest events. The number of
+ * events lost is tracked for each subscriber.
+ */
+
+struct gpiod_event_publisher;
+struct gpiod_event_subscriber;
+
+/**
+ * @brief Create a new event publisher.
+ * @param chip GPIO chip whose lines will be published.
+ * @param name Name of the shared memory object. Must not contain slashes.
+ * @param size Minimum number of events the ring must be able to hold. The
+ *             actual capacity is rounded up to a power of two.
+ * @return New event publisher object or NULL on error. If a shared memory
+ *         object with this name already exists, errno is set to EEXIST.
+ */
+struct gpiod_event_publisher *
+gpiod_event_publisher_new(struct gpiod_chip *chip, const char *name,
+			  unsigned int size);
+
+/**
+ * @brief Remove the shared memory object and free the publisher.
+ * @param pub Event publisher object to free.
+ *
+ * Subscribers that are already attached can still read what was published
+ * but no new ones can attach.
+ */
+void gpiod_event_publisher_free(struct gpiod_event_publisher *pub);
+
+/**
+ * @brief Start publishing events of a set of lines.
+ * @param pub Event publisher object.
+ * @param bulk Set of lines requested for events.
+ * @return 0 on success, -1 on error.
+ *
+ * Subscribers only see line offsets so all lines published through a single
+ * publisher must belong to the chip it was created for.
+ */
+int gpiod_event_publisher_add(struct gpiod_event_publisher *pub,
+			      struct gpiod_line_bulk *bulk);
+
+/**
+ * @brief Get the file descriptor the publisher needs to be woken up on.
+ * @param pub Event publisher object.
+ * @return File descriptor which becomes readable when any of the published
+ *         lines has pending events.
+ */
+int gpiod_event_publisher_get_fd(struct gpiod_event_publisher *pub);
+
+/**
+ * @brief Wait for events on the published lines and publish them.
+ * @param pub Event publisher object.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @return Number of events published, 0 if the wait timed out or -1 if an
+ *         error occurred.
+ */
+int gpiod_event_publisher_dispatch(struct gpiod_event_publisher *pub,
+				   const struct timespec *timeout);
+
+/**
+ * @brief Publish events read by other means.
+ * @param pub Event publisher object.
+ * @param events Events to publish.
+ * @param num_events Number of events to publish.
+ * @return 0 on success, -1 on error.
+ */
+int gpiod_event_publisher_publish(struct gpiod_event_publisher *pub,
+				  const struct gpiod_line_event_ext *events,
+				  unsigned int num_events);
+
+/**
+ * @brief Attach to an event publisher.
+ * @param name Name the publisher was created with.
+ * @return New event subscriber object or NULL on error.
+ *
+ * The subscriber receives the events published after it attached.
+ */
+struct gpiod_event_subscriber *gpiod_event_subscriber_open(const char *name);
+
+/**
+ * @brief Detach from the publisher and free the subscriber.
+ * @param sub Event subscriber object.
+ */
+void gpiod_event_subscriber_close(struct gpiod_event_subscriber *sub);
+
+/**
+ * @brief Get the name of the chip whose events are published.
+ * @param sub Event subscriber object.
+ * @return Name of the chip the publisher was created for.
+ */
+const char *
+gpiod_event_subscriber_chip_name(struct gpiod_event_subscriber *sub);
+
+/**
+ * @brief Read published events.
+ * @param sub Event subscriber object.
+ * @param timeout Wait time limit. NULL means wait forever.
+ * @param events Buffer to which the event data will be copied. Must hold at
+ *               least the amount of events specified in num_events.
+ * @param num_events Specifies how many events can be stored in the buffer.
+ * @return Number of events stored in the buffer, 0 if the wait timed out or
+ *         -1 if an error occurred.
+ */
+int gpiod_event_subscriber_read(struct gpiod_event_subscriber *sub,
+				const struct timespec *timeout,
+				struct gpiod_line_event_ext *events,
+				unsigned int num_events);
+
+/**
+ * @brief Get the number of events this subscriber missed.
+ * @param sub Event subscriber object.
+ * @return Number of events overwritten by the publisher before this
+ *         subscriber could read them.
+ */
+unsigned long long
+gpiod_event_subscriber_num_lost(struct gpiod_event_subscriber *sub);
+
+/**
+ * @}
+ *
+ * @defgroup value_snapshot Value snapshots
+ * @{
+ *
+ * When many threads need the values of the same lines, each of them calling
+ * ::gpiod_line_get_value_bulk results in a separate system call. A value
+ * snapshot has a library thread keep the latest values of up to 64 lines in
+ * a bitmap - either by sampling them periodically or by tracking edge events
+ * - and publishes it with a sequence lock. Readers never make a system call
+ * or take a lock, they only retry if they raced with an update.
+ *
+ * If given a name, the snapshot is placed in POSIX shared memory and other
+ * processes can attach to it read-only with ::gpiod_value_snapshot_open.
+ */
+
+struct gpiod_value_snapshot;
+
+/**
+ * @brief How a value snapshot is kept up to date.
+ */
+enum {
+	GPIOD_VALUE_SNAPSHOT_PERIODIC = 1,
+	/**< Read the values from the kernel at a fixed interval. */
+	GPIOD_VALUE_SNAPSHOT_ON_EVENTS,
+	/**< Derive the values from edge events. Lines must be requested for
+	 *   both edges. The values are read from the kernel again if events
+	 *   were lost. */
+};
+
+/**
+ * @brief Contents of a value snapshot.
+ */
+struct gpiod_value_snapshot_data {
+	unsigned long long bits;
+	/**< Bitmap of line values, bit N holding the value of line N. */
+	struct timespec ts;
+	/**< Time of the update on the CLOCK_MONOTONIC clock. */
+	unsigned long long generation;
+	/**< Number of updates so far. */
+	unsigned int num_lines;
+	/**< Number of lines in the snapshot. */
+};
+
+/**
+ * @brief Start publishing snapshots of line values.
+ * @param bulk Set of up to 64 requested lines. Line N of the bulk is mapped
+ *             to bit N of the bitmap.
+ * @param mode GPIOD_VALUE_SNAPSHOT_PERIODIC or GPIOD_VALUE_SNAPSHOT_ON_EVENTS.
+ * @param period Sampling interval. Only used in the periodic mode.
+ * @param shm_name If not NULL, name of the shared memory object in which to
+ *                 publish the snapshot. Must not contain slashes.
+ * @return New value snapshot object or NULL on error.
+ *
+ * The lines must not be released before the snapshot is freed.
+ */
+struct gpiod_value_snapshot *
+gpiod_value_snapshot_new(struct gpiod_line_bulk *bulk, int mode,
+			 const struct timespec *period, const char *shm_name);
+
+/**
+ * @brief Attach to a value snapshot published by another process.
+ * @param shm_name Name the snapshot was created with.
+ * @return New read-only value snapshot object or NULL on error.
+ */
+struct gpiod_value_snapshot *gpiod_value_snapshot_open(const char *shm_name);
+
+/**
+ * @brief Stop updating the snapshot, if this object owns it, and free it.
+ * @param snap Value snapshot object.
+ */
+void gpiod_value_snapshot_free(struct gpiod_value_snapshot *snap);
+
+/**
+ * @brief Read the latest snapshot.
+ * @param snap Value snapshot object.
+ * @param data Structure in which to store a consistent copy of the snapshot.
+ * @return 0 on success, -1 on error.
+ * @note This function is safe to call from any number of threads at once.
+ *
+ * If an update stays in progress for more than 10 milliseconds, the call
+ * fails with errno set to EAGAIN. This usually means that the process that
+ * publishes the snapshot died in the middle of an update.
+ */
+int gpiod_value_snapshot_read(struct gpiod_value_snapshot *snap,
+			      struct gpiod_value_snapshot_data *data);
+
+/**
+ * @brief Get the offset of the line mapped to given bit of the snapshot.
+ * @param snap Value snapshot object.
+ * @param index Bit index.
+ * @return Line offset or -1 if the index is out of range.
+ */
+int gpiod_value_snapshot_offset(struct gpiod_value_snapshot *snap,
+				unsigned int index);
+
+/**
+ * @brief Get the name of the chip the snapshot lines belong to.
+ * @param snap Value snapshot object.
+ * @return Chip name.
+ */
+const char *gpiod_value_snapshot_chip_name(struct gpiod_value_snapshot *snap);
+
+/**
+ * @}
+ *
+ * @defgroup event_thread Real-time event thread
+ * @{
+ *
+ * Consumers that care about the latency of event handling want the event
+ * dispatch to run on a dedicated core, with a real-time priority, without
+ * page faults and without memory allocations. An event thread is an event
+ * loop driven by a library thread set up this way. Callbacks are invoked from
+ * that thread.
+ *
+ * None of the real-time settings are mandatory: if the process lacks the
+ * privileges (or the system the resources) for any of them, the thread is
+ * started without it. The settings that were actually applied can be checked
+ * with ::gpiod_event_thread_rt_status.
+ *
+ * For every event the thread records the delay between the kernel timestamp
+ * and the moment it is about to be handed to the callback. This relies on
+ * the events being timestamped with the default CLOCK_MONOTONIC clock.
+ */
+
+struct gpiod_event_thread;
+
+/**
+ * @brief Event thread flags.
+ */
+enum {
+	GPIOD_EVENT_THREAD_FLAG_LOCK_MEMORY = GPIOD_BIT(0),
+	/**< Lock all current and future memory of the process in RAM. If
+	 *   the thread's stack then doesn't fit in the locked memory limit,
+	 *   the lock is dropped again unless the process had already locked
+	 *   some memory itself, in which case the thread fails to start. */
+};
+
+/**
+ * @brief Real-time settings applied to a running event thread.
+ */
+enum {
+	GPIOD_EVENT_THREAD_RT_AFFINITY = GPIOD_BIT(0),
+	/**< The thread is pinned to the requested CPU. */
+	GPIOD_EVENT_THREAD_RT_PRIORITY = GPIOD_BIT(1),
+	/**< The thread runs with the SCHED_FIFO policy. */
+	GPIOD_EVENT_THREAD_RT_MEMLOCK = GPIOD_BIT(2),
+	/**< The memory of the process is locked. */
+};
+
+/**
+ * @brief Number of buckets of the latency histogram.
+ */
+#define GPIOD_EVENT_THREAD_NUM_BUCKETS		16
+
+/**
+ * @brief Event thread statistics.
+ */
+struct gpiod_event_thread_stats {
+	unsigned long long num_wakeups;
+	/**< Number of times the thread woke up to dispatch events. */
+	unsigned long long num_events;
+	/**< Number of events handed to the callbacks. */
+	unsigned long long latency_min_ns;
+	/**< Lowest event latency seen. */
+	unsigned long long latency_max_ns;
+	/**< Highest event latency seen. */
+	unsigned long long latency_avg_ns;
+	/**< Average event latency. */
+	unsigned long long hist[GPIOD_EVENT_THREAD_NUM_BUCKETS];
+	/**< Latency histogram. Bucket 0 counts events handled within 1
+	 *   microsecond, bucket N > 0 those handled within 2^N but no sooner
+	 *   than 2^(N-1) microseconds. The last bucket also counts all slower
+	 *   events. */
+};
+
+/**
+ * @brief Create a new event thread.
+ * @param cpu CPU to pin the thread to or -1 to let it run anywhere.
+ * @param priority SCHED_FIFO priority of the thread or 0 to keep the default
+ *                 scheduling policy.
+ * @param flags Additional settings - see GPIOD_EVENT_THREAD_FLAG_*.
+ * @return New event thread object or NULL on error.
+ */
+struct gpiod_event_thread *gpiod_event_thread_new(int cpu, int priority,
+						  int flags);
+
+/**
+ * @brief Stop the thread and release all resources allocated for it.
+ * @param thread Event thread object to free.
+ */
+void gpiod_event_thread_free(struct gpiod_event_thread *thread);
+
+/**
+ * @brief Add a set of lines to the thread.
+ * @param thread Event thread object.
+ * @param bulk Set of lines requested for events.
+ * @param cb Callback to invoke from the thread with the events of this set.
+ *           If it returns GPIOD_EVENT_LOOP_CB_STOP, the thread exits.
+ * @param data User data passed to the callback.
+ * @return 0 on success, -1 on error. Lines can't be added while the thread is
+ *         running - errno is set to EBUSY in that case.
+ */
+int gpiod_event_thread_add(struct gpiod_event_thread *thread,
+			   struct gpiod_line_bulk *bulk,
+			   gpiod_event_loop_cb cb, void *data);
+
+/**
+ * @brief Start the thread.
+ * @param thread Event thread object.
+ * @return 0 on success, -1 on error. Failing to apply any of the real-time
+ *         settings is not an error.
+ * @note Locking memory affects the whole process and is not undone when the
+ *       thread is stopped. It is undone right away if the thread's stack
+ *       can't be locked.
+ */
+int gpiod_event_thread_start(struct gpiod_event_thread *thread);
+
+/**
+ * @brief Stop the thread.
+ * @param thread Event thread object.
+ * @return 0 on success, -1 if the thread had exited due to an error, in
+ *         which case errno is set to the error that made it exit.
+ */
+int gpiod_event_thread_stop(struct gpiod_event_thread *thread);
+
+/**
+ * @brief Check which real-time settings have been applied.
+ * @param thread Event thread object.
+ * @return Bitmask of GPIOD_EVENT_THREAD_RT_* values. Always 0 if the thread
+ *         has never been started.
+ */
+int gpiod_event_thread_rt_status(struct gpiod_event_thread *thread);
+
+/**
+ * @brief Get the statistics of the event thread.
+ * @param thread Event thread object.
+ * @param stats Structure in which to store the statistics.
+ * @note This function is safe to call while the thread is running.
+ */
+void gpiod_event_thread_get_stats(struct gpiod_event_thread *thread,
+				  struct gpiod_event_thread_stats *stats);
+
+/**
+ * @}
+ *
+ * @defgroup output_sequencer Output sequencer
+ * @{
+ *
+ * An output sequencer plays a table of timed value changes on a set of lines
+ * requested as outputs. Every step is scheduled at an absolute point in time
+ * (the start of the sequence plus the step's time) so that the sleep jitter
+ * doesn't accumulate over the course of the sequence. The steps are executed
+ * from a dedicated thread with a single system call each.
+ *
+ * A sequence may be looped: the n-th iteration starts at the start time plus
+ * n times the period of the sequence.
+ *
+ * If the thread wakes up too late for a step, the step is executed as soon as
+ * possible and the subsequent steps keep their original schedule. A step is
+ * counted as late if, by the time it was executed, the next step was already
+ * due.
+ */
+
+struct gpiod_output_sequencer;
+
+/**
+ * @brief Single step of an output sequence.
+ */
+struct gpiod_output_step {
+	struct timespec time;
+	/**< Time of the step relative to the start of the iteration. */
+	unsigned long long mask;
+	/**< Bit N selects line N of the bulk for modification. */
+	unsigned long long bits;
+	/**< Bit N holds the new value of line N of the bulk. */
+};
+
+/**
+ * @brief Output sequencer statistics.
+ */
+struct gpiod_output_sequencer_stats {
+	unsigned long long num_steps;
+	/**< Number of steps executed. */
+	unsigned long long num_late;
+	/**< Number of steps executed after the next step was due. */
+	unsigned long long num_iterations;
+	/**< Number of iterations completed. */
+	unsigned long long lateness_max_ns;
+	/**< Highest delay between the scheduled and actual time of a step. */
+	unsigned long long lateness_avg_ns;
+	/**< Average delay between the scheduled and actual time of a step. */
+};
+
+/**
+ * @brief Create a new output sequencer.
+ * @param bulk Set of lines requested together as outputs. At most 64 lines
+ *             are supported.
+ * @param steps Table of steps sorted by time. It's copied by the sequencer.
+ * @param num_steps Number of steps in the table.
+ * @param period Length of a single iteration or NULL if the sequence is
+ *               never looped. Must be greater than the time of the last step.
+ * @return New output sequencer object or NULL on error.
+ */
+struct gpiod_output_sequencer *
+gpiod_output_sequencer_new(struct gpiod_line_bulk *bulk,
+			   const struct gpiod_output_step *steps,
+			   unsigned int num_steps,
+			   const struct timespec *period);
+
+/**
+ * @brief Stop the sequencer and release all resources allocated for it.
+ * @param seq Output sequencer object to free.
+ */
+void gpiod_output_sequencer_free(struct gpiod_output_sequencer *seq);
+
+/**
+ * @brief Start playing the sequence.
+ * @param seq Output sequencer object.
+ * @param start Absolute CLOCK_MONOTONIC time of the start of the sequence or
+ *              NULL to start right away.
+ * @param num_iterations Number of times to play the sequence or 0 to loop
+ *                       until stopped. Values other than 1 require the
+ *                       sequencer to have been created with a period.
+ * @return 0 on success, -1 on error. If the sequencer is already running,
+ *         errno is set to EBUSY.
+ *
+ * The statistics are reset every time the sequencer is started.
+ */
+int gpiod_output_sequencer_start(struct gpiod_output_sequencer *seq,
+				 const struct timespec *start,
+				 unsigned int num_iterations);
+
+/**
+ * @brief Wait for the sequencer to finish playing.
+ * @param seq Output sequencer object.
+ * @param timeout Wait time limit or NULL to wait indefinitely.
+ * @return 1 if the sequencer has finished (or was never started), 0 if the
+ *         timeout expired and -1 on error.
+ *
+ * The sequencer finishes once all iterations have been played or if setting
+ * the line values failed. Call ::gpiod_output_sequencer_stop afterwards to
+ * retrieve the error status.
+ */
+int gpiod_output_sequencer_wait(struct gpiod_output_sequencer *seq,
+				const struct timespec *timeout);
+
+/**
+ * @brief Get the file descriptor which becomes readable when the sequencer
+ *        finishes playing.
+ * @param seq Output sequencer object.
+ * @return File descriptor to poll. It must not be read or closed.
+ *
+ * This allows to wait for the sequencer along with other descriptors. The
+ * descriptor is reset every time the sequencer is started.
+ */
+int gpiod_output_sequencer_get_fd(struct gpiod_output_sequencer *seq);
+
+/**
+ * @brief Stop the sequencer.
+ * @param seq Output sequencer object.
+ * @return 0 on success, -1 if the thread had exited due to an error, in
+ *         which case errno is set to the error that made it exit.
+ *
+ * The lines keep the values set by the last executed step.
+ */
+int gpiod_output_sequencer_stop(struct gpiod_output_sequencer *seq);
+
+/**
+ * @brief Get the statistics of the sequencer.
+ * @param seq Output sequencer object.
+ * @param stats Structure in which to store the statistics.
+ * @note This function is safe to call while the sequencer is running.
+ */
+void
+gpiod_output_sequencer_get_stats(struct gpiod_output_sequencer *seq,
+				 struct gpiod_output_sequencer_stats *stats);
+
+/**
+ * @}
+ *
+ * @defgroup soft_pwm Software PWM
+ * @{
+ *
+ * A software PWM generates duty cycles on a set of lines requested together
+ * as outputs, each line being a separate channel. All channels share the
+ * same period and are driven from a single timer thread: the channels with
+ * a non-zero duty cycle are switched on together at the start of every
+ * period and all channels switching off at the same tick are switched off
+ * with a single system call. The edges are scheduled at absolute times so
+ * that the jitter of one period doesn't carry over to the next one.
+ *
+ * Duty cycles can be updated from any thread at any time without locking.
+ * New values take effect at the start of the next period, so a period is
+ * never cut short or stretched.
+ */
+
+struct gpiod_soft_pwm;
+
+/**
+ * @brief Duty cycle value corresponding to a line that's always on.
+ */
+#define GPIOD_SOFT_PWM_DUTY_MAX		1000000
+
+/**
+ * @brief Software PWM statistics.
+ */
+struct gpiod_soft_pwm_stats {
+	unsigned long long num_periods;
+	/**< Number of periods generated. */
+	unsigned long long num_overruns;
+	/**< Number of periods skipped because the thread fell behind. */
+	unsigned long long num_writes;
+	/**< Number of value writes passed to the kernel. */
+	unsigned long long jitter_max_ns;
+	/**< Highest delay between the scheduled and actual time of an edge. */
+	unsigned long long jitter_avg_ns;
+	/**< Average delay between the scheduled and actual time of an edge. */
+};
+
+/**
+ * @brief Create a new software PWM.
+ * @param bulk Set of lines requested together as outputs. Line N of the bulk
+ *             is driven as channel N. At most 64 lines are supported.
+ * @param period Period shared by all channels.
+ * @param resolution Granularity of the edges within the period or NULL to
+ *                   use a thousandth of the period. The edges of channels
+ *                   falling into the same tick are merged.
+ * @return New software PWM object or NULL on error.
+ *
+ * All duty cycles are initially 0.
+ */
+struct gpiod_soft_pwm *gpiod_soft_pwm_new(struct gpiod_line_bulk *bulk,
+					  const struct timespec *period,
+					  const struct timespec *resolution);
+
+/**
+ * @brief Stop the PWM and release all resources allocated for it.
+ * @param pwm Software PWM object to free.
+ */
+void gpiod_soft_pwm_free(struct gpiod_soft_pwm *pwm);
+
+/**
+ * @brief Set the duty cycle of a channel.
+ * @param pwm Software PWM object.
+ * @param channel Index of the line in the bulk the PWM was created for.
+ * @param duty Duty cycle in the range from 0 (always off) to
+ *             GPIOD_SOFT_PWM_DUTY_MAX (always on).
+ * @return 0 on success, -1 if any of the arguments is out of range.
+ * @note This function is safe to call from any thread while the PWM is
+ *       running.
+ */
+int gpiod_soft_pwm_set_duty(struct gpiod_soft_pwm *pwm, unsigned int channel,
+			    unsigned int duty);
+
+/**
+ * @brief Get the duty cycle of a channel.
+ * @param pwm Software PWM object.
+ * @param channel Index of the line in the bulk the PWM was created for.
+ * @return Last duty cycle set for the channel, 0 if the channel is out of
+ *         range.
+ */
+unsigned int gpiod_soft_pwm_get_duty(struct gpiod_soft_pwm *pwm,
+				     unsigned int channel);
+
+/**
+ * @brief Start generating the duty cycles.
+ * @param pwm Software PWM object.
+ * @return 0 on success, -1 on error. If the PWM is already running, errno is
+ *         set to EBUSY.
+ *
+ * The statistics are reset every time the PWM is started.
+ */
+int gpiod_soft_pwm_start(struct gpiod_soft_pwm *pwm);
+
+/**
+ * @brief Stop generating the duty cycles.
+ * @param pwm Software PWM object.
+ * @return 0 on success, -1 if the thread had exited due to an error, in
+ *         which case errno is set to the error that made it exit.
+ *
+ * All channels are left inactive.
+ */
+int gpiod_soft_pwm_stop(struct gpiod_soft_pwm *pwm);
+
+/**
+ * @brief Get the statistics of the PWM.
+ * @param pwm Software PWM object.
+ * @param stats Structure in which to store the statistics.
+ * @note This function is safe to call while the PWM is running.
+ */
+void gpiod_soft_pwm_get_stats(struct gpiod_soft_pwm *pwm,
+			      struct gpiod_soft_pwm_stats *stats);
+
+/**
+ * @}
+ *
+ * @defgroup bitbang Bit-banging serial protocols
+ * @{
+ *
+ * The bit-bang engine clocks SPI-style synchronous serial transfers through
+ * GPIO lines: a clock line and an optional data output line belonging to a
+ * request of output lines, plus an optional data input line belonging to
+ * a request of input lines. The kernel representation of every combination
+ * of the clock and data output levels is prepared when the engine is created
+ * so that each bit costs two system calls setting the outputs and - if data
+ * is received - one reading the input.
+ *
+ * The transfers are executed synchronously by the calling thread. If a clock
+ * period is configured, the engine busy-waits between the clock edges.
+ */
+
+struct gpiod_bitbang;
+
+/**
+ * @brief Bit-bang engine flags.
+ */
+enum {
+	GPIOD_BITBANG_FLAG_CPOL = GPIOD_BIT(0),
+	/**< The clock is high when idle. */
+	GPIOD_BITBANG_FLAG_CPHA = GPIOD_BIT(1),
+	/**< Data is sampled on the trailing clock edge instead of the leading
+	 *   one. */
+	GPIOD_BITBANG_FLAG_LSB_FIRST = GPIOD_BIT(2),
+	/**< Shift the least significant bit of every byte first. */
+};
+
+/**
+ * @brief Bit-bang engine configuration.
+ */
+struct gpiod_bitbang_config {
+	unsigned int clock;
+	/**< Index of the clock line in the set of output lines. */
+	int data_out;
+	/**< Index of the data output line in the set of output lines or -1 if
+	 *   the engine only receives data. */
+	int data_in;
+	/**< Index of the data input line in the set of input lines or -1 if
+	 *   the engine only sends data. */
+	struct timespec half_period;
+	/**< Minimum time between two clock edges. Zero means as fast as
+	 *   possible. */
+	int flags;
+	/**< Additional settings - see GPIOD_BITBANG_FLAG_*. */
+};
+
+/**
+ * @brief Bit-bang engine statistics.
+ */
+struct gpiod_bitbang_stats {
+	unsigned long long num_bits;
+	/**< Number of bits transferred. */
+	unsigned long long last_bit_rate;
+	/**< Bit rate achieved by the last transfer in bits per second. */
+	unsigned long long avg_bit_rate;
+	/**< Bit rate achieved by all transfers in bits per second. */
+};
+
+/**
+ * @brief Create a new bit-bang engine.
+ * @param outputs Set of lines requested together as outputs holding the clock
+ *                and data output lines.
+ * @param inputs Set of lines requested together as inputs holding the data
+ *               input line. May be NULL if the engine only sends data.
+ * @param config Engine configuration.
+ * @return New bit-bang engine object or NULL on error. If the lines of either
+ *         set weren't requested together, errno is set to EINVAL.
+ *
+ * The clock line is driven to its idle level right away. The lines must stay
+ * requested for as long as the engine is used.
+ */
+struct gpiod_bitbang *
+gpiod_bitbang_new(struct gpiod_line_bulk *outputs,
+		  struct gpiod_line_bulk *inputs,
+		  const struct gpiod_bitbang_config *config);
+
+/**
+ * @brief Release all resources allocated for a bit-bang engine.
+ * @param bb Bit-bang engine object to free.
+ */
+void gpiod_bitbang_free(struct gpiod_bitbang *bb);
+
+/**
+ * @brief Perform a full-duplex transfer.
+ * @param bb Bit-bang engine object.
+ * @param tx Bytes to send or NULL to keep the data output low.
+ * @param rx Buffer for the received bytes or NULL to not sample the input.
+ * @param len Number of bytes to transfer.
+ * @return 0 on success, -1 on error.
+ *
+ * The clock is left idle once the transfer completes. If an error occurs in
+ * the middle of a transfer, the line levels are undefined.
+ */
+int gpiod_bitbang_transfer(struct gpiod_bitbang *bb, const unsigned char *tx,
+			   unsigned char *rx, size_t len);
+
+/**
+ * @brief Get the statistics of the bit-bang engine.
+ * @param bb Bit-bang engine object.
+ * @param stats Structure in which to store the statistics.
+ */
+void gpiod_bitbang_get_stats(struct gpiod_bitbang *bb,
+			     struct gpiod_bitbang_stats *stats);
+
+/**
+ * @}
+ *
+ * @defgroup quadrature Quadrature encoders
+ * @{
+ *
+ * A quadrature encoder object decodes the position of a rotary or linear
+ * encoder from the edges on its A and B lines, optionally counting the pulses
+ * on its index (Z) line. Every edge is counted (x4 decoding).
+ *
+ * The events are read from the kernel in batches and decoded straight from
+ * their kernel representation. Edges dropped by the kernel are detected from
+ * gaps in the per-line sequence numbers and reported as missed; the decoder
+ * then resynchronizes with the current levels. Transitions of both A and B
+ * at once can't be decoded and are reported as invalid.
+ *
+ * The events are decoded by the thread calling
+ * ::gpiod_quadrature_encoder_read while the current state can be retrieved
+ * from any thread at any time with ::gpiod_quadrature_encoder_snapshot
+ * without locking.
+ */
+
+struct gpiod_quadrature_encoder;
+
+/**
+ * @brief State of a quadrature encoder.
+ */
+struct gpiod_quadrature_snapshot {
+	long long position;
+	/**< Current position in counts. */
+	long long velocity;
+	/**< Velocity in counts per second measured over at least the last
+	 *   10 milliseconds of movement. Drops to 0 once there has been no
+	 *   edge for 10 milliseconds. */
+	long long index_position;
+	/**< Position at the last rising edge of the index line. */
+	unsigned long long num_index;
+	/**< Number of rising edges seen on the index line. */
+	unsigned long long num_invalid;
+	/**< Number of transitions which changed both A and B at once. */
+	unsigned long long num_missed;
+	/**< Number of edges dropped by the kernel. */
+	struct timespec ts;
+	/**< Timestamp of the last edge decoded on the A or B line. */
+};
+
+/**
+ * @brief Create a new quadrature encoder decoder.
+ * @param bulk Set of lines requested together for both edge events with
+ *             GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD.
+ * @param a Index of the A line in the bulk.
+ * @param b Index of the B line in the bulk.
+ * @param z Index of the index line in the bulk or -1 if there's none.
+ * @return New quadrature encoder object or NULL on error.
+ *
+ * The initial position is 0. The decoder consumes all events of the request
+ * directly from the kernel, so they must not be read in any other way while
+ * it's in use. Software event filters don't apply to them.
+ */
+struct gpiod_quadrature_encoder *
+gpiod_quadrature_encoder_new(struct gpiod_line_bulk *bulk, unsigned int a,
+			     unsigned int b, int z);
+
+/**
+ * @brief Release all resources allocated for a quadrature encoder.
+ * @param enc Quadrature encoder object to free.
+ */
+void gpiod_quadrature_encoder_free(struct gpiod_quadrature_encoder *enc);
+
+/**
+ * @brief Get the file descriptor to poll for new events.
+ * @param enc Quadrature encoder object.
+ * @return File descriptor of the request.
+ */
+int gpiod_quadrature_encoder_get_fd(struct gpiod_quadrature_encoder *enc);
+
+/**
+ * @brief Read and decode a batch of pending events.
+ * @param enc Quadrature encoder object.
+ * @return Number of events decoded or -1 on error.
+ *
+ * This function blocks until at least one event is available unless the
+ * lines were requested with GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK. The new
+ * state is published once the whole batch has been decoded.
+ */
+int gpiod_quadrature_encoder_read(struct gpiod_quadrature_encoder *enc);
+
+/**
+ * @brief Get the current state of the encoder.
+ * @param enc Quadrature encoder object.
+ * @param snap Structure in which to store a consistent copy of the state.
+ * @note This function is safe to call from any number of threads at once.
+ */
+void gpiod_quadrature_encoder_snapshot(struct gpiod_quadrature_encoder *enc,
+				       struct gpiod_quadrature_snapshot *snap);
+
+/**
+ * @}
+ *
+ * @defgroup measurement Frequency measurement
+ * @{
+ *
+ * A measurement object derives the frequency, the period and the duty cycle
+ * of a signal from the timestamps of the edge events of a single line. The
+ * periods are measured between consecutive rising edges, or falling edges if
+ * only those are requested. The duty cycle is only known if the line is
+ * requested for both edges.
+ *
+ * The statistics cover a sliding window of configurable length. The window
+ * is tracked in a fixed number of slots, so the memory used doesn't depend
+ * on the frequency and the window advances in steps of one eighth of its
+ * length. Periods interrupted by edges lost in the kernel or coalesced by
+ * the rate limiter are not counted.
+ */
+
+struct gpiod_line_measurement;
+
+/**
+ * @brief Signal parameters measured over the window.
+ */
+struct gpiod_line_measurement_data {
+	unsigned long long num_periods;
+	/**< Number of full periods in the window. */
+	unsigned long long period_min_ns;
+	/**< Shortest period in nanoseconds. */
+	unsigned long long period_max_ns;
+	/**< Longest period in nanoseconds. */
+	unsigned long long period_avg_ns;
+	/**< Average period in nanoseconds. */
+	double frequency;
+	/**< Average frequency in Hz. */
+	double duty_cycle;
+	/**< Fraction of the period the line spent active, between 0 and 1.
+	 *   Always 0 unless the line is requested for both edges. */
+};
+
+/**
+ * @brief Create a new measurement object for a line.
+ * @param line GPIO line requested for edge events with its own file
+ *             descriptor.
+ * @param window Length of the window covered by the statistics.
+ * @return New measurement object or NULL on error. If the line shares its
+ *         file descriptor with other lines, errno is set to EINVAL.
+ *
+ * The object consumes the events of the line, so they must not be read in
+ * any other way while it's in use. Software event filters apply to them.
+ */
+struct gpiod_line_measurement *
+gpiod_line_measurement_new(struct gpiod_line *line,
+			   const struct timespec *window);
+
+/**
+ * @brief Release all resources allocated for a measurement object.
+ * @param meas Measurement object to free.
+ */
+void gpiod_line_measurement_free(struct gpiod_line_measurement *meas);
+
+/**
+ * @brief Consume all pending events of the line without blocking.
+ * @param meas Measurement object.
+ * @return Number of events consumed or -1 on error.
+ *
+ * Only needed if events can pile up faster than the kernel buffer holds them
+ * between two calls to ::gpiod_line_measurement_read.
+ */
+int gpiod_line_measurement_update(struct gpiod_line_measurement *meas);
+
+/**
+ * @brief Consume all pending events and get the current statistics.
+ * @param meas Measurement object.
+ * @param data Buffer in which to store the statistics.
+ * @return 0 on success, -1 on error.
+ *
+ * If no full period ended within the window all values are 0.
+ */
+int gpiod_line_measurement_read(struct gpiod_line_measurement *meas,
+				struct gpiod_line_measurement_data *data);
+
+/**
+ * @}
+ *
+ * @defgroup edge_counter Edge counters
+ * @{
+ *
+ * An edge counter counts the edge events of a set of lines without handing
+ * them over to the user. A library thread reads the raw events from the
+ * kernel in batches and only keeps a 64-bit counter per line, together with
+ * the number of edges seen during the last full window of configurable
+ * length. All counters can be retrieved from any thread at any time.
+ *
+ * Edges the kernel had to drop are counted too as they still advance the
+ * per-line event sequence numbers. Software event filters don't apply.
+ */
+
+struct gpiod_edge_counter;
+
+/**
+ * @brief Start counting the edges on a set of lines.
+ * @param bulk Non-empty set of lines requested for edge events.
+ * @param window Length of the window over which the rates are computed.
+ * @return New edge counter object or NULL on error.
+ *
+ * All counters start at 0. The counter consumes all events of the requests
+ * the lines belong to, so they must not be read in any other way while it's
+ * in use.
+ */
+struct gpiod_edge_counter *
+gpiod_edge_counter_new(struct gpiod_line_bulk *bulk,
+		       const struct timespec *window);
+
+/**
+ * @brief Stop counting and release all resources.
+ * @param cnt Edge counter object to free.
+ */
+void gpiod_edge_counter_free(struct gpiod_edge_counter *cnt);
+
+/**
+ * @brief Get the number of lines whose edges are counted.
+ * @param cnt Edge counter object.
+ * @return Number of lines in the bulk the counter was created with.
+ */
+unsigned int gpiod_edge_counter_num_lines(struct gpiod_edge_counter *cnt);
+
+/**
+ * @brief Read the counters of all lines at once.
+ * @param cnt Edge counter object.
+ * @param counts Array in which to store the total number of edges counted
+ *               for each line, in the order of the bulk, or NULL.
+ * @param rates Array in which to store the number of edges per second over
+ *              the last full window for each line or NULL.
+ * @return 0 on success, -1 if the counting thread failed.
+ *
+ * Both arrays must be able to hold as many elements as there are lines.
+ * The values of different lines are not guaranteed to be taken at exactly
+ * the same time.
+ */
+int gpiod_edge_counter_read(struct gpiod_edge_counter *cnt,
+			    unsigned long long *counts, double *rates);
+
+/**
+ * @}
+ *
+ * @defgroup reflex Reflex rules
+ * @{
+ *
+ * A reflex object drives outputs in direct reaction to input edges without
+ * involving the application. It is attached to an event thread and its rules
+ * are evaluated right in the event dispatch path: every rule whose edge and
+ * input condition match contributes a masked write to the outputs and all of
+ * them are applied with a single system call.
+ *
+ * Every trigger is logged with the kernel timestamp of the input edge and the
+ * time the output write completed, so the reaction time can be measured. The
+ * log is a ring which the event thread never waits for - triggers which don't
+ * fit in it are only counted.
+ *
+ * The output cache of the output lines is kept up to date, but the outputs
+ * must not be written by the application while the event thread runs.
+ */
+
+struct gpiod_reflex;
+
+/**
+ * @brief Single reflex rule.
+ */
+struct gpiod_reflex_rule {
+	unsigned int input;
+	/**< Index of the input line in the bulk of inputs. */
+	int edge;
+	/**< Edge triggering the rule - GPIOD_LINE_EVENT_RISING_EDGE or
+	 *   GPIOD_LINE_EVENT_FALLING_EDGE. */
+	unsigned long long in_mask;
+	/**< Bitmap of the input lines whose levels must match in_bits after
+	 *   the edge for the rule to fire. 0 for no condition. */
+	unsigned long long in_bits;
+	/**< Required levels of the input lines selected by in_mask. */
+	unsigned long long mask;
+	/**< Bitmap of the output lines to drive - bit N corresponds to line N
+	 *   of the bulk of outputs. */
+	unsigned long long bits;
+	/**< Values to drive the output lines selected by mask to. */
+};
+
+/**
+ * @brief Record of a fired rule.
+ */
+struct gpiod_reflex_trigger {
+	unsigned int rule;
+	/**< Index of the rule that fired. */
+	struct timespec input_ts;
+	/**< Timestamp of the input edge. */
+	struct timespec output_ts;
+	/**< CLOCK_MONOTONIC time at which the output write completed. */
+};
+
+/**
+ * @brief Reflex statistics.
+ */
+struct gpiod_reflex_stats {
+	unsigned long long num_triggers;
+	/**< Number of times a rule fired. */
+	unsigned long long num_lost;
+	/**< Number of triggers that didn't fit in the log. */
+	unsigned long long reaction_min_ns;
+	/**< Shortest time from an input edge to the completed output write. */
+	unsigned long long reaction_max_ns;
+	/**< Longest reaction time. */
+	unsigned long long reaction_avg_ns;
+	/**< Average reaction time. */
+};
+
+/**
+ * @brief Create a new reflex object.
+ * @param inputs Set of lines requested for edge events.
+ * @param outputs Set of lines requested together as outputs.
+ * @param rules Array of rules, evaluated in order. Where several rules firing
+ *              on the same edge drive the same output, the last one wins.
+ * @param num_rules Number of rules, at most 64.
+ * @param log_size Minimum number of triggers the log can hold.
+ * @return New reflex object or NULL on error.
+ *
+ * Rules must not depend on edges the input lines aren't requested for and
+ * lines used in input conditions must be requested for both edges. Their
+ * levels are read once here and followed from the events afterwards. Events
+ * of lines with separate file descriptors may be handled out of order, so
+ * input conditions are best used with GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD.
+ */
+struct gpiod_reflex *
+gpiod_reflex_new(struct gpiod_line_bulk *inputs,
+		 struct gpiod_line_bulk *outputs,
+		 const struct gpiod_reflex_rule *rules, unsigned int num_rules,
+		 unsigned int log_size);
+
+/**
+ * @brief Release all resources allocated for a reflex object.
+ * @param reflex Reflex object to free.
+ * @note The event thread it's attached to must be stopped first.
+ */
+void gpiod_reflex_free(struct gpiod_reflex *reflex);
+
+/**
+ * @brief Attach a reflex object to an event thread.
+ * @param reflex Reflex object.
+ * @param thread Event thread which is not running.
+ * @return 0 on success, -1 on error.
+ *
+ * The events of the inputs are consumed by the reflex object. If writing the
+ * outputs fails, the event thread exits.
+ */
+int gpiod_reflex_attach(struct gpiod_reflex *reflex,
+			struct gpiod_event_thread *thread);
+
+/**
+ * @brief Read the oldest entries of the trigger log without blocking.
+ * @param reflex Reflex object.
+ * @param triggers Buffer in which to store the log entries.
+ * @param num_triggers Maximum number of entries to read.
+ * @return Number of entries read or -1 if the log is empty and writing the
+ *         outputs failed, in which case errno is set to the error.
+ * @note Only one thread at a time may read the log.
+ */
+int gpiod_reflex_read_log(struct gpiod_reflex *reflex,
+			  struct gpiod_reflex_trigger *triggers,
+			  unsigned int num_triggers);
+
+/**
+ * @brief Get the statistics of a reflex object.
+ * @param reflex Reflex object.
+ * @param stats Structure in which to store the statistics.
+ * @note This function is safe to call while the event thread is running.
+ */
+void gpiod_reflex_get_stats(struct gpiod_reflex *reflex,
+			    struct gpiod_reflex_stats *stats);
+
+/**
+ * @}
+ *
+ * @defgroup sampler Periodic sampling
+ * @{
+ *
+ * A sampler reads the values of a set of lines at a fixed rate from a library
+ * thread into a ring of timestamped samples. The sampling times are computed
+ * on an absolute CLOCK_MONOTONIC grid, so delays in taking one sample don't
+ * shift the following ones. Samples which couldn't be taken in time are
+ * skipped and counted as overruns, samples which don't fit in the ring
+ * because the consumer didn't read them fast enough are dropped and counted.
+ */
+
+struct gpiod_sampler;
+
+/**
+ * @brief Single sample.
+ */
+struct gpiod_sample {
+	unsigned long long timestamp_ns;
+	/**< CLOCK_MONOTONIC time at which the values were read. */
+	unsigned long long bits;
+	/**< Values of the lines - bit N corresponds to line N of the bulk. */
+};
+
+/**
+ * @brief Sampler statistics.
+ */
+struct gpiod_sampler_stats {
+	unsigned long long num_samples;
+	/**< Number of samples taken. */
+	unsigned long long num_dropped;
+	/**< Number of samples taken while the ring was full. */
+	unsigned long long num_overruns;
+	/**< Number of samples skipped because the thread fell behind. */
+	unsigned long long jitter_max_ns;
+	/**< Highest delay of a sample behind its scheduled time. */
+	unsigned long long jitter_avg_ns;
+	/**< Average delay of a sample behind its scheduled time. */
+};
+
+/**
+ * @brief Create a new sampler.
+ * @param bulk Set of lines requested together.
+ * @param period Time between two consecutive samples.
+ * @param ring_size Minimum number of samples the ring can hold.
+ * @return New sampler object or NULL on error.
+ */
+struct gpiod_sampler *
+gpiod_sampler_new(struct gpiod_line_bulk *bulk, const struct timespec *period,
+		  unsigned int ring_size);
+
+/**
+ * @brief Stop the sampler and release all resources allocated for it.
+ * @param sampler Sampler object to free.
+ */
+void gpiod_sampler_free(struct gpiod_sampler *sampler);
+
+/**
+ * @brief Start sampling.
+ * @param sampler Sampler object.
+ * @return 0 on success, -1 on error. If the sampler is already running,
+ *         errno is set to EBUSY.
+ *
+ * The first sample is taken right away. The statistics are reset.
+ */
+int gpiod_sampler_start(struct gpiod_sampler *sampler);
+
+/**
+ * @brief Stop sampling.
+ * @param sampler Sampler object.
+ * @return 0 on success, -1 if the sampling thread had exited due to an error,
+ *         in which case errno is set to the error that made it exit.
+ *
+ * Samples still in the ring can be read afterwards.
+ */
+int gpiod_sampler_stop(struct gpiod_sampler *sampler);
+
+/**
+ * @brief Get the file descriptor which becomes readable when new samples are
+ *        available.
+ * @param sampler Sampler object.
+ * @return File descriptor to poll. It must not be read or closed.
+ */
+int gpiod_sampler_get_fd(struct gpiod_sampler *sampler);
+
+/**
+ * @brief Read the oldest samples from the ring.
+ * @param sampler Sampler object.
+ * @param timeout Wait time limit if the ring is empty. NULL means wait
+ *                forever.
+ * @param samples Buffer in which to store the samples.
+ * @param num_samples Maximum number of samples to read.
+ * @return Number of samples read, 0 if the wait timed out or -1 on error,
+ *         including the sampling thread having failed.
+ * @note Only one thread at a time may read samples.
+ */
+int gpiod_sampler_read(struct gpiod_sampler *sampler,
+		       const struct timespec *timeout,
+		       struct gpiod_sample *samples, unsigned int num_samples);
+
+/**
+ * @brief Get the statistics of a sampler.
+ * @param sampler Sampler object.
+ * @param stats Structure in which to store the statistics.
+ * @note This function is safe to call while the sampler is running.
+ */
+void gpiod_sampler_get_stats(struct gpiod_sampler *sampler,
+			     struct gpiod_sampler_stats *stats);
+
+/**
+ * @}
+ *
+ * @defgroup keypad Matrix keypad scanning
+ * @{
+ *
+ * A keypad object scans a matrix of keys from a library thread. The rows are
+ * outputs requested together and the columns are inputs requested together
+ * for edge events on a single file descriptor (see
+ * ::GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD). Logical values are used on both
+ * sides: an active row is driven to 1 and a column reading 1 means a closed
+ * contact, so a matrix with pull-ups on the columns needs both requests to be
+ * active-low.
+ *
+ * While no key is pressed all rows are kept active and the thread sleeps until
+ * an edge on any column. It then scans the matrix by activating one row at a
+ * time until all keys are released again. A key has to keep its new state for
+ * the whole debounce period before an event is reported.
+ *
+ * The keypad owns both requests while it exists - their values must not be
+ * changed and their events must not be read by the user.
+ */
+
+struct gpiod_keypad;
+
+/**
+ * @brief Possible key event types.
+ */
+enum {
+	GPIOD_KEYPAD_KEY_PRESS = 1,
+	/**< Key has been pressed. */
+	GPIOD_KEYPAD_KEY_RELEASE,
+	/**< Key has been released. */
+};
+
+/**
+ * @brief Structure holding key event info.
+ */
+struct gpiod_keypad_event {
+	unsigned int row;
+	/**< Index of the row of the key in the rows bulk. */
+	unsigned int col;
+	/**< Index of the column of the key in the columns bulk. */
+	int event_type;
+	/**< Type of the event. */
+	struct timespec ts;
+	/**< CLOCK_MONOTONIC time at which the new state was confirmed. */
+};
+
+/**
+ * @brief Create a keypad and start scanning it.
+ * @param rows Up to 64 output lines requested together.
+ * @param cols Up to 64 lines requested together for both edge events on a
+ *             shared file descriptor.
+ * @param debounce Time a key must keep its state for it to be reported.
+ * @return New keypad object or NULL on error. If the lines aren't requested
+ *         as needed, errno is set to EPERM.
+ */
+struct gpiod_keypad *gpiod_keypad_new(struct gpiod_line_bulk *rows,
+				      struct gpiod_line_bulk *cols,
+				      const struct timespec *debounce);
+
+/**
+ * @brief Stop scanning and release all resources allocated for a keypad.
+ * @param keypad Keypad object to free.
+ *
+ * All rows are left active.
+ */
+void gpiod_keypad_free(struct gpiod_keypad *keypad);
+
+/**
+ * @brief Get the file descriptor which becomes readable when key events are
+ *        available.
+ * @param keypad Keypad object.
+ * @return File descriptor to poll. It must not be read or closed.
+ */
+int gpiod_keypad_get_fd(struct gpiod_keypad *keypad);
+
+/**
+ * @brief Read key events.
+ * @param keypad Keypad object.
+ * @param timeout Wait time limit if there are no events. NULL means wait
+ *                forever.
+ * @param events Buffer in which to store the events.
+ * @param num_events Maximum number of events to read.
+ * @return Number of events read, 0 if the wait timed out or -1 on error,
+ *         including the scanning thread having failed.
+ * @note Only one thread at a time may read events. Events which are not read
+ *       in time are lost once the internal queue fills up - see
+ *       ::gpiod_keypad_num_lost.
+ */
+int gpiod_keypad_read(struct gpiod_keypad *keypad,
+		      const struct timespec *timeout,
+		      struct gpiod_keypad_event *events,
+		      unsigned int num_events);
+
+/**
+ * @brief Get the debounced state of all keys.
+ * @param keypad Keypad object.
+ * @param state Array with an entry for each row in which bit N is set if the
+ *              key in column N is pressed.
+ * @note This function is safe to call while the keypad is being scanned.
+ */
+void gpiod_keypad_get_state(struct gpiod_keypad *keypad,
+			    unsigned long long *state);
+
+/**
+ * @brief Get the number of key events lost.
+ * @param keypad Keypad object.
+ * @return Number of events dropped because the internal queue was full.
+ * @note This function is safe to call while the keypad is being scanned.
+ */
+unsigned long long gpiod_keypad_num_lost(struct gpiod_keypad *keypad);
+
+/**
+ * @}
+ *
+ * @defgroup capture Binary event capture
+ * @{
+ *
+ * Line events can be recorded into a compact binary capture format for later
+ * analysis. All integers in it are unsigned LEB128 varints. A capture starts
+ * with a header:
+ *
+ * - the 8 byte magic "GPIODCAP",
+ * - the format version (currently 1),
+ * - the chip name and label,
+ * - the number of lines followed by the offset and name of every line.
+ *
+ * Strings are stored as their length followed by the characters without the
+ * terminating null byte. The header is followed by one record per event
+ * until the end of the stream:
+ *
+ * - the difference between the event timestamp and the timestamp of the
+ *   previous event (0 for the first one) in nanoseconds, zigzag-encoded as
+ *   it can be negative for events coming from separate file descriptors,
+ * - the index of the line in the header shifted left by two with the lowest
+ *   bit set for rising edges and the next one set for extended records.
+ *
+ * Extended records are followed by:
+ *
+ * - the number of edges of the line lost since its previous record, as told
+ *   by the gap in the line sequence numbers not covered by coalesced edges,
+ * - the number of edges the event stands for minus one,
+ * - the difference between the event timestamp and the time of the first
+ *   edge it stands for in nanoseconds.
+ *
+ * Only coalesced events and events following lost ones need extended records.
+ * Busy lines typically take three to four bytes per event.
+ */
+
+struct gpiod_capture_writer;
+struct gpiod_capture_reader;
+
+/**
+ * @brief Create a capture writer and write the capture header.
+ * @param fd File descriptor to write the capture to. It's not closed by the
+ *           writer.
+ * @param bulk Up to 64 lines of a single chip whose events will be recorded.
+ *             They don't need to be requested.
+ * @return New capture writer or NULL on error.
+ *
+ * The writer buffers the data and only writes it out in large chunks.
+ */
+struct gpiod_capture_writer *
+gpiod_capture_writer_new(int fd, struct gpiod_line_bulk *bulk);
+
+/**
+ * @brief Flush the remaining data and release all resources allocated for a
+ *        capture writer.
+ * @param writer Capture writer to free.
+ * @note Errors writing out the remaining data are not reported - call
+ *       ::gpiod_capture_writer_flush first to check for them.
+ */
+void gpiod_capture_writer_free(struct gpiod_capture_writer *writer);
+
+/**
+ * @brief Record line events.
+ * @param writer Capture writer.
+ * @param events Events to record.
+ * @param num_events Number of events to record.
+ * @return 0 on success, -1 on error. If any event comes from a line not in
+ *         the header, errno is set to EINVAL and nothing is recorded.
+ *
+ * Besides the timestamp, offset and type of the events, gaps in their line
+ * sequence numbers and the number and first timestamp of coalesced events
+ * are recorded.
+ */
+int gpiod_capture_writer_add(struct gpiod_capture_writer *writer,
+			     const struct gpiod_line_event_ext *events,
+			     unsigned int num_events);
+
+/**
+ * @brief Write out all buffered data.
+ * @param writer Capture writer.
+ * @return 0 on success, -1 on error.
+ */
+int gpiod_capture_writer_flush(struct gpiod_capture_writer *writer);
+
+/**
+ * @brief Create a capture reader and read the capture header.
+ * @param fd File descriptor to read the capture from. It's not closed by the
+ *           reader.
+ * @return New capture reader or NULL on error. If the header is invalid,
+ *         errno is set to EINVAL.
+ */
+struct gpiod_capture_reader *gpiod_capture_reader_new(int fd);
+
+/**
+ * @brief Release all resources allocated for a capture reader.
+ * @param reader Capture reader to free.
+ */
+void gpiod_capture_reader_free(struct gpiod_capture_reader *reader);
+
+/**
+ * @brief Get the name of the chip the capture was recorded on.
+ * @param reader Capture reader.
+ * @return Name of the chip.
+ */
+const char *gpiod_capture_reader_chip_name(struct gpiod_capture_reader *reader);
+
+/**
+ * @brief Get the label of the chip the capture was recorded on.
+ * @param reader Capture reader.
+ * @return Label of the chip.
+ */
+const char *
+gpiod_capture_reader_chip_label(struct gpiod_capture_reader *reader);
+
+/**
+ * @brief Get the number of lines recorded in a capture.
+ * @param reader Capture reader.
+ * @return Number of lines in the capture header.
+ */
+unsigned int
+gpiod_capture_reader_num_lines(struct gpiod_capture_reader *reader);
+
+/**
+ * @brief Get the offset of a line recorded in a capture.
+ * @param reader Capture reader.
+ * @param index Index of the line in the capture header.
+ * @return Offset of the line.
+ */
+unsigned int
+gpiod_capture_reader_line_offset(struct gpiod_capture_reader *reader,
+				 unsigned int index);
+
+/**
+ * @brief Get the name of a line recorded in a capture.
+ * @param reader Capture reader.
+ * @param index Index of the line in the capture header.
+ * @return Name of the line or NULL if the line is unnamed.
+ */
+const char *gpiod_capture_reader_line_name(struct gpiod_capture_reader *reader,
+					   unsigned int index);
+
+/**
+ * @brief Read recorded events.
+ * @param reader Capture reader.
+ * @param events Buffer in which to store the events.
+ * @param num_events Maximum number of events to read.
+ * @return Number of events read, 0 at the end of the capture or -1 on error.
+ *
+ * The sequence numbers are renumbered from 1 across the whole capture,
+ * skipping the edges recorded as lost or coalesced, so the global sequence
+ * number doesn't match the one of the request the events were read from.
+ * A truncated last record, as left behind by a recorder which was killed, is
+ * treated as the end of the capture.
+ */
+int gpiod_capture_reader_read(struct gpiod_capture_reader *reader,
+			      struct gpiod_line_event_ext *events,
+			      unsigned int num_events);
+
+/**
  * @}
  *
  * @defgroup misc Stuff that didn't fit anywhere else
@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Bit-bang engine for synchronous serial protocols. Every possible output
+ * state is prepared in the format expected by the kernel beforehand so that
+ * clocking a bit costs nothing but the system calls.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+struct gpiod_bitbang {
+	int flags;
+	uint64_t half_period_ns;
+	int clock_idle;
+
+	int out_fd;
+	struct gpiod_line *clock;
+	struct gpiod_line *data_out;
+	/* Indexed by the clock level and the data bit. */
+	struct gpio_v2_line_values out[2][2];
+
+	int in_fd;
+	struct gpio_v2_line_values in;
+
+	unsigned long long num_bits;
+	unsigned long long busy_ns;
+	unsigned long long last_bit_rate;
+};
+
+static int bitbang_set(struct gpiod_bitbang *bb, int clock, int data)
+{
+	return ioctl(bb->out_fd, GPIO_V2_LINE_SET_VALUES_IOCTL,
+		     &bb->out[clock][data]);
+}
+
+static int bitbang_get(struct gpiod_bitbang *bb)
+{
+	struct gpio_v2_line_values lv = bb->in;
+	int rv;
+
+	rv = ioctl(bb->in_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv);
+	if (rv < 0)
+		return -1;
+
+	return !!(lv.bits & lv.mask);
+}
+
+/*
+ * Sleeping is far too coarse for the periods in question - spin until the
+ * deadline instead.
+ */
+static void bitbang_delay(struct gpiod_bitbang *bb, uint64_t *deadline)
+{
+	if (!bb->half_period_ns)
+		return;
+
+	*deadline += bb->half_period_ns;
+	while (monotonic_ns() < *deadline)
+		;
+}
+
+static bool bitbang_line_valid(struct gpiod_line_bulk *bulk, int index,
+			       int direction)
+{
+	unsigned int num_lines = gpiod_line_bulk_num_lines(bulk);
+
+	if (num_lines > 64 || index < 0 || (unsigned int)index >= num_lines)
+		return false;
+
+	return gpiod_line_direction(gpiod_line_bulk_get_line(bulk, index)) ==
+								direction;
+}
+
+static bool bitbang_config_valid(struct gpiod_line_bulk *outputs,
+				 struct gpiod_line_bulk *inputs,
+				 const struct gpiod_bitbang_config *config)
+{
+	if (config->flags & ~(GPIOD_BITBANG_FLAG_CPOL |
+			      GPIOD_BITBANG_FLAG_CPHA |
+			      GPIOD_BITBANG_FLAG_LSB_FIRST))
+		return false;
+
+	if (config->clock > INT_MAX ||
+	    !bitbang_line_valid(outputs, config->clock,
+				GPIOD_LINE_DIRECTION_OUTPUT))
+		return false;
+
+	if (config->data_out >= 0 &&
+	    (config->data_out == (int)config->clock ||
+	     !bitbang_line_valid(outputs, config->data_out,
+				 GPIOD_LINE_DIRECTION_OUTPUT)))
+		return false;
+
+	if (config->data_in >= 0 &&
+	    (!inputs || !bitbang_line_valid(inputs, config->data_in,
+					     GPIOD_LINE_DIRECTION_INPUT)))
+		return false;
+
+	return true;
+}
+
+GPIOD_API struct gpiod_bitbang *
+gpiod_bitbang_new(struct gpiod_line_bulk *outputs,
+		  struct gpiod_line_bulk *inputs,
+		  const struct gpiod_bitbang_config *config)
+{
+	uint64_t out_bits[64], in_bits[64], clock_bit, data_bit = 0;
+	struct gpiod_bitbang *bb;
+	int clock, data;
+
+	if (!bitbang_config_valid(outputs, inputs, config)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	bb = malloc(sizeof(*bb));
+	if (!bb)
+		return NULL;
+
+	memset(bb, 0, sizeof(*bb));
+	bb->flags = config->flags;
+	bb->half_period_ns = timespec_to_ns(&config->half_period);
+	bb->clock_idle = !!(config->flags & GPIOD_BITBANG_FLAG_CPOL);
+	bb->in_fd = -1;
+
+	bb->out_fd = line_bulk_request_bits(outputs, out_bits);
+	if (bb->out_fd < 0)
+		goto err_free;
+
+	bb->clock = gpiod_line_bulk_get_line(outputs, config->clock);
+	if (config->data_out >= 0)
+		bb->data_out = gpiod_line_bulk_get_line(outputs,
+							config->data_out);
+
+	clock_bit = out_bits[config->clock];
+	if (bb->data_out)
+		data_bit = out_bits[config->data_out];
+
+	for (clock = 0; clock < 2; clock++) {
+		for (data = 0; data < 2; data++) {
+			bb->out[clock][data].mask = clock_bit | data_bit;
+			bb->out[clock][data].bits = (clock ? clock_bit : 0) |
+						    (data ? data_bit : 0);
+		}
+	}
+
+	if (config->data_in >= 0) {
+		bb->in_fd = line_bulk_request_bits(inputs, in_bits);
+		if (bb->in_fd < 0)
+			goto err_free;
+
+		bb->in.mask = in_bits[config->data_in];
+	}
+
+	/* Start with the clock idle, leave the data line alone. */
+	if (gpiod_line_set_value(bb->clock, bb->clock_idle) < 0)
+		goto err_free;
+
+	return bb;
+
+err_free:
+	free(bb);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_bitbang_free(struct gpiod_bitbang *bb)
+{
+	free(bb);
+}
+
+GPIOD_API int gpiod_bitbang_transfer(struct gpiod_bitbang *bb,
+				     const unsigned char *tx,
+				     unsigned char *rx, size_t len)
+{
+	int idle = bb->clock_idle, active = !bb->clock_idle, first, second;
+	bool lsb_first = bb->flags & GPIOD_BITBANG_FLAG_LSB_FIRST;
+	uint64_t start, deadline, elapsed;
+	unsigned int bit, shift;
+	unsigned char in;
+	int out = 0, rv;
+	size_t i;
+
+	if (rx && bb->in_fd < 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/*
+	 * The data line changes together with the first clock edge of every
+	 * bit and the input is sampled right after the second one. With
+	 * CPHA=0 the first edge is the trailing one of the previous bit, with
+	 * CPHA=1 it's the leading one.
+	 */
+	if (bb->flags & GPIOD_BITBANG_FLAG_CPHA) {
+		first = active;
+		second = idle;
+	} else {
+		first = idle;
+		second = active;
+	}
+
+	start = deadline = monotonic_ns();
+
+	for (i = 0; i < len; i++) {
+		in = 0;
+
+		for (bit = 0; bit < 8; bit++) {
+			shift = lsb_first ? bit : 7 - bit;
+			out = tx ? (tx[i] >> shift) & 1 : 0;
+
+			rv = bitbang_set(bb, first, out);
+			if (rv < 0)
+				goto err_invalidate;
+
+			bitbang_delay(bb, &deadline);
+
+			rv = bitbang_set(bb, second, out);
+			if (rv < 0)
+				goto err_invalidate;
+
+			if (rx) {
+				rv = bitbang_get(bb);
+				if (rv < 0)
+					goto err_invalidate;
+
+				in |= rv << shift;
+			}
+
+			bitbang_delay(bb, &deadline);
+		}
+
+		if (rx)
+			rx[i] = in;
+	}
+
+	/* With CPHA=0 the last bit ends with the clock still active. */
+	if (len && second != idle) {
+		rv = bitbang_set(bb, idle, out);
+		if (rv < 0)
+			goto err_invalidate;
+	}
+
+	if (len) {
+		line_output_sync(bb->clock, idle);
+		if (bb->data_out)
+			line_output_sync(bb->data_out, out);
+	}
+
+	elapsed = monotonic_ns() - start;
+	bb->num_bits += len * 8;
+	bb->busy_ns += elapsed;
+	if (elapsed)
+		bb->last_bit_rate = len * 8 * 1e9 / elapsed;
+
+	return 0;
+
+err_invalidate:
+	/* Some of the writes may have gone through. */
+	line_output_invalidate(bb->clock);
+	if (bb->data_out)
+		line_output_invalidate(bb->data_out);
+
+	return -1;
+}
+
+GPIOD_API void gpiod_bitbang_get_stats(struct gpiod_bitbang *bb,
+				       struct gpiod_bitbang_stats *stats)
+{
+	stats->num_bits = bb->num_bits;
+	stats->last_bit_rate = bb->last_bit_rate;
+	stats->avg_bit_rate = bb->busy_ns ?
+		bb->num_bits * 1e9 / bb->busy_ns : 0;
+}
@@ -0,0 +1,587 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/* Binary capture format for line event streams. */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+#define CAPTURE_MAGIC			"GPIODCAP"
+#define CAPTURE_MAGIC_SIZE		8
+#define CAPTURE_VERSION			1
+#define CAPTURE_MAX_LINES		64
+#define CAPTURE_BUF_SIZE		65536
+/* Longest possible varint encoding of a 64-bit value. */
+#define CAPTURE_VARINT_MAX		10
+/* Longest possible record: the timestamp, the line and three extensions. */
+#define CAPTURE_RECORD_MAX		(5 * CAPTURE_VARINT_MAX)
+
+/* Bits of the line field of a record. */
+#define CAPTURE_REC_RISING		0x1
+#define CAPTURE_REC_EXTENDED		0x2
+
+struct gpiod_capture_writer {
+	int fd;
+	unsigned int num_lines;
+	unsigned int offsets[CAPTURE_MAX_LINES];
+	uint64_t last_ts;
+	unsigned long line_seqno[CAPTURE_MAX_LINES];
+
+	size_t len;
+	unsigned char buf[CAPTURE_BUF_SIZE];
+};
+
+struct gpiod_capture_reader {
+	int fd;
+	char chip_name[GPIO_MAX_NAME_SIZE];
+	char chip_label[GPIO_MAX_NAME_SIZE];
+	unsigned int num_lines;
+	unsigned int offsets[CAPTURE_MAX_LINES];
+	char names[CAPTURE_MAX_LINES][GPIO_MAX_NAME_SIZE];
+
+	uint64_t last_ts;
+	unsigned long seqno;
+	unsigned long line_seqno[CAPTURE_MAX_LINES];
+
+	size_t pos;
+	size_t len;
+	unsigned char buf[CAPTURE_BUF_SIZE];
+};
+
+static uint64_t capture_zigzag(int64_t val)
+{
+	return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+}
+
+static int64_t capture_unzigzag(uint64_t val)
+{
+	return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+}
+
+static int capture_write_out(struct gpiod_capture_writer *writer)
+{
+	size_t done = 0;
+	ssize_t wr;
+
+	while (done < writer->len) {
+		wr = write(writer->fd, writer->buf + done, writer->len - done);
+		if (wr < 0) {
+			if (errno == EINTR)
+				continue;
+
+			/* Keep what's left so that a retry doesn't lose it. */
+			memmove(writer->buf, writer->buf + done,
+				writer->len - done);
+			writer->len -= done;
+			return -1;
+		}
+
+		done += wr;
+	}
+
+	writer->len = 0;
+
+	return 0;
+}
+
+/* Make sure there's room for size more bytes in the buffer. */
+static int capture_reserve(struct gpiod_capture_writer *writer, size_t size)
+{
+	if (writer->len + size <= CAPTURE_BUF_SIZE)
+		return 0;
+
+	return capture_write_out(writer);
+}
+
+static void capture_put_varint(struct gpiod_capture_writer *writer,
+			       uint64_t val)
+{
+	while (val >= 0x80) {
+		writer->buf[writer->len++] = (val & 0x7f) | 0x80;
+		val >>= 7;
+	}
+
+	writer->buf[writer->len++] = val;
+}
+
+static int capture_put_string(struct gpiod_capture_writer *writer,
+			      const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+	int rv;
+
+	if (len >= GPIO_MAX_NAME_SIZE)
+		len = GPIO_MAX_NAME_SIZE - 1;
+
+	rv = capture_reserve(writer, CAPTURE_VARINT_MAX + len);
+	if (rv)
+		return -1;
+
+	capture_put_varint(writer, len);
+	if (len) {
+		memcpy(writer->buf + writer->len, str, len);
+		writer->len += len;
+	}
+
+	return 0;
+}
+
+static int capture_put_header(struct gpiod_capture_writer *writer,
+			      struct gpiod_line_bulk *bulk)
+{
+	struct gpiod_chip *chip;
+	struct gpiod_line *line;
+	unsigned int i;
+	int rv;
+
+	chip = gpiod_line_get_chip(gpiod_line_bulk_get_line(bulk, 0));
+
+	memcpy(writer->buf, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE);
+	writer->len = CAPTURE_MAGIC_SIZE;
+	capture_put_varint(writer, CAPTURE_VERSION);
+
+	rv = capture_put_string(writer, gpiod_chip_get_name(chip));
+	if (rv)
+		return -1;
+
+	rv = capture_put_string(writer, gpiod_chip_get_label(chip));
+	if (rv)
+		return -1;
+
+	capture_put_varint(writer, writer->num_lines);
+
+	for (i = 0; i < writer->num_lines; i++) {
+		line = gpiod_line_bulk_get_line(bulk, i);
+
+		rv = capture_reserve(writer, CAPTURE_VARINT_MAX);
+		if (rv)
+			return -1;
+
+		capture_put_varint(writer, writer->offsets[i]);
+
+		rv = capture_put_string(writer, gpiod_line_name(line));
+		if (rv)
+			return -1;
+	}
+
+	return capture_write_out(writer);
+}
+
+GPIOD_API struct gpiod_capture_writer *
+gpiod_capture_writer_new(int fd, struct gpiod_line_bulk *bulk)
+{
+	struct gpiod_capture_writer *writer;
+	unsigned int num_lines, i;
+	int rv;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (num_lines == 0 || num_lines > CAPTURE_MAX_LINES) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	writer = malloc(sizeof(*writer));
+	if (!writer)
+		return NULL;
+
+	memset(writer, 0, sizeof(*writer));
+	writer->fd = fd;
+	writer->num_lines = num_lines;
+
+	for (i = 0; i < num_lines; i++)
+		writer->offsets[i] = gpiod_line_offset(
+					gpiod_line_bulk_get_line(bulk, i));
+
+	rv = capture_put_header(writer, bulk);
+	if (rv) {
+		free(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+GPIOD_API void gpiod_capture_writer_free(struct gpiod_capture_writer *writer)
+{
+	if (!writer)
+		return;
+
+	capture_write_out(writer);
+	free(writer);
+}
+
+static int capture_line_index(const unsigned int *offsets,
+			      unsigned int num_lines, unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_lines; i++) {
+		if (offsets[i] == offset)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Write the line field of a record followed by the extensions if the event
+ * doesn't directly follow the previous one of its line or stands for several
+ * edges. Events without sequence numbers or first timestamps are recorded as
+ * regular ones.
+ */
+static void capture_put_record(struct gpiod_capture_writer *writer,
+			       const struct gpiod_line_event_ext *event,
+			       unsigned int index, uint64_t ts)
+{
+	unsigned long last = writer->line_seqno[index], lost = 0, extra = 0;
+	uint64_t first, span = 0, rec;
+
+	if (event->num_events > 1)
+		extra = event->num_events - 1;
+
+	/* Coalesced events carry the sequence number of their last edge. */
+	if (last && event->line_seqno > last + extra + 1)
+		lost = event->line_seqno - last - extra - 1;
+	if (event->line_seqno)
+		writer->line_seqno[index] = event->line_seqno;
+
+	first = timespec_to_ns(&event->first_ts);
+	if (first && first < ts)
+		span = ts - first;
+
+	rec = (uint64_t)index << 2;
+	if (event->event_type == GPIOD_LINE_EVENT_RISING_EDGE)
+		rec |= CAPTURE_REC_RISING;
+	if (lost || extra || span)
+		rec |= CAPTURE_REC_EXTENDED;
+
+	capture_put_varint(writer, rec);
+
+	if (rec & CAPTURE_REC_EXTENDED) {
+		capture_put_varint(writer, lost);
+		capture_put_varint(writer, extra);
+		capture_put_varint(writer, span);
+	}
+}
+
+GPIOD_API int
+gpiod_capture_writer_add(struct gpiod_capture_writer *writer,
+			 const struct gpiod_line_event_ext *events,
+			 unsigned int num_events)
+{
+	unsigned int i;
+	uint64_t ts;
+	int rv, index;
+
+	/* Validate all events first so that an invalid one records nothing. */
+	for (i = 0; i < num_events; i++) {
+		index = capture_line_index(writer->offsets, writer->num_lines,
+					   events[i].offset);
+		if (index < 0) {
+			errno = EINVAL;
+			return -1;
+		}
+	}
+
+	for (i = 0; i < num_events; i++) {
+		rv = capture_reserve(writer, CAPTURE_RECORD_MAX);
+		if (rv)
+			return -1;
+
+		index = capture_line_index(writer->offsets, writer->num_lines,
+					   events[i].offset);
+		ts = timespec_to_ns(&events[i].ts);
+
+		capture_put_varint(writer,
+				   capture_zigzag(ts - writer->last_ts));
+		capture_put_record(writer, &events[i], index, ts);
+
+		writer->last_ts = ts;
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_capture_writer_flush(struct gpiod_capture_writer *writer)
+{
+	return capture_write_out(writer);
+}
+
+/* Returns 0 on success, 1 at the end of the file and -1 on error. */
+static int capture_get_byte(struct gpiod_capture_reader *reader,
+			    unsigned char *byte)
+{
+	ssize_t rd;
+
+	if (reader->pos == reader->len) {
+		do {
+			rd = read(reader->fd, reader->buf, CAPTURE_BUF_SIZE);
+		} while (rd < 0 && errno == EINTR);
+		if (rd < 0)
+			return -1;
+		if (rd == 0)
+			return 1;
+
+		reader->pos = 0;
+		reader->len = rd;
+	}
+
+	*byte = reader->buf[reader->pos++];
+
+	return 0;
+}
+
+static int capture_get_varint(struct gpiod_capture_reader *reader,
+			      uint64_t *val)
+{
+	unsigned int shift = 0;
+	unsigned char byte;
+	int rv;
+
+	*val = 0;
+
+	do {
+		if (shift >= 64) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		rv = capture_get_byte(reader, &byte);
+		if (rv)
+			return rv;
+
+		*val |= (uint64_t)(byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+
+	return 0;
+}
+
+/* Like capture_get_varint() but the end of the file is an error. */
+static int capture_get_header_varint(struct gpiod_capture_reader *reader,
+				     uint64_t *val)
+{
+	int rv;
+
+	rv = capture_get_varint(reader, val);
+	if (rv > 0)
+		errno = EINVAL;
+
+	return rv ? -1 : 0;
+}
+
+static int capture_get_string(struct gpiod_capture_reader *reader, char *str)
+{
+	unsigned char byte;
+	uint64_t len, i;
+	int rv;
+
+	rv = capture_get_header_varint(reader, &len);
+	if (rv)
+		return -1;
+
+	if (len >= GPIO_MAX_NAME_SIZE) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < len; i++) {
+		rv = capture_get_byte(reader, &byte);
+		if (rv) {
+			if (rv > 0)
+				errno = EINVAL;
+			return -1;
+		}
+
+		str[i] = byte;
+	}
+
+	str[len] = '\0';
+
+	return 0;
+}
+
+static int capture_get_header(struct gpiod_capture_reader *reader)
+{
+	unsigned char magic[CAPTURE_MAGIC_SIZE];
+	uint64_t val;
+	unsigned int i;
+	int rv;
+
+	for (i = 0; i < CAPTURE_MAGIC_SIZE; i++) {
+		rv = capture_get_byte(reader, &magic[i]);
+		if (rv) {
+			if (rv > 0)
+				errno = EINVAL;
+			return -1;
+		}
+	}
+
+	if (memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	rv = capture_get_header_varint(reader, &val);
+	if (rv)
+		return -1;
+
+	if (val != CAPTURE_VERSION) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	rv = capture_get_string(reader, reader->chip_name);
+	if (rv)
+		return -1;
+
+	rv = capture_get_string(reader, reader->chip_label);
+	if (rv)
+		return -1;
+
+	rv = capture_get_header_varint(reader, &val);
+	if (rv)
+		return -1;
+
+	if (val == 0 || val > CAPTURE_MAX_LINES) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	reader->num_lines = val;
+
+	for (i = 0; i < reader->num_lines; i++) {
+		rv = capture_get_header_varint(reader, &val);
+		if (rv)
+			return -1;
+
+		reader->offsets[i] = val;
+
+		rv = capture_get_string(reader, reader->names[i]);
+		if (rv)
+			return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API struct gpiod_capture_reader *gpiod_capture_reader_new(int fd)
+{
+	struct gpiod_capture_reader *reader;
+	int rv;
+
+	reader = malloc(sizeof(*reader));
+	if (!reader)
+		return NULL;
+
+	memset(reader, 0, sizeof(*reader));
+	reader->fd = fd;
+
+	rv = capture_get_header(reader);
+	if (rv) {
+		free(reader);
+		return NULL;
+	}
+
+	return reader;
+}
+
+GPIOD_API void gpiod_capture_reader_free(struct gpiod_capture_reader *reader)
+{
+	free(reader);
+}
+
+GPIOD_API const char *
+gpiod_capture_reader_chip_name(struct gpiod_capture_reader *reader)
+{
+	return reader->chip_name;
+}
+
+GPIOD_API const char *
+gpiod_capture_reader_chip_label(struct gpiod_capture_reader *reader)
+{
+	return reader->chip_label;
+}
+
+GPIOD_API unsigned int
+gpiod_capture_reader_num_lines(struct gpiod_capture_reader *reader)
+{
+	return reader->num_lines;
+}
+
+GPIOD_API unsigned int
+gpiod_capture_reader_line_offset(struct gpiod_capture_reader *reader,
+				 unsigned int index)
+{
+	return reader->offsets[index];
+}
+
+GPIOD_API const char *
+gpiod_capture_reader_line_name(struct gpiod_capture_reader *reader,
+			       unsigned int index)
+{
+	return reader->names[index][0] ? reader->names[index] : NULL;
+}
+
+GPIOD_API int gpiod_capture_reader_read(struct gpiod_capture_reader *reader,
+					struct gpiod_line_event_ext *events,
+					unsigned int num_events)
+{
+	uint64_t delta, rec, lost, extra, span;
+	struct gpiod_line_event_ext *event;
+	unsigned int i, index;
+	int rv;
+
+	for (i = 0; i < num_events; i++) {
+		rv = capture_get_varint(reader, &delta);
+		if (rv == 0)
+			rv = capture_get_varint(reader, &rec);
+		if (rv > 0)
+			break;
+		if (rv < 0)
+			return -1;
+
+		lost = extra = span = 0;
+		if (rec & CAPTURE_REC_EXTENDED) {
+			rv = capture_get_varint(reader, &lost);
+			if (rv == 0)
+				rv = capture_get_varint(reader, &extra);
+			if (rv == 0)
+				rv = capture_get_varint(reader, &span);
+			if (rv > 0)
+				break;
+			if (rv < 0)
+				return -1;
+		}
+
+		index = rec >> 2;
+		if (index >= reader->num_lines) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		reader->last_ts += capture_unzigzag(delta);
+
+		event = &events[i];
+		memset(event, 0, sizeof(*event));
+		ns_to_timespec(reader->last_ts, &event->ts);
+		ns_to_timespec(reader->last_ts - span, &event->first_ts);
+		event->event_type = rec & CAPTURE_REC_RISING ?
+					GPIOD_LINE_EVENT_RISING_EDGE :
+					GPIOD_LINE_EVENT_FALLING_EDGE;
+		event->offset = reader->offsets[index];
+		reader->seqno += lost + extra + 1;
+		reader->line_seqno[index] += lost + extra + 1;
+		event->seqno = reader->seqno;
+		event->line_seqno = reader->line_seqno[index];
+		event->num_events = extra + 1;
+	}
+
+	return i;
+}
@@ -8,6 +8,7 @@
 #include <gpiod.h>
 #include <limits.h>
 #include <poll.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -31,6 +32,68 @@ enum {
 struct line_fd_handle {
 	int fd;
 	int refcount;
+
+	/* Was the file descriptor switched to non-blocking mode? */
+	bool nonblock;
+
+	/* Output writes passed to the kernel and elided by the shadow cache. */
+	unsigned long long writes_issued;
+	unsigned long long writes_skipped;
+
+	/*
+	 * Number of lines of the request with a software event filter, rate
+	 * limit or coalescing enabled. Lines of one request may be released
+	 * or reconfigured from different threads so it's updated atomically.
+	 */
+	unsigned int num_filters;
+};
+
+/*
+ * Software debounce and glitch filter. Edges closer to each other than the
+ * settle period form a burst which is held back until the line has been
+ * stable for that long. A burst is then reported as a single event for the
+ * last edge - or not at all if the line ended up where it started.
+ */
+struct line_event_filter {
+	__u64 stable_ns;
+	__u64 min_pulse_ns;
+	__u64 settle_ns;
+
+	/* Level last reported to the user or -1 if none was yet. */
+	int reported;
+
+	/* The burst currently held back. */
+	bool pending;
+	struct gpio_v2_line_event first;
+	struct gpio_v2_line_event last;
+	unsigned int num_raw;
+
+	/* Read by gpiod_line_get_event_filter_stats() from any thread. */
+	unsigned long long num_bounces;
+	unsigned long long num_glitches;
+};
+
+/*
+ * Events that made it through the filter are merged into runs if coalescing
+ * is enabled. Single events or whole runs then have to pass a token bucket
+ * whose credit is kept in nanoseconds: each event costs one interval and
+ * the credit grows with the time elapsed between the events.
+ */
+struct line_event_limit {
+	__u64 interval_ns;
+	__u64 max_credit_ns;
+	__u64 credit_ns;
+	__u64 last_ts_ns;
+
+	__u64 window_ns;
+	bool run_open;
+	__u64 run_start_ns;
+	struct gpiod_line_event_ext run;
+
+	/* Read by gpiod_line_get_event_limit_stats() from any thread. */
+	unsigned long long num_passed;
+	unsigned long long num_dropped;
+	unsigned long long num_coalesced;
 };
 
 struct gpiod_line {
@@ -45,6 +108,35 @@ struct gpiod_line {
 	/* The logical value last written to the line. */
 	int output_value;
 
+	/* Is output_value known to reflect the current state of the line? */
+	bool output_valid;
+
+	/* Position of the line within the kernel request it belongs to. */
+	unsigned int req_index;
+
+	/* The request type provided to request the line. */
+	int req_type;
+
+	/*
+	 * Logical value of an input line as tracked from its edge events,
+	 * valid only if input_valid is set. input_sync_ns is taken before the
+	 * value is read, so events timestamped before it predate the value
+	 * and are not applied to it, while edges racing with the read are
+	 * applied again which is harmless.
+	 */
+	int input_value;
+	bool input_valid;
+	__u64 input_sync_ns;
+
+	/* Sequence number of the last event read for this line. */
+	__u32 last_line_seqno;
+
+	/* Software event filter or NULL if not enabled. */
+	struct line_event_filter *filter;
+
+	/* Rate limit and coalescing or NULL if neither is enabled. */
+	struct line_event_limit *limit;
+
 	/* The GPIOLINE_FLAGs returned by GPIO_GET_LINEINFO_IOCTL. */
 	__u32 info_flags;
 
@@ -69,6 +161,8 @@ struct gpiod_chip {
 
 	struct gpiod_line **lines;
 	unsigned int num_lines;
+	/* Serializes line info updates done by gpiod_chip_get_line(). */
+	pthread_mutex_t info_lock;
 
 	int fd;
 
@@ -277,6 +371,7 @@ GPIOD_API struct gpiod_chip *gpiod_chip_open(const char *path)
 	chip->fd = fd;
 	chip->num_lines = info.lines;
 	chip->refcount = 1;
+	pthread_mutex_init(&chip->info_lock, NULL);
 
 	/*
 	 * GPIO device must have a name - don't bother checking this field. In
@@ -306,7 +401,7 @@ err_close_fd:
 
 GPIOD_API struct gpiod_chip *gpiod_chip_ref(struct gpiod_chip *chip)
 {
-	chip->refcount++;
+	__atomic_add_fetch(&chip->refcount, 1, __ATOMIC_RELAXED);
 	return chip;
 }
 
@@ -315,8 +410,12 @@ GPIOD_API void gpiod_chip_unref(struct gpiod_chip *chip)
 	struct gpiod_line *line;
 	unsigned int i;
 
-	chip->refcount--;
-	if (chip->refcount > 0)
+	/*
+	 * Release ordering makes all accesses to the chip by this thread
+	 * happen before the teardown in whichever thread drops the last
+	 * reference.
+	 */
+	if (__atomic_sub_fetch(&chip->refcount, 1, __ATOMIC_ACQ_REL) > 0)
 		return;
 
 	if (chip->lines) {
@@ -331,6 +430,7 @@ GPIOD_API void gpiod_chip_unref(struct gpiod_chip *chip)
 		free(chip->lines);
 	}
 
+	pthread_mutex_destroy(&chip->info_lock);
 	close(chip->fd);
 	free(chip);
 }
@@ -352,10 +452,36 @@ GPIOD_API unsigned int gpiod_chip_get_num_lines(struct gpiod_chip *chip)
 
 static int line_update(struct gpiod_line *line);
 
+/*
+ * The array of line objects is allocated on first use. Two threads may race
+ * to do it - only one of them gets to install its array.
+ */
+static struct gpiod_line **chip_get_lines_array(struct gpiod_chip *chip)
+{
+	struct gpiod_line **lines, **expected = NULL;
+
+	lines = __atomic_load_n(&chip->lines, __ATOMIC_ACQUIRE);
+	if (lines)
+		return lines;
+
+	lines = calloc(chip->num_lines, sizeof(struct gpiod_line *));
+	if (!lines)
+		return NULL;
+
+	if (!__atomic_compare_exchange_n(&chip->lines, &expected, lines,
+					 false, __ATOMIC_ACQ_REL,
+					 __ATOMIC_ACQUIRE)) {
+		free(lines);
+		lines = expected;
+	}
+
+	return lines;
+}
+
 GPIOD_API struct gpiod_line *
 gpiod_chip_get_line(struct gpiod_chip *chip, unsigned int offset)
 {
-	struct gpiod_line *line;
+	struct gpiod_line **lines, *line, *expected = NULL;
 	int rv;
 
 	if (offset >= chip->num_lines) {
@@ -363,14 +489,12 @@ gpiod_chip_get_line(struct gpiod_chip *chip, unsigned int offset)
 		return NULL;
 	}
 
-	if (!chip->lines) {
-		chip->lines = calloc(chip->num_lines,
-				     sizeof(struct gpiod_line *));
-		if (!chip->lines)
-			return NULL;
-	}
+	lines = chip_get_lines_array(chip);
+	if (!lines)
+		return NULL;
 
-	if (!chip->lines[offset]) {
+	line = __atomic_load_n(&lines[offset], __ATOMIC_ACQUIRE);
+	if (!line) {
 		line = malloc(sizeof(*line));
 		if (!line)
 			return NULL;
@@ -380,9 +504,13 @@ gpiod_chip_get_line(struct gpiod_chip *chip, unsigned int offset)
 		line->offset = offset;
 		line->chip = chip;
 
-		chip->lines[offset] = line;
-	} else {
-		line = chip->lines[offset];
+		/* Another thread may have created this line in the meantime. */
+		if (!__atomic_compare_exchange_n(&lines[offset], &expected,
+						 line, false, __ATOMIC_ACQ_REL,
+						 __ATOMIC_ACQUIRE)) {
+			free(line);
+			line = expected;
+		}
 	}
 
 	rv = line_update(line);
@@ -400,24 +528,42 @@ static struct line_fd_handle *line_make_fd_handle(int fd)
 	if (!handle)
 		return NULL;
 
+	memset(handle, 0, sizeof(*handle));
 	handle->fd = fd;
-	handle->refcount = 0;
 
 	return handle;
 }
 
+static int line_make_event_fd_nonblock(struct line_fd_handle *handle)
+{
+	int flags;
+
+	flags = fcntl(handle->fd, F_GETFL);
+	if (flags < 0)
+		return -1;
+
+	if (fcntl(handle->fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return -1;
+
+	handle->nonblock = true;
+
+	return 0;
+}
+
 static void line_fd_incref(struct gpiod_line *line)
 {
-	line->fd_handle->refcount++;
+	__atomic_add_fetch(&line->fd_handle->refcount, 1, __ATOMIC_RELAXED);
 }
 
 static void line_fd_decref(struct gpiod_line *line)
 {
 	struct line_fd_handle *handle = line->fd_handle;
 
-	handle->refcount--;
-
-	if (handle->refcount == 0) {
+	/*
+	 * Different lines of a request may be released from different threads
+	 * at once - the last one closes the descriptor.
+	 */
+	if (__atomic_sub_fetch(&handle->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
 		close(handle->fd);
 		free(handle);
 		line->fd_handle = NULL;
@@ -514,6 +660,10 @@ static int line_info_v2_to_info_flags(struct gpio_v2_line_info *info)
 	return iflags;
 }
 
+/*
+ * Lookups and requests of the same line may race, serialize the updates of
+ * the cached line info.
+ */
 static int line_update(struct gpiod_line *line)
 {
 	struct gpio_v2_line_info info;
@@ -522,9 +672,13 @@ static int line_update(struct gpiod_line *line)
 	memset(&info, 0, sizeof(info));
 	info.offset = line->offset;
 
+	pthread_mutex_lock(&line->chip->info_lock);
+
 	rv = ioctl(line->chip->fd, GPIO_V2_GET_LINEINFO_IOCTL, &info);
-	if (rv < 0)
+	if (rv < 0) {
+		pthread_mutex_unlock(&line->chip->info_lock);
 		return -1;
+	}
 
 	line->direction = info.flags & GPIO_V2_LINE_FLAG_OUTPUT
 						? GPIOD_LINE_DIRECTION_OUTPUT
@@ -537,6 +691,8 @@ static int line_update(struct gpiod_line *line)
 	strncpy(line->name, info.name, sizeof(line->name));
 	strncpy(line->consumer, info.consumer, sizeof(line->consumer));
 
+	pthread_mutex_unlock(&line->chip->info_lock);
+
 	return 0;
 }
 
@@ -686,9 +842,13 @@ static void lines_bitmap_assign_bit(__u64 *bits, int nr, bool value)
 		lines_bitmap_clear_bit(bits, nr);
 }
 
-static int line_request_values(struct gpiod_line_bulk *bulk,
-			       const struct gpiod_line_request_config *config,
-			       const int *vals)
+/*
+ * Request all lines in the bulk with a single GPIO_V2_GET_LINE_IOCTL so that
+ * they share one file descriptor.
+ */
+static int line_request_single_fd(struct gpiod_line_bulk *bulk,
+			const struct gpiod_line_request_config *config,
+			const int *vals, int state)
 {
 	struct gpiod_line *line;
 	struct line_fd_handle *line_fd;
@@ -737,12 +897,28 @@ static int line_request_values(struct gpiod_line_bulk *bulk,
 	if (!line_fd)
 		return -1;
 
+	if (state == LINE_REQUESTED_EVENTS &&
+	    (config->flags & GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK)) {
+		rv = line_make_event_fd_nonblock(line_fd);
+		if (rv) {
+			close(line_fd->fd);
+			free(line_fd);
+			return -1;
+		}
+	}
+
 	line_bulk_foreach_line(bulk, line, i) {
-		line->state = LINE_REQUESTED_VALUES;
+		line->state = state;
 		line->req_flags = config->flags;
-		if (config->request_type == GPIOD_LINE_REQUEST_DIRECTION_OUTPUT)
+		line->req_type = config->request_type;
+		line->req_index = i;
+		line->output_valid = config->request_type ==
+					GPIOD_LINE_REQUEST_DIRECTION_OUTPUT;
+		if (line->output_valid)
 			line->output_value = lines_bitmap_test_bit(
 				req.config.attrs[0].attr.values, i);
+		line->input_valid = false;
+		line->last_line_seqno = 0;
 		line_set_fd(line, line_fd);
 
 		rv = line_update(line);
@@ -755,6 +931,14 @@ static int line_request_values(struct gpiod_line_bulk *bulk,
 	return 0;
 }
 
+static int line_request_values(struct gpiod_line_bulk *bulk,
+			       const struct gpiod_line_request_config *config,
+			       const int *vals)
+{
+	return line_request_single_fd(bulk, config, vals,
+				      LINE_REQUESTED_VALUES);
+}
+
 static int line_request_event_single(struct gpiod_line *line,
 			const struct gpiod_line_request_config *config)
 {
@@ -780,8 +964,22 @@ static int line_request_event_single(struct gpiod_line *line,
 	if (!line_fd)
 		return -1;
 
+	if (config->flags & GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK) {
+		rv = line_make_event_fd_nonblock(line_fd);
+		if (rv) {
+			close(line_fd->fd);
+			free(line_fd);
+			return -1;
+		}
+	}
+
 	line->state = LINE_REQUESTED_EVENTS;
 	line->req_flags = config->flags;
+	line->req_type = config->request_type;
+	line->req_index = 0;
+	line->output_valid = false;
+	line->input_valid = false;
+	line->last_line_seqno = 0;
 	line_set_fd(line, line_fd);
 
 	rv = line_update(line);
@@ -800,6 +998,10 @@ static int line_request_events(struct gpiod_line_bulk *bulk,
 	unsigned int off;
 	int rv, rev;
 
+	if (config->flags & GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD)
+		return line_request_single_fd(bulk, config, NULL,
+					      LINE_REQUESTED_EVENTS);
+
 	line_bulk_foreach_line(bulk, line, off) {
 		rv = line_request_event_single(line, config);
 		if (rv) {
@@ -852,6 +1054,10 @@ gpiod_line_request_bulk(struct gpiod_line_bulk *bulk,
 	return -1;
 }
 
+static void line_filter_set(struct gpiod_line *line,
+			    struct line_event_filter *filter,
+			    struct line_event_limit *limit);
+
 GPIOD_API void gpiod_line_release(struct gpiod_line *line)
 {
 	struct gpiod_line_bulk bulk = BULK_SINGLE_LINE_INIT(line);
@@ -866,12 +1072,54 @@ GPIOD_API void gpiod_line_release_bulk(struct gpiod_line_bulk *bulk)
 
 	line_bulk_foreach_line(bulk, line, idx) {
 		if (line->state != LINE_FREE) {
+			line_filter_set(line, NULL, NULL);
+
 			line_fd_decref(line);
 			line->state = LINE_FREE;
 		}
 	}
 }
 
+static bool line_input_cache_enabled(struct gpiod_line *line)
+{
+	/* We can only follow the line level if we see every edge. */
+	return (line->req_flags & GPIOD_LINE_REQUEST_FLAG_INPUT_CACHE) &&
+	       line->req_type == GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES;
+}
+
+static bool line_input_cached(struct gpiod_line *line)
+{
+	return line_input_cache_enabled(line) && line->input_valid;
+}
+
+static void line_input_cache_sync(struct gpiod_line *line, int value,
+				  __u64 sync_ns)
+{
+	line->input_value = value;
+	line->input_valid = true;
+	line->input_sync_ns = sync_ns;
+}
+
+static void line_input_cache_update(struct gpiod_line *line,
+				    const struct gpio_v2_line_event *event)
+{
+	/*
+	 * A gap in the sequence numbers means we missed some events - either
+	 * the kernel FIFO overflowed or someone read the file descriptor
+	 * directly. Stop trusting the cache until it's resynchronized.
+	 */
+	if (event->line_seqno != line->last_line_seqno + 1)
+		line->input_valid = false;
+
+	line->last_line_seqno = event->line_seqno;
+
+	if (!line_input_cached(line) ||
+	    event->timestamp_ns < line->input_sync_ns)
+		return;
+
+	line->input_value = event->id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+}
+
 GPIOD_API int gpiod_line_get_value(struct gpiod_line *line)
 {
 	struct gpiod_line_bulk bulk = BULK_SINGLE_LINE_INIT(line);
@@ -888,46 +1136,71 @@ GPIOD_API int gpiod_line_get_value_bulk(struct gpiod_line_bulk *bulk,
 					int *values)
 {
 	struct gpio_v2_line_values lv;
-	struct gpiod_line *line;
-	unsigned int i;
-	int rv, fd;
+	struct gpiod_line *line, *other;
+	unsigned int i, j;
+	__u64 sync_ns;
+	bool *done;
+	int rv = 0;
 
 	if (!line_bulk_all_requested(bulk))
 		return -1;
 
-	line = gpiod_line_bulk_get_line(bulk, 0);
+	/* Lines of separate requests may make up a bulk of any size. */
+	done = calloc(bulk->num_lines, sizeof(*done));
+	if (!done)
+		return -1;
 
-	memset(&lv, 0, sizeof(lv));
+	line_bulk_foreach_line(bulk, line, i) {
+		done[i] = line_input_cached(line);
+		if (done[i])
+			values[i] = line->input_value;
+	}
+
+	/*
+	 * Lines requested together share a file descriptor - read all of
+	 * them with a single ioctl() per request.
+	 */
+	line_bulk_foreach_line(bulk, line, i) {
+		if (done[i])
+			continue;
+
+		memset(&lv, 0, sizeof(lv));
 
-	if (line->state == LINE_REQUESTED_VALUES) {
-		for (i = 0; i < gpiod_line_bulk_num_lines(bulk); i++)
-			lines_bitmap_set_bit(&lv.mask, i);
+		for (j = i; j < bulk->num_lines; j++) {
+			other = bulk->lines[j];
+			if (!done[j] && other->fd_handle == line->fd_handle)
+				lines_bitmap_set_bit(&lv.mask, other->req_index);
+		}
 
-		fd = line_get_fd(line);
+		/*
+		 * Take the timestamp before reading the values so that no
+		 * edge can slip in between the two and get lost.
+		 */
+		sync_ns = monotonic_ns();
 
-		rv = ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv);
+		rv = ioctl(line_get_fd(line),
+			   GPIO_V2_LINE_GET_VALUES_IOCTL, &lv);
 		if (rv < 0)
-			return -1;
+			break;
 
-		for (i = 0; i < gpiod_line_bulk_num_lines(bulk); i++)
-			values[i] = lines_bitmap_test_bit(lv.bits, i);
+		for (j = i; j < bulk->num_lines; j++) {
+			other = bulk->lines[j];
+			if (done[j] || other->fd_handle != line->fd_handle)
+				continue;
 
-	} else if (line->state == LINE_REQUESTED_EVENTS) {
-		lines_bitmap_set_bit(&lv.mask, 0);
-		for (i = 0; i < gpiod_line_bulk_num_lines(bulk); i++) {
-			line = gpiod_line_bulk_get_line(bulk, i);
+			values[j] = lines_bitmap_test_bit(lv.bits,
+							  other->req_index);
+			if (line_input_cache_enabled(other))
+				line_input_cache_sync(other, values[j],
+						      sync_ns);
 
-			fd = line_get_fd(line);
-			rv = ioctl(fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv);
-			if (rv < 0)
-				return -1;
-			values[i] = lines_bitmap_test_bit(lv.bits, 0);
+			done[j] = true;
 		}
-	} else {
-		errno = EINVAL;
-		return -1;
 	}
-	return 0;
+
+	free(done);
+
+	return rv < 0 ? -1 : 0;
 }
 
 GPIOD_API int gpiod_line_set_value(struct gpiod_line *line, int value)
@@ -937,33 +1210,149 @@ GPIOD_API int gpiod_line_set_value(struct gpiod_line *line, int value)
 	return gpiod_line_set_value_bulk(&bulk, &value);
 }
 
+static bool line_output_cached(struct gpiod_line *line, int value)
+{
+	return (line->req_flags & GPIOD_LINE_REQUEST_FLAG_OUTPUT_CACHE) &&
+	       line->output_valid && line->output_value == value;
+}
+
 GPIOD_API int gpiod_line_set_value_bulk(struct gpiod_line_bulk *bulk,
 					const int *values)
+{
+	unsigned long long bits = 0;
+	unsigned int i;
+
+	if (bulk->num_lines > LINE_REQUEST_MAX_LINES) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; values && i < bulk->num_lines; i++) {
+		if (values[i])
+			bits |= 1ULL << i;
+	}
+
+	return gpiod_line_set_value_bulk_mask(bulk, ~0ULL, bits);
+}
+
+GPIOD_API int gpiod_line_set_value_bulk_mask(struct gpiod_line_bulk *bulk,
+					     unsigned long long mask,
+					     unsigned long long bits)
 {
 	struct gpio_v2_line_values lv;
-	struct gpiod_line *line;
 	unsigned int i;
-	int rv, fd;
+	struct gpiod_line *line;
+	int rv, fd, val;
 
 	if (!line_bulk_all_requested(bulk))
 		return -1;
 
 	memset(&lv, 0, sizeof(lv));
 
-	for (i = 0; i < gpiod_line_bulk_num_lines(bulk); i++) {
-		lines_bitmap_set_bit(&lv.mask, i);
-		lines_bitmap_assign_bit(&lv.bits, i, values && values[i]);
+	line_bulk_foreach_line(bulk, line, i) {
+		if (i >= LINE_REQUEST_MAX_LINES || !(mask & (1ULL << i)))
+			continue;
+
+		val = !!(bits & (1ULL << i));
+
+		if (line_output_cached(line, val))
+			continue;
+
+		lines_bitmap_set_bit(&lv.mask, line->req_index);
+		lines_bitmap_assign_bit(&lv.bits, line->req_index, val);
 	}
 
 	line = gpiod_line_bulk_get_line(bulk, 0);
+
+	/*
+	 * Every line already holds the requested value - nothing to do. The
+	 * counters may be read from other threads at any time.
+	 */
+	if (!lv.mask) {
+		__atomic_add_fetch(&line->fd_handle->writes_skipped, 1,
+				   __ATOMIC_RELAXED);
+		return 0;
+	}
+
 	fd = line_get_fd(line);
 
 	rv = ioctl(fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv);
 	if (rv < 0)
 		return -1;
 
-	line_bulk_foreach_line(bulk, line, i)
-		line->output_value = lines_bitmap_test_bit(lv.bits, i);
+	__atomic_add_fetch(&line->fd_handle->writes_issued, 1,
+			   __ATOMIC_RELAXED);
+
+	line_bulk_foreach_line(bulk, line, i) {
+		if (i >= LINE_REQUEST_MAX_LINES || !(mask & (1ULL << i)))
+			continue;
+
+		line->output_value = !!(bits & (1ULL << i));
+		line->output_valid = true;
+	}
+
+	return 0;
+}
+
+int line_bulk_request_bits(struct gpiod_line_bulk *bulk, uint64_t *bits)
+{
+	struct gpiod_line *line, *first;
+	unsigned int i;
+
+	if (!line_bulk_all_requested(bulk))
+		return -1;
+
+	first = gpiod_line_bulk_get_line(bulk, 0);
+
+	line_bulk_foreach_line(bulk, line, i) {
+		if (line->fd_handle != first->fd_handle) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		bits[i] = 1ULL << line->req_index;
+	}
+
+	return line_get_fd(first);
+}
+
+void line_output_sync(struct gpiod_line *line, int value)
+{
+	line->output_value = value;
+	line->output_valid = true;
+}
+
+void line_output_invalidate(struct gpiod_line *line)
+{
+	line->output_valid = false;
+}
+
+int line_request_type(struct gpiod_line *line)
+{
+	return line_is_requested(line) ? line->req_type : -1;
+}
+
+bool line_fd_shared(struct gpiod_line *line)
+{
+	return line_is_requested(line) &&
+	       __atomic_load_n(&line->fd_handle->refcount,
+			       __ATOMIC_RELAXED) > 1;
+}
+
+GPIOD_API int
+gpiod_line_get_output_stats(struct gpiod_line *line,
+			    struct gpiod_line_output_stats *stats)
+{
+	if (!line_is_requested(line)) {
+		errno = EPERM;
+		return -1;
+	}
+
+	stats->writes_issued = __atomic_load_n(&line->fd_handle->writes_issued,
+					       __ATOMIC_RELAXED);
+	stats->writes_skipped = __atomic_load_n(
+					&line->fd_handle->writes_skipped,
+					__ATOMIC_RELAXED);
 
 	return 0;
 }
@@ -1014,7 +1403,9 @@ GPIOD_API int gpiod_line_set_config_bulk(struct gpiod_line_bulk *bulk,
 
 	line_bulk_foreach_line(bulk, line, i) {
 		line->req_flags = flags;
-		if (direction == GPIOD_LINE_REQUEST_DIRECTION_OUTPUT)
+		line->output_valid = direction ==
+					GPIOD_LINE_REQUEST_DIRECTION_OUTPUT;
+		if (line->output_valid)
 			line->output_value = lines_bitmap_test_bit(
 				hcfg.attrs[0].attr.values, i);
 
@@ -1143,98 +1534,932 @@ GPIOD_API int gpiod_line_event_wait_bulk(struct gpiod_line_bulk *bulk,
 	return 1;
 }
 
-GPIOD_API int gpiod_line_event_read(struct gpiod_line *line,
-				    struct gpiod_line_event *event)
+/*
+ * The kernel stores up to 16 events per line in the FIFO of a request. For
+ * requests spanning multiple lines this can be more than we're willing to
+ * put on the stack so limit the number of events read at once - the caller
+ * will get the rest on the next read.
+ */
+#define LINE_EVENT_MAX_READ	64
+
+static int line_event_read_raw(int fd, struct gpio_v2_line_event *evdata,
+			       unsigned int num_events)
 {
-	int ret;
+	ssize_t rd;
 
-	ret = gpiod_line_event_read_multiple(line, event, 1);
-	if (ret < 0)
+	if (num_events > LINE_EVENT_MAX_READ)
+		num_events = LINE_EVENT_MAX_READ;
+
+	memset(evdata, 0, num_events * sizeof(*evdata));
+
+	rd = read(fd, evdata, num_events * sizeof(*evdata));
+	if (rd < 0) {
+		return -1;
+	} else if ((unsigned int)rd < sizeof(*evdata)) {
+		errno = EIO;
 		return -1;
+	}
 
-	return 0;
+	return rd / sizeof(*evdata);
 }
 
-GPIOD_API int gpiod_line_event_read_multiple(struct gpiod_line *line,
-					     struct gpiod_line_event *events,
-					     unsigned int num_events)
+static void line_event_from_v2(const struct gpio_v2_line_event *evdata,
+			       struct gpiod_line_event_ext *event)
 {
-	int fd;
+	event->offset = evdata->offset;
+	event->event_type = evdata->id == GPIO_V2_LINE_EVENT_RISING_EDGE
+					? GPIOD_LINE_EVENT_RISING_EDGE
+					: GPIOD_LINE_EVENT_FALLING_EDGE;
+	event->ts.tv_sec = evdata->timestamp_ns / 1000000000ULL;
+	event->ts.tv_nsec = evdata->timestamp_ns % 1000000000ULL;
+	event->seqno = evdata->seqno;
+	event->line_seqno = evdata->line_seqno;
+	event->first_ts = event->ts;
+	event->num_events = 1;
+}
+
+/* Returns the number of events stored - zero or one. */
+static unsigned int line_limit_rate(struct gpiod_line *line,
+				    const struct gpiod_line_event_ext *event,
+				    struct gpiod_line_event_ext *out)
+{
+	struct line_event_limit *limit = line->limit;
+	__u64 ts;
+
+	if (limit->interval_ns) {
+		/* Refill the bucket with the time elapsed since last event. */
+		ts = timespec_to_ns(&event->ts);
+		if (ts > limit->last_ts_ns) {
+			if (limit->last_ts_ns)
+				limit->credit_ns += ts - limit->last_ts_ns;
+			if (limit->credit_ns > limit->max_credit_ns)
+				limit->credit_ns = limit->max_credit_ns;
+
+			limit->last_ts_ns = ts;
+		}
 
-	fd = gpiod_line_event_get_fd(line);
-	if (fd < 0)
-		return -1;
+		if (limit->credit_ns < limit->interval_ns) {
+			counter_add(&limit->num_dropped, event->num_events);
+			return 0;
+		}
+
+		limit->credit_ns -= limit->interval_ns;
+	}
+
+	*out = *event;
+	counter_add(&limit->num_passed, 1);
 
-	return gpiod_line_event_read_fd_multiple(fd, events, num_events);
+	return 1;
 }
 
-GPIOD_API int gpiod_line_event_get_fd(struct gpiod_line *line)
+static void line_limit_close_run(struct gpiod_line *line,
+				 struct gpiod_line_event_ext *events,
+				 unsigned int *num_events)
 {
-	if (line->state != LINE_REQUESTED_EVENTS) {
-		errno = EPERM;
-		return -1;
-	}
+	struct line_event_limit *limit = line->limit;
 
-	return line_get_fd(line);
+	limit->run_open = false;
+	counter_add(&limit->num_coalesced, limit->run.num_events - 1);
+	*num_events += line_limit_rate(line, &limit->run,
+				       &events[*num_events]);
 }
 
-GPIOD_API int gpiod_line_event_read_fd(int fd, struct gpiod_line_event *event)
+/*
+ * Pass an event through the rate limiter and the coalescing stage of the
+ * line. Returns the number of events stored - zero or one.
+ */
+static unsigned int line_limit_push(struct gpiod_line *line,
+				    const struct gpiod_line_event_ext *event,
+				    struct gpiod_line_event_ext *out)
 {
-	int ret;
+	struct line_event_limit *limit = line->limit;
+	struct timespec first_ts;
+	unsigned long count;
+	unsigned int num = 0;
+	__u64 ts;
 
-	ret = gpiod_line_event_read_fd_multiple(fd, event, 1);
-	if (ret < 0)
-		return -1;
+	if (!limit->window_ns)
+		return line_limit_rate(line, event, out);
 
-	return 0;
-}
+	ts = timespec_to_ns(&event->ts);
 
-GPIOD_API int gpiod_line_event_read_fd_multiple(int fd,
-						struct gpiod_line_event *events,
-						unsigned int num_events)
-{
-	/*
-	 * 16 is the maximum number of events the kernel can store in the FIFO
-	 * so we can allocate the buffer on the stack.
-	 *
-	 * NOTE: This is no longer strictly true for uAPI v2.  While 16 is
-	 * the default for single line, a request with multiple lines will
-	 * have a larger buffer.  So need to rethink the allocation here,
-	 * or at least the comment above...
-	 */
-	struct gpio_v2_line_event evdata[16], *curr;
-	struct gpiod_line_event *event;
-	unsigned int events_read, i;
-	ssize_t rd;
+	if (limit->run_open) {
+		if (ts - limit->run_start_ns < limit->window_ns) {
+			first_ts = limit->run.first_ts;
+			count = limit->run.num_events;
 
-	memset(evdata, 0, sizeof(evdata));
+			limit->run = *event;
+			limit->run.first_ts = first_ts;
+			limit->run.num_events += count;
 
-	if (num_events > 16)
-		num_events = 16;
+			return 0;
+		}
 
-	rd = read(fd, evdata, num_events * sizeof(*evdata));
-	if (rd < 0) {
+		line_limit_close_run(line, out, &num);
+	}
+
+	limit->run_open = true;
+	limit->run_start_ns = ts;
+	limit->run = *event;
+
+	return num;
+}
+
+static void line_filter_resolve(struct gpiod_line *line,
+				struct gpiod_line_event_ext *events,
+				unsigned int *num_events)
+{
+	struct line_event_filter *filter = line->filter;
+	struct gpiod_line_event_ext event;
+	int level, reported;
+
+	filter->pending = false;
+
+	level = filter->last.id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+	reported = filter->reported;
+	/* Nothing reported yet - the first edge tells us where we started. */
+	if (reported < 0)
+		reported = filter->first.id != GPIO_V2_LINE_EVENT_RISING_EDGE;
+
+	/*
+	 * With only one kind of edge requested we can't follow the level -
+	 * each burst is reported.
+	 */
+	if (level != reported ||
+	    line->req_type != GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES) {
+		counter_add(&filter->num_bounces, filter->num_raw - 1);
+		filter->reported = level;
+
+		line_event_from_v2(&filter->last, &event);
+		if (line->limit)
+			*num_events += line_limit_push(line, &event,
+						       &events[*num_events]);
+		else
+			events[(*num_events)++] = event;
+
+		return;
+	}
+
+	filter->reported = reported;
+
+	if (filter->last.timestamp_ns - filter->first.timestamp_ns <
+	    filter->min_pulse_ns)
+		counter_add(&filter->num_glitches, filter->num_raw);
+	else
+		counter_add(&filter->num_bounces, filter->num_raw);
+}
+
+/* Returns the number of events stored - zero or one. */
+static unsigned int line_filter_push(struct gpiod_line *line,
+				     const struct gpio_v2_line_event *evdata,
+				     struct gpiod_line_event_ext *events)
+{
+	struct line_event_filter *filter = line->filter;
+	unsigned int num = 0;
+
+	if (filter->pending) {
+		if (evdata->timestamp_ns - filter->last.timestamp_ns <
+		    filter->settle_ns) {
+			filter->last = *evdata;
+			filter->num_raw++;
+			return 0;
+		}
+
+		/* The previous burst had settled before this edge. */
+		line_filter_resolve(line, events, &num);
+	}
+
+	filter->pending = true;
+	filter->first = filter->last = *evdata;
+	filter->num_raw = 1;
+
+	return num;
+}
+
+static bool line_request_filtered(struct gpiod_line *line)
+{
+	return __atomic_load_n(&line->fd_handle->num_filters,
+			       __ATOMIC_RELAXED) != 0;
+}
+
+unsigned int line_filter_flush(struct gpiod_line *line,
+			       struct gpiod_line_event_ext *events,
+			       unsigned int num_events)
+{
+	struct gpiod_line **lines = line->chip->lines, *other;
+	unsigned int i, num = 0;
+	__u64 now;
+
+	if (!line_request_filtered(line))
+		return 0;
+
+	now = monotonic_ns();
+
+	for (i = 0; i < line->chip->num_lines && num < num_events; i++) {
+		other = lines[i];
+		if (!other || other->fd_handle != line->fd_handle)
+			continue;
+
+		if (other->filter && other->filter->pending &&
+		    other->filter->last.timestamp_ns +
+		    other->filter->settle_ns <= now)
+			line_filter_resolve(other, events, &num);
+
+		/* The burst resolved above may have opened a new run. */
+		if (other->limit && other->limit->run_open &&
+		    other->limit->run_start_ns +
+		    other->limit->window_ns <= now && num < num_events)
+			line_limit_close_run(other, events, &num);
+	}
+
+	return num;
+}
+
+uint64_t line_filter_deadline(struct gpiod_line *line)
+{
+	struct gpiod_line **lines = line->chip->lines, *other;
+	__u64 deadline = 0;
+	unsigned int i;
+
+	if (line->state != LINE_REQUESTED_EVENTS ||
+	    !line_request_filtered(line))
+		return 0;
+
+	for (i = 0; i < line->chip->num_lines; i++) {
+		other = lines[i];
+		if (!other || other->fd_handle != line->fd_handle)
+			continue;
+
+		if (other->filter && other->filter->pending)
+			deadline = deadline_min(deadline,
+					other->filter->last.timestamp_ns +
+					other->filter->settle_ns);
+
+		if (other->limit && other->limit->run_open)
+			deadline = deadline_min(deadline,
+					other->limit->run_start_ns +
+					other->limit->window_ns);
+	}
+
+	return deadline;
+}
+
+unsigned int line_events_from_raw(struct gpiod_line *line,
+				  const struct gpio_v2_line_event *evdata,
+				  struct gpiod_line_event_ext *events,
+				  unsigned int num_events)
+{
+	struct gpiod_line_event_ext event;
+	struct gpiod_line *evline;
+	unsigned int i, num = 0;
+
+	for (i = 0; i < num_events; i++) {
+		evline = line->chip->lines[evdata[i].offset];
+		if (!evline) {
+			line_event_from_v2(&evdata[i], &events[num++]);
+			continue;
+		}
+
+		line_input_cache_update(evline, &evdata[i]);
+
+		if (evline->filter) {
+			num += line_filter_push(evline, &evdata[i],
+						&events[num]);
+		} else if (evline->limit) {
+			line_event_from_v2(&evdata[i], &event);
+			num += line_limit_push(evline, &event, &events[num]);
+		} else {
+			line_event_from_v2(&evdata[i], &events[num++]);
+		}
+	}
+
+	return num;
+}
+
+GPIOD_API int gpiod_line_event_read(struct gpiod_line *line,
+				    struct gpiod_line_event *event)
+{
+	int ret;
+
+	ret = gpiod_line_event_read_multiple(line, event, 1);
+	if (ret < 0)
 		return -1;
-	} else if ((unsigned int)rd < sizeof(*evdata)) {
-		errno = EIO;
+
+	return 0;
+}
+
+/*
+ * Wait until either the request's descriptor becomes readable or the
+ * deadline passes. A deadline of 0 means waiting for the descriptor only.
+ * Errors are left for the caller to find out by reading.
+ */
+static void line_filter_wait(int fd, __u64 deadline)
+{
+	struct timespec timeout, *tsp = NULL;
+	struct pollfd pfd;
+
+	if (deadline) {
+		timeout_until_ns(deadline, &timeout);
+		tsp = &timeout;
+	}
+
+	pfd.fd = fd;
+	pfd.events = POLLIN | POLLPRI;
+
+	ppoll(&pfd, 1, tsp, NULL);
+}
+
+static bool line_event_fd_readable(int fd)
+{
+	struct pollfd pfd;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN | POLLPRI;
+
+	/* On error let the caller find out by reading from the descriptor. */
+	return poll(&pfd, 1, 0) != 0;
+}
+
+int line_event_read_filtered(struct gpiod_line *line,
+			     struct gpiod_line_event_ext *events,
+			     unsigned int num_events)
+{
+	struct gpio_v2_line_event evdata[LINE_EVENT_MAX_READ];
+	unsigned int num;
+	int fd, rv;
+
+	fd = gpiod_line_event_get_fd(line);
+	if (fd < 0)
+		return -1;
+
+	num = line_filter_flush(line, events, num_events);
+	if (num)
+		return num;
+
+	/*
+	 * Held back events are due at times only the caller can wait for,
+	 * along with whatever else it's waiting for - don't get stuck in
+	 * read() on a blocking descriptor past them.
+	 */
+	if (line_request_filtered(line) && !line->fd_handle->nonblock &&
+	    !line_event_fd_readable(fd))
+		return 0;
+
+	rv = line_event_read_raw(fd, evdata, num_events);
+	if (rv < 0)
 		return -1;
+
+	num = line_events_from_raw(line, evdata, events, rv);
+	num += line_filter_flush(line, events + num, num_events - num);
+
+	return num;
+}
+
+/* Strip events down to the basic format. Errors are passed through. */
+static int line_events_to_base(struct gpiod_line_event *events,
+			       const struct gpiod_line_event_ext *ext, int num)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		events[i].ts = ext[i].ts;
+		events[i].event_type = ext[i].event_type;
+		events[i].offset = ext[i].offset;
 	}
 
-	events_read = rd / sizeof(*evdata);
-	if (events_read < num_events)
-		num_events = events_read;
+	return num;
+}
 
-	for (i = 0; i < num_events; i++) {
-		curr = &evdata[i];
-		event = &events[i];
+GPIOD_API int gpiod_line_event_read_multiple(struct gpiod_line *line,
+					     struct gpiod_line_event *events,
+					     unsigned int num_events)
+{
+	struct gpiod_line_event_ext ext[LINE_EVENT_MAX_READ];
+	int rv;
 
-		event->offset = curr->offset;
-		event->event_type = curr->id == GPIO_V2_LINE_EVENT_RISING_EDGE
-					? GPIOD_LINE_EVENT_RISING_EDGE
-					: GPIOD_LINE_EVENT_FALLING_EDGE;
-		event->ts.tv_sec = curr->timestamp_ns / 1000000000ULL;
-		event->ts.tv_nsec = curr->timestamp_ns % 1000000000ULL;
+	if (num_events > LINE_EVENT_MAX_READ)
+		num_events = LINE_EVENT_MAX_READ;
+
+	rv = gpiod_line_event_read_multiple_ext(line, ext, num_events);
+
+	return line_events_to_base(events, ext, rv);
+}
+
+GPIOD_API int
+gpiod_line_event_read_multiple_ext(struct gpiod_line *line,
+				   struct gpiod_line_event_ext *events,
+				   unsigned int num_events)
+{
+	int rv;
+
+	/*
+	 * Keep reading if filters swallowed or held back everything. In
+	 * non-blocking mode that ends with EAGAIN once the descriptor is
+	 * drained.
+	 */
+	for (;;) {
+		rv = line_event_read_filtered(line, events, num_events);
+		if (rv != 0)
+			return rv;
+
+		if (!line->fd_handle->nonblock)
+			line_filter_wait(line_get_fd(line),
+					 line_filter_deadline(line));
+	}
+}
+
+GPIOD_API int
+gpiod_line_event_get_filter_deadline(struct gpiod_line *line,
+				     struct timespec *deadline)
+{
+	__u64 due;
+
+	if (line->state != LINE_REQUESTED_EVENTS) {
+		errno = EPERM;
+		return -1;
+	}
+
+	due = line_filter_deadline(line);
+	if (!due)
+		return 0;
+
+	ns_to_timespec(due, deadline);
+
+	return 1;
+}
+
+/*
+ * Replace the software filter and the rate limit of a line, releasing the
+ * old ones if they're not reused. Edges held back by the old ones are lost.
+ */
+static void line_filter_set(struct gpiod_line *line,
+			    struct line_event_filter *filter,
+			    struct line_event_limit *limit)
+{
+	bool had = line->filter || line->limit;
+
+	if (line->filter != filter)
+		free(line->filter);
+	if (line->limit != limit)
+		free(line->limit);
+
+	line->filter = filter;
+	line->limit = limit;
+
+	if (had && !filter && !limit)
+		__atomic_sub_fetch(&line->fd_handle->num_filters, 1,
+				   __ATOMIC_RELAXED);
+	else if (!had && (filter || limit))
+		__atomic_add_fetch(&line->fd_handle->num_filters, 1,
+				   __ATOMIC_RELAXED);
+}
+
+GPIOD_API int
+gpiod_line_set_event_filter(struct gpiod_line *line,
+			    const struct timespec *stable,
+			    const struct timespec *min_pulse)
+{
+	struct line_event_filter *filter;
+	__u64 stable_ns, min_pulse_ns;
+
+	if (line->state != LINE_REQUESTED_EVENTS) {
+		errno = EPERM;
+		return -1;
+	}
+
+	stable_ns = stable ? timespec_to_ns(stable) : 0;
+	min_pulse_ns = min_pulse ? timespec_to_ns(min_pulse) : 0;
+
+	if (!stable_ns && !min_pulse_ns) {
+		line_filter_set(line, NULL, line->limit);
+		return 0;
+	}
+
+	filter = malloc(sizeof(*filter));
+	if (!filter)
+		return -1;
+
+	memset(filter, 0, sizeof(*filter));
+	filter->stable_ns = stable_ns;
+	filter->min_pulse_ns = min_pulse_ns;
+	filter->settle_ns = stable_ns > min_pulse_ns ? stable_ns : min_pulse_ns;
+	filter->reported = -1;
+
+	line_filter_set(line, filter, line->limit);
+
+	return 0;
+}
+
+GPIOD_API void
+gpiod_line_get_event_filter_stats(struct gpiod_line *line,
+				  struct gpiod_line_event_filter_stats *stats)
+{
+	struct line_event_filter *filter = line->filter;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!filter)
+		return;
+
+	stats->num_bounces = __atomic_load_n(&filter->num_bounces,
+					     __ATOMIC_RELAXED);
+	stats->num_glitches = __atomic_load_n(&filter->num_glitches,
+					      __ATOMIC_RELAXED);
+}
+
+/* Get a copy of the current rate limit settings to modify. */
+static struct line_event_limit *line_limit_dup(struct gpiod_line *line)
+{
+	struct line_event_limit *limit;
+
+	limit = malloc(sizeof(*limit));
+	if (!limit)
+		return NULL;
+
+	if (line->limit)
+		memcpy(limit, line->limit, sizeof(*limit));
+	else
+		memset(limit, 0, sizeof(*limit));
+
+	return limit;
+}
+
+static void line_limit_apply(struct gpiod_line *line,
+			     struct line_event_limit *limit)
+{
+	if (!limit->interval_ns && !limit->window_ns) {
+		free(limit);
+		limit = NULL;
+	}
+
+	line_filter_set(line, line->filter, limit);
+}
+
+GPIOD_API int gpiod_line_set_event_rate_limit(struct gpiod_line *line,
+					      unsigned int rate,
+					      unsigned int burst)
+{
+	struct line_event_limit *limit;
+
+	if (line->state != LINE_REQUESTED_EVENTS) {
+		errno = EPERM;
+		return -1;
+	}
+
+	if (rate > 1000000000 || (rate && !burst)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	limit = line_limit_dup(line);
+	if (!limit)
+		return -1;
+
+	limit->interval_ns = rate ? 1000000000ULL / rate : 0;
+	limit->max_credit_ns = limit->interval_ns * burst;
+	limit->credit_ns = limit->max_credit_ns;
+	limit->last_ts_ns = 0;
+
+	line_limit_apply(line, limit);
+
+	return 0;
+}
+
+GPIOD_API int
+gpiod_line_set_event_coalescing(struct gpiod_line *line,
+				const struct timespec *window)
+{
+	struct line_event_limit *limit;
+
+	if (line->state != LINE_REQUESTED_EVENTS) {
+		errno = EPERM;
+		return -1;
+	}
+
+	limit = line_limit_dup(line);
+	if (!limit)
+		return -1;
+
+	limit->window_ns = window ? timespec_to_ns(window) : 0;
+	limit->run_open = false;
+
+	line_limit_apply(line, limit);
+
+	return 0;
+}
+
+GPIOD_API void
+gpiod_line_get_event_limit_stats(struct gpiod_line *line,
+				 struct gpiod_line_event_limit_stats *stats)
+{
+	struct line_event_limit *limit = line->limit;
+
+	memset(stats, 0, sizeof(*stats));
+
+	if (!limit)
+		return;
+
+	stats->num_passed = __atomic_load_n(&limit->num_passed,
+					    __ATOMIC_RELAXED);
+	stats->num_dropped = __atomic_load_n(&limit->num_dropped,
+					     __ATOMIC_RELAXED);
+	stats->num_coalesced = __atomic_load_n(&limit->num_coalesced,
+					       __ATOMIC_RELAXED);
+}
+
+/* Set of distinct event file descriptors a line bulk maps to. */
+struct line_event_fd_set {
+	unsigned int num_fds;
+	struct gpiod_line *lines[LINE_REQUEST_MAX_LINES];
+	struct pollfd fds[LINE_REQUEST_MAX_LINES];
+	bool nonblock;
+};
+
+static int line_event_fd_set_init(struct gpiod_line_bulk *bulk,
+				  struct line_event_fd_set *set)
+{
+	struct gpiod_line *line;
+	unsigned int i, j;
+
+	memset(set, 0, sizeof(*set));
+	set->nonblock = true;
+
+	line_bulk_foreach_line(bulk, line, i) {
+		if (line->state != LINE_REQUESTED_EVENTS) {
+			errno = EPERM;
+			return -1;
+		}
+
+		for (j = 0; j < set->num_fds; j++) {
+			if (set->lines[j]->fd_handle == line->fd_handle)
+				break;
+		}
+
+		if (j == set->num_fds) {
+			set->lines[j] = line;
+			set->fds[j].fd = line_get_fd(line);
+			set->fds[j].events = POLLIN | POLLPRI;
+			set->nonblock = set->nonblock &&
+					line->fd_handle->nonblock;
+			set->num_fds++;
+		}
+	}
+
+	if (set->num_fds == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Read whatever is pending on the non-blocking descriptors of the set without
+ * waiting. Returns the number of events read.
+ */
+static int line_event_fd_set_try_read(struct line_event_fd_set *set,
+				      struct gpiod_line_event_ext *events,
+				      unsigned int num_events)
+{
+	unsigned int i, num_read = 0;
+	int rv;
+
+	for (i = 0; i < set->num_fds && num_read < num_events; i++) {
+		rv = line_event_read_filtered(set->lines[i],
+					      events + num_read,
+					      num_events - num_read);
+		if (rv < 0) {
+			if (errno == EAGAIN)
+				continue;
+
+			return -1;
+		}
+
+		num_read += rv;
+	}
+
+	return num_read;
+}
+
+static int line_event_fd_set_read(struct line_event_fd_set *set,
+				  const struct timespec *timeout,
+				  struct gpiod_line_event_ext *events,
+				  unsigned int num_events)
+{
+	unsigned int i, num_read = 0;
+	__u64 deadline = 0, wake, due;
+	struct timespec remaining;
+	int rv;
+
+	if (set->nonblock) {
+		/*
+		 * Under load there's usually something to read already -
+		 * don't bother polling in that case.
+		 */
+		rv = line_event_fd_set_try_read(set, events, num_events);
+		if (rv != 0)
+			return rv;
+	} else if (set->num_fds == 1 && !timeout) {
+		/*
+		 * All lines share a single file descriptor and we're willing
+		 * to wait forever: just let read() block, there's no need to
+		 * poll first.
+		 */
+		return gpiod_line_event_read_multiple_ext(set->lines[0],
+							  events, num_events);
+	}
+
+	if (timeout)
+		deadline = monotonic_ns() + timespec_to_ns(timeout);
+
+	for (;;) {
+		/* Also wake up when events held back by filters are due. */
+		wake = deadline;
+		for (i = 0; i < set->num_fds; i++)
+			wake = deadline_min(wake,
+					    line_filter_deadline(set->lines[i]));
+
+		if (wake)
+			timeout_until_ns(wake, &remaining);
+
+		rv = ppoll(set->fds, set->num_fds, wake ? &remaining : NULL,
+			   NULL);
+		if (rv < 0)
+			return -1;
+
+		for (i = 0; i < set->num_fds && num_read < num_events; i++) {
+			if (!set->fds[i].revents) {
+				due = line_filter_deadline(set->lines[i]);
+				if (!due || due > monotonic_ns())
+					continue;
+			}
+
+			if (set->fds[i].revents & POLLNVAL) {
+				errno = EINVAL;
+				return -1;
+			}
+
+			rv = line_event_read_filtered(set->lines[i],
+						      events + num_read,
+						      num_events - num_read);
+			if (rv < 0) {
+				if (errno == EAGAIN)
+					continue;
+
+				return -1;
+			}
+
+			num_read += rv;
+		}
+
+		if (num_read)
+			return num_read;
+
+		/* Software event filters swallowed everything - go on. */
+		if (timeout && monotonic_ns() >= deadline)
+			return 0;
+	}
+}
+
+GPIOD_API int gpiod_line_event_read_bulk(struct gpiod_line_bulk *bulk,
+					 const struct timespec *timeout,
+					 struct gpiod_line_event *events,
+					 unsigned int num_events)
+{
+	struct gpiod_line_event_ext ext[LINE_EVENT_MAX_READ];
+	int rv;
+
+	if (num_events > LINE_EVENT_MAX_READ)
+		num_events = LINE_EVENT_MAX_READ;
+
+	rv = gpiod_line_event_read_bulk_ext(bulk, timeout, ext, num_events);
+
+	return line_events_to_base(events, ext, rv);
+}
+
+GPIOD_API int
+gpiod_line_event_read_bulk_ext(struct gpiod_line_bulk *bulk,
+			       const struct timespec *timeout,
+			       struct gpiod_line_event_ext *events,
+			       unsigned int num_events)
+{
+	struct line_event_fd_set set;
+	int rv;
+
+	if (num_events == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	rv = line_event_fd_set_init(bulk, &set);
+	if (rv)
+		return -1;
+
+	return line_event_fd_set_read(&set, timeout, events, num_events);
+}
+
+static int line_event_fd_set_busy_poll(struct line_event_fd_set *set,
+				       const struct timespec *spin,
+				       const struct timespec *timeout,
+				       struct gpiod_line_event_ext *events,
+				       unsigned int num_events)
+{
+	__u64 start, elapsed, spin_ns, timeout_ns;
+	struct timespec remaining;
+	int rv;
+
+	spin_ns = timespec_to_ns(spin);
+	start = monotonic_ns();
+
+	do {
+		rv = line_event_fd_set_try_read(set, events, num_events);
+		if (rv != 0)
+			return rv;
+
+		elapsed = monotonic_ns() - start;
+	} while (elapsed < spin_ns);
+
+	if (!timeout)
+		return line_event_fd_set_read(set, NULL, events, num_events);
+
+	timeout_ns = timespec_to_ns(timeout);
+	timeout_ns = timeout_ns > elapsed ? timeout_ns - elapsed : 0;
+	ns_to_timespec(timeout_ns, &remaining);
+
+	return line_event_fd_set_read(set, &remaining, events, num_events);
+}
+
+GPIOD_API int
+gpiod_line_event_read_bulk_busy_poll(struct gpiod_line_bulk *bulk,
+				     const struct timespec *spin,
+				     const struct timespec *timeout,
+				     struct gpiod_line_event *events,
+				     unsigned int num_events)
+{
+	struct gpiod_line_event_ext ext[LINE_EVENT_MAX_READ];
+	struct line_event_fd_set set;
+	int rv;
+
+	if (num_events == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	rv = line_event_fd_set_init(bulk, &set);
+	if (rv)
+		return -1;
+
+	/* Spinning on blocking descriptors would never give up the CPU. */
+	if (!set.nonblock) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (num_events > LINE_EVENT_MAX_READ)
+		num_events = LINE_EVENT_MAX_READ;
+
+	rv = line_event_fd_set_busy_poll(&set, spin, timeout, ext, num_events);
+
+	return line_events_to_base(events, ext, rv);
+}
+
+GPIOD_API int gpiod_line_event_get_fd(struct gpiod_line *line)
+{
+	if (line->state != LINE_REQUESTED_EVENTS) {
+		errno = EPERM;
+		return -1;
+	}
+
+	return line_get_fd(line);
+}
+
+GPIOD_API int gpiod_line_event_read_fd(int fd, struct gpiod_line_event *event)
+{
+	int ret;
+
+	ret = gpiod_line_event_read_fd_multiple(fd, event, 1);
+	if (ret < 0)
+		return -1;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_line_event_read_fd_multiple(int fd,
+						struct gpiod_line_event *events,
+						unsigned int num_events)
+{
+	struct gpio_v2_line_event evdata[LINE_EVENT_MAX_READ];
+	struct gpiod_line_event_ext event;
+	int rv, i;
+
+	rv = line_event_read_raw(fd, evdata, num_events);
+	if (rv < 0)
+		return -1;
+
+	for (i = 0; i < rv; i++) {
+		line_event_from_v2(&evdata[i], &event);
+		line_events_to_base(&events[i], &event, 1);
 	}
 
-	return i;
+	return rv;
 }
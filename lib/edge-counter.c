@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Edge counters maintained by a library thread which drains the raw events
+ * straight from the kernel so that no event ever reaches the user.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+#define EDGE_COUNTER_MAX_LINES		64
+#define EDGE_COUNTER_BATCH_SIZE		64
+
+/*
+ * The counters are only written by the counting thread and read with relaxed
+ * atomic loads from anywhere, so no locking is needed on either side.
+ */
+struct gpiod_edge_counter {
+	unsigned int num_lines;
+	unsigned int offsets[EDGE_COUNTER_MAX_LINES];
+	unsigned long last_line_seqno[EDGE_COUNTER_MAX_LINES];
+
+	/* Distinct request file descriptors plus the stop eventfd. */
+	struct pollfd pfds[EDGE_COUNTER_MAX_LINES + 1];
+	unsigned int num_fds;
+
+	pthread_t thread;
+	int stop_fd;
+	int error;
+
+	uint64_t window_ns;
+	uint64_t window_end_ns;
+	unsigned long long window_start[EDGE_COUNTER_MAX_LINES];
+
+	unsigned long long counts[EDGE_COUNTER_MAX_LINES];
+	/* Number of edges counted during the last full window. */
+	unsigned long long window_counts[EDGE_COUNTER_MAX_LINES];
+
+	struct gpio_v2_line_event buf[EDGE_COUNTER_BATCH_SIZE];
+};
+
+static int edge_counter_line(struct gpiod_edge_counter *cnt,
+			     unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < cnt->num_lines; i++) {
+		if (cnt->offsets[i] == offset)
+			return i;
+	}
+
+	return -1;
+}
+
+static void edge_counter_count(struct gpiod_edge_counter *cnt,
+			       const struct gpio_v2_line_event *ev)
+{
+	unsigned long long edges = 1;
+	unsigned long last;
+	int line;
+
+	line = edge_counter_line(cnt, ev->offset);
+	if (line < 0)
+		return;
+
+	/*
+	 * Edges the kernel had to drop still advance the per-line sequence
+	 * number, so they are counted too.
+	 */
+	last = cnt->last_line_seqno[line];
+	if (last && ev->line_seqno > last)
+		edges = ev->line_seqno - last;
+	cnt->last_line_seqno[line] = ev->line_seqno;
+
+	__atomic_store_n(&cnt->counts[line], cnt->counts[line] + edges,
+			 __ATOMIC_RELAXED);
+}
+
+static int edge_counter_drain(struct gpiod_edge_counter *cnt, int fd)
+{
+	unsigned int num, i;
+	ssize_t rd;
+
+	rd = read(fd, cnt->buf, sizeof(cnt->buf));
+	if (rd < 0)
+		return errno == EAGAIN ? 0 : -1;
+
+	if ((size_t)rd < sizeof(*cnt->buf)) {
+		errno = EIO;
+		return -1;
+	}
+
+	num = rd / sizeof(*cnt->buf);
+	for (i = 0; i < num; i++)
+		edge_counter_count(cnt, &cnt->buf[i]);
+
+	return 0;
+}
+
+static void edge_counter_roll_window(struct gpiod_edge_counter *cnt,
+				     uint64_t now)
+{
+	unsigned long long count;
+	unsigned int i;
+
+	if (now < cnt->window_end_ns)
+		return;
+
+	for (i = 0; i < cnt->num_lines; i++) {
+		count = cnt->counts[i];
+		__atomic_store_n(&cnt->window_counts[i],
+				 count - cnt->window_start[i],
+				 __ATOMIC_RELAXED);
+		cnt->window_start[i] = count;
+	}
+
+	/* Windows without any wake-up in them are skipped. */
+	cnt->window_end_ns += cnt->window_ns *
+			(1 + (now - cnt->window_end_ns) / cnt->window_ns);
+}
+
+static void *edge_counter_thread(void *data)
+{
+	struct gpiod_edge_counter *cnt = data;
+	struct pollfd *stop = &cnt->pfds[cnt->num_fds];
+	struct timespec timeout;
+	unsigned int i;
+	uint64_t now;
+	int rv;
+
+	for (;;) {
+		now = monotonic_ns();
+		edge_counter_roll_window(cnt, now);
+		ns_to_timespec(cnt->window_end_ns - now, &timeout);
+
+		rv = ppoll(cnt->pfds, cnt->num_fds + 1, &timeout, NULL);
+		if (rv < 0) {
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		if (stop->revents)
+			return NULL;
+
+		for (i = 0; i < cnt->num_fds; i++) {
+			if (!cnt->pfds[i].revents)
+				continue;
+
+			rv = edge_counter_drain(cnt, cnt->pfds[i].fd);
+			if (rv < 0)
+				goto out;
+		}
+	}
+
+out:
+	__atomic_store_n(&cnt->error, errno, __ATOMIC_RELEASE);
+
+	return NULL;
+}
+
+static void edge_counter_add_fd(struct gpiod_edge_counter *cnt, int fd)
+{
+	unsigned int i;
+
+	for (i = 0; i < cnt->num_fds; i++) {
+		if (cnt->pfds[i].fd == fd)
+			return;
+	}
+
+	cnt->pfds[cnt->num_fds].fd = fd;
+	cnt->pfds[cnt->num_fds].events = POLLIN | POLLPRI;
+	cnt->num_fds++;
+}
+
+GPIOD_API struct gpiod_edge_counter *
+gpiod_edge_counter_new(struct gpiod_line_bulk *bulk,
+		       const struct timespec *window)
+{
+	struct gpiod_edge_counter *cnt;
+	unsigned int num_lines, i;
+	struct gpiod_line *line;
+	uint64_t window_ns;
+	int rv, type;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	window_ns = timespec_to_ns(window);
+	if (num_lines == 0 || num_lines > EDGE_COUNTER_MAX_LINES ||
+	    window_ns == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	for (i = 0; i < num_lines; i++) {
+		type = line_request_type(gpiod_line_bulk_get_line(bulk, i));
+		if (type != GPIOD_LINE_REQUEST_EVENT_RISING_EDGE &&
+		    type != GPIOD_LINE_REQUEST_EVENT_FALLING_EDGE &&
+		    type != GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES) {
+			errno = EPERM;
+			return NULL;
+		}
+	}
+
+	cnt = malloc(sizeof(*cnt));
+	if (!cnt)
+		return NULL;
+
+	memset(cnt, 0, sizeof(*cnt));
+	cnt->num_lines = num_lines;
+	cnt->window_ns = window_ns;
+
+	for (i = 0; i < num_lines; i++) {
+		line = gpiod_line_bulk_get_line(bulk, i);
+		cnt->offsets[i] = gpiod_line_offset(line);
+		edge_counter_add_fd(cnt, gpiod_line_event_get_fd(line));
+	}
+
+	cnt->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (cnt->stop_fd < 0)
+		goto err_free;
+
+	cnt->pfds[cnt->num_fds].fd = cnt->stop_fd;
+	cnt->pfds[cnt->num_fds].events = POLLIN;
+	cnt->window_end_ns = monotonic_ns() + window_ns;
+
+	rv = pthread_create(&cnt->thread, NULL, edge_counter_thread, cnt);
+	if (rv) {
+		errno = rv;
+		goto err_close;
+	}
+
+	return cnt;
+
+err_close:
+	close(cnt->stop_fd);
+err_free:
+	free(cnt);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_edge_counter_free(struct gpiod_edge_counter *cnt)
+{
+	if (!cnt)
+		return;
+
+	fd_signal(cnt->stop_fd);
+	pthread_join(cnt->thread, NULL);
+
+	close(cnt->stop_fd);
+	free(cnt);
+}
+
+GPIOD_API unsigned int
+gpiod_edge_counter_num_lines(struct gpiod_edge_counter *cnt)
+{
+	return cnt->num_lines;
+}
+
+GPIOD_API int gpiod_edge_counter_read(struct gpiod_edge_counter *cnt,
+				      unsigned long long *counts,
+				      double *rates)
+{
+	unsigned int i;
+	int error;
+
+	error = __atomic_load_n(&cnt->error, __ATOMIC_ACQUIRE);
+	if (error) {
+		errno = error;
+		return -1;
+	}
+
+	for (i = 0; i < cnt->num_lines; i++) {
+		if (counts)
+			counts[i] = __atomic_load_n(&cnt->counts[i],
+						    __ATOMIC_RELAXED);
+		if (rates)
+			rates[i] = __atomic_load_n(&cnt->window_counts[i],
+						   __ATOMIC_RELAXED) *
+				   1e9 / cnt->window_ns;
+	}
+
+	return 0;
+}
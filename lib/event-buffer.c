@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Large userspace buffer for line events filled by a dedicated drain thread
+ * so that the small kernel FIFOs never overflow while the consumer stalls.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+struct gpiod_event_buffer {
+	int policy;
+	struct gpiod_event_loop *loop;
+	pthread_t thread;
+	bool running;
+	int stop_fd;
+
+	struct spsc_ring ring;
+
+	unsigned long long num_buffered;
+	unsigned long long num_dropped;
+	unsigned long high_watermark;
+};
+
+static bool event_buffer_push(struct gpiod_event_buffer *buf,
+			      const struct gpiod_line_event_ext *event)
+{
+	struct gpiod_line_event_ext *slot;
+	unsigned long used;
+
+	slot = spsc_ring_slot(&buf->ring);
+	if (!slot) {
+		switch (buf->policy) {
+		case GPIOD_EVENT_BUFFER_DROP_NEWEST:
+			counter_add(&buf->num_dropped, 1);
+			return true;
+		case GPIOD_EVENT_BUFFER_DROP_OLDEST:
+			/*
+			 * If this fails, the consumer has just taken the
+			 * oldest event and there's room now.
+			 */
+			if (spsc_ring_drop_oldest(&buf->ring))
+				counter_add(&buf->num_dropped, 1);
+			break;
+		case GPIOD_EVENT_BUFFER_BLOCK:
+			if (!spsc_ring_wait_space(&buf->ring, buf->stop_fd))
+				return false;
+			break;
+		}
+
+		slot = spsc_ring_slot(&buf->ring);
+	}
+
+	*slot = *event;
+	spsc_ring_push(&buf->ring);
+	counter_add(&buf->num_buffered, 1);
+
+	used = spsc_ring_used(&buf->ring);
+	if (used > buf->high_watermark)
+		__atomic_store_n(&buf->high_watermark, used, __ATOMIC_RELAXED);
+
+	return true;
+}
+
+static int event_buffer_collect(const struct gpiod_line_event_ext *events,
+				unsigned int num_events, void *data)
+{
+	struct gpiod_event_buffer *buf = data;
+	unsigned int i;
+
+	for (i = 0; i < num_events; i++) {
+		if (!event_buffer_push(buf, &events[i]))
+			return GPIOD_EVENT_LOOP_CB_STOP;
+	}
+
+	return GPIOD_EVENT_LOOP_CB_NEXT;
+}
+
+static void *event_buffer_drain(void *data)
+{
+	struct gpiod_event_buffer *buf = data;
+	struct timespec ts = { 0, 0 };
+	struct pollfd pfds[2];
+	unsigned long head;
+	int rv, error = 0;
+
+	pfds[0].fd = gpiod_event_loop_get_fd(buf->loop);
+	pfds[0].events = POLLIN;
+	pfds[1].fd = buf->stop_fd;
+	pfds[1].events = POLLIN;
+
+	for (;;) {
+		rv = poll(pfds, 2, -1);
+		if (rv < 0) {
+			if (errno == EINTR)
+				continue;
+
+			error = errno;
+			break;
+		}
+
+		if (pfds[1].revents)
+			break;
+
+		head = buf->ring.head;
+
+		rv = gpiod_event_loop_dispatch(buf->loop, &ts);
+		if (rv < 0) {
+			error = errno;
+			break;
+		}
+
+		if (buf->ring.head != head)
+			fd_signal(buf->ring.data_fd);
+	}
+
+	if (error)
+		spsc_ring_set_error(&buf->ring, error);
+
+	return NULL;
+}
+
+GPIOD_API struct gpiod_event_buffer *
+gpiod_event_buffer_new(unsigned int size, int policy)
+{
+	struct gpiod_event_buffer *buf;
+	int rv;
+
+	if (size == 0 || size > (1U << 24) ||
+	    policy < GPIOD_EVENT_BUFFER_DROP_OLDEST ||
+	    policy > GPIOD_EVENT_BUFFER_BLOCK) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	buf = malloc(sizeof(*buf));
+	if (!buf)
+		return NULL;
+
+	memset(buf, 0, sizeof(*buf));
+	buf->policy = policy;
+	buf->stop_fd = -1;
+
+	rv = spsc_ring_init(&buf->ring, size,
+			    sizeof(struct gpiod_line_event_ext),
+			    policy == GPIOD_EVENT_BUFFER_BLOCK);
+	if (rv)
+		goto err_free;
+
+	buf->loop = gpiod_event_loop_new();
+	if (!buf->loop)
+		goto err_free;
+
+	buf->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (buf->stop_fd < 0)
+		goto err_free;
+
+	return buf;
+
+err_free:
+	gpiod_event_buffer_free(buf);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_event_buffer_free(struct gpiod_event_buffer *buf)
+{
+	if (!buf)
+		return;
+
+	gpiod_event_buffer_stop(buf);
+
+	if (buf->stop_fd >= 0)
+		close(buf->stop_fd);
+
+	gpiod_event_loop_free(buf->loop);
+	spsc_ring_release(&buf->ring);
+	free(buf);
+}
+
+GPIOD_API int gpiod_event_buffer_add(struct gpiod_event_buffer *buf,
+				     struct gpiod_line_bulk *bulk)
+{
+	if (buf->running) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	return gpiod_event_loop_add(buf->loop, bulk,
+				    event_buffer_collect, buf);
+}
+
+GPIOD_API int gpiod_event_buffer_start(struct gpiod_event_buffer *buf)
+{
+	int rv;
+
+	if (buf->running) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	fd_clear(buf->stop_fd);
+	buf->ring.error = 0;
+
+	rv = pthread_create(&buf->thread, NULL, event_buffer_drain, buf);
+	if (rv) {
+		errno = rv;
+		return -1;
+	}
+
+	buf->running = true;
+
+	return 0;
+}
+
+GPIOD_API void gpiod_event_buffer_stop(struct gpiod_event_buffer *buf)
+{
+	if (!buf->running)
+		return;
+
+	fd_signal(buf->stop_fd);
+	pthread_join(buf->thread, NULL);
+	buf->running = false;
+}
+
+GPIOD_API int gpiod_event_buffer_get_fd(struct gpiod_event_buffer *buf)
+{
+	return buf->ring.data_fd;
+}
+
+GPIOD_API int gpiod_event_buffer_read(struct gpiod_event_buffer *buf,
+				      const struct timespec *timeout,
+				      struct gpiod_line_event_ext *events,
+				      unsigned int num_events)
+{
+	if (num_events == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return spsc_ring_read(&buf->ring, timeout, events, num_events);
+}
+
+GPIOD_API void
+gpiod_event_buffer_get_stats(struct gpiod_event_buffer *buf,
+			     struct gpiod_event_buffer_stats *stats)
+{
+	stats->capacity = buf->ring.mask + 1;
+	stats->num_pending = spsc_ring_used(&buf->ring);
+	stats->high_watermark = __atomic_load_n(&buf->high_watermark,
+						__ATOMIC_RELAXED);
+	stats->num_buffered = __atomic_load_n(&buf->num_buffered,
+					      __ATOMIC_RELAXED);
+	stats->num_dropped = __atomic_load_n(&buf->num_dropped,
+					     __ATOMIC_RELAXED);
+}
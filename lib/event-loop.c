@@ -0,0 +1,380 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Event loop dispatching line events from any number of requests to
+ * per-request callbacks.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define EVENT_LOOP_MAX_READY		64
+#define EVENT_LOOP_MAX_EVENTS		64
+
+/*
+ * Every distinct event file descriptor registered with the loop is tracked
+ * by one source. Lines requested with a shared event descriptor map to a
+ * single source, otherwise there's one per line.
+ */
+struct event_loop_source {
+	int fd;
+	struct gpiod_line *line;
+	gpiod_event_loop_cb cb;
+	void *data;
+	struct event_loop_source *next;
+};
+
+/*
+ * Events held back by software filters become due without their descriptor
+ * becoming readable - a timer in the epoll set wakes the loop up for them.
+ */
+struct gpiod_event_loop {
+	int epfd;
+	int timerfd;
+	uint64_t timer_deadline;
+	struct event_loop_source *sources;
+};
+
+GPIOD_API struct gpiod_event_loop *gpiod_event_loop_new(void)
+{
+	struct gpiod_event_loop *loop;
+	struct epoll_event event;
+	int rv;
+
+	loop = malloc(sizeof(*loop));
+	if (!loop)
+		return NULL;
+
+	memset(loop, 0, sizeof(*loop));
+
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0)
+		goto err_free;
+
+	loop->timerfd = timerfd_create(CLOCK_MONOTONIC,
+				       TFD_CLOEXEC | TFD_NONBLOCK);
+	if (loop->timerfd < 0)
+		goto err_close_epfd;
+
+	/* Sources are identified by their pointers, the timer by NULL. */
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+
+	rv = epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->timerfd, &event);
+	if (rv)
+		goto err_close_timerfd;
+
+	return loop;
+
+err_close_timerfd:
+	close(loop->timerfd);
+err_close_epfd:
+	close(loop->epfd);
+err_free:
+	free(loop);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_event_loop_free(struct gpiod_event_loop *loop)
+{
+	struct event_loop_source *src, *next;
+
+	if (!loop)
+		return;
+
+	for (src = loop->sources; src; src = next) {
+		next = src->next;
+		free(src);
+	}
+
+	close(loop->timerfd);
+	close(loop->epfd);
+	free(loop);
+}
+
+static struct event_loop_source *
+event_loop_find_source(struct gpiod_event_loop *loop, int fd)
+{
+	struct event_loop_source *src;
+
+	for (src = loop->sources; src; src = src->next) {
+		if (src->fd == fd)
+			return src;
+	}
+
+	return NULL;
+}
+
+static void event_loop_drop_source(struct gpiod_event_loop *loop,
+				   struct event_loop_source *src)
+{
+	struct event_loop_source **pos;
+
+	for (pos = &loop->sources; *pos; pos = &(*pos)->next) {
+		if (*pos == src) {
+			*pos = src->next;
+			break;
+		}
+	}
+
+	epoll_ctl(loop->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+	free(src);
+}
+
+static int event_loop_add_line(struct gpiod_event_loop *loop,
+			       struct gpiod_line *line,
+			       gpiod_event_loop_cb cb, void *data,
+			       struct event_loop_source *added)
+{
+	struct event_loop_source *src, *pos;
+	struct epoll_event event;
+	int fd, rv;
+
+	fd = gpiod_line_event_get_fd(line);
+	if (fd < 0)
+		return -1;
+
+	src = event_loop_find_source(loop, fd);
+	if (src) {
+		/* Another line of this bulk sharing the same descriptor. */
+		for (pos = loop->sources; pos != added; pos = pos->next) {
+			if (pos == src)
+				return 0;
+		}
+
+		errno = EBUSY;
+		return -1;
+	}
+
+	src = malloc(sizeof(*src));
+	if (!src)
+		return -1;
+
+	src->fd = fd;
+	src->line = line;
+	src->cb = cb;
+	src->data = data;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLPRI;
+	event.data.ptr = src;
+
+	rv = epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &event);
+	if (rv) {
+		free(src);
+		return -1;
+	}
+
+	src->next = loop->sources;
+	loop->sources = src;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_loop_add(struct gpiod_event_loop *loop,
+				   struct gpiod_line_bulk *bulk,
+				   gpiod_event_loop_cb cb, void *data)
+{
+	struct event_loop_source *added, *src;
+	unsigned int i, num_lines;
+	int rv;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (!cb || num_lines == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Sources are pushed at the front - remember where this call began. */
+	added = loop->sources;
+
+	for (i = 0; i < num_lines; i++) {
+		rv = event_loop_add_line(loop,
+					 gpiod_line_bulk_get_line(bulk, i),
+					 cb, data, added);
+		if (rv) {
+			while (loop->sources != added) {
+				src = loop->sources;
+				event_loop_drop_source(loop, src);
+			}
+
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_loop_remove(struct gpiod_event_loop *loop,
+				      struct gpiod_line_bulk *bulk)
+{
+	struct event_loop_source *src;
+	unsigned int i, num_lines;
+	int fd;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+
+	for (i = 0; i < num_lines; i++) {
+		fd = gpiod_line_event_get_fd(gpiod_line_bulk_get_line(bulk, i));
+		if (fd < 0)
+			return -1;
+
+		src = event_loop_find_source(loop, fd);
+		if (src)
+			event_loop_drop_source(loop, src);
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_loop_get_fd(struct gpiod_event_loop *loop)
+{
+	return loop->epfd;
+}
+
+static int event_loop_timeout_ms(const struct timespec *timeout)
+{
+	long long ms;
+
+	if (!timeout)
+		return -1;
+
+	/* Round up so that we never wake up before the deadline. */
+	ms = (long long)timeout->tv_sec * 1000 +
+	     (timeout->tv_nsec + 999999) / 1000000;
+
+	return ms > 0x7fffffff ? 0x7fffffff : (int)ms;
+}
+
+/* Arm the timer for the earliest event held back by any source. */
+static int event_loop_arm_timer(struct gpiod_event_loop *loop)
+{
+	struct event_loop_source *src;
+	struct itimerspec its;
+	uint64_t deadline = 0;
+	int rv;
+
+	for (src = loop->sources; src; src = src->next)
+		deadline = deadline_min(deadline,
+					line_filter_deadline(src->line));
+
+	if (deadline == loop->timer_deadline)
+		return 0;
+
+	/* A zero it_value disarms the timer. */
+	memset(&its, 0, sizeof(its));
+	ns_to_timespec(deadline, &its.it_value);
+
+	rv = timerfd_settime(loop->timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+	if (rv)
+		return -1;
+
+	loop->timer_deadline = deadline;
+
+	return 0;
+}
+
+/*
+ * Read the events of a source and pass them to its callback. Returns the
+ * number of events dispatched or -1 on error. Sets stop if the callback asked
+ * for it.
+ */
+static int event_loop_dispatch_source(struct event_loop_source *src,
+				      bool *stop)
+{
+	struct gpiod_line_event_ext events[EVENT_LOOP_MAX_EVENTS];
+	int rv;
+
+	rv = line_event_read_filtered(src->line, events,
+				      EVENT_LOOP_MAX_EVENTS);
+	if (rv < 0) {
+		/* Someone else may have drained a non-blocking fd. */
+		return errno == EAGAIN ? 0 : -1;
+	}
+
+	/* Everything was swallowed or held back by software event filters. */
+	if (rv == 0)
+		return 0;
+
+	/*
+	 * The descriptor is watched in level-triggered mode so whatever we
+	 * didn't get to will be reported on the next call.
+	 */
+	if (src->cb(events, rv, src->data) == GPIOD_EVENT_LOOP_CB_STOP)
+		*stop = true;
+
+	return rv;
+}
+
+/*
+ * Dispatch the events of all sources that have held back events due. Returns
+ * 0 on success or -1 on error.
+ */
+static int event_loop_dispatch_due(struct gpiod_event_loop *loop,
+				   bool *stop)
+{
+	struct event_loop_source *src;
+	uint64_t now, due;
+	int rv;
+
+	/* The timer has expired - it needs to be armed again in any case. */
+	fd_clear(loop->timerfd);
+	loop->timer_deadline = 0;
+
+	now = monotonic_ns();
+
+	for (src = loop->sources; src && !*stop; src = src->next) {
+		due = line_filter_deadline(src->line);
+		if (!due || due > now)
+			continue;
+
+		rv = event_loop_dispatch_source(src, stop);
+		if (rv < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_loop_dispatch(struct gpiod_event_loop *loop,
+					const struct timespec *timeout)
+{
+	struct epoll_event ready[EVENT_LOOP_MAX_READY];
+	struct event_loop_source *src;
+	int num_ready, i, rv;
+	bool stop = false;
+
+	num_ready = epoll_wait(loop->epfd, ready, EVENT_LOOP_MAX_READY,
+			       event_loop_timeout_ms(timeout));
+	if (num_ready < 0)
+		return -1;
+	if (num_ready == 0)
+		return GPIOD_EVENT_LOOP_TIMEOUT;
+
+	for (i = 0; i < num_ready && !stop; i++) {
+		src = ready[i].data.ptr;
+
+		if (src)
+			rv = event_loop_dispatch_source(src, &stop);
+		else
+			rv = event_loop_dispatch_due(loop, &stop);
+		if (rv < 0)
+			return -1;
+	}
+
+	rv = event_loop_arm_timer(loop);
+	if (rv)
+		return -1;
+
+	return stop ? GPIOD_EVENT_LOOP_STOPPED : GPIOD_EVENT_LOOP_DISPATCHED;
+}
@@ -0,0 +1,344 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Chronologically ordered stream of line events coming from multiple
+ * requests and chips.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+
+/*
+ * Maximum number of events held back by the merger. Once this limit is
+ * approached, the oldest events are released even if their reorder window
+ * hasn't expired yet.
+ */
+#define EVENT_MERGER_MAX_PENDING	1024
+/* Number of events a single dispatch of the event loop can add at most. */
+#define EVENT_MERGER_MAX_BURST		64
+
+/* One per distinct event file descriptor. */
+struct event_merger_source {
+	int fd;
+	unsigned int num_pending;
+	struct gpiod_event_merger *merger;
+};
+
+struct event_merger_entry {
+	uint64_t ts_ns;
+	struct gpiod_line_event_ext event;
+	struct event_merger_source *src;
+};
+
+struct gpiod_event_merger {
+	uint64_t window_ns;
+	struct gpiod_event_loop *loop;
+	struct gpiod_line_bulk *single;
+	struct event_merger_source **sources;
+	unsigned int num_sources;
+	/* Sources that currently have no event held back. */
+	unsigned int num_empty;
+	/* Binary min-heap ordered by timestamp and sequence number. */
+	struct event_merger_entry heap[EVENT_MERGER_MAX_PENDING];
+	unsigned int num_pending;
+};
+
+static bool event_merger_before(const struct event_merger_entry *a,
+				const struct event_merger_entry *b)
+{
+	if (a->ts_ns != b->ts_ns)
+		return a->ts_ns < b->ts_ns;
+
+	return a->event.seqno < b->event.seqno;
+}
+
+static void event_merger_swap(struct event_merger_entry *a,
+			      struct event_merger_entry *b)
+{
+	struct event_merger_entry tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+static void event_merger_push(struct gpiod_event_merger *merger,
+			      const struct gpiod_line_event_ext *event,
+			      struct event_merger_source *src)
+{
+	struct event_merger_entry *heap = merger->heap;
+	unsigned int pos, parent;
+
+	pos = merger->num_pending++;
+	heap[pos].ts_ns = timespec_to_ns(&event->ts);
+	heap[pos].event = *event;
+	heap[pos].src = src;
+
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (!event_merger_before(&heap[pos], &heap[parent]))
+			break;
+
+		event_merger_swap(&heap[pos], &heap[parent]);
+		pos = parent;
+	}
+
+	if (src->num_pending++ == 0)
+		merger->num_empty--;
+}
+
+static void event_merger_pop(struct gpiod_event_merger *merger,
+			     struct gpiod_line_event_ext *event)
+{
+	struct event_merger_entry *heap = merger->heap;
+	unsigned int pos = 0, child;
+
+	*event = heap[0].event;
+	if (--heap[0].src->num_pending == 0)
+		merger->num_empty++;
+
+	heap[0] = heap[--merger->num_pending];
+
+	for (;;) {
+		child = 2 * pos + 1;
+		if (child >= merger->num_pending)
+			break;
+
+		if (child + 1 < merger->num_pending &&
+		    event_merger_before(&heap[child + 1], &heap[child]))
+			child++;
+
+		if (!event_merger_before(&heap[child], &heap[pos]))
+			break;
+
+		event_merger_swap(&heap[pos], &heap[child]);
+		pos = child;
+	}
+}
+
+/*
+ * The oldest held-back event can be released if its reorder window has
+ * expired, if every source has an event pending - nothing that arrives later
+ * can precede it then - or if we're running out of room.
+ */
+static bool event_merger_releasable(struct gpiod_event_merger *merger,
+				    uint64_t now)
+{
+	if (merger->num_pending == 0)
+		return false;
+
+	if (merger->heap[0].ts_ns + merger->window_ns <= now)
+		return true;
+
+	if (merger->num_empty == 0)
+		return true;
+
+	return merger->num_pending >
+	       EVENT_MERGER_MAX_PENDING - EVENT_MERGER_MAX_BURST;
+}
+
+static int event_merger_collect(const struct gpiod_line_event_ext *events,
+				unsigned int num_events, void *data)
+{
+	struct event_merger_source *src = data;
+	unsigned int i;
+
+	for (i = 0; i < num_events; i++)
+		event_merger_push(src->merger, &events[i], src);
+
+	/* Leave the other descriptors for later if another burst won't fit. */
+	if (src->merger->num_pending >
+	    EVENT_MERGER_MAX_PENDING - EVENT_MERGER_MAX_BURST)
+		return GPIOD_EVENT_LOOP_CB_STOP;
+
+	return GPIOD_EVENT_LOOP_CB_NEXT;
+}
+
+GPIOD_API struct gpiod_event_merger *
+gpiod_event_merger_new(const struct timespec *window)
+{
+	struct gpiod_event_merger *merger;
+
+	merger = malloc(sizeof(*merger));
+	if (!merger)
+		return NULL;
+
+	memset(merger, 0, sizeof(*merger));
+	merger->window_ns = window ? timespec_to_ns(window) : 0;
+
+	merger->single = gpiod_line_bulk_new(1);
+	if (!merger->single)
+		goto err_free_merger;
+
+	merger->loop = gpiod_event_loop_new();
+	if (!merger->loop)
+		goto err_free_bulk;
+
+	return merger;
+
+err_free_bulk:
+	gpiod_line_bulk_free(merger->single);
+err_free_merger:
+	free(merger);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_event_merger_free(struct gpiod_event_merger *merger)
+{
+	unsigned int i;
+
+	if (!merger)
+		return;
+
+	gpiod_event_loop_free(merger->loop);
+	gpiod_line_bulk_free(merger->single);
+
+	for (i = 0; i < merger->num_sources; i++)
+		free(merger->sources[i]);
+
+	free(merger->sources);
+	free(merger);
+}
+
+static bool event_merger_has_fd(struct gpiod_event_merger *merger, int fd)
+{
+	unsigned int i;
+
+	for (i = 0; i < merger->num_sources; i++) {
+		if (merger->sources[i]->fd == fd)
+			return true;
+	}
+
+	return false;
+}
+
+static int event_merger_add_line(struct gpiod_event_merger *merger,
+				 struct gpiod_line *line)
+{
+	struct event_merger_source *src, **sources;
+	int fd, rv;
+
+	fd = gpiod_line_event_get_fd(line);
+	if (fd < 0)
+		return -1;
+
+	if (event_merger_has_fd(merger, fd))
+		return 0;
+
+	sources = realloc(merger->sources,
+			  (merger->num_sources + 1) * sizeof(*sources));
+	if (!sources)
+		return -1;
+	merger->sources = sources;
+
+	src = malloc(sizeof(*src));
+	if (!src)
+		return -1;
+
+	memset(src, 0, sizeof(*src));
+	src->fd = fd;
+	src->merger = merger;
+
+	/*
+	 * Register each descriptor separately so that the callback knows
+	 * which source the events come from.
+	 */
+	gpiod_line_bulk_reset(merger->single);
+	gpiod_line_bulk_add_line(merger->single, line);
+
+	rv = gpiod_event_loop_add(merger->loop, merger->single,
+				  event_merger_collect, src);
+	if (rv) {
+		free(src);
+		return -1;
+	}
+
+	sources[merger->num_sources++] = src;
+	merger->num_empty++;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_merger_add(struct gpiod_event_merger *merger,
+				     struct gpiod_line_bulk *bulk)
+{
+	unsigned int i, num_lines;
+	int rv;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (num_lines == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < num_lines; i++) {
+		rv = event_merger_add_line(merger,
+					   gpiod_line_bulk_get_line(bulk, i));
+		if (rv)
+			return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_merger_read(struct gpiod_event_merger *merger,
+				      const struct timespec *timeout,
+				      struct gpiod_line_event_ext *events,
+				      unsigned int num_events)
+{
+	uint64_t now, deadline = 0, wait_ns;
+	unsigned int num = 0;
+	struct timespec ts, *tsp;
+	int rv;
+
+	if (merger->num_sources == 0 || num_events == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	now = monotonic_ns();
+	if (timeout)
+		deadline = now + timespec_to_ns(timeout);
+
+	for (;;) {
+		while (num < num_events &&
+		       event_merger_releasable(merger, now))
+			event_merger_pop(merger, &events[num++]);
+
+		if (num > 0)
+			return num;
+
+		if (timeout && now >= deadline)
+			return 0;
+
+		/*
+		 * Sleep until either something new arrives, the window of the
+		 * oldest held-back event expires or we time out.
+		 */
+		tsp = NULL;
+		if (merger->num_pending || timeout) {
+			wait_ns = UINT64_MAX;
+			if (merger->num_pending) {
+				wait_ns = merger->heap[0].ts_ns +
+					  merger->window_ns;
+				wait_ns = wait_ns > now ? wait_ns - now : 0;
+			}
+			if (timeout && deadline - now < wait_ns)
+				wait_ns = deadline - now;
+
+			ns_to_timespec(wait_ns, &ts);
+			tsp = &ts;
+		}
+
+		rv = gpiod_event_loop_dispatch(merger->loop, tsp);
+		if (rv < 0)
+			return -1;
+
+		now = monotonic_ns();
+	}
+}
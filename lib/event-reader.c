@@ -0,0 +1,613 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Batched reading of line events from many event file descriptors. Uses
+ * io_uring if the library was built with it and the kernel allows it, plain
+ * poll() and read() otherwise.
+ *
+ * Line event descriptors lack FMODE_NOWAIT. Kernels which fall back to
+ * checking poll() readiness for such files arm a poll handler for every read
+ * kept outstanding here, older ones punt each read to an io-wq worker.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+/* Number of kernel events each outstanding read can return. */
+#define EVENT_READER_SLOT_EVENTS	16
+
+/* One per distinct event file descriptor watched by the reader. */
+struct event_reader_slot {
+	int fd;
+	struct gpiod_line *line;
+#ifdef HAVE_LIBURING
+	struct gpio_v2_line_event buf[EVENT_READER_SLOT_EVENTS];
+	unsigned int num_ready;
+	unsigned int pos;
+	/* A read into buf is in flight. */
+	bool armed;
+#endif
+};
+
+struct gpiod_event_reader {
+	int backend;
+	unsigned int num_slots;
+	struct event_reader_slot **slots;
+	struct pollfd *fds;
+#ifdef HAVE_LIBURING
+	struct io_uring ring;
+	/* FIFO of slots holding completed reads not yet handed to the user. */
+	struct event_reader_slot **ready;
+	unsigned int ready_head;
+	unsigned int num_queued;
+#endif
+};
+
+/*
+ * Time at which events held back by software filters of any watched request
+ * become due or 0 if there are none.
+ */
+static uint64_t event_reader_filter_deadline(struct gpiod_event_reader *reader)
+{
+	uint64_t deadline = 0;
+	unsigned int i;
+
+	for (i = 0; i < reader->num_slots; i++)
+		deadline = deadline_min(deadline,
+				line_filter_deadline(reader->slots[i]->line));
+
+	return deadline;
+}
+
+/* Store the events held back by software filters that are due by now. */
+static unsigned int event_reader_flush_due(struct gpiod_event_reader *reader,
+					   struct gpiod_line_event_ext *events,
+					   unsigned int num_events)
+{
+	unsigned int i, total = 0;
+	uint64_t now, due;
+
+	now = monotonic_ns();
+
+	for (i = 0; i < reader->num_slots && total < num_events; i++) {
+		due = line_filter_deadline(reader->slots[i]->line);
+		if (!due || due > now)
+			continue;
+
+		total += line_filter_flush(reader->slots[i]->line,
+					   &events[total], num_events - total);
+	}
+
+	return total;
+}
+
+/*
+ * Set up the timeout of a wait so that it ends either at the deadline of the
+ * read or when held back events become due. Returns NULL if neither applies.
+ */
+static struct timespec *
+event_reader_wait_timeout(struct gpiod_event_reader *reader,
+			  uint64_t deadline, struct timespec *ts)
+{
+	deadline = deadline_min(deadline, event_reader_filter_deadline(reader));
+	if (!deadline)
+		return NULL;
+
+	timeout_until_ns(deadline, ts);
+
+	return ts;
+}
+
+#ifdef HAVE_LIBURING
+
+#define EVENT_READER_RING_ENTRIES	256
+
+static int event_reader_uring_init(struct gpiod_event_reader *reader)
+{
+	int rv;
+
+	rv = io_uring_queue_init(EVENT_READER_RING_ENTRIES, &reader->ring, 0);
+	if (rv < 0)
+		return -1;
+
+	return 0;
+}
+
+static unsigned int event_reader_uring_num_armed(
+					struct gpiod_event_reader *reader)
+{
+	unsigned int i, num = 0;
+
+	for (i = 0; i < reader->num_slots; i++) {
+		if (reader->slots[i]->armed)
+			num++;
+	}
+
+	return num;
+}
+
+/*
+ * The kernel keeps writing into the slot buffers for as long as the reads are
+ * in flight - cancel them and wait for the completions before the buffers go
+ * away.
+ */
+static void event_reader_uring_cancel(struct gpiod_event_reader *reader)
+{
+	struct event_reader_slot *slot;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	unsigned int i;
+	int rv;
+
+	for (i = 0; i < reader->num_slots; i++) {
+		slot = reader->slots[i];
+		if (!slot->armed)
+			continue;
+
+		sqe = io_uring_get_sqe(&reader->ring);
+		if (!sqe) {
+			io_uring_submit(&reader->ring);
+			sqe = io_uring_get_sqe(&reader->ring);
+			if (!sqe)
+				break;
+		}
+
+		io_uring_prep_cancel(sqe, slot, 0);
+		io_uring_sqe_set_data(sqe, NULL);
+	}
+
+	io_uring_submit(&reader->ring);
+
+	while (event_reader_uring_num_armed(reader)) {
+		rv = io_uring_wait_cqe(&reader->ring, &cqe);
+		if (rv == -EINTR)
+			continue;
+		if (rv < 0)
+			break;
+
+		/* Completions of the cancel requests themselves carry NULL. */
+		slot = io_uring_cqe_get_data(cqe);
+		if (slot)
+			slot->armed = false;
+
+		io_uring_cqe_seen(&reader->ring, cqe);
+	}
+}
+
+static void event_reader_uring_exit(struct gpiod_event_reader *reader)
+{
+	event_reader_uring_cancel(reader);
+	io_uring_queue_exit(&reader->ring);
+	free(reader->ready);
+}
+
+static int event_reader_uring_arm(struct gpiod_event_reader *reader,
+				  struct event_reader_slot *slot)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(&reader->ring);
+	if (!sqe) {
+		/* Submission queue full - flush it and try again. */
+		io_uring_submit(&reader->ring);
+		sqe = io_uring_get_sqe(&reader->ring);
+		if (!sqe) {
+			errno = EBUSY;
+			return -1;
+		}
+	}
+
+	io_uring_prep_read(sqe, slot->fd, slot->buf, sizeof(slot->buf), 0);
+	io_uring_sqe_set_data(sqe, slot);
+	slot->armed = true;
+
+	return 0;
+}
+
+static int event_reader_uring_add(struct gpiod_event_reader *reader,
+				  struct event_reader_slot *slot)
+{
+	struct event_reader_slot **ready;
+	unsigned int i;
+	int rv;
+
+	ready = malloc((reader->num_slots + 1) * sizeof(*ready));
+	if (!ready)
+		return -1;
+
+	/* The FIFO wraps around at num_slots so unroll it before growing. */
+	for (i = 0; i < reader->num_queued; i++)
+		ready[i] = reader->ready[(reader->ready_head + i) %
+					 reader->num_slots];
+
+	free(reader->ready);
+	reader->ready = ready;
+	reader->ready_head = 0;
+
+	rv = event_reader_uring_arm(reader, slot);
+	if (rv)
+		return -1;
+
+	rv = io_uring_submit(&reader->ring);
+	if (rv < 0) {
+		errno = -rv;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void event_reader_uring_queue(struct gpiod_event_reader *reader,
+				     struct event_reader_slot *slot)
+{
+	unsigned int tail;
+
+	tail = (reader->ready_head + reader->num_queued) % reader->num_slots;
+	reader->ready[tail] = slot;
+	reader->num_queued++;
+}
+
+/* Hand over events from completed reads and re-arm the drained slots. */
+static int event_reader_uring_copy(struct gpiod_event_reader *reader,
+				   struct gpiod_line_event_ext *events,
+				   unsigned int num_events)
+{
+	struct event_reader_slot *slot;
+	unsigned int num, total = 0;
+	int rv;
+
+	while (reader->num_queued && total < num_events) {
+		slot = reader->ready[reader->ready_head];
+
+		num = slot->num_ready - slot->pos;
+		if (num > num_events - total)
+			num = num_events - total;
+
+		total += line_events_from_raw(slot->line,
+					      &slot->buf[slot->pos],
+					      &events[total], num);
+		slot->pos += num;
+
+		if (slot->pos < slot->num_ready)
+			break;
+
+		reader->ready_head = (reader->ready_head + 1) %
+				     reader->num_slots;
+		reader->num_queued--;
+
+		rv = event_reader_uring_arm(reader, slot);
+		if (rv)
+			return -1;
+	}
+
+	rv = io_uring_submit(&reader->ring);
+	if (rv < 0) {
+		errno = -rv;
+		return -1;
+	}
+
+	return total;
+}
+
+static int event_reader_uring_harvest(struct gpiod_event_reader *reader)
+{
+	struct io_uring_cqe *cqes[EVENT_READER_RING_ENTRIES];
+	struct event_reader_slot *slot;
+	unsigned int num, i;
+	int res, rv = 0;
+
+	num = io_uring_peek_batch_cqe(&reader->ring, cqes,
+				      EVENT_READER_RING_ENTRIES);
+
+	for (i = 0; i < num && rv == 0; i++) {
+		slot = io_uring_cqe_get_data(cqes[i]);
+		res = cqes[i]->res;
+		slot->armed = false;
+
+		if (res == -EINTR || res == -EAGAIN) {
+			rv = event_reader_uring_arm(reader, slot);
+		} else if (res < 0 || (unsigned int)res < sizeof(slot->buf[0])) {
+			/*
+			 * Report the error but keep watching the descriptor,
+			 * otherwise its events would silently stop coming.
+			 */
+			rv = event_reader_uring_arm(reader, slot);
+			if (rv == 0) {
+				errno = res < 0 ? -res : EIO;
+				rv = -1;
+			}
+		} else {
+			slot->num_ready = res / sizeof(slot->buf[0]);
+			slot->pos = 0;
+			event_reader_uring_queue(reader, slot);
+		}
+	}
+
+	io_uring_cq_advance(&reader->ring, i);
+
+	return rv;
+}
+
+static int event_reader_uring_read(struct gpiod_event_reader *reader,
+				   const struct timespec *timeout,
+				   struct gpiod_line_event_ext *events,
+				   unsigned int num_events)
+{
+	struct __kernel_timespec kts, *ktsp;
+	struct io_uring_cqe *cqe;
+	struct timespec ts, *tsp;
+	uint64_t deadline = 0;
+	bool expired = false;
+	int rv;
+
+	if (timeout)
+		deadline = monotonic_ns() + timespec_to_ns(timeout);
+
+	/*
+	 * Reads interrupted in the kernel get re-armed during harvesting and
+	 * software event filters may hold back everything we've read in which
+	 * cases there may be nothing to return yet - keep waiting.
+	 */
+	for (;;) {
+		rv = event_reader_flush_due(reader, events, num_events);
+		if (rv == 0 && reader->num_queued)
+			rv = event_reader_uring_copy(reader, events,
+						     num_events);
+		if (rv != 0 || expired)
+			return rv;
+
+		rv = io_uring_submit(&reader->ring);
+		if (rv < 0) {
+			errno = -rv;
+			return -1;
+		}
+
+		ktsp = NULL;
+		tsp = event_reader_wait_timeout(reader, deadline, &ts);
+		if (tsp) {
+			kts.tv_sec = tsp->tv_sec;
+			kts.tv_nsec = tsp->tv_nsec;
+			ktsp = &kts;
+		}
+
+		rv = io_uring_wait_cqe_timeout(&reader->ring, &cqe, ktsp);
+		if (rv == -ETIME) {
+			/* Go around once more for the events that got due. */
+			expired = timeout && monotonic_ns() >= deadline;
+			continue;
+		}
+		if (rv < 0) {
+			errno = -rv;
+			return -1;
+		}
+
+		rv = event_reader_uring_harvest(reader);
+		if (rv)
+			return -1;
+	}
+}
+
+#endif /* HAVE_LIBURING */
+
+static int event_reader_poll_read(struct gpiod_event_reader *reader,
+				  const struct timespec *timeout,
+				  struct gpiod_line_event_ext *events,
+				  unsigned int num_events)
+{
+	unsigned int i, total;
+	struct timespec ts;
+	uint64_t deadline = 0;
+	int rv;
+
+	if (timeout)
+		deadline = monotonic_ns() + timespec_to_ns(timeout);
+
+	for (;;) {
+		rv = ppoll(reader->fds, reader->num_slots,
+			   event_reader_wait_timeout(reader, deadline, &ts),
+			   NULL);
+		if (rv < 0)
+			return -1;
+
+		total = event_reader_flush_due(reader, events, num_events);
+
+		for (i = 0; i < reader->num_slots && total < num_events; i++) {
+			if (!reader->fds[i].revents)
+				continue;
+
+			rv = line_event_read_filtered(reader->slots[i]->line,
+						      &events[total],
+						      num_events - total);
+			if (rv < 0) {
+				if (errno == EAGAIN)
+					continue;
+
+				return -1;
+			}
+
+			total += rv;
+		}
+
+		/* Software event filters may have held back everything. */
+		if (total || (timeout && monotonic_ns() >= deadline))
+			return total;
+	}
+}
+
+GPIOD_API struct gpiod_event_reader *gpiod_event_reader_new(void)
+{
+	struct gpiod_event_reader *reader;
+
+	reader = malloc(sizeof(*reader));
+	if (!reader)
+		return NULL;
+
+	memset(reader, 0, sizeof(*reader));
+	reader->backend = GPIOD_EVENT_READER_BACKEND_READ;
+
+#ifdef HAVE_LIBURING
+	/*
+	 * The kernel may lack io_uring or have it disabled by policy - that's
+	 * not an error, we just take the slow path.
+	 */
+	if (event_reader_uring_init(reader) == 0)
+		reader->backend = GPIOD_EVENT_READER_BACKEND_IO_URING;
+#endif
+
+	return reader;
+}
+
+GPIOD_API void gpiod_event_reader_free(struct gpiod_event_reader *reader)
+{
+	unsigned int i;
+
+	if (!reader)
+		return;
+
+#ifdef HAVE_LIBURING
+	if (reader->backend == GPIOD_EVENT_READER_BACKEND_IO_URING)
+		event_reader_uring_exit(reader);
+#endif
+
+	for (i = 0; i < reader->num_slots; i++)
+		free(reader->slots[i]);
+
+	free(reader->slots);
+	free(reader->fds);
+	free(reader);
+}
+
+static bool event_reader_has_fd(struct gpiod_event_reader *reader, int fd)
+{
+	unsigned int i;
+
+	for (i = 0; i < reader->num_slots; i++) {
+		if (reader->slots[i]->fd == fd)
+			return true;
+	}
+
+	return false;
+}
+
+static int event_reader_add_line(struct gpiod_event_reader *reader,
+				 struct gpiod_line *line)
+{
+	struct event_reader_slot *slot, **slots;
+	struct pollfd *fds;
+	int fd;
+
+	fd = gpiod_line_event_get_fd(line);
+	if (fd < 0)
+		return -1;
+
+	if (event_reader_has_fd(reader, fd))
+		return 0;
+
+	slots = realloc(reader->slots,
+			(reader->num_slots + 1) * sizeof(*slots));
+	if (!slots)
+		return -1;
+	reader->slots = slots;
+
+	fds = realloc(reader->fds, (reader->num_slots + 1) * sizeof(*fds));
+	if (!fds)
+		return -1;
+	reader->fds = fds;
+
+	slot = malloc(sizeof(*slot));
+	if (!slot)
+		return -1;
+
+	memset(slot, 0, sizeof(*slot));
+	slot->fd = fd;
+	slot->line = line;
+
+#ifdef HAVE_LIBURING
+	if (reader->backend == GPIOD_EVENT_READER_BACKEND_IO_URING) {
+		int rv;
+
+		/*
+		 * A read posted on a non-blocking descriptor completes
+		 * immediately with -EAGAIN instead of waiting for data.
+		 */
+		if (fcntl(fd, F_GETFL) & O_NONBLOCK) {
+			free(slot);
+			errno = EINVAL;
+			return -1;
+		}
+
+		rv = event_reader_uring_add(reader, slot);
+		if (rv) {
+			free(slot);
+			return -1;
+		}
+	}
+#endif
+
+	fds[reader->num_slots].fd = fd;
+	fds[reader->num_slots].events = POLLIN | POLLPRI;
+	fds[reader->num_slots].revents = 0;
+	slots[reader->num_slots] = slot;
+	reader->num_slots++;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_reader_add(struct gpiod_event_reader *reader,
+				     struct gpiod_line_bulk *bulk)
+{
+	unsigned int i, num_lines;
+	int rv;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (num_lines == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (i = 0; i < num_lines; i++) {
+		rv = event_reader_add_line(reader,
+					   gpiod_line_bulk_get_line(bulk, i));
+		if (rv)
+			return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_reader_backend(struct gpiod_event_reader *reader)
+{
+	return reader->backend;
+}
+
+GPIOD_API int gpiod_event_reader_read(struct gpiod_event_reader *reader,
+				      const struct timespec *timeout,
+				      struct gpiod_line_event_ext *events,
+				      unsigned int num_events)
+{
+	if (reader->num_slots == 0 || num_events == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+#ifdef HAVE_LIBURING
+	if (reader->backend == GPIOD_EVENT_READER_BACKEND_IO_URING)
+		return event_reader_uring_read(reader, timeout,
+					       events, num_events);
+#endif
+
+	return event_reader_poll_read(reader, timeout, events, num_events);
+}
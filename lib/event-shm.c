@@ -0,0 +1,490 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Fan-out of line events to other processes through a ring buffer in POSIX
+ * shared memory.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gpiod.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define EVENT_SHM_MAGIC		0x47504945 /* "GPIE" */
+#define EVENT_SHM_VERSION	2
+
+/*
+ * Everything in the mapping uses fixed-size types as the publisher and the
+ * subscribers may be built separately.
+ *
+ * A slot is valid for write number N once its seq field reads N + 1. The
+ * publisher zeroes seq before overwriting a slot so a subscriber can detect
+ * that a slot changed under it by reading seq before and after copying.
+ */
+struct event_shm_record {
+	uint64_t seq;
+	uint64_t timestamp_ns;
+	uint64_t seqno;
+	uint64_t line_seqno;
+	uint32_t offset;
+	uint32_t event_type;
+	uint64_t first_timestamp_ns;
+	uint64_t num_events;
+};
+
+struct event_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;
+	uint32_t record_size;
+	/* Total number of events ever published. */
+	uint64_t head;
+	/* Futex word bumped on every publication. */
+	uint32_t wake_seq;
+	uint32_t reserved;
+	char chip_name[32];
+	uint8_t padding[64];
+	struct event_shm_record records[];
+};
+
+struct gpiod_event_publisher {
+	char *path;
+	size_t size;
+	struct event_shm_header *shm;
+	struct gpiod_event_loop *loop;
+	struct gpiod_chip *chip;
+	/* Events published by the current call to the dispatch function. */
+	int num_dispatched;
+};
+
+struct gpiod_event_subscriber {
+	size_t size;
+	struct event_shm_header *shm;
+	/*
+	 * Validated copy of the capacity - the header is writable by the
+	 * publisher, which could change it after we checked it.
+	 */
+	uint32_t capacity;
+	uint64_t cursor;
+	unsigned long long num_lost;
+};
+
+static int event_shm_futex(uint32_t *uaddr, int op, uint32_t val,
+			   const struct timespec *timeout)
+{
+	return syscall(SYS_futex, uaddr, op, val, timeout, NULL, 0);
+}
+
+static size_t event_shm_size(unsigned int capacity)
+{
+	return sizeof(struct event_shm_header) +
+	       capacity * sizeof(struct event_shm_record);
+}
+
+static char *event_shm_path(const char *name)
+{
+	char *path;
+	int rv;
+
+	if (!name || !name[0] || strchr(name, '/')) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	rv = asprintf(&path, "/%s", name);
+	if (rv < 0)
+		return NULL;
+
+	return path;
+}
+
+GPIOD_API struct gpiod_event_publisher *
+gpiod_event_publisher_new(struct gpiod_chip *chip, const char *name,
+			  unsigned int size)
+{
+	struct gpiod_event_publisher *pub;
+	unsigned int capacity = 1;
+	int fd, rv;
+
+	if (size == 0 || size > (1U << 24)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	while (capacity < size)
+		capacity <<= 1;
+
+	pub = malloc(sizeof(*pub));
+	if (!pub)
+		return NULL;
+
+	memset(pub, 0, sizeof(*pub));
+	pub->size = event_shm_size(capacity);
+	pub->chip = chip;
+
+	pub->path = event_shm_path(name);
+	if (!pub->path)
+		goto err_free_pub;
+
+	pub->loop = gpiod_event_loop_new();
+	if (!pub->loop)
+		goto err_free_path;
+
+	fd = shm_open(pub->path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0)
+		goto err_free_loop;
+
+	rv = ftruncate(fd, pub->size);
+	if (rv)
+		goto err_unlink;
+
+	pub->shm = mmap(NULL, pub->size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fd, 0);
+	if (pub->shm == MAP_FAILED)
+		goto err_unlink;
+
+	close(fd);
+
+	pub->shm->capacity = capacity;
+	pub->shm->record_size = sizeof(struct event_shm_record);
+	pub->shm->version = EVENT_SHM_VERSION;
+	strncpy(pub->shm->chip_name, gpiod_chip_get_name(chip),
+		sizeof(pub->shm->chip_name) - 1);
+	/* Subscribers refuse to attach until the magic is there. */
+	__atomic_store_n(&pub->shm->magic, EVENT_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	return pub;
+
+err_unlink:
+	shm_unlink(pub->path);
+	close(fd);
+err_free_loop:
+	gpiod_event_loop_free(pub->loop);
+err_free_path:
+	free(pub->path);
+err_free_pub:
+	free(pub);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_event_publisher_free(struct gpiod_event_publisher *pub)
+{
+	if (!pub)
+		return;
+
+	/* Existing subscribers keep their mapping, new ones can't attach. */
+	shm_unlink(pub->path);
+	munmap(pub->shm, pub->size);
+	gpiod_event_loop_free(pub->loop);
+	free(pub->path);
+	free(pub);
+}
+
+GPIOD_API int
+gpiod_event_publisher_publish(struct gpiod_event_publisher *pub,
+			      const struct gpiod_line_event_ext *events,
+			      unsigned int num_events)
+{
+	struct event_shm_header *shm = pub->shm;
+	struct event_shm_record *rec;
+	uint64_t head;
+	unsigned int i;
+
+	head = shm->head;
+
+	for (i = 0; i < num_events; i++, head++) {
+		rec = &shm->records[head & (shm->capacity - 1)];
+
+		__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		rec->timestamp_ns = timespec_to_ns(&events[i].ts);
+		rec->seqno = events[i].seqno;
+		rec->line_seqno = events[i].line_seqno;
+		rec->offset = events[i].offset;
+		rec->event_type = events[i].event_type;
+		rec->first_timestamp_ns = timespec_to_ns(&events[i].first_ts);
+		rec->num_events = events[i].num_events;
+
+		__atomic_store_n(&rec->seq, head + 1, __ATOMIC_RELEASE);
+	}
+
+	__atomic_store_n(&shm->head, head, __ATOMIC_RELEASE);
+	__atomic_fetch_add(&shm->wake_seq, 1, __ATOMIC_ACQ_REL);
+
+	/*
+	 * Subscribers map the ring read-only so they can't tell us whether
+	 * anyone is sleeping - wake unconditionally, once per batch.
+	 */
+	event_shm_futex(&shm->wake_seq, FUTEX_WAKE, INT_MAX, NULL);
+
+	return 0;
+}
+
+static int event_publisher_collect(const struct gpiod_line_event_ext *events,
+				   unsigned int num_events, void *data)
+{
+	struct gpiod_event_publisher *pub = data;
+
+	gpiod_event_publisher_publish(pub, events, num_events);
+	pub->num_dispatched += num_events;
+
+	return GPIOD_EVENT_LOOP_CB_NEXT;
+}
+
+GPIOD_API int gpiod_event_publisher_add(struct gpiod_event_publisher *pub,
+					struct gpiod_line_bulk *bulk)
+{
+	struct gpiod_line *line;
+
+	line = gpiod_line_bulk_get_line(bulk, 0);
+	if (!line)
+		return -1;
+
+	/* Subscribers only see offsets so all lines must share a chip. */
+	if (gpiod_line_get_chip(line) != pub->chip) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return gpiod_event_loop_add(pub->loop, bulk,
+				    event_publisher_collect, pub);
+}
+
+GPIOD_API int gpiod_event_publisher_get_fd(struct gpiod_event_publisher *pub)
+{
+	return gpiod_event_loop_get_fd(pub->loop);
+}
+
+GPIOD_API int
+gpiod_event_publisher_dispatch(struct gpiod_event_publisher *pub,
+			       const struct timespec *timeout)
+{
+	int rv;
+
+	pub->num_dispatched = 0;
+
+	rv = gpiod_event_loop_dispatch(pub->loop, timeout);
+	if (rv < 0)
+		return -1;
+
+	return pub->num_dispatched;
+}
+
+GPIOD_API struct gpiod_event_subscriber *
+gpiod_event_subscriber_open(const char *name)
+{
+	struct gpiod_event_subscriber *sub;
+	struct event_shm_header *shm;
+	uint32_t capacity;
+	struct stat st;
+	char *path;
+	int fd, rv;
+
+	path = event_shm_path(name);
+	if (!path)
+		return NULL;
+
+	fd = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+	free(path);
+	if (fd < 0)
+		return NULL;
+
+	rv = fstat(fd, &st);
+	if (rv)
+		goto err_close;
+
+	if ((size_t)st.st_size < sizeof(*shm)) {
+		errno = ENODATA;
+		goto err_close;
+	}
+
+	/*
+	 * Read-only is enough to wait on the futex and guarantees that a
+	 * misbehaving subscriber can't corrupt what the others see.
+	 */
+	shm = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (shm == MAP_FAILED)
+		goto err_close;
+
+	close(fd);
+
+	if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != EVENT_SHM_MAGIC)
+		goto err_proto;
+
+	capacity = shm->capacity;
+
+	/* The ring is indexed with a mask so the capacity is a power of 2. */
+	if (shm->version != EVENT_SHM_VERSION ||
+	    shm->record_size != sizeof(struct event_shm_record) ||
+	    capacity == 0 || (capacity & (capacity - 1)) ||
+	    event_shm_size(capacity) > (size_t)st.st_size)
+		goto err_proto;
+
+	sub = malloc(sizeof(*sub));
+	if (!sub) {
+		munmap(shm, st.st_size);
+		return NULL;
+	}
+
+	memset(sub, 0, sizeof(*sub));
+	sub->shm = shm;
+	sub->size = st.st_size;
+	sub->capacity = capacity;
+	/* Start with the events published from now on. */
+	sub->cursor = __atomic_load_n(&shm->head, __ATOMIC_ACQUIRE);
+
+	return sub;
+
+err_proto:
+	munmap(shm, st.st_size);
+	errno = EPROTO;
+
+	return NULL;
+
+err_close:
+	close(fd);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_event_subscriber_close(struct gpiod_event_subscriber *sub)
+{
+	if (!sub)
+		return;
+
+	munmap(sub->shm, sub->size);
+	free(sub);
+}
+
+GPIOD_API const char *
+gpiod_event_subscriber_chip_name(struct gpiod_event_subscriber *sub)
+{
+	return sub->shm->chip_name;
+}
+
+/*
+ * Copy out the record for the current cursor position. Returns false if the
+ * publisher has already overwritten it.
+ */
+static bool event_subscriber_copy(struct gpiod_event_subscriber *sub,
+				  struct gpiod_line_event_ext *event)
+{
+	struct event_shm_header *shm = sub->shm;
+	struct event_shm_record *rec;
+	uint64_t seq;
+
+	rec = &shm->records[sub->cursor & (sub->capacity - 1)];
+
+	seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+	if (seq != sub->cursor + 1)
+		return false;
+
+	ns_to_timespec(rec->timestamp_ns, &event->ts);
+	event->seqno = rec->seqno;
+	event->line_seqno = rec->line_seqno;
+	event->offset = rec->offset;
+	event->event_type = rec->event_type;
+	ns_to_timespec(rec->first_timestamp_ns, &event->first_ts);
+	event->num_events = rec->num_events;
+
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return __atomic_load_n(&rec->seq, __ATOMIC_RELAXED) == seq;
+}
+
+static unsigned int event_subscriber_take(struct gpiod_event_subscriber *sub,
+					  struct gpiod_line_event_ext *events,
+					  unsigned int num_events)
+{
+	uint64_t head, capacity = sub->capacity;
+	unsigned int num = 0;
+
+	head = __atomic_load_n(&sub->shm->head, __ATOMIC_ACQUIRE);
+
+	while (sub->cursor < head && num < num_events) {
+		/* Too far behind - skip to the oldest event still there. */
+		if (head - sub->cursor > capacity) {
+			sub->num_lost += head - capacity - sub->cursor;
+			sub->cursor = head - capacity;
+		}
+
+		if (event_subscriber_copy(sub, &events[num])) {
+			num++;
+			sub->cursor++;
+			continue;
+		}
+
+		/* Overwritten while we were looking - catch up and retry. */
+		head = __atomic_load_n(&sub->shm->head, __ATOMIC_ACQUIRE);
+		if (head - sub->cursor <= capacity) {
+			sub->num_lost++;
+			sub->cursor++;
+		}
+	}
+
+	return num;
+}
+
+GPIOD_API int gpiod_event_subscriber_read(struct gpiod_event_subscriber *sub,
+					  const struct timespec *timeout,
+					  struct gpiod_line_event_ext *events,
+					  unsigned int num_events)
+{
+	uint64_t deadline = 0, now;
+	struct timespec remaining;
+	unsigned int num;
+	uint32_t wake_seq;
+	int rv;
+
+	if (num_events == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (timeout)
+		deadline = monotonic_ns() + timespec_to_ns(timeout);
+
+	for (;;) {
+		/* Sample the futex word first so that no wake-up is lost. */
+		wake_seq = __atomic_load_n(&sub->shm->wake_seq,
+					   __ATOMIC_ACQUIRE);
+
+		num = event_subscriber_take(sub, events, num_events);
+		if (num)
+			return num;
+
+		if (timeout) {
+			now = monotonic_ns();
+			if (now >= deadline)
+				return 0;
+
+			ns_to_timespec(deadline - now, &remaining);
+		}
+
+		rv = event_shm_futex(&sub->shm->wake_seq, FUTEX_WAIT, wake_seq,
+				     timeout ? &remaining : NULL);
+		if (rv && errno != EAGAIN && errno != EINTR &&
+		    errno != ETIMEDOUT)
+			return -1;
+	}
+}
+
+GPIOD_API unsigned long long
+gpiod_event_subscriber_num_lost(struct gpiod_event_subscriber *sub)
+{
+	return sub->num_lost;
+}
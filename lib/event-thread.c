@@ -0,0 +1,445 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Event loop running on a library thread set up for low latency: pinned to
+ * a CPU, scheduled with SCHED_FIFO and with its memory locked and prefaulted.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+/*
+ * Small enough to fit in the default locked memory limit of unprivileged
+ * processes, large enough for the dispatch path and the user callbacks.
+ */
+#define EVENT_THREAD_STACK_SIZE		(256 * 1024)
+/* Amount of stack touched by the thread before it starts handling events. */
+#define EVENT_THREAD_PREFAULT_STACK	(64 * 1024)
+/* Smaller than any page size Linux supports. */
+#define EVENT_THREAD_PREFAULT_STRIDE	1024
+
+#define EVENT_THREAD_FLAGS_MASK		GPIOD_EVENT_THREAD_FLAG_LOCK_MEMORY
+
+/* Wraps the user callback of every registered set of lines. */
+struct event_thread_handler {
+	struct gpiod_event_thread *thread;
+	gpiod_event_loop_cb cb;
+	void *data;
+	struct event_thread_handler *next;
+};
+
+struct gpiod_event_thread {
+	int cpu;
+	int priority;
+	int flags;
+	struct gpiod_event_loop *loop;
+	struct event_thread_handler *handlers;
+	pthread_t thread;
+	bool running;
+	int stop_fd;
+	int rt_status;
+	int error;
+
+	/* Only written by the thread but read from anywhere. */
+	unsigned long long num_wakeups;
+	unsigned long long num_events;
+	unsigned long long latency_min;
+	unsigned long long latency_max;
+	unsigned long long latency_sum;
+	unsigned long long hist[GPIOD_EVENT_THREAD_NUM_BUCKETS];
+};
+
+static void event_thread_store(unsigned long long *ptr,
+			       unsigned long long val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_RELAXED);
+}
+
+static unsigned long long event_thread_load(unsigned long long *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static unsigned int event_thread_bucket(unsigned long long latency)
+{
+	unsigned long long usec = latency / 1000;
+	unsigned int bucket;
+
+	if (usec == 0)
+		return 0;
+
+	bucket = 64 - __builtin_clzll(usec);
+	if (bucket >= GPIOD_EVENT_THREAD_NUM_BUCKETS)
+		bucket = GPIOD_EVENT_THREAD_NUM_BUCKETS - 1;
+
+	return bucket;
+}
+
+static void event_thread_account(struct gpiod_event_thread *thread,
+				 const struct gpiod_line_event_ext *events,
+				 unsigned int num_events)
+{
+	unsigned long long latency, ts;
+	unsigned int i, bucket;
+	uint64_t now;
+
+	now = monotonic_ns();
+
+	for (i = 0; i < num_events; i++) {
+		ts = timespec_to_ns(&events[i].ts);
+		latency = now > ts ? now - ts : 0;
+
+		if (thread->num_events == 0 || latency < thread->latency_min)
+			event_thread_store(&thread->latency_min, latency);
+		if (latency > thread->latency_max)
+			event_thread_store(&thread->latency_max, latency);
+
+		bucket = event_thread_bucket(latency);
+		counter_add(&thread->hist[bucket], 1);
+		counter_add(&thread->latency_sum, latency);
+		counter_add(&thread->num_events, 1);
+	}
+}
+
+static int event_thread_dispatch(const struct gpiod_line_event_ext *events,
+				 unsigned int num_events, void *data)
+{
+	struct event_thread_handler *handler = data;
+
+	event_thread_account(handler->thread, events, num_events);
+
+	return handler->cb(events, num_events, handler->data);
+}
+
+/*
+ * Touch the stack the dispatch path will use so that handling the first
+ * events doesn't take page faults.
+ */
+static void __attribute__((noinline)) event_thread_prefault(void)
+{
+	volatile char stack[EVENT_THREAD_PREFAULT_STACK];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(stack); i += EVENT_THREAD_PREFAULT_STRIDE)
+		stack[i] = 0;
+}
+
+static void *event_thread_func(void *data)
+{
+	struct gpiod_event_thread *thread = data;
+	struct timespec ts = { 0, 0 };
+	struct pollfd pfds[2];
+	int rv;
+
+	event_thread_prefault();
+
+	pfds[0].fd = gpiod_event_loop_get_fd(thread->loop);
+	pfds[0].events = POLLIN;
+	pfds[1].fd = thread->stop_fd;
+	pfds[1].events = POLLIN;
+
+	for (;;) {
+		rv = poll(pfds, 2, -1);
+		if (rv < 0) {
+			if (errno == EINTR)
+				continue;
+
+			thread->error = errno;
+			break;
+		}
+
+		if (pfds[1].revents)
+			break;
+
+		counter_add(&thread->num_wakeups, 1);
+
+		rv = gpiod_event_loop_dispatch(thread->loop, &ts);
+		if (rv < 0) {
+			thread->error = errno;
+			break;
+		}
+
+		if (rv == GPIOD_EVENT_LOOP_STOPPED)
+			break;
+	}
+
+	return NULL;
+}
+
+/*
+ * Check if the process already has any memory locked. Assume it does if we
+ * can't tell so that we never unlock memory the user locked.
+ */
+static bool event_thread_memory_locked(void)
+{
+	unsigned long locked_kb = 1;
+	char buf[128];
+	FILE *fp;
+
+	fp = fopen("/proc/self/status", "re");
+	if (!fp)
+		return true;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		if (sscanf(buf, "VmLck: %lu", &locked_kb) == 1)
+			break;
+	}
+
+	fclose(fp);
+
+	return locked_kb > 0;
+}
+
+/*
+ * Start the thread with as many of the requested settings as we're allowed
+ * to apply. Returns the settings that were applied or -1 on error.
+ */
+static int event_thread_spawn(struct gpiod_event_thread *thread)
+{
+	struct sched_param param;
+	pthread_attr_t attr;
+	bool was_locked = true;
+	cpu_set_t cpus;
+	int want = 0, rv;
+
+	if (thread->cpu >= 0)
+		want |= GPIOD_EVENT_THREAD_RT_AFFINITY;
+	if (thread->priority > 0)
+		want |= GPIOD_EVENT_THREAD_RT_PRIORITY;
+
+	/*
+	 * Do it before the thread is created so that its stack gets locked
+	 * as soon as it's mapped.
+	 */
+	if (thread->flags & GPIOD_EVENT_THREAD_FLAG_LOCK_MEMORY) {
+		was_locked = event_thread_memory_locked();
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+			want |= GPIOD_EVENT_THREAD_RT_MEMLOCK;
+	}
+
+	for (;;) {
+		rv = pthread_attr_init(&attr);
+		if (rv)
+			break;
+
+		pthread_attr_setstacksize(&attr, EVENT_THREAD_STACK_SIZE);
+
+		if (want & GPIOD_EVENT_THREAD_RT_AFFINITY) {
+			CPU_ZERO(&cpus);
+			CPU_SET(thread->cpu, &cpus);
+			pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+		}
+
+		if (want & GPIOD_EVENT_THREAD_RT_PRIORITY) {
+			memset(&param, 0, sizeof(param));
+			param.sched_priority = thread->priority;
+			pthread_attr_setinheritsched(&attr,
+						     PTHREAD_EXPLICIT_SCHED);
+			pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+			pthread_attr_setschedparam(&attr, &param);
+		}
+
+		rv = pthread_create(&thread->thread, &attr,
+				    event_thread_func, thread);
+		pthread_attr_destroy(&attr);
+		if (rv == 0)
+			return want;
+
+		/*
+		 * Not allowed to use real-time scheduling, the CPU is offline
+		 * or outside of our cpuset or the stack doesn't fit in the
+		 * locked memory limit - try without. Memory locking can only
+		 * be undone if it was us who locked it, munlockall() would
+		 * also drop the locks taken by the user.
+		 */
+		if (rv == EPERM && (want & GPIOD_EVENT_THREAD_RT_PRIORITY)) {
+			want &= ~GPIOD_EVENT_THREAD_RT_PRIORITY;
+		} else if (rv == EINVAL &&
+			   (want & GPIOD_EVENT_THREAD_RT_AFFINITY)) {
+			want &= ~GPIOD_EVENT_THREAD_RT_AFFINITY;
+		} else if (rv == EAGAIN && !was_locked &&
+			   (want & GPIOD_EVENT_THREAD_RT_MEMLOCK)) {
+			munlockall();
+			want &= ~GPIOD_EVENT_THREAD_RT_MEMLOCK;
+		} else {
+			break;
+		}
+	}
+
+	errno = rv;
+	return -1;
+}
+
+GPIOD_API struct gpiod_event_thread *
+gpiod_event_thread_new(int cpu, int priority, int flags)
+{
+	struct gpiod_event_thread *thread;
+
+	if (cpu < -1 || cpu >= CPU_SETSIZE || priority < 0 ||
+	    (priority > 0 && (priority < sched_get_priority_min(SCHED_FIFO) ||
+			      priority > sched_get_priority_max(SCHED_FIFO))) ||
+	    (flags & ~EVENT_THREAD_FLAGS_MASK)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	thread = malloc(sizeof(*thread));
+	if (!thread)
+		return NULL;
+
+	memset(thread, 0, sizeof(*thread));
+	thread->cpu = cpu;
+	thread->priority = priority;
+	thread->flags = flags;
+
+	thread->loop = gpiod_event_loop_new();
+	if (!thread->loop)
+		goto err_free;
+
+	thread->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (thread->stop_fd < 0)
+		goto err_free_loop;
+
+	return thread;
+
+err_free_loop:
+	gpiod_event_loop_free(thread->loop);
+err_free:
+	free(thread);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_event_thread_free(struct gpiod_event_thread *thread)
+{
+	struct event_thread_handler *handler, *next;
+
+	if (!thread)
+		return;
+
+	gpiod_event_thread_stop(thread);
+
+	for (handler = thread->handlers; handler; handler = next) {
+		next = handler->next;
+		free(handler);
+	}
+
+	close(thread->stop_fd);
+	gpiod_event_loop_free(thread->loop);
+	free(thread);
+}
+
+GPIOD_API int gpiod_event_thread_add(struct gpiod_event_thread *thread,
+				     struct gpiod_line_bulk *bulk,
+				     gpiod_event_loop_cb cb, void *data)
+{
+	struct event_thread_handler *handler;
+	int rv;
+
+	if (thread->running) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	if (!cb) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Allocated up front so that the thread itself never has to. */
+	handler = malloc(sizeof(*handler));
+	if (!handler)
+		return -1;
+
+	handler->thread = thread;
+	handler->cb = cb;
+	handler->data = data;
+
+	rv = gpiod_event_loop_add(thread->loop, bulk,
+				  event_thread_dispatch, handler);
+	if (rv) {
+		free(handler);
+		return -1;
+	}
+
+	handler->next = thread->handlers;
+	thread->handlers = handler;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_thread_start(struct gpiod_event_thread *thread)
+{
+	int rv;
+
+	if (thread->running) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	fd_clear(thread->stop_fd);
+	thread->error = 0;
+
+	rv = event_thread_spawn(thread);
+	if (rv < 0)
+		return -1;
+
+	thread->rt_status = rv;
+	thread->running = true;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_thread_stop(struct gpiod_event_thread *thread)
+{
+	if (!thread->running)
+		return 0;
+
+	fd_signal(thread->stop_fd);
+	pthread_join(thread->thread, NULL);
+	thread->running = false;
+
+	if (thread->error) {
+		errno = thread->error;
+		return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_event_thread_rt_status(struct gpiod_event_thread *thread)
+{
+	return thread->rt_status;
+}
+
+GPIOD_API void
+gpiod_event_thread_get_stats(struct gpiod_event_thread *thread,
+			     struct gpiod_event_thread_stats *stats)
+{
+	unsigned int i;
+
+	stats->num_wakeups = event_thread_load(&thread->num_wakeups);
+	stats->num_events = event_thread_load(&thread->num_events);
+	stats->latency_min_ns = event_thread_load(&thread->latency_min);
+	stats->latency_max_ns = event_thread_load(&thread->latency_max);
+
+	/* The sum and the count may be off by one event - close enough. */
+	stats->latency_avg_ns = stats->num_events ?
+			event_thread_load(&thread->latency_sum) /
+			stats->num_events : 0;
+
+	for (i = 0; i < GPIOD_EVENT_THREAD_NUM_BUCKETS; i++)
+		stats->hist[i] = event_thread_load(&thread->hist[i]);
+}
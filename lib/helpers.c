@@ -9,6 +9,7 @@
 #include <errno.h>
 #include <gpiod.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "internal.h"
@@ -300,3 +301,114 @@ GPIOD_API int gpiod_line_request_bulk_both_edges_events_flags(
 	return line_event_request_type_bulk(bulk, consumer, flags,
 					GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES);
 }
+
+static int line_event_cmp_ts(const void *p1, const void *p2)
+{
+	const struct gpiod_line_event *ev1 = p1, *ev2 = p2;
+	uint64_t ts1 = timespec_to_ns(&ev1->ts), ts2 = timespec_to_ns(&ev2->ts);
+
+	return ts1 < ts2 ? -1 : ts1 > ts2;
+}
+
+static int line_bulk_find_offset(struct gpiod_line_bulk *bulk,
+				 unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < gpiod_line_bulk_num_lines(bulk); i++) {
+		if (gpiod_line_offset(gpiod_line_bulk_get_line(bulk, i)) ==
+		    offset)
+			return i;
+	}
+
+	return -1;
+}
+
+GPIOD_API int gpiod_line_wait_pattern_bulk(struct gpiod_line_bulk *bulk,
+					   unsigned long long mask,
+					   unsigned long long bits,
+					   const struct timespec *timeout,
+					   struct timespec *ts)
+{
+	struct gpiod_line_event events[64];
+	unsigned long long state = 0;
+	uint64_t start, deadline = 0, now;
+	unsigned int num_lines, i;
+	struct timespec remaining, *left = NULL;
+	int values[64], rv, idx;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (num_lines == 0 || num_lines > 64 || !mask || (bits & ~mask) ||
+	    (num_lines < 64 && (mask >> num_lines))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Levels can only be followed if every change is reported. */
+	for (i = 0; i < num_lines; i++) {
+		if (line_request_type(gpiod_line_bulk_get_line(bulk, i)) !=
+					GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES) {
+			errno = EPERM;
+			return -1;
+		}
+	}
+
+	start = monotonic_ns();
+	if (timeout)
+		deadline = start + timespec_to_ns(timeout);
+
+	rv = gpiod_line_get_value_bulk(bulk, values);
+	if (rv < 0)
+		return -1;
+
+	for (i = 0; i < num_lines; i++) {
+		if (values[i])
+			state |= 1ULL << i;
+	}
+
+	if ((state & mask) == bits) {
+		if (ts)
+			ns_to_timespec(start, ts);
+		return 1;
+	}
+
+	for (;;) {
+		if (timeout) {
+			now = monotonic_ns();
+			if (now >= deadline)
+				return 0;
+
+			ns_to_timespec(deadline - now, &remaining);
+			left = &remaining;
+		}
+
+		rv = gpiod_line_event_read_bulk(bulk, left, events, 64);
+		if (rv < 0)
+			return -1;
+
+		/* Events come grouped by file descriptor - order them first. */
+		qsort(events, rv, sizeof(*events), line_event_cmp_ts);
+
+		for (i = 0; i < (unsigned int)rv; i++) {
+			/* The initial read already reflects older edges. */
+			if (timespec_to_ns(&events[i].ts) < start)
+				continue;
+
+			idx = line_bulk_find_offset(bulk, events[i].offset);
+			if (idx < 0)
+				continue;
+
+			if (events[i].event_type ==
+						GPIOD_LINE_EVENT_RISING_EDGE)
+				state |= 1ULL << idx;
+			else
+				state &= ~(1ULL << idx);
+
+			if ((state & mask) == bits) {
+				if (ts)
+					*ts = events[i].ts;
+				return 1;
+			}
+		}
+	}
+}
@@ -6,6 +6,190 @@
 
 /* For internal library use only. */
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
 #define GPIOD_API __attribute__((visibility("default")))
 
+/* Time conversion helpers - all library timekeeping uses CLOCK_MONOTONIC. */
+uint64_t timespec_to_ns(const struct timespec *ts);
+void ns_to_timespec(uint64_t ns, struct timespec *ts);
+uint64_t monotonic_ns(void);
+
+/* Time left until a deadline in nanoseconds, zero if it has passed. */
+void timeout_until_ns(uint64_t deadline, struct timespec *ts);
+
+/* The earlier of two deadlines, where 0 stands for no deadline at all. */
+uint64_t deadline_min(uint64_t a, uint64_t b);
+
+/*
+ * Sleep until the CLOCK_MONOTONIC deadline given in nanoseconds. The end is
+ * slept with clock_nanosleep(TIMER_ABSTIME) for precision but until then the
+ * sleep is cut short as soon as stop_fd becomes readable. Returns 0 once the
+ * deadline passed, 1 if stopped and -1 on error.
+ */
+int sleep_until_ns(uint64_t deadline, int stop_fd);
+
+/*
+ * Periodic threads that fell behind don't try to catch up: move the deadline
+ * of the next period past the ones that were missed entirely. Returns the
+ * number of periods skipped.
+ */
+uint64_t deadline_skip_missed(uint64_t *deadline, uint64_t period);
+
+/*
+ * Wake up whoever polls an eventfd, reset an eventfd or an expired timerfd.
+ * Errors are ignored: a failed write would mean the counter overflowed and
+ * a failed read that there was nothing to reset.
+ */
+void fd_signal(int fd);
+void fd_clear(int fd);
+
+/*
+ * Statistics counters are only written by the thread owning them but read
+ * from anywhere with relaxed atomic loads, so a plain store is enough.
+ */
+void counter_add(unsigned long long *counter, unsigned long long val);
+
+/*
+ * Single-producer, single-consumer queue of fixed-size items handed over from
+ * a library thread to the user. Both indexes run freely and are masked on
+ * access. The producer is the only writer of head while tail is advanced with
+ * compare-and-swap - by the consumer when reading and by the producer when it
+ * discards the oldest item.
+ */
+struct spsc_ring {
+	void *items;
+	size_t item_size;
+	unsigned long mask;
+	unsigned long head;
+	unsigned long tail;
+	/* Signalled by the producer when it has stored new items. */
+	int data_fd;
+	/* Signalled by the consumer when it freed room in a full ring. */
+	int space_fd;
+	/* Set by the producer if it stopped because of an error. */
+	int error;
+};
+
+/*
+ * Allocate room for size items rounded up to a power of two. The space_fd is
+ * only created if the producer is going to wait for room. On error the ring
+ * is still safe to release.
+ */
+int spsc_ring_init(struct spsc_ring *ring, unsigned int size,
+		   size_t item_size, bool wait_space);
+void spsc_ring_release(struct spsc_ring *ring);
+
+/* Number of items queued - may be stale by the time it returns. */
+unsigned long spsc_ring_used(struct spsc_ring *ring);
+
+/*
+ * Producer side. Items are written in place to the slot returned by
+ * spsc_ring_slot() - NULL if the ring is full - and made visible to the
+ * consumer with spsc_ring_push(). Signalling data_fd is up to the caller so
+ * that it can be done once per batch.
+ */
+void *spsc_ring_slot(struct spsc_ring *ring);
+void spsc_ring_push(struct spsc_ring *ring);
+
+/*
+ * Discard the oldest item of a full ring. Returns false if the consumer made
+ * room in the meantime and nothing was discarded.
+ */
+bool spsc_ring_drop_oldest(struct spsc_ring *ring);
+
+/*
+ * Wait until the consumer makes room. Returns false if stop_fd became readable
+ * in the meantime or on error.
+ */
+bool spsc_ring_wait_space(struct spsc_ring *ring, int stop_fd);
+
+/* Record the error that stopped the producer and wake up the consumer. */
+void spsc_ring_set_error(struct spsc_ring *ring, int error);
+
+/*
+ * Consumer side. Take up to num_items items, waiting at most timeout (forever
+ * if NULL) for the first one to arrive. Returns the number of items taken, 0
+ * if the timeout expired and -1 on error including the one the producer left.
+ */
+int spsc_ring_read(struct spsc_ring *ring, const struct timespec *timeout,
+		   void *items, unsigned int num_items);
+
+struct gpio_v2_line_event;
+struct gpiod_line;
+struct gpiod_line_bulk;
+struct gpiod_line_event_ext;
+
+/*
+ * Translate events read straight from the event file descriptor of line into
+ * the libgpiod format, updating the input value cache on the way. Edges
+ * swallowed or held back by software event filters are not stored. Returns
+ * the number of events stored which never exceeds num_events.
+ */
+unsigned int line_events_from_raw(struct gpiod_line *line,
+				  const struct gpio_v2_line_event *evdata,
+				  struct gpiod_line_event_ext *events,
+				  unsigned int num_events);
+
+/*
+ * Like gpiod_line_event_read_multiple_ext() but returns 0 instead of reading
+ * again if software event filters swallowed or held back all events read.
+ * Never waits for held back events to become due and, if the request has any
+ * software filters, doesn't block on an empty descriptor either.
+ */
+int line_event_read_filtered(struct gpiod_line *line,
+			     struct gpiod_line_event_ext *events,
+			     unsigned int num_events);
+
+/*
+ * Store the events held back by software filters of the request of line that
+ * are due by now. Returns the number of events stored.
+ */
+unsigned int line_filter_flush(struct gpiod_line *line,
+			       struct gpiod_line_event_ext *events,
+			       unsigned int num_events);
+
+/*
+ * Time at which the next event held back by software filters of the request
+ * of line is due or 0 if nothing is held back. Multiplexers must wake up
+ * then and read from the line.
+ */
+uint64_t line_filter_deadline(struct gpiod_line *line);
+
+/*
+ * For code driving the GPIO_V2_LINE_{GET,SET}_VALUES ioctls directly: store
+ * the bit corresponding to line N of bulk in the bitmap of its request in
+ * bits[N] and return the file descriptor of the request. Returns -1 and sets
+ * errno to EPERM if any line isn't requested or to EINVAL if the lines
+ * weren't requested together.
+ */
+int line_bulk_request_bits(struct gpiod_line_bulk *bulk, uint64_t *bits);
+
+/*
+ * Record the value last written to an output line behind the back of the
+ * core code so that the output cache stays coherent.
+ */
+void line_output_sync(struct gpiod_line *line, int value);
+
+/*
+ * Forget the cached value of an output line after writing to it behind the
+ * back of the core code failed half-way. The next write goes to the kernel.
+ */
+void line_output_invalidate(struct gpiod_line *line);
+
+/*
+ * Get the GPIOD_LINE_REQUEST_* type the line was requested with or -1 if
+ * it's not requested.
+ */
+int line_request_type(struct gpiod_line *line);
+
+/*
+ * Check whether the file descriptor of a requested line is shared with other
+ * lines of the same request.
+ */
+bool line_fd_shared(struct gpiod_line *line);
+
 #endif /* __LIBGPIOD_GPIOD_INTERNAL_H__ */
@@ -0,0 +1,447 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Matrix keypad scanning - the thread sleeps on column edges while the keypad
+ * is idle and scans it row by row while any key is down.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+#define KEYPAD_MAX_LINES		64
+#define KEYPAD_RING_SIZE		64
+#define KEYPAD_MIN_SCAN_NS		1000000ULL
+
+struct gpiod_keypad {
+	unsigned int num_rows;
+	unsigned int num_cols;
+	struct gpiod_line *rows[KEYPAD_MAX_LINES];
+
+	int row_fd;
+	uint64_t row_bits[KEYPAD_MAX_LINES];
+	uint64_t row_mask;
+	/* Last value written to the rows request if row_values_valid. */
+	uint64_t row_values;
+	bool row_values_valid;
+
+	int col_fd;
+	uint64_t col_bits[KEYPAD_MAX_LINES];
+	uint64_t col_mask;
+
+	uint64_t debounce_ns;
+	uint64_t scan_ns;
+
+	pthread_t thread;
+	int stop_fd;
+
+	/* Raw state of every row from the last scan and when it changed. */
+	uint64_t raw[KEYPAD_MAX_LINES];
+	uint64_t raw_ns[KEYPAD_MAX_LINES];
+	/* Debounced state, only written by the thread. */
+	unsigned long long state[KEYPAD_MAX_LINES];
+
+	struct spsc_ring ring;
+	/* Only written by the thread but read from anywhere. */
+	unsigned long long num_lost;
+
+	struct gpio_v2_line_event buf[16];
+};
+
+static int keypad_drive_rows(struct gpiod_keypad *keypad, uint64_t values)
+{
+	struct gpio_v2_line_values lv;
+	int rv;
+
+	if (keypad->row_values_valid && values == keypad->row_values)
+		return 0;
+
+	lv.mask = keypad->row_mask;
+	lv.bits = values;
+
+	rv = ioctl(keypad->row_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv);
+	if (rv < 0)
+		return -1;
+
+	keypad->row_values = values;
+	keypad->row_values_valid = true;
+
+	return 0;
+}
+
+static int keypad_read_cols(struct gpiod_keypad *keypad, uint64_t *cols)
+{
+	struct gpio_v2_line_values lv;
+	unsigned int i;
+	int rv;
+
+	lv.mask = keypad->col_mask;
+	lv.bits = 0;
+
+	rv = ioctl(keypad->col_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv);
+	if (rv < 0)
+		return -1;
+
+	*cols = 0;
+	for (i = 0; i < keypad->num_cols; i++) {
+		if (lv.bits & keypad->col_bits[i])
+			*cols |= 1ULL << i;
+	}
+
+	return 0;
+}
+
+/*
+ * The column edges only serve as a wake-up - their contents don't matter. The
+ * column descriptor may be blocking and changing its flags would affect the
+ * caller, so check for pending events before every read.
+ */
+static int keypad_drain_cols(struct gpiod_keypad *keypad)
+{
+	struct pollfd pfd;
+	ssize_t rd;
+	int rv;
+
+	pfd.fd = keypad->col_fd;
+	pfd.events = POLLIN | POLLPRI;
+
+	for (;;) {
+		rv = poll(&pfd, 1, 0);
+		if (rv <= 0)
+			return rv;
+
+		rd = read(keypad->col_fd, keypad->buf, sizeof(keypad->buf));
+		if (rd < 0)
+			return errno == EAGAIN ? 0 : -1;
+	}
+}
+
+static void keypad_queue(struct gpiod_keypad *keypad, unsigned int row,
+			 unsigned int col, int event_type, uint64_t now)
+{
+	struct gpiod_keypad_event *event;
+
+	/* The consumer is too slow - lose the event. */
+	event = spsc_ring_slot(&keypad->ring);
+	if (!event) {
+		counter_add(&keypad->num_lost, 1);
+		return;
+	}
+
+	event->row = row;
+	event->col = col;
+	event->event_type = event_type;
+	ns_to_timespec(now, &event->ts);
+
+	spsc_ring_push(&keypad->ring);
+}
+
+static void keypad_debounce(struct gpiod_keypad *keypad, unsigned int row,
+			    uint64_t raw, uint64_t now)
+{
+	unsigned long long changed;
+	unsigned int col;
+
+	if (raw != keypad->raw[row]) {
+		keypad->raw[row] = raw;
+		keypad->raw_ns[row] = now;
+	}
+
+	changed = keypad->state[row] ^ raw;
+	if (!changed || now - keypad->raw_ns[row] < keypad->debounce_ns)
+		return;
+
+	for (col = 0; col < keypad->num_cols; col++) {
+		if (changed & (1ULL << col))
+			keypad_queue(keypad, row, col,
+				     raw & (1ULL << col) ?
+						GPIOD_KEYPAD_KEY_PRESS :
+						GPIOD_KEYPAD_KEY_RELEASE,
+				     now);
+	}
+
+	__atomic_store_n(&keypad->state[row], raw, __ATOMIC_RELAXED);
+}
+
+/*
+ * Scan all rows once. The scan needs to go on while busy is set, that is
+ * while any key is down or hasn't settled yet.
+ */
+static int keypad_scan(struct gpiod_keypad *keypad, bool *busy)
+{
+	unsigned long head = keypad->ring.head;
+	unsigned int row;
+	uint64_t cols, now;
+	int rv;
+
+	*busy = false;
+
+	for (row = 0; row < keypad->num_rows; row++) {
+		rv = keypad_drive_rows(keypad, keypad->row_bits[row]);
+		if (rv < 0)
+			return -1;
+
+		rv = keypad_read_cols(keypad, &cols);
+		if (rv < 0)
+			return -1;
+
+		now = monotonic_ns();
+		keypad_debounce(keypad, row, cols, now);
+		if (cols || keypad->state[row])
+			*busy = true;
+	}
+
+	if (keypad->ring.head != head)
+		fd_signal(keypad->ring.data_fd);
+
+	return 0;
+}
+
+/*
+ * Activate all rows and wait until any key closes a contact. Returns 0 when
+ * woken up by a column, 1 if stopped and -1 on error.
+ */
+static int keypad_idle(struct gpiod_keypad *keypad)
+{
+	struct pollfd pfds[2];
+	uint64_t cols;
+	int rv;
+
+	rv = keypad_drive_rows(keypad, keypad->row_mask);
+	if (rv < 0)
+		return -1;
+
+	/*
+	 * Drain the edges caused by scanning before checking the columns so
+	 * that a key pressed right after the check still wakes us up.
+	 */
+	rv = keypad_drain_cols(keypad);
+	if (rv < 0)
+		return -1;
+
+	rv = keypad_read_cols(keypad, &cols);
+	if (rv < 0)
+		return -1;
+
+	if (cols)
+		return 0;
+
+	pfds[0].fd = keypad->col_fd;
+	pfds[0].events = POLLIN | POLLPRI;
+	pfds[1].fd = keypad->stop_fd;
+	pfds[1].events = POLLIN;
+
+	for (;;) {
+		rv = poll(pfds, 2, -1);
+		if (rv < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return -1;
+		}
+
+		if (pfds[1].revents)
+			return 1;
+
+		return keypad_drain_cols(keypad);
+	}
+}
+
+static void *keypad_thread(void *data)
+{
+	struct gpiod_keypad *keypad = data;
+	uint64_t deadline = 0;
+	bool busy = false;
+	int rv;
+
+	for (;;) {
+		if (!busy) {
+			rv = keypad_idle(keypad);
+			if (rv)
+				break;
+
+			deadline = monotonic_ns();
+		}
+
+		rv = keypad_scan(keypad, &busy);
+		if (rv)
+			break;
+
+		if (!busy)
+			continue;
+
+		deadline += keypad->scan_ns;
+		rv = sleep_until_ns(deadline, keypad->stop_fd);
+		if (rv)
+			break;
+	}
+
+	if (rv < 0)
+		spsc_ring_set_error(&keypad->ring, errno);
+
+	return NULL;
+}
+
+static bool keypad_bulk_requested(struct gpiod_line_bulk *bulk, int type)
+{
+	unsigned int num_lines, i;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	for (i = 0; i < num_lines; i++) {
+		if (line_request_type(gpiod_line_bulk_get_line(bulk, i)) !=
+									type)
+			return false;
+	}
+
+	return true;
+}
+
+GPIOD_API struct gpiod_keypad *gpiod_keypad_new(struct gpiod_line_bulk *rows,
+						struct gpiod_line_bulk *cols,
+						const struct timespec *debounce)
+{
+	unsigned int num_rows, num_cols, i;
+	struct gpiod_keypad *keypad;
+	struct gpiod_line *line;
+	int rv, fd;
+
+	num_rows = gpiod_line_bulk_num_lines(rows);
+	num_cols = gpiod_line_bulk_num_lines(cols);
+	if (num_rows == 0 || num_rows > KEYPAD_MAX_LINES ||
+	    num_cols == 0 || num_cols > KEYPAD_MAX_LINES) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (!keypad_bulk_requested(rows, GPIOD_LINE_REQUEST_DIRECTION_OUTPUT) ||
+	    !keypad_bulk_requested(cols, GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES)) {
+		errno = EPERM;
+		return NULL;
+	}
+
+	/* All columns must come from a single request. */
+	fd = gpiod_line_event_get_fd(gpiod_line_bulk_get_line(cols, 0));
+	for (i = 1; i < num_cols; i++) {
+		line = gpiod_line_bulk_get_line(cols, i);
+		if (gpiod_line_event_get_fd(line) != fd) {
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	keypad = malloc(sizeof(*keypad));
+	if (!keypad)
+		return NULL;
+
+	memset(keypad, 0, sizeof(*keypad));
+	keypad->num_rows = num_rows;
+	keypad->num_cols = num_cols;
+	keypad->col_fd = fd;
+	keypad->debounce_ns = timespec_to_ns(debounce);
+	keypad->scan_ns = keypad->debounce_ns / 4;
+	if (keypad->scan_ns < KEYPAD_MIN_SCAN_NS)
+		keypad->scan_ns = KEYPAD_MIN_SCAN_NS;
+
+	keypad->row_fd = line_bulk_request_bits(rows, keypad->row_bits);
+	if (keypad->row_fd < 0)
+		goto err_free;
+
+	line_bulk_request_bits(cols, keypad->col_bits);
+
+	for (i = 0; i < num_rows; i++) {
+		keypad->rows[i] = gpiod_line_bulk_get_line(rows, i);
+		keypad->row_mask |= keypad->row_bits[i];
+	}
+
+	for (i = 0; i < num_cols; i++)
+		keypad->col_mask |= keypad->col_bits[i];
+
+	keypad->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (keypad->stop_fd < 0)
+		goto err_free;
+
+	rv = spsc_ring_init(&keypad->ring, KEYPAD_RING_SIZE,
+			    sizeof(struct gpiod_keypad_event), false);
+	if (rv)
+		goto err_release_ring;
+
+	rv = pthread_create(&keypad->thread, NULL, keypad_thread, keypad);
+	if (rv) {
+		errno = rv;
+		goto err_release_ring;
+	}
+
+	return keypad;
+
+err_release_ring:
+	spsc_ring_release(&keypad->ring);
+	close(keypad->stop_fd);
+err_free:
+	free(keypad);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_keypad_free(struct gpiod_keypad *keypad)
+{
+	unsigned int i;
+
+	if (!keypad)
+		return;
+
+	fd_signal(keypad->stop_fd);
+	pthread_join(keypad->thread, NULL);
+
+	/* Leave the rows active for whoever uses the request next. */
+	keypad_drive_rows(keypad, keypad->row_mask);
+	for (i = 0; i < keypad->num_rows; i++)
+		line_output_sync(keypad->rows[i],
+				 !!(keypad->row_values & keypad->row_bits[i]));
+
+	close(keypad->stop_fd);
+	spsc_ring_release(&keypad->ring);
+	free(keypad);
+}
+
+GPIOD_API int gpiod_keypad_get_fd(struct gpiod_keypad *keypad)
+{
+	return keypad->ring.data_fd;
+}
+
+GPIOD_API int gpiod_keypad_read(struct gpiod_keypad *keypad,
+				const struct timespec *timeout,
+				struct gpiod_keypad_event *events,
+				unsigned int num_events)
+{
+	if (num_events == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return spsc_ring_read(&keypad->ring, timeout, events, num_events);
+}
+
+GPIOD_API void gpiod_keypad_get_state(struct gpiod_keypad *keypad,
+				      unsigned long long *state)
+{
+	unsigned int i;
+
+	for (i = 0; i < keypad->num_rows; i++)
+		state[i] = __atomic_load_n(&keypad->state[i],
+					   __ATOMIC_RELAXED);
+}
+
+GPIOD_API unsigned long long gpiod_keypad_num_lost(struct gpiod_keypad *keypad)
+{
+	return __atomic_load_n(&keypad->num_lost, __ATOMIC_RELAXED);
+}
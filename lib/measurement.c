@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/* Frequency, period and duty cycle measurement from edge event timestamps. */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+
+#define MEASUREMENT_NUM_BUCKETS		8
+#define MEASUREMENT_BATCH_SIZE		16
+
+/*
+ * The window is split into buckets of equal length, each accumulating the
+ * periods that ended within it. The oldest bucket is recycled as time goes
+ * on so the memory needed doesn't depend on the rate of edges.
+ */
+struct measurement_bucket {
+	uint64_t start_ns;
+	unsigned long num_periods;
+	uint64_t period_sum;
+	uint64_t period_min;
+	uint64_t period_max;
+	uint64_t high_sum;
+	uint64_t high_period_sum;
+};
+
+struct gpiod_line_measurement {
+	struct gpiod_line *line;
+	int ref_edge;
+	bool both_edges;
+	uint64_t bucket_ns;
+
+	/* Timestamps of the last edges or 0 if none seen yet. */
+	uint64_t last_ref_ns;
+	uint64_t last_other_ns;
+	unsigned long last_line_seqno;
+
+	struct measurement_bucket buckets[MEASUREMENT_NUM_BUCKETS];
+};
+
+static struct measurement_bucket *
+measurement_bucket(struct gpiod_line_measurement *meas, uint64_t ts)
+{
+	struct measurement_bucket *bucket;
+	uint64_t start;
+
+	start = ts / meas->bucket_ns * meas->bucket_ns;
+	bucket = &meas->buckets[(ts / meas->bucket_ns) %
+				MEASUREMENT_NUM_BUCKETS];
+
+	if (bucket->start_ns != start) {
+		memset(bucket, 0, sizeof(*bucket));
+		bucket->start_ns = start;
+		bucket->period_min = UINT64_MAX;
+	}
+
+	return bucket;
+}
+
+static void measurement_add(struct gpiod_line_measurement *meas,
+			    const struct gpiod_line_event_ext *event)
+{
+	struct measurement_bucket *bucket;
+	uint64_t ts, period;
+	bool gap;
+
+	ts = timespec_to_ns(&event->ts);
+
+	/*
+	 * Edges dropped by the kernel or merged by the rate limiter leave a
+	 * hole in the signal - start over from the edge that follows it.
+	 */
+	gap = event->num_events != 1 ||
+	      (meas->last_line_seqno &&
+	       event->line_seqno != meas->last_line_seqno + 1);
+	meas->last_line_seqno = event->line_seqno;
+	if (gap) {
+		meas->last_ref_ns = meas->last_other_ns = 0;
+		if (event->num_events != 1)
+			return;
+	}
+
+	if (event->event_type != meas->ref_edge) {
+		meas->last_other_ns = ts;
+		return;
+	}
+
+	if (meas->last_ref_ns && ts > meas->last_ref_ns) {
+		period = ts - meas->last_ref_ns;
+		bucket = measurement_bucket(meas, ts);
+
+		bucket->num_periods++;
+		bucket->period_sum += period;
+		if (period < bucket->period_min)
+			bucket->period_min = period;
+		if (period > bucket->period_max)
+			bucket->period_max = period;
+
+		if (meas->both_edges &&
+		    meas->last_other_ns > meas->last_ref_ns) {
+			bucket->high_sum += meas->last_other_ns -
+					    meas->last_ref_ns;
+			bucket->high_period_sum += period;
+		}
+	}
+
+	meas->last_ref_ns = ts;
+}
+
+GPIOD_API struct gpiod_line_measurement *
+gpiod_line_measurement_new(struct gpiod_line *line,
+			   const struct timespec *window)
+{
+	struct gpiod_line_measurement *meas;
+	uint64_t window_ns;
+	int type;
+
+	type = line_request_type(line);
+	if (type != GPIOD_LINE_REQUEST_EVENT_RISING_EDGE &&
+	    type != GPIOD_LINE_REQUEST_EVENT_FALLING_EDGE &&
+	    type != GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES) {
+		errno = EPERM;
+		return NULL;
+	}
+
+	/* Events of the other lines would be consumed and lost. */
+	window_ns = timespec_to_ns(window);
+	if (line_fd_shared(line) || window_ns < MEASUREMENT_NUM_BUCKETS) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	meas = malloc(sizeof(*meas));
+	if (!meas)
+		return NULL;
+
+	memset(meas, 0, sizeof(*meas));
+	meas->line = line;
+	meas->bucket_ns = window_ns / MEASUREMENT_NUM_BUCKETS;
+	meas->both_edges = type == GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES;
+	meas->ref_edge = type == GPIOD_LINE_REQUEST_EVENT_FALLING_EDGE ?
+					GPIOD_LINE_EVENT_FALLING_EDGE :
+					GPIOD_LINE_EVENT_RISING_EDGE;
+
+	return meas;
+}
+
+GPIOD_API void
+gpiod_line_measurement_free(struct gpiod_line_measurement *meas)
+{
+	free(meas);
+}
+
+GPIOD_API int
+gpiod_line_measurement_update(struct gpiod_line_measurement *meas)
+{
+	struct gpiod_line_event_ext events[MEASUREMENT_BATCH_SIZE];
+	struct pollfd pfd;
+	int rv, i, total = 0;
+	uint64_t due;
+
+	pfd.fd = gpiod_line_event_get_fd(meas->line);
+	pfd.events = POLLIN | POLLPRI;
+
+	for (;;) {
+		rv = poll(&pfd, 1, 0);
+		if (rv < 0)
+			return -1;
+		if (rv == 0) {
+			/* Events held back by filters may have become due. */
+			due = line_filter_deadline(meas->line);
+			if (!due || due > monotonic_ns())
+				return total;
+		}
+
+		rv = line_event_read_filtered(meas->line, events,
+					      MEASUREMENT_BATCH_SIZE);
+		if (rv < 0)
+			return -1;
+		if (rv == 0 && pfd.revents == 0)
+			return total;
+
+		for (i = 0; i < rv; i++)
+			measurement_add(meas, &events[i]);
+
+		total += rv;
+	}
+}
+
+GPIOD_API int
+gpiod_line_measurement_read(struct gpiod_line_measurement *meas,
+			    struct gpiod_line_measurement_data *data)
+{
+	uint64_t sum = 0, min = UINT64_MAX, max = 0, high = 0, high_period = 0;
+	unsigned long long num = 0;
+	struct measurement_bucket *bucket;
+	uint64_t now, oldest = 0, span;
+	unsigned int i;
+	int rv;
+
+	rv = gpiod_line_measurement_update(meas);
+	if (rv < 0)
+		return -1;
+
+	now = monotonic_ns() / meas->bucket_ns * meas->bucket_ns;
+	span = (MEASUREMENT_NUM_BUCKETS - 1) * meas->bucket_ns;
+	/* Shortly after boot the window reaches back past time zero. */
+	if (now > span)
+		oldest = now - span;
+
+	for (i = 0; i < MEASUREMENT_NUM_BUCKETS; i++) {
+		bucket = &meas->buckets[i];
+		if (!bucket->num_periods || bucket->start_ns < oldest)
+			continue;
+
+		num += bucket->num_periods;
+		sum += bucket->period_sum;
+		high += bucket->high_sum;
+		high_period += bucket->high_period_sum;
+		if (bucket->period_min < min)
+			min = bucket->period_min;
+		if (bucket->period_max > max)
+			max = bucket->period_max;
+	}
+
+	memset(data, 0, sizeof(*data));
+	data->num_periods = num;
+
+	if (num) {
+		data->frequency = (double)num * 1000000000.0 / sum;
+		data->period_min_ns = min;
+		data->period_max_ns = max;
+		data->period_avg_ns = sum / num;
+	}
+
+	if (high_period)
+		data->duty_cycle = (double)high / high_period;
+
+	return 0;
+}
@@ -3,7 +3,14 @@
 
 /* Misc code that didn't fit anywhere else. */
 
+#include <errno.h>
 #include <gpiod.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "internal.h"
 
@@ -11,3 +18,310 @@ GPIOD_API const char *gpiod_version_string(void)
 {
 	return GPIOD_VERSION_STR;
 }
+
+uint64_t timespec_to_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+}
+
+void ns_to_timespec(uint64_t ns, struct timespec *ts)
+{
+	ts->tv_sec = ns / 1000000000ULL;
+	ts->tv_nsec = ns % 1000000000ULL;
+}
+
+uint64_t monotonic_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return timespec_to_ns(&now);
+}
+
+void timeout_until_ns(uint64_t deadline, struct timespec *ts)
+{
+	uint64_t now = monotonic_ns();
+
+	ns_to_timespec(deadline > now ? deadline - now : 0, ts);
+}
+
+uint64_t deadline_min(uint64_t a, uint64_t b)
+{
+	if (!a || (b && b < a))
+		return b;
+
+	return a;
+}
+
+/*
+ * Don't let ppoll() run closer than this to the deadline - its timeout is
+ * subject to timer slack. The rest is slept with clock_nanosleep().
+ */
+#define SLEEP_POLL_MARGIN_NS	1000000ULL
+
+int sleep_until_ns(uint64_t deadline, int stop_fd)
+{
+	struct timespec ts;
+	struct pollfd pfd;
+	uint64_t now;
+	int rv;
+
+	pfd.fd = stop_fd;
+	pfd.events = POLLIN;
+
+	for (;;) {
+		now = monotonic_ns();
+		if (now + SLEEP_POLL_MARGIN_NS >= deadline)
+			break;
+
+		ns_to_timespec(deadline - now - SLEEP_POLL_MARGIN_NS, &ts);
+		rv = ppoll(&pfd, 1, &ts, NULL);
+		if (rv > 0)
+			return 1;
+		if (rv < 0 && errno != EINTR)
+			return -1;
+	}
+
+	ns_to_timespec(deadline, &ts);
+
+	do {
+		rv = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	} while (rv == EINTR);
+
+	return 0;
+}
+
+uint64_t deadline_skip_missed(uint64_t *deadline, uint64_t period)
+{
+	uint64_t now = monotonic_ns(), missed;
+
+	if (now < *deadline + period)
+		return 0;
+
+	missed = (now - *deadline) / period;
+	*deadline += missed * period;
+
+	return missed;
+}
+
+void fd_signal(int fd)
+{
+	uint64_t val = 1;
+	ssize_t wr;
+
+	wr = write(fd, &val, sizeof(val));
+	(void)wr;
+}
+
+void fd_clear(int fd)
+{
+	uint64_t val;
+	ssize_t rd;
+
+	rd = read(fd, &val, sizeof(val));
+	(void)rd;
+}
+
+void counter_add(unsigned long long *counter, unsigned long long val)
+{
+	__atomic_store_n(counter, *counter + val, __ATOMIC_RELAXED);
+}
+
+int spsc_ring_init(struct spsc_ring *ring, unsigned int size,
+		   size_t item_size, bool wait_space)
+{
+	unsigned long capacity = 1;
+
+	while (capacity < size)
+		capacity <<= 1;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->item_size = item_size;
+	ring->mask = capacity - 1;
+	ring->data_fd = ring->space_fd = -1;
+
+	ring->items = malloc(capacity * item_size);
+	if (!ring->items)
+		return -1;
+
+	ring->data_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (ring->data_fd < 0)
+		return -1;
+
+	if (wait_space) {
+		ring->space_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (ring->space_fd < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+void spsc_ring_release(struct spsc_ring *ring)
+{
+	if (ring->data_fd >= 0)
+		close(ring->data_fd);
+	if (ring->space_fd >= 0)
+		close(ring->space_fd);
+
+	free(ring->items);
+}
+
+static unsigned long spsc_ring_load(unsigned long *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+static bool spsc_ring_advance_tail(struct spsc_ring *ring,
+				   unsigned long tail, unsigned long num)
+{
+	return __atomic_compare_exchange_n(&ring->tail, &tail, tail + num,
+					   false, __ATOMIC_ACQ_REL,
+					   __ATOMIC_ACQUIRE);
+}
+
+unsigned long spsc_ring_used(struct spsc_ring *ring)
+{
+	unsigned long tail = spsc_ring_load(&ring->tail);
+
+	return spsc_ring_load(&ring->head) - tail;
+}
+
+void *spsc_ring_slot(struct spsc_ring *ring)
+{
+	unsigned long head = ring->head;
+
+	if (head - spsc_ring_load(&ring->tail) > ring->mask)
+		return NULL;
+
+	return (char *)ring->items + (head & ring->mask) * ring->item_size;
+}
+
+void spsc_ring_push(struct spsc_ring *ring)
+{
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+bool spsc_ring_drop_oldest(struct spsc_ring *ring)
+{
+	unsigned long tail = spsc_ring_load(&ring->tail);
+
+	if (ring->head - tail <= ring->mask)
+		return false;
+
+	return spsc_ring_advance_tail(ring, tail, 1);
+}
+
+bool spsc_ring_wait_space(struct spsc_ring *ring, int stop_fd)
+{
+	struct pollfd pfds[2];
+	int rv;
+
+	pfds[0].fd = ring->space_fd;
+	pfds[0].events = POLLIN;
+	pfds[1].fd = stop_fd;
+	pfds[1].events = POLLIN;
+
+	for (;;) {
+		/* Re-check after arming to not miss a wake-up. */
+		fd_clear(ring->space_fd);
+		if (ring->head - spsc_ring_load(&ring->tail) <= ring->mask)
+			return true;
+
+		rv = poll(pfds, 2, -1);
+		if (rv < 0 && errno != EINTR)
+			return false;
+
+		if (rv > 0 && pfds[1].revents)
+			return false;
+	}
+}
+
+void spsc_ring_set_error(struct spsc_ring *ring, int error)
+{
+	__atomic_store_n(&ring->error, error, __ATOMIC_RELEASE);
+	fd_signal(ring->data_fd);
+}
+
+static unsigned long spsc_ring_take(struct spsc_ring *ring, void *items,
+				    unsigned long num_items)
+{
+	unsigned long head, tail, avail, start, first;
+	size_t size = ring->item_size;
+
+	do {
+		tail = spsc_ring_load(&ring->tail);
+		head = spsc_ring_load(&ring->head);
+
+		avail = head - tail;
+		if (avail == 0)
+			return 0;
+		if (avail > num_items)
+			avail = num_items;
+
+		start = tail & ring->mask;
+		first = ring->mask + 1 - start;
+		if (first > avail)
+			first = avail;
+
+		memcpy(items, (char *)ring->items + start * size,
+		       first * size);
+		memcpy((char *)items + first * size, ring->items,
+		       (avail - first) * size);
+
+		/*
+		 * If the producer discarded the oldest item while we were
+		 * copying, what we have may have been overwritten.
+		 */
+	} while (!spsc_ring_advance_tail(ring, tail, avail));
+
+	if (ring->space_fd >= 0 && head - tail > ring->mask)
+		fd_signal(ring->space_fd);
+
+	return avail;
+}
+
+int spsc_ring_read(struct spsc_ring *ring, const struct timespec *timeout,
+		   void *items, unsigned int num_items)
+{
+	struct timespec left, *tsp = NULL;
+	uint64_t deadline = 0;
+	struct pollfd pfd;
+	int rv;
+
+	if (timeout) {
+		deadline = monotonic_ns() + timespec_to_ns(timeout);
+		tsp = &left;
+	}
+
+	pfd.fd = ring->data_fd;
+	pfd.events = POLLIN;
+
+	for (;;) {
+		/* Clear the notification first so that we never miss one. */
+		fd_clear(ring->data_fd);
+
+		rv = spsc_ring_take(ring, items, num_items);
+		if (rv > 0)
+			return rv;
+
+		rv = __atomic_load_n(&ring->error, __ATOMIC_ACQUIRE);
+		if (rv) {
+			errno = rv;
+			return -1;
+		}
+
+		/*
+		 * Wake-ups without new items - the producer signalling its
+		 * last batch after we already took it - mustn't restart the
+		 * timeout.
+		 */
+		if (tsp)
+			timeout_until_ns(deadline, tsp);
+
+		rv = ppoll(&pfd, 1, tsp, NULL);
+		if (rv <= 0)
+			return rv;
+	}
+}
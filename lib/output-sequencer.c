@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Output sequencer - plays a table of timed value changes on a set of output
+ * lines from a dedicated thread, scheduling every step at an absolute time.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+struct sequencer_step {
+	uint64_t time_ns;
+	unsigned long long mask;
+	unsigned long long bits;
+};
+
+struct gpiod_output_sequencer {
+	struct gpiod_line_bulk *bulk;
+	struct sequencer_step *steps;
+	unsigned int num_steps;
+	uint64_t period_ns;
+
+	uint64_t start_ns;
+	unsigned int num_iterations;
+
+	pthread_t thread;
+	bool running;
+	int stop_fd;
+	/* Signalled by the thread when it exits. */
+	int done_fd;
+	int error;
+
+	unsigned long long num_steps_done;
+	unsigned long long num_late;
+	unsigned long long num_iterations_done;
+	unsigned long long lateness_max;
+	unsigned long long lateness_sum;
+};
+
+static void sequencer_account(struct gpiod_output_sequencer *seq,
+			      uint64_t deadline, uint64_t next, uint64_t now)
+{
+	uint64_t lateness = now > deadline ? now - deadline : 0;
+
+	counter_add(&seq->lateness_sum, lateness);
+	if (lateness > seq->lateness_max)
+		__atomic_store_n(&seq->lateness_max, lateness,
+				 __ATOMIC_RELAXED);
+
+	/* We only got to this step once the next one was already due. */
+	if (next && now >= next)
+		counter_add(&seq->num_late, 1);
+
+	counter_add(&seq->num_steps_done, 1);
+}
+
+static uint64_t sequencer_next_deadline(struct gpiod_output_sequencer *seq,
+					uint64_t base, uint64_t iter,
+					unsigned int step)
+{
+	if (step + 1 < seq->num_steps)
+		return base + seq->steps[step + 1].time_ns;
+
+	if (!seq->period_ns ||
+	    (seq->num_iterations && iter + 1 == seq->num_iterations))
+		return 0;
+
+	return base + seq->period_ns + seq->steps[0].time_ns;
+}
+
+static void *sequencer_run(void *data)
+{
+	struct gpiod_output_sequencer *seq = data;
+	struct sequencer_step *step;
+	uint64_t base, deadline, now, iter;
+	unsigned int i;
+	int rv;
+
+	/* Unlimited sequences may well run for more than 2^32 periods. */
+	for (iter = 0, base = seq->start_ns;
+	     !seq->num_iterations || iter < seq->num_iterations;
+	     iter++, base += seq->period_ns) {
+		for (i = 0; i < seq->num_steps; i++) {
+			step = &seq->steps[i];
+			deadline = base + step->time_ns;
+
+			rv = sleep_until_ns(deadline, seq->stop_fd);
+			if (rv < 0)
+				seq->error = errno;
+			if (rv)
+				goto out;
+
+			now = monotonic_ns();
+
+			rv = gpiod_line_set_value_bulk_mask(seq->bulk,
+							    step->mask,
+							    step->bits);
+			if (rv < 0) {
+				seq->error = errno;
+				goto out;
+			}
+
+			sequencer_account(seq, deadline,
+					  sequencer_next_deadline(seq, base,
+								  iter, i),
+					  now);
+		}
+
+		counter_add(&seq->num_iterations_done, 1);
+	}
+
+out:
+	fd_signal(seq->done_fd);
+
+	return NULL;
+}
+
+GPIOD_API struct gpiod_output_sequencer *
+gpiod_output_sequencer_new(struct gpiod_line_bulk *bulk,
+			   const struct gpiod_output_step *steps,
+			   unsigned int num_steps,
+			   const struct timespec *period)
+{
+	struct gpiod_output_sequencer *seq;
+	unsigned int i, num_lines;
+	unsigned long long valid;
+	uint64_t prev = 0;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (!num_steps || num_lines == 0 || num_lines > 64) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	valid = num_lines == 64 ? ~0ULL : (1ULL << num_lines) - 1;
+
+	for (i = 0; i < num_steps; i++) {
+		if ((steps[i].mask & ~valid) ||
+		    timespec_to_ns(&steps[i].time) < prev) {
+			errno = EINVAL;
+			return NULL;
+		}
+
+		prev = timespec_to_ns(&steps[i].time);
+	}
+
+	/* The last step must be played before the next iteration begins. */
+	if (period && timespec_to_ns(period) <= prev) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	seq = malloc(sizeof(*seq));
+	if (!seq)
+		return NULL;
+
+	memset(seq, 0, sizeof(*seq));
+	seq->num_steps = num_steps;
+	seq->period_ns = period ? timespec_to_ns(period) : 0;
+	seq->stop_fd = seq->done_fd = -1;
+
+	seq->steps = malloc(num_steps * sizeof(*seq->steps));
+	if (!seq->steps)
+		goto err_free;
+
+	for (i = 0; i < num_steps; i++) {
+		seq->steps[i].time_ns = timespec_to_ns(&steps[i].time);
+		seq->steps[i].mask = steps[i].mask;
+		seq->steps[i].bits = steps[i].bits & steps[i].mask;
+	}
+
+	/* The caller's bulk may be gone by the time the thread runs. */
+	seq->bulk = gpiod_line_bulk_new(num_lines);
+	if (!seq->bulk)
+		goto err_free;
+
+	for (i = 0; i < num_lines; i++)
+		gpiod_line_bulk_add_line(seq->bulk,
+					 gpiod_line_bulk_get_line(bulk, i));
+
+	seq->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	seq->done_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (seq->stop_fd < 0 || seq->done_fd < 0)
+		goto err_free;
+
+	return seq;
+
+err_free:
+	gpiod_output_sequencer_free(seq);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_output_sequencer_free(struct gpiod_output_sequencer *seq)
+{
+	if (!seq)
+		return;
+
+	gpiod_output_sequencer_stop(seq);
+
+	if (seq->stop_fd >= 0)
+		close(seq->stop_fd);
+	if (seq->done_fd >= 0)
+		close(seq->done_fd);
+
+	if (seq->bulk)
+		gpiod_line_bulk_free(seq->bulk);
+	free(seq->steps);
+	free(seq);
+}
+
+GPIOD_API int gpiod_output_sequencer_start(struct gpiod_output_sequencer *seq,
+					   const struct timespec *start,
+					   unsigned int num_iterations)
+{
+	int rv;
+
+	if (seq->running) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	if (num_iterations != 1 && !seq->period_ns) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	fd_clear(seq->stop_fd);
+	fd_clear(seq->done_fd);
+	seq->error = 0;
+	seq->start_ns = start ? timespec_to_ns(start) : monotonic_ns();
+	seq->num_iterations = num_iterations;
+
+	seq->num_steps_done = seq->num_late = seq->num_iterations_done = 0;
+	seq->lateness_max = seq->lateness_sum = 0;
+
+	rv = pthread_create(&seq->thread, NULL, sequencer_run, seq);
+	if (rv) {
+		errno = rv;
+		return -1;
+	}
+
+	seq->running = true;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_output_sequencer_wait(struct gpiod_output_sequencer *seq,
+					  const struct timespec *timeout)
+{
+	struct pollfd pfd;
+	int rv;
+
+	if (!seq->running)
+		return 1;
+
+	pfd.fd = seq->done_fd;
+	pfd.events = POLLIN;
+
+	rv = ppoll(&pfd, 1, timeout, NULL);
+	if (rv < 0)
+		return -1;
+
+	return rv > 0 ? 1 : 0;
+}
+
+GPIOD_API int gpiod_output_sequencer_get_fd(struct gpiod_output_sequencer *seq)
+{
+	return seq->done_fd;
+}
+
+GPIOD_API int gpiod_output_sequencer_stop(struct gpiod_output_sequencer *seq)
+{
+	if (!seq->running)
+		return 0;
+
+	fd_signal(seq->stop_fd);
+	pthread_join(seq->thread, NULL);
+	seq->running = false;
+
+	if (seq->error) {
+		errno = seq->error;
+		return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API void
+gpiod_output_sequencer_get_stats(struct gpiod_output_sequencer *seq,
+				 struct gpiod_output_sequencer_stats *stats)
+{
+	stats->num_steps = __atomic_load_n(&seq->num_steps_done,
+					   __ATOMIC_RELAXED);
+	stats->num_late = __atomic_load_n(&seq->num_late, __ATOMIC_RELAXED);
+	stats->num_iterations = __atomic_load_n(&seq->num_iterations_done,
+						__ATOMIC_RELAXED);
+	stats->lateness_max_ns = __atomic_load_n(&seq->lateness_max,
+						 __ATOMIC_RELAXED);
+	stats->lateness_avg_ns = __atomic_load_n(&seq->lateness_sum,
+						 __ATOMIC_RELAXED);
+	if (stats->num_steps)
+		stats->lateness_avg_ns /= stats->num_steps;
+}
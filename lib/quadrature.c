@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/* Quadrature encoder decoding straight from the raw edge event stream. */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+#define QUADRATURE_BATCH_SIZE		64
+#define QUADRATURE_VELOCITY_WINDOW_NS	10000000ULL
+
+enum {
+	QUADRATURE_A = 0,
+	QUADRATURE_B,
+	QUADRATURE_Z,
+	QUADRATURE_NUM_LINES,
+};
+
+/*
+ * Position change for every transition between two states of the A and B
+ * lines, indexed by (old << 2 | new) where the state is (A << 1 | B). Both
+ * lines changing at once can't be decoded and is marked with 2.
+ */
+static const int quadrature_steps[16] = {
+	 0, -1,  1,  2,
+	 1,  0,  2, -1,
+	-1,  2,  0,  1,
+	 2,  1, -1,  0,
+};
+
+struct quadrature_data {
+	long long position;
+	long long velocity;
+	long long index_position;
+	unsigned long long num_index;
+	unsigned long long num_invalid;
+	unsigned long long num_missed;
+	uint64_t timestamp_ns;
+};
+
+struct gpiod_quadrature_encoder {
+	int fd;
+	unsigned int offsets[QUADRATURE_NUM_LINES];
+	bool has_index;
+
+	unsigned int state;
+	unsigned int levels[QUADRATURE_NUM_LINES];
+	unsigned long last_line_seqno[QUADRATURE_NUM_LINES];
+
+	uint64_t window_start_ns;
+	long long window_start_pos;
+
+	/*
+	 * The decoder updates its private copy and publishes it after each
+	 * batch. Readers access the published one under a seqlock - seq is odd
+	 * while an update is in progress.
+	 */
+	struct quadrature_data work;
+	struct quadrature_data data;
+	unsigned int seq;
+
+	struct gpio_v2_line_event buf[QUADRATURE_BATCH_SIZE];
+};
+
+static void quadrature_publish(struct gpiod_quadrature_encoder *enc)
+{
+	unsigned int seq = enc->seq;
+
+	__atomic_store_n(&enc->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	enc->data = enc->work;
+
+	__atomic_store_n(&enc->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static int quadrature_line(struct gpiod_quadrature_encoder *enc,
+			   unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < QUADRATURE_NUM_LINES; i++) {
+		if (enc->offsets[i] == offset &&
+		    (i != QUADRATURE_Z || enc->has_index))
+			return i;
+	}
+
+	return -1;
+}
+
+static void quadrature_decode(struct gpiod_quadrature_encoder *enc,
+			      const struct gpio_v2_line_event *ev)
+{
+	unsigned int level, state;
+	unsigned long gap;
+	int line, step;
+
+	line = quadrature_line(enc, ev->offset);
+	if (line < 0)
+		return;
+
+	level = ev->id == GPIO_V2_LINE_EVENT_RISING_EDGE;
+
+	/*
+	 * Edges the kernel had to drop show up as gaps in the per-line
+	 * sequence numbers. Without them the direction of the movement is
+	 * unknown, so just resynchronize with the new level. Events read
+	 * before the decoder was created don't count.
+	 */
+	gap = enc->last_line_seqno[line] ?
+		ev->line_seqno - enc->last_line_seqno[line] - 1 : 0;
+	enc->last_line_seqno[line] = ev->line_seqno;
+	if (gap) {
+		enc->work.num_missed += gap;
+		enc->levels[line] = level;
+		enc->state = enc->levels[QUADRATURE_A] << 1 |
+			     enc->levels[QUADRATURE_B];
+		return;
+	}
+
+	enc->levels[line] = level;
+
+	if (line == QUADRATURE_Z) {
+		if (level) {
+			enc->work.num_index++;
+			enc->work.index_position = enc->work.position;
+		}
+
+		return;
+	}
+
+	state = enc->levels[QUADRATURE_A] << 1 | enc->levels[QUADRATURE_B];
+	step = quadrature_steps[enc->state << 2 | state];
+	enc->state = state;
+
+	if (step == 2)
+		enc->work.num_invalid++;
+	else
+		enc->work.position += step;
+
+	enc->work.timestamp_ns = ev->timestamp_ns;
+}
+
+static void quadrature_update_velocity(struct gpiod_quadrature_encoder *enc)
+{
+	uint64_t elapsed;
+
+	if (!enc->window_start_ns) {
+		enc->window_start_ns = enc->work.timestamp_ns;
+		enc->window_start_pos = enc->work.position;
+		return;
+	}
+
+	elapsed = enc->work.timestamp_ns - enc->window_start_ns;
+	if (elapsed < QUADRATURE_VELOCITY_WINDOW_NS)
+		return;
+
+	enc->work.velocity = (enc->work.position - enc->window_start_pos) *
+			     1000000000LL / (long long)elapsed;
+	enc->window_start_ns = enc->work.timestamp_ns;
+	enc->window_start_pos = enc->work.position;
+}
+
+GPIOD_API struct gpiod_quadrature_encoder *
+gpiod_quadrature_encoder_new(struct gpiod_line_bulk *bulk, unsigned int a,
+			     unsigned int b, int z)
+{
+	struct gpiod_quadrature_encoder *enc;
+	unsigned int num_lines, i;
+	struct gpiod_line *line;
+	int values[64], rv, fd;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (num_lines > 64 || a >= num_lines || b >= num_lines || a == b ||
+	    (z >= 0 && ((unsigned int)z >= num_lines ||
+			(unsigned int)z == a || (unsigned int)z == b))) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	fd = gpiod_line_event_get_fd(gpiod_line_bulk_get_line(bulk, 0));
+
+	for (i = 0; i < num_lines; i++) {
+		line = gpiod_line_bulk_get_line(bulk, i);
+		if (line_request_type(line) !=
+					GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES) {
+			errno = EPERM;
+			return NULL;
+		}
+
+		/* All lines must come from a single request. */
+		if (gpiod_line_event_get_fd(line) != fd) {
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	rv = gpiod_line_get_value_bulk(bulk, values);
+	if (rv < 0)
+		return NULL;
+
+	enc = malloc(sizeof(*enc));
+	if (!enc)
+		return NULL;
+
+	memset(enc, 0, sizeof(*enc));
+	enc->fd = fd;
+	enc->offsets[QUADRATURE_A] = gpiod_line_offset(
+					gpiod_line_bulk_get_line(bulk, a));
+	enc->offsets[QUADRATURE_B] = gpiod_line_offset(
+					gpiod_line_bulk_get_line(bulk, b));
+	enc->levels[QUADRATURE_A] = values[a];
+	enc->levels[QUADRATURE_B] = values[b];
+	enc->state = values[a] << 1 | values[b];
+
+	if (z >= 0) {
+		enc->has_index = true;
+		enc->offsets[QUADRATURE_Z] = gpiod_line_offset(
+					gpiod_line_bulk_get_line(bulk, z));
+		enc->levels[QUADRATURE_Z] = values[z];
+	}
+
+	return enc;
+}
+
+GPIOD_API void
+gpiod_quadrature_encoder_free(struct gpiod_quadrature_encoder *enc)
+{
+	free(enc);
+}
+
+GPIOD_API int
+gpiod_quadrature_encoder_get_fd(struct gpiod_quadrature_encoder *enc)
+{
+	return enc->fd;
+}
+
+GPIOD_API int
+gpiod_quadrature_encoder_read(struct gpiod_quadrature_encoder *enc)
+{
+	unsigned int num, i;
+	ssize_t rd;
+
+	rd = read(enc->fd, enc->buf, sizeof(enc->buf));
+	if (rd < 0)
+		return -1;
+
+	if ((size_t)rd < sizeof(*enc->buf)) {
+		errno = EIO;
+		return -1;
+	}
+
+	num = rd / sizeof(*enc->buf);
+
+	for (i = 0; i < num; i++)
+		quadrature_decode(enc, &enc->buf[i]);
+
+	quadrature_update_velocity(enc);
+	quadrature_publish(enc);
+
+	return num;
+}
+
+GPIOD_API void
+gpiod_quadrature_encoder_snapshot(struct gpiod_quadrature_encoder *enc,
+				  struct gpiod_quadrature_snapshot *snap)
+{
+	struct quadrature_data *data = &enc->data;
+	unsigned int seq;
+
+	for (;;) {
+		seq = __atomic_load_n(&enc->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			continue;
+
+		snap->position = data->position;
+		snap->velocity = data->velocity;
+		snap->index_position = data->index_position;
+		snap->num_index = data->num_index;
+		snap->num_invalid = data->num_invalid;
+		snap->num_missed = data->num_missed;
+		ns_to_timespec(data->timestamp_ns, &snap->ts);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&enc->seq, __ATOMIC_RELAXED) == seq)
+			break;
+	}
+
+	/* Nothing moved for a whole window - the encoder stands still. */
+	if (snap->velocity && monotonic_ns() >= timespec_to_ns(&snap->ts) +
+					QUADRATURE_VELOCITY_WINDOW_NS)
+		snap->velocity = 0;
+}
@@ -0,0 +1,405 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Reflex rules driving outputs straight from the event dispatch path so that
+ * the reaction to an input edge never has to go through application code.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+#define REFLEX_MAX_LINES		64
+
+struct reflex_rule {
+	unsigned int input;
+	int edge;
+	unsigned long long in_mask;
+	unsigned long long in_bits;
+	/* Already translated into the bitmap of the output request. */
+	struct gpio_v2_line_values out;
+};
+
+/*
+ * The trigger log is a single-producer, single-consumer ring. The event
+ * thread never waits for the reader - triggers that don't fit are counted
+ * and forgotten.
+ */
+struct gpiod_reflex {
+	struct gpiod_line_bulk *inputs;
+	unsigned int num_inputs;
+	unsigned int in_offsets[REFLEX_MAX_LINES];
+	unsigned long long levels;
+
+	int out_fd;
+	unsigned int num_outputs;
+	struct gpiod_line *out_lines[REFLEX_MAX_LINES];
+	uint64_t out_bits[REFLEX_MAX_LINES];
+
+	struct reflex_rule *rules;
+	unsigned int num_rules;
+
+	struct gpiod_reflex_trigger *log;
+	unsigned long log_mask;
+	unsigned long head;
+	unsigned long tail;
+
+	/* Only written by the event thread but read from anywhere. */
+	unsigned long long num_triggers;
+	unsigned long long num_lost;
+	unsigned long long reaction_min;
+	unsigned long long reaction_max;
+	unsigned long long reaction_sum;
+	int error;
+};
+
+static void reflex_store(unsigned long long *ptr, unsigned long long val)
+{
+	__atomic_store_n(ptr, val, __ATOMIC_RELAXED);
+}
+
+static unsigned long long reflex_load(unsigned long long *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static int reflex_input(struct gpiod_reflex *reflex, unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < reflex->num_inputs; i++) {
+		if (reflex->in_offsets[i] == offset)
+			return i;
+	}
+
+	return -1;
+}
+
+static void reflex_log(struct gpiod_reflex *reflex, unsigned int rule,
+		       const struct gpiod_line_event_ext *event,
+		       uint64_t output)
+{
+	struct gpiod_reflex_trigger *trigger;
+	unsigned long head = reflex->head;
+
+	if (head - __atomic_load_n(&reflex->tail, __ATOMIC_ACQUIRE) >
+							reflex->log_mask) {
+		counter_add(&reflex->num_lost, 1);
+		return;
+	}
+
+	trigger = &reflex->log[head & reflex->log_mask];
+	trigger->rule = rule;
+	trigger->input_ts = event->ts;
+	ns_to_timespec(output, &trigger->output_ts);
+
+	__atomic_store_n(&reflex->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void reflex_account(struct gpiod_reflex *reflex, uint64_t reaction)
+{
+	if (!reflex->num_triggers || reaction < reflex->reaction_min)
+		reflex_store(&reflex->reaction_min, reaction);
+	if (reaction > reflex->reaction_max)
+		reflex_store(&reflex->reaction_max, reaction);
+
+	counter_add(&reflex->reaction_sum, reaction);
+	counter_add(&reflex->num_triggers, 1);
+}
+
+/* Returns the number of rules that fired or -1 if writing failed. */
+static int reflex_handle(struct gpiod_reflex *reflex,
+			 const struct gpiod_line_event_ext *event)
+{
+	struct gpio_v2_line_values out = { 0, 0 };
+	unsigned long long fired = 0;
+	struct reflex_rule *rule;
+	uint64_t output, input;
+	unsigned int i;
+	int idx, num = 0;
+
+	idx = reflex_input(reflex, event->offset);
+	if (idx < 0)
+		return 0;
+
+	if (event->event_type == GPIOD_LINE_EVENT_RISING_EDGE)
+		reflex->levels |= 1ULL << idx;
+	else
+		reflex->levels &= ~(1ULL << idx);
+
+	/* Later rules win where several of them drive the same output. */
+	for (i = 0; i < reflex->num_rules; i++) {
+		rule = &reflex->rules[i];
+
+		if (rule->input != (unsigned int)idx ||
+		    rule->edge != event->event_type ||
+		    (reflex->levels & rule->in_mask) != rule->in_bits)
+			continue;
+
+		out.bits = (out.bits & ~rule->out.mask) | rule->out.bits;
+		out.mask |= rule->out.mask;
+		fired |= 1ULL << i;
+		num++;
+	}
+
+	if (!num)
+		return 0;
+
+	if (ioctl(reflex->out_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &out) < 0)
+		return -1;
+
+	output = monotonic_ns();
+	input = timespec_to_ns(&event->ts);
+
+	for (i = 0; i < reflex->num_rules && fired; i++) {
+		if (!(fired & (1ULL << i)))
+			continue;
+
+		fired &= ~(1ULL << i);
+		reflex_log(reflex, i, event, output);
+		reflex_account(reflex, output > input ? output - input : 0);
+	}
+
+	for (i = 0; i < reflex->num_outputs; i++) {
+		if (out.mask & reflex->out_bits[i])
+			line_output_sync(reflex->out_lines[i],
+					 !!(out.bits & reflex->out_bits[i]));
+	}
+
+	return num;
+}
+
+static int reflex_callback(const struct gpiod_line_event_ext *events,
+			   unsigned int num_events, void *data)
+{
+	struct gpiod_reflex *reflex = data;
+	unsigned int i;
+
+	for (i = 0; i < num_events; i++) {
+		if (reflex_handle(reflex, &events[i]) < 0) {
+			__atomic_store_n(&reflex->error, errno,
+					 __ATOMIC_RELEASE);
+			return GPIOD_EVENT_LOOP_CB_STOP;
+		}
+	}
+
+	return GPIOD_EVENT_LOOP_CB_NEXT;
+}
+
+static bool reflex_rule_valid(const struct gpiod_reflex_rule *rule,
+			      struct gpiod_line_bulk *inputs,
+			      unsigned int num_outputs)
+{
+	unsigned int num_inputs = gpiod_line_bulk_num_lines(inputs), i;
+	int type;
+
+	if (rule->input >= num_inputs || !rule->mask ||
+	    (rule->edge != GPIOD_LINE_EVENT_RISING_EDGE &&
+	     rule->edge != GPIOD_LINE_EVENT_FALLING_EDGE) ||
+	    (rule->bits & ~rule->mask) || (rule->in_bits & ~rule->in_mask) ||
+	    (num_outputs < 64 && (rule->mask >> num_outputs)) ||
+	    (num_inputs < 64 && (rule->in_mask >> num_inputs)))
+		return false;
+
+	type = line_request_type(gpiod_line_bulk_get_line(inputs,
+							  rule->input));
+	if (type != GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES &&
+	    !(type == GPIOD_LINE_REQUEST_EVENT_RISING_EDGE &&
+	      rule->edge == GPIOD_LINE_EVENT_RISING_EDGE) &&
+	    !(type == GPIOD_LINE_REQUEST_EVENT_FALLING_EDGE &&
+	      rule->edge == GPIOD_LINE_EVENT_FALLING_EDGE))
+		return false;
+
+	/* The levels of the lines in a condition must be followed. */
+	for (i = 0; i < num_inputs; i++) {
+		if ((rule->in_mask & (1ULL << i)) &&
+		    line_request_type(gpiod_line_bulk_get_line(inputs, i)) !=
+					GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES)
+			return false;
+	}
+
+	return true;
+}
+
+GPIOD_API struct gpiod_reflex *
+gpiod_reflex_new(struct gpiod_line_bulk *inputs,
+		 struct gpiod_line_bulk *outputs,
+		 const struct gpiod_reflex_rule *rules, unsigned int num_rules,
+		 unsigned int log_size)
+{
+	unsigned int num_inputs, num_outputs, i, j;
+	unsigned long capacity = 1;
+	struct gpiod_reflex *reflex;
+	struct reflex_rule *rule;
+	struct gpiod_line *line;
+	int values[64], type;
+
+	num_inputs = gpiod_line_bulk_num_lines(inputs);
+	num_outputs = gpiod_line_bulk_num_lines(outputs);
+	if (num_inputs == 0 || num_inputs > REFLEX_MAX_LINES ||
+	    num_outputs == 0 || num_outputs > REFLEX_MAX_LINES ||
+	    num_rules == 0 || num_rules > 64 ||
+	    log_size == 0 || log_size > (1U << 24)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	for (i = 0; i < num_inputs; i++) {
+		type = line_request_type(gpiod_line_bulk_get_line(inputs, i));
+		if (type != GPIOD_LINE_REQUEST_EVENT_RISING_EDGE &&
+		    type != GPIOD_LINE_REQUEST_EVENT_FALLING_EDGE &&
+		    type != GPIOD_LINE_REQUEST_EVENT_BOTH_EDGES) {
+			errno = EPERM;
+			return NULL;
+		}
+	}
+
+	for (i = 0; i < num_rules; i++) {
+		if (!reflex_rule_valid(&rules[i], inputs, num_outputs)) {
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	while (capacity < log_size)
+		capacity <<= 1;
+
+	reflex = malloc(sizeof(*reflex));
+	if (!reflex)
+		return NULL;
+
+	memset(reflex, 0, sizeof(*reflex));
+	reflex->num_inputs = num_inputs;
+	reflex->num_outputs = num_outputs;
+	reflex->num_rules = num_rules;
+	reflex->log_mask = capacity - 1;
+
+	reflex->out_fd = line_bulk_request_bits(outputs, reflex->out_bits);
+	if (reflex->out_fd < 0)
+		goto err_free;
+
+	if (gpiod_line_direction(gpiod_line_bulk_get_line(outputs, 0)) !=
+						GPIOD_LINE_DIRECTION_OUTPUT) {
+		errno = EPERM;
+		goto err_free;
+	}
+
+	if (gpiod_line_get_value_bulk(inputs, values) < 0)
+		goto err_free;
+
+	/* The caller's bulk may be gone by the time we're attached. */
+	reflex->inputs = gpiod_line_bulk_new(num_inputs);
+	if (!reflex->inputs)
+		goto err_free;
+
+	for (i = 0; i < num_inputs; i++) {
+		line = gpiod_line_bulk_get_line(inputs, i);
+		gpiod_line_bulk_add_line(reflex->inputs, line);
+		reflex->in_offsets[i] = gpiod_line_offset(line);
+		if (values[i])
+			reflex->levels |= 1ULL << i;
+	}
+
+	for (i = 0; i < num_outputs; i++)
+		reflex->out_lines[i] = gpiod_line_bulk_get_line(outputs, i);
+
+	reflex->rules = calloc(num_rules, sizeof(*reflex->rules));
+	reflex->log = calloc(capacity, sizeof(*reflex->log));
+	if (!reflex->rules || !reflex->log)
+		goto err_free;
+
+	for (i = 0; i < num_rules; i++) {
+		rule = &reflex->rules[i];
+		rule->input = rules[i].input;
+		rule->edge = rules[i].edge;
+		rule->in_mask = rules[i].in_mask;
+		rule->in_bits = rules[i].in_bits;
+
+		for (j = 0; j < num_outputs; j++) {
+			if (rules[i].mask & (1ULL << j))
+				rule->out.mask |= reflex->out_bits[j];
+			if (rules[i].bits & (1ULL << j))
+				rule->out.bits |= reflex->out_bits[j];
+		}
+	}
+
+	return reflex;
+
+err_free:
+	gpiod_reflex_free(reflex);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_reflex_free(struct gpiod_reflex *reflex)
+{
+	if (!reflex)
+		return;
+
+	if (reflex->inputs)
+		gpiod_line_bulk_free(reflex->inputs);
+
+	free(reflex->rules);
+	free(reflex->log);
+	free(reflex);
+}
+
+GPIOD_API int gpiod_reflex_attach(struct gpiod_reflex *reflex,
+				  struct gpiod_event_thread *thread)
+{
+	return gpiod_event_thread_add(thread, reflex->inputs,
+				      reflex_callback, reflex);
+}
+
+GPIOD_API int gpiod_reflex_read_log(struct gpiod_reflex *reflex,
+				    struct gpiod_reflex_trigger *triggers,
+				    unsigned int num_triggers)
+{
+	unsigned long head, tail, avail, i;
+	int error;
+
+	tail = reflex->tail;
+	head = __atomic_load_n(&reflex->head, __ATOMIC_ACQUIRE);
+
+	avail = head - tail;
+	if (avail > num_triggers)
+		avail = num_triggers;
+
+	if (!avail) {
+		error = __atomic_load_n(&reflex->error, __ATOMIC_ACQUIRE);
+		if (error) {
+			errno = error;
+			return -1;
+		}
+
+		return 0;
+	}
+
+	for (i = 0; i < avail; i++)
+		triggers[i] = reflex->log[(tail + i) & reflex->log_mask];
+
+	__atomic_store_n(&reflex->tail, tail + avail, __ATOMIC_RELEASE);
+
+	return avail;
+}
+
+GPIOD_API void gpiod_reflex_get_stats(struct gpiod_reflex *reflex,
+				      struct gpiod_reflex_stats *stats)
+{
+	unsigned long long num;
+
+	num = reflex_load(&reflex->num_triggers);
+
+	stats->num_triggers = num;
+	stats->num_lost = reflex_load(&reflex->num_lost);
+	stats->reaction_min_ns = reflex_load(&reflex->reaction_min);
+	stats->reaction_max_ns = reflex_load(&reflex->reaction_max);
+	stats->reaction_avg_ns = num ?
+			reflex_load(&reflex->reaction_sum) / num : 0;
+}
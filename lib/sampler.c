@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Periodic sampler - reads the values of a set of lines on a fixed absolute
+ * time grid into a ring of timestamped samples.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "internal.h"
+#include "uapi/gpio.h"
+
+#define SAMPLER_MAX_LINES	64
+
+/*
+ * The sampling thread never waits for the consumer - samples that don't fit
+ * in the ring are dropped and counted.
+ */
+struct gpiod_sampler {
+	int fd;
+	unsigned int num_lines;
+	uint64_t line_bits[SAMPLER_MAX_LINES];
+	uint64_t req_mask;
+	uint64_t period_ns;
+
+	pthread_t thread;
+	bool running;
+	int stop_fd;
+
+	struct spsc_ring ring;
+
+	/* Only written by the thread but read from anywhere. */
+	unsigned long long num_samples;
+	unsigned long long num_dropped;
+	unsigned long long num_overruns;
+	unsigned long long jitter_max;
+	unsigned long long jitter_sum;
+};
+
+static int sampler_take(struct gpiod_sampler *sampler, uint64_t deadline)
+{
+	struct gpio_v2_line_values lv;
+	struct gpiod_sample *sample;
+	unsigned long long bits = 0;
+	uint64_t now;
+	unsigned int i;
+	int rv;
+
+	lv.mask = sampler->req_mask;
+	lv.bits = 0;
+
+	now = monotonic_ns();
+	rv = ioctl(sampler->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv);
+	if (rv < 0)
+		return -1;
+
+	for (i = 0; i < sampler->num_lines; i++) {
+		if (lv.bits & sampler->line_bits[i])
+			bits |= 1ULL << i;
+	}
+
+	counter_add(&sampler->num_samples, 1);
+	counter_add(&sampler->jitter_sum, now - deadline);
+	if (now - deadline > sampler->jitter_max)
+		__atomic_store_n(&sampler->jitter_max, now - deadline,
+				 __ATOMIC_RELAXED);
+
+	sample = spsc_ring_slot(&sampler->ring);
+	if (!sample) {
+		counter_add(&sampler->num_dropped, 1);
+		return 0;
+	}
+
+	sample->timestamp_ns = now;
+	sample->bits = bits;
+	spsc_ring_push(&sampler->ring);
+
+	fd_signal(sampler->ring.data_fd);
+
+	return 0;
+}
+
+static void *sampler_run(void *data)
+{
+	struct gpiod_sampler *sampler = data;
+	uint64_t deadline, missed;
+	int rv;
+
+	deadline = monotonic_ns();
+
+	for (;;) {
+		rv = sleep_until_ns(deadline, sampler->stop_fd);
+		if (rv)
+			break;
+
+		rv = sampler_take(sampler, deadline);
+		if (rv)
+			break;
+
+		deadline += sampler->period_ns;
+
+		missed = deadline_skip_missed(&deadline, sampler->period_ns);
+		if (missed)
+			counter_add(&sampler->num_overruns, missed);
+	}
+
+	if (rv < 0)
+		spsc_ring_set_error(&sampler->ring, errno);
+
+	return NULL;
+}
+
+GPIOD_API struct gpiod_sampler *
+gpiod_sampler_new(struct gpiod_line_bulk *bulk, const struct timespec *period,
+		  unsigned int ring_size)
+{
+	struct gpiod_sampler *sampler;
+	unsigned int num_lines, i;
+	uint64_t period_ns;
+	int rv;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	period_ns = timespec_to_ns(period);
+	if (num_lines == 0 || num_lines > SAMPLER_MAX_LINES ||
+	    period_ns == 0 || ring_size == 0 || ring_size > (1U << 24)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	sampler = malloc(sizeof(*sampler));
+	if (!sampler)
+		return NULL;
+
+	memset(sampler, 0, sizeof(*sampler));
+	sampler->num_lines = num_lines;
+	sampler->period_ns = period_ns;
+	sampler->stop_fd = -1;
+
+	rv = spsc_ring_init(&sampler->ring, ring_size,
+			    sizeof(struct gpiod_sample), false);
+	if (rv)
+		goto err_free;
+
+	sampler->fd = line_bulk_request_bits(bulk, sampler->line_bits);
+	if (sampler->fd < 0)
+		goto err_free;
+
+	for (i = 0; i < num_lines; i++)
+		sampler->req_mask |= sampler->line_bits[i];
+
+	sampler->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (sampler->stop_fd < 0)
+		goto err_free;
+
+	return sampler;
+
+err_free:
+	gpiod_sampler_free(sampler);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_sampler_free(struct gpiod_sampler *sampler)
+{
+	if (!sampler)
+		return;
+
+	gpiod_sampler_stop(sampler);
+
+	if (sampler->stop_fd >= 0)
+		close(sampler->stop_fd);
+
+	spsc_ring_release(&sampler->ring);
+	free(sampler);
+}
+
+GPIOD_API int gpiod_sampler_start(struct gpiod_sampler *sampler)
+{
+	int rv;
+
+	if (sampler->running) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	fd_clear(sampler->stop_fd);
+	sampler->ring.error = 0;
+
+	sampler->num_samples = sampler->num_dropped = 0;
+	sampler->num_overruns = 0;
+	sampler->jitter_max = sampler->jitter_sum = 0;
+
+	rv = pthread_create(&sampler->thread, NULL, sampler_run, sampler);
+	if (rv) {
+		errno = rv;
+		return -1;
+	}
+
+	sampler->running = true;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_sampler_stop(struct gpiod_sampler *sampler)
+{
+	if (!sampler->running)
+		return 0;
+
+	fd_signal(sampler->stop_fd);
+	pthread_join(sampler->thread, NULL);
+	sampler->running = false;
+
+	if (sampler->ring.error) {
+		errno = sampler->ring.error;
+		return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API int gpiod_sampler_get_fd(struct gpiod_sampler *sampler)
+{
+	return sampler->ring.data_fd;
+}
+
+GPIOD_API int gpiod_sampler_read(struct gpiod_sampler *sampler,
+				 const struct timespec *timeout,
+				 struct gpiod_sample *samples,
+				 unsigned int num_samples)
+{
+	if (num_samples == 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return spsc_ring_read(&sampler->ring, timeout, samples, num_samples);
+}
+
+GPIOD_API void gpiod_sampler_get_stats(struct gpiod_sampler *sampler,
+				       struct gpiod_sampler_stats *stats)
+{
+	stats->num_samples = __atomic_load_n(&sampler->num_samples,
+					     __ATOMIC_RELAXED);
+	stats->num_dropped = __atomic_load_n(&sampler->num_dropped,
+					     __ATOMIC_RELAXED);
+	stats->num_overruns = __atomic_load_n(&sampler->num_overruns,
+					      __ATOMIC_RELAXED);
+	stats->jitter_max_ns = __atomic_load_n(&sampler->jitter_max,
+					       __ATOMIC_RELAXED);
+	stats->jitter_avg_ns = __atomic_load_n(&sampler->jitter_sum,
+					       __ATOMIC_RELAXED);
+	if (stats->num_samples)
+		stats->jitter_avg_ns /= stats->num_samples;
+}
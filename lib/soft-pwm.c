@@ -0,0 +1,341 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Software PWM - generates duty cycles for a set of output lines from a single
+ * timer thread, setting all lines switching at the same tick at once.
+ */
+
+#include <errno.h>
+#include <gpiod.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define SOFT_PWM_MAX_CHANNELS	64
+
+/* Lines switching off at the same tick of a period. */
+struct soft_pwm_edge {
+	uint64_t offset_ns;
+	unsigned long long mask;
+};
+
+struct gpiod_soft_pwm {
+	struct gpiod_line_bulk *bulk;
+	unsigned int num_channels;
+	uint64_t period_ns;
+	uint64_t resolution_ns;
+
+	/*
+	 * Written by any thread with atomic stores, picked up by the timer
+	 * thread at the start of every period.
+	 */
+	unsigned int duty[SOFT_PWM_MAX_CHANNELS];
+
+	struct soft_pwm_edge edges[SOFT_PWM_MAX_CHANNELS];
+
+	pthread_t thread;
+	bool running;
+	int stop_fd;
+	int error;
+
+	unsigned long long num_periods;
+	unsigned long long num_overruns;
+	unsigned long long num_writes;
+	unsigned long long jitter_max;
+	unsigned long long jitter_sum;
+};
+
+/*
+ * Build the schedule of the next period: returns the mask of the lines to
+ * switch on at its start and fills the table of the switch-off edges sorted
+ * by time, one entry per tick.
+ */
+static unsigned long long soft_pwm_schedule(struct gpiod_soft_pwm *pwm,
+					    unsigned int *num_edges)
+{
+	unsigned long long on = 0, bit;
+	unsigned int i, j, n = 0;
+	uint64_t offset;
+	unsigned int duty;
+
+	for (i = 0; i < pwm->num_channels; i++) {
+		duty = __atomic_load_n(&pwm->duty[i], __ATOMIC_RELAXED);
+		if (duty == 0)
+			continue;
+
+		bit = 1ULL << i;
+		on |= bit;
+
+		if (duty >= GPIOD_SOFT_PWM_DUTY_MAX)
+			continue;
+
+		/* Round to the nearest tick. */
+		offset = (pwm->period_ns * duty + GPIOD_SOFT_PWM_DUTY_MAX / 2) /
+			 GPIOD_SOFT_PWM_DUTY_MAX;
+		offset = (offset + pwm->resolution_ns / 2) /
+			 pwm->resolution_ns * pwm->resolution_ns;
+		/* Lines going off at the end of the period just stay on... */
+		if (offset >= pwm->period_ns)
+			continue;
+
+		/* ...and lines going off right away are never switched on. */
+		if (offset == 0) {
+			on &= ~bit;
+			continue;
+		}
+
+		for (j = 0; j < n && pwm->edges[j].offset_ns < offset; j++)
+			;
+
+		if (j < n && pwm->edges[j].offset_ns == offset) {
+			pwm->edges[j].mask |= bit;
+			continue;
+		}
+
+		memmove(&pwm->edges[j + 1], &pwm->edges[j],
+			(n - j) * sizeof(*pwm->edges));
+		pwm->edges[j].offset_ns = offset;
+		pwm->edges[j].mask = bit;
+		n++;
+	}
+
+	*num_edges = n;
+
+	return on;
+}
+
+static int soft_pwm_write(struct gpiod_soft_pwm *pwm, uint64_t deadline,
+			  unsigned long long mask, unsigned long long bits)
+{
+	uint64_t now, jitter;
+	int rv;
+
+	now = monotonic_ns();
+	jitter = now > deadline ? now - deadline : 0;
+
+	rv = gpiod_line_set_value_bulk_mask(pwm->bulk, mask, bits);
+	if (rv < 0)
+		return -1;
+
+	counter_add(&pwm->num_writes, 1);
+	counter_add(&pwm->jitter_sum, jitter);
+	if (jitter > pwm->jitter_max)
+		__atomic_store_n(&pwm->jitter_max, jitter, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+static void *soft_pwm_run(void *data)
+{
+	struct gpiod_soft_pwm *pwm = data;
+	unsigned long long all, on, state = 0;
+	uint64_t base, deadline, missed;
+	unsigned int i, num_edges;
+	bool known = false;
+	int rv;
+
+	all = pwm->num_channels == 64 ?
+		~0ULL : (1ULL << pwm->num_channels) - 1;
+	base = monotonic_ns();
+
+	for (;;) {
+		on = soft_pwm_schedule(pwm, &num_edges);
+
+		rv = sleep_until_ns(base, pwm->stop_fd);
+		if (rv)
+			goto out;
+
+		/* Lines fully on or off for several periods aren't touched. */
+		if (!known || on != state) {
+			rv = soft_pwm_write(pwm, base, all, on);
+			if (rv)
+				goto out;
+
+			state = on;
+			known = true;
+		}
+
+		for (i = 0; i < num_edges; i++) {
+			deadline = base + pwm->edges[i].offset_ns;
+
+			rv = sleep_until_ns(deadline, pwm->stop_fd);
+			if (rv)
+				goto out;
+
+			rv = soft_pwm_write(pwm, deadline, pwm->edges[i].mask, 0);
+			if (rv)
+				goto out;
+
+			state &= ~pwm->edges[i].mask;
+		}
+
+		counter_add(&pwm->num_periods, 1);
+		base += pwm->period_ns;
+
+		missed = deadline_skip_missed(&base, pwm->period_ns);
+		if (missed)
+			counter_add(&pwm->num_overruns, missed);
+	}
+
+out:
+	if (rv < 0)
+		pwm->error = errno;
+
+	/* Leave all channels inactive. */
+	if (gpiod_line_set_value_bulk_mask(pwm->bulk, all, 0) < 0 &&
+	    !pwm->error)
+		pwm->error = errno;
+
+	return NULL;
+}
+
+GPIOD_API struct gpiod_soft_pwm *
+gpiod_soft_pwm_new(struct gpiod_line_bulk *bulk,
+		   const struct timespec *period,
+		   const struct timespec *resolution)
+{
+	struct gpiod_soft_pwm *pwm;
+	unsigned int i, num_lines;
+	uint64_t period_ns, res_ns;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	period_ns = timespec_to_ns(period);
+	res_ns = resolution ? timespec_to_ns(resolution) : period_ns / 1000;
+
+	if (num_lines == 0 || num_lines > SOFT_PWM_MAX_CHANNELS ||
+	    res_ns == 0 || res_ns > period_ns) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	pwm = malloc(sizeof(*pwm));
+	if (!pwm)
+		return NULL;
+
+	memset(pwm, 0, sizeof(*pwm));
+	pwm->num_channels = num_lines;
+	pwm->period_ns = period_ns;
+	pwm->resolution_ns = res_ns;
+	pwm->stop_fd = -1;
+
+	/* The caller's bulk may be gone by the time the thread runs. */
+	pwm->bulk = gpiod_line_bulk_new(num_lines);
+	if (!pwm->bulk)
+		goto err_free;
+
+	for (i = 0; i < num_lines; i++)
+		gpiod_line_bulk_add_line(pwm->bulk,
+					 gpiod_line_bulk_get_line(bulk, i));
+
+	pwm->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (pwm->stop_fd < 0)
+		goto err_free;
+
+	return pwm;
+
+err_free:
+	gpiod_soft_pwm_free(pwm);
+
+	return NULL;
+}
+
+GPIOD_API void gpiod_soft_pwm_free(struct gpiod_soft_pwm *pwm)
+{
+	if (!pwm)
+		return;
+
+	gpiod_soft_pwm_stop(pwm);
+
+	if (pwm->stop_fd >= 0)
+		close(pwm->stop_fd);
+	if (pwm->bulk)
+		gpiod_line_bulk_free(pwm->bulk);
+	free(pwm);
+}
+
+GPIOD_API int gpiod_soft_pwm_set_duty(struct gpiod_soft_pwm *pwm,
+				      unsigned int channel, unsigned int duty)
+{
+	if (channel >= pwm->num_channels || duty > GPIOD_SOFT_PWM_DUTY_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	__atomic_store_n(&pwm->duty[channel], duty, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+GPIOD_API unsigned int gpiod_soft_pwm_get_duty(struct gpiod_soft_pwm *pwm,
+					       unsigned int channel)
+{
+	if (channel >= pwm->num_channels)
+		return 0;
+
+	return __atomic_load_n(&pwm->duty[channel], __ATOMIC_RELAXED);
+}
+
+GPIOD_API int gpiod_soft_pwm_start(struct gpiod_soft_pwm *pwm)
+{
+	int rv;
+
+	if (pwm->running) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	fd_clear(pwm->stop_fd);
+	pwm->error = 0;
+
+	pwm->num_periods = pwm->num_overruns = pwm->num_writes = 0;
+	pwm->jitter_max = pwm->jitter_sum = 0;
+
+	rv = pthread_create(&pwm->thread, NULL, soft_pwm_run, pwm);
+	if (rv) {
+		errno = rv;
+		return -1;
+	}
+
+	pwm->running = true;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_soft_pwm_stop(struct gpiod_soft_pwm *pwm)
+{
+	if (!pwm->running)
+		return 0;
+
+	fd_signal(pwm->stop_fd);
+	pthread_join(pwm->thread, NULL);
+	pwm->running = false;
+
+	if (pwm->error) {
+		errno = pwm->error;
+		return -1;
+	}
+
+	return 0;
+}
+
+GPIOD_API void gpiod_soft_pwm_get_stats(struct gpiod_soft_pwm *pwm,
+					struct gpiod_soft_pwm_stats *stats)
+{
+	stats->num_periods = __atomic_load_n(&pwm->num_periods,
+					     __ATOMIC_RELAXED);
+	stats->num_overruns = __atomic_load_n(&pwm->num_overruns,
+					      __ATOMIC_RELAXED);
+	stats->num_writes = __atomic_load_n(&pwm->num_writes,
+					    __ATOMIC_RELAXED);
+	stats->jitter_max_ns = __atomic_load_n(&pwm->jitter_max,
+					       __ATOMIC_RELAXED);
+	stats->jitter_avg_ns = __atomic_load_n(&pwm->jitter_sum,
+					       __ATOMIC_RELAXED);
+	if (stats->num_writes)
+		stats->jitter_avg_ns /= stats->num_writes;
+}
@@ -0,0 +1,531 @@
+// SPDX-License-Identifier: LGPL-2.1-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+/*
+ * Line values sampled by a library thread and published through a seqlock
+ * for lock-free readers in any thread or - through shared memory - process.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gpiod.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "internal.h"
+
+#define VALUE_SNAPSHOT_MAGIC		0x47505653 /* "GPVS" */
+#define VALUE_SNAPSHOT_VERSION		1
+#define VALUE_SNAPSHOT_MAX_LINES	64
+/* For how long readers wait for an update in progress to complete. */
+#define VALUE_SNAPSHOT_READ_TIMEOUT_NS	10000000ULL
+
+/*
+ * The published data. Fixed-size types only as it may be shared with
+ * processes built separately. The seq field is odd while an update is in
+ * progress.
+ */
+struct value_snapshot_data {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seq;
+	uint32_t num_lines;
+	uint64_t bits;
+	uint64_t timestamp_ns;
+	uint64_t generation;
+	uint32_t offsets[VALUE_SNAPSHOT_MAX_LINES];
+	char chip_name[32];
+};
+
+struct gpiod_value_snapshot {
+	struct value_snapshot_data *data;
+	/* Only set for the object that owns the sampling thread. */
+	bool owner;
+	char *shm_path;
+	/* The shared memory object was created by us and is ours to unlink. */
+	bool shm_created;
+
+	int mode;
+	uint64_t period_ns;
+	struct gpiod_line_bulk *bulk;
+	unsigned long last_line_seqno[VALUE_SNAPSHOT_MAX_LINES];
+	struct gpiod_event_loop *loop;
+	pthread_t thread;
+	int stop_fd;
+};
+
+static void value_snapshot_publish(struct gpiod_value_snapshot *snap,
+				   uint64_t bits, uint64_t timestamp_ns)
+{
+	struct value_snapshot_data *data = snap->data;
+	uint32_t seq = data->seq;
+
+	__atomic_store_n(&data->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	data->bits = bits;
+	data->timestamp_ns = timestamp_ns;
+	data->generation++;
+
+	__atomic_store_n(&data->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Read all values from the kernel and publish them. */
+static int value_snapshot_sample(struct gpiod_value_snapshot *snap)
+{
+	int values[VALUE_SNAPSHOT_MAX_LINES];
+	unsigned int i, num_lines;
+	uint64_t bits = 0;
+	int rv;
+
+	rv = gpiod_line_get_value_bulk(snap->bulk, values);
+	if (rv)
+		return -1;
+
+	num_lines = gpiod_line_bulk_num_lines(snap->bulk);
+	for (i = 0; i < num_lines; i++) {
+		if (values[i])
+			bits |= 1ULL << i;
+	}
+
+	value_snapshot_publish(snap, bits, monotonic_ns());
+
+	return 0;
+}
+
+static int value_snapshot_line_index(struct gpiod_value_snapshot *snap,
+				     unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < snap->data->num_lines; i++) {
+		if (snap->data->offsets[i] == offset)
+			return i;
+	}
+
+	return -1;
+}
+
+static int value_snapshot_apply(const struct gpiod_line_event_ext *events,
+				unsigned int num_events, void *data)
+{
+	struct gpiod_value_snapshot *snap = data;
+	uint64_t bits = snap->data->bits;
+	bool resync = false;
+	unsigned int i;
+	int index;
+
+	for (i = 0; i < num_events; i++) {
+		index = value_snapshot_line_index(snap, events[i].offset);
+		if (index < 0)
+			continue;
+
+		/* A gap means the kernel dropped events - ask for the truth. */
+		if (events[i].line_seqno != snap->last_line_seqno[index] + 1)
+			resync = true;
+		snap->last_line_seqno[index] = events[i].line_seqno;
+
+		if (events[i].event_type == GPIOD_LINE_EVENT_RISING_EDGE)
+			bits |= 1ULL << index;
+		else
+			bits &= ~(1ULL << index);
+	}
+
+	if (resync) {
+		if (value_snapshot_sample(snap))
+			return GPIOD_EVENT_LOOP_CB_STOP;
+	} else if (num_events) {
+		value_snapshot_publish(snap, bits,
+				timespec_to_ns(&events[num_events - 1].ts));
+	}
+
+	return GPIOD_EVENT_LOOP_CB_NEXT;
+}
+
+static void *value_snapshot_periodic(void *data)
+{
+	struct gpiod_value_snapshot *snap = data;
+	uint64_t next, now;
+	struct timespec ts;
+	struct pollfd pfd;
+	int rv;
+
+	pfd.fd = snap->stop_fd;
+	pfd.events = POLLIN;
+
+	next = monotonic_ns();
+
+	for (;;) {
+		if (value_snapshot_sample(snap))
+			break;
+
+		/* Stay on the period's grid however long sampling took. */
+		next += snap->period_ns;
+		now = monotonic_ns();
+		if (next < now)
+			next = now;
+
+		ns_to_timespec(next - now, &ts);
+
+		rv = ppoll(&pfd, 1, &ts, NULL);
+		if (rv != 0 && !(rv < 0 && errno == EINTR))
+			break;
+	}
+
+	return NULL;
+}
+
+static void *value_snapshot_on_events(void *data)
+{
+	struct gpiod_value_snapshot *snap = data;
+	struct timespec ts = { 0, 0 };
+	struct pollfd pfds[2];
+	int rv;
+
+	pfds[0].fd = gpiod_event_loop_get_fd(snap->loop);
+	pfds[0].events = POLLIN;
+	pfds[1].fd = snap->stop_fd;
+	pfds[1].events = POLLIN;
+
+	for (;;) {
+		rv = poll(pfds, 2, -1);
+		if (rv < 0) {
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		if (pfds[1].revents)
+			break;
+
+		rv = gpiod_event_loop_dispatch(snap->loop, &ts);
+		if (rv < 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static struct value_snapshot_data *value_snapshot_map(const char *path,
+						      bool create)
+{
+	struct value_snapshot_data *data;
+	struct stat st;
+	int fd, rv;
+
+	if (create)
+		fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,
+			      0644);
+	else
+		fd = shm_open(path, O_RDONLY | O_CLOEXEC, 0);
+	if (fd < 0)
+		return NULL;
+
+	if (create) {
+		rv = ftruncate(fd, sizeof(*data));
+		if (rv)
+			goto err_close;
+	} else {
+		rv = fstat(fd, &st);
+		if (rv)
+			goto err_close;
+
+		if ((size_t)st.st_size < sizeof(*data)) {
+			errno = EPROTO;
+			goto err_close;
+		}
+	}
+
+	data = mmap(NULL, sizeof(*data),
+		    create ? PROT_READ | PROT_WRITE : PROT_READ,
+		    MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		goto err_close;
+
+	close(fd);
+
+	return data;
+
+err_close:
+	rv = errno;
+	if (create)
+		shm_unlink(path);
+	close(fd);
+	errno = rv;
+
+	return NULL;
+}
+
+static char *value_snapshot_shm_path(const char *name)
+{
+	char *path;
+
+	if (!name[0] || strchr(name, '/')) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (asprintf(&path, "/%s", name) < 0)
+		return NULL;
+
+	return path;
+}
+
+static int value_snapshot_copy_bulk(struct gpiod_value_snapshot *snap,
+				    struct gpiod_line_bulk *bulk)
+{
+	unsigned int i, num_lines;
+	struct gpiod_line *line;
+
+	num_lines = gpiod_line_bulk_num_lines(bulk);
+	if (num_lines == 0 || num_lines > VALUE_SNAPSHOT_MAX_LINES) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	snap->bulk = gpiod_line_bulk_new(num_lines);
+	if (!snap->bulk)
+		return -1;
+
+	for (i = 0; i < num_lines; i++) {
+		line = gpiod_line_bulk_get_line(bulk, i);
+		gpiod_line_bulk_add_line(snap->bulk, line);
+		snap->data->offsets[i] = gpiod_line_offset(line);
+	}
+
+	snap->data->num_lines = num_lines;
+	strncpy(snap->data->chip_name,
+		gpiod_chip_get_name(gpiod_line_get_chip(line)),
+		sizeof(snap->data->chip_name) - 1);
+
+	return 0;
+}
+
+GPIOD_API struct gpiod_value_snapshot *
+gpiod_value_snapshot_new(struct gpiod_line_bulk *bulk, int mode,
+			 const struct timespec *period, const char *shm_name)
+{
+	struct gpiod_value_snapshot *snap;
+	void *(*func)(void *);
+	int rv;
+
+	if ((mode == GPIOD_VALUE_SNAPSHOT_PERIODIC &&
+	     (!period || timespec_to_ns(period) == 0)) ||
+	    (mode != GPIOD_VALUE_SNAPSHOT_PERIODIC &&
+	     mode != GPIOD_VALUE_SNAPSHOT_ON_EVENTS)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	snap = malloc(sizeof(*snap));
+	if (!snap)
+		return NULL;
+
+	memset(snap, 0, sizeof(*snap));
+	snap->owner = true;
+	snap->mode = mode;
+	snap->stop_fd = -1;
+	if (period)
+		snap->period_ns = timespec_to_ns(period);
+
+	if (shm_name) {
+		snap->shm_path = value_snapshot_shm_path(shm_name);
+		if (!snap->shm_path)
+			goto err_free;
+
+		snap->data = value_snapshot_map(snap->shm_path, true);
+		snap->shm_created = !!snap->data;
+	} else {
+		snap->data = malloc(sizeof(*snap->data));
+		if (snap->data)
+			memset(snap->data, 0, sizeof(*snap->data));
+	}
+	if (!snap->data)
+		goto err_free;
+
+	snap->data->version = VALUE_SNAPSHOT_VERSION;
+
+	rv = value_snapshot_copy_bulk(snap, bulk);
+	if (rv)
+		goto err_free;
+
+	snap->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (snap->stop_fd < 0)
+		goto err_free;
+
+	if (mode == GPIOD_VALUE_SNAPSHOT_ON_EVENTS) {
+		snap->loop = gpiod_event_loop_new();
+		if (!snap->loop)
+			goto err_free;
+
+		rv = gpiod_event_loop_add(snap->loop, snap->bulk,
+					  value_snapshot_apply, snap);
+		if (rv)
+			goto err_free;
+
+		func = value_snapshot_on_events;
+	} else {
+		func = value_snapshot_periodic;
+	}
+
+	/*
+	 * Start from a known state - in the event mode, everything after
+	 * this is derived from edges.
+	 */
+	rv = value_snapshot_sample(snap);
+	if (rv)
+		goto err_free;
+
+	__atomic_store_n(&snap->data->magic, VALUE_SNAPSHOT_MAGIC,
+			 __ATOMIC_RELEASE);
+
+	rv = pthread_create(&snap->thread, NULL, func, snap);
+	if (rv) {
+		errno = rv;
+		goto err_free;
+	}
+
+	return snap;
+
+err_free:
+	rv = errno;
+	/* Don't try to stop a thread that was never started. */
+	if (snap->stop_fd >= 0)
+		close(snap->stop_fd);
+	snap->stop_fd = -1;
+	gpiod_value_snapshot_free(snap);
+	errno = rv;
+
+	return NULL;
+}
+
+GPIOD_API struct gpiod_value_snapshot *
+gpiod_value_snapshot_open(const char *shm_name)
+{
+	struct gpiod_value_snapshot *snap;
+	char *path;
+
+	path = value_snapshot_shm_path(shm_name);
+	if (!path)
+		return NULL;
+
+	snap = malloc(sizeof(*snap));
+	if (!snap) {
+		free(path);
+		return NULL;
+	}
+
+	memset(snap, 0, sizeof(*snap));
+	snap->stop_fd = -1;
+
+	snap->data = value_snapshot_map(path, false);
+	free(path);
+	if (!snap->data) {
+		free(snap);
+		return NULL;
+	}
+
+	if (__atomic_load_n(&snap->data->magic, __ATOMIC_ACQUIRE) !=
+					VALUE_SNAPSHOT_MAGIC ||
+	    snap->data->version != VALUE_SNAPSHOT_VERSION) {
+		munmap(snap->data, sizeof(*snap->data));
+		free(snap);
+		errno = EPROTO;
+		return NULL;
+	}
+
+	return snap;
+}
+
+GPIOD_API void gpiod_value_snapshot_free(struct gpiod_value_snapshot *snap)
+{
+	if (!snap)
+		return;
+
+	if (snap->stop_fd >= 0) {
+		fd_signal(snap->stop_fd);
+		pthread_join(snap->thread, NULL);
+		close(snap->stop_fd);
+	}
+
+	gpiod_event_loop_free(snap->loop);
+	if (snap->bulk)
+		gpiod_line_bulk_free(snap->bulk);
+
+	if (snap->shm_path || !snap->owner) {
+		if (snap->data)
+			munmap(snap->data, sizeof(*snap->data));
+	} else {
+		free(snap->data);
+	}
+
+	if (snap->shm_created)
+		shm_unlink(snap->shm_path);
+	free(snap->shm_path);
+
+	free(snap);
+}
+
+GPIOD_API int gpiod_value_snapshot_read(struct gpiod_value_snapshot *snap,
+					struct gpiod_value_snapshot_data *out)
+{
+	struct value_snapshot_data *data = snap->data;
+	uint64_t give_up = 0, now;
+	uint32_t seq;
+
+	for (;;) {
+		seq = __atomic_load_n(&data->seq, __ATOMIC_ACQUIRE);
+		if (!(seq & 1)) {
+			out->bits = data->bits;
+			ns_to_timespec(data->timestamp_ns, &out->ts);
+			out->generation = data->generation;
+
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+			if (__atomic_load_n(&data->seq, __ATOMIC_RELAXED) == seq)
+				break;
+		}
+
+		/*
+		 * Updates take no time unless the publisher got preempted in
+		 * the middle of one - or died there, leaving seq odd for good.
+		 * Only start the clock once the first attempt failed.
+		 */
+		now = monotonic_ns();
+		if (!give_up) {
+			give_up = now + VALUE_SNAPSHOT_READ_TIMEOUT_NS;
+		} else if (now >= give_up) {
+			errno = EAGAIN;
+			return -1;
+		}
+	}
+
+	out->num_lines = data->num_lines;
+
+	return 0;
+}
+
+GPIOD_API int gpiod_value_snapshot_offset(struct gpiod_value_snapshot *snap,
+					  unsigned int index)
+{
+	if (index >= snap->data->num_lines) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return snap->data->offsets[index];
+}
+
+GPIOD_API const char *
+gpiod_value_snapshot_chip_name(struct gpiod_value_snapshot *snap)
+{
+	return snap->data->chip_name;
+}
@@ -172,6 +172,59 @@ void gpiod_test_chip_set_pull(guint chip_index, guint line_offset, gint pull)
 			g_strerror(errno));
 }
 
+void gpiod_test_toggle_line(guint line_offset, guint num_pulses,
+			    gulong half_period_us)
+{
+	guint i;
+
+	for (i = 0; i < num_pulses; i++) {
+		gpiod_test_chip_set_pull(0, line_offset, 1);
+		if (half_period_us)
+			g_usleep(half_period_us);
+		gpiod_test_chip_set_pull(0, line_offset, 0);
+		if (half_period_us)
+			g_usleep(half_period_us);
+	}
+}
+
+struct gpiod_line_bulk *gpiod_test_request_outputs(struct gpiod_chip *chip,
+						   guint *offsets,
+						   guint num_lines)
+{
+	struct gpiod_line_bulk *bulk;
+	gint ret;
+
+	bulk = gpiod_chip_get_lines(chip, offsets, num_lines);
+	g_assert_nonnull(bulk);
+	if (!bulk)
+		return NULL;
+
+	ret = gpiod_line_request_bulk_output(bulk, GPIOD_TEST_CONSUMER, NULL);
+	g_assert_cmpint(ret, ==, 0);
+
+	return bulk;
+}
+
+struct gpiod_line_bulk *gpiod_test_request_events(struct gpiod_chip *chip,
+						  guint *offsets,
+						  guint num_lines)
+{
+	struct gpiod_line_bulk *bulk;
+	gint ret;
+
+	bulk = gpiod_chip_get_lines(chip, offsets, num_lines);
+	g_assert_nonnull(bulk);
+	if (!bulk)
+		return NULL;
+
+	ret = gpiod_line_request_bulk_both_edges_events_flags(bulk,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+
+	return bulk;
+}
+
 static gpointer event_worker_func(gpointer data)
 {
 	GpiodTestEventThread *thread = data;
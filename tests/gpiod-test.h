@@ -21,9 +21,48 @@
  */
 typedef struct gpiod_chip gpiod_chip_struct;
 typedef struct gpiod_line_bulk gpiod_line_bulk_struct;
+typedef struct gpiod_event_loop gpiod_event_loop_struct;
+typedef struct gpiod_event_reader gpiod_event_reader_struct;
+typedef struct gpiod_event_merger gpiod_event_merger_struct;
+typedef struct gpiod_event_buffer gpiod_event_buffer_struct;
+typedef struct gpiod_event_thread gpiod_event_thread_struct;
+typedef struct gpiod_output_sequencer gpiod_output_sequencer_struct;
+typedef struct gpiod_soft_pwm gpiod_soft_pwm_struct;
+typedef struct gpiod_bitbang gpiod_bitbang_struct;
+typedef struct gpiod_quadrature_encoder gpiod_quadrature_encoder_struct;
+typedef struct gpiod_line_measurement gpiod_line_measurement_struct;
+typedef struct gpiod_edge_counter gpiod_edge_counter_struct;
+typedef struct gpiod_reflex gpiod_reflex_struct;
+typedef struct gpiod_sampler gpiod_sampler_struct;
+typedef struct gpiod_keypad gpiod_keypad_struct;
+typedef struct gpiod_capture_reader gpiod_capture_reader_struct;
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_chip_struct, gpiod_chip_unref);
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_line_bulk_struct, gpiod_line_bulk_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_event_loop_struct, gpiod_event_loop_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_event_reader_struct,
+			      gpiod_event_reader_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_event_merger_struct,
+			      gpiod_event_merger_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_event_buffer_struct,
+			      gpiod_event_buffer_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_event_thread_struct,
+			      gpiod_event_thread_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_output_sequencer_struct,
+			      gpiod_output_sequencer_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_soft_pwm_struct, gpiod_soft_pwm_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_bitbang_struct, gpiod_bitbang_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_quadrature_encoder_struct,
+			      gpiod_quadrature_encoder_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_line_measurement_struct,
+			      gpiod_line_measurement_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_edge_counter_struct,
+			      gpiod_edge_counter_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_reflex_struct, gpiod_reflex_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_sampler_struct, gpiod_sampler_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_keypad_struct, gpiod_keypad_free);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(gpiod_capture_reader_struct,
+			      gpiod_capture_reader_free);
 
 /* These are private definitions and should not be used directly. */
 typedef void (*_gpiod_test_func)(void);
@@ -83,6 +122,24 @@ const gchar *gpiod_test_chip_name(guint idx);
 gint gpiod_test_chip_get_value(guint chip_index, guint line_offset);
 void gpiod_test_chip_set_pull(guint chip_index, guint line_offset, gint pull);
 
+/*
+ * Toggle a line of the first chip num_pulses times, holding each level for
+ * half_period_us microseconds.
+ */
+void gpiod_test_toggle_line(guint line_offset, guint num_pulses,
+			    gulong half_period_us);
+
+/*
+ * Request lines of a chip as outputs or for both edge events on a shared
+ * file descriptor. Failures are reported as test failures.
+ */
+struct gpiod_line_bulk *gpiod_test_request_outputs(struct gpiod_chip *chip,
+						   guint *offsets,
+						   guint num_lines);
+struct gpiod_line_bulk *gpiod_test_request_events(struct gpiod_chip *chip,
+						  guint *offsets,
+						  guint num_lines);
+
 /* Helpers for triggering line events in a separate thread. */
 struct gpiod_test_event_thread;
 typedef struct gpiod_test_event_thread GpiodTestEventThread;
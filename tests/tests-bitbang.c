@@ -0,0 +1,177 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+#include <string.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "bitbang"
+
+GPIOD_TEST_CASE(send, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) outputs = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_bitbang_config config;
+	struct gpiod_bitbang_stats stats;
+	unsigned int offsets[] = { 0, 1 };
+	unsigned char tx[] = { 0xa5, 0x3c };
+	struct gpiod_bitbang *bb;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	outputs = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(outputs);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_output(outputs, GPIOD_TEST_CONSUMER,
+					     NULL);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	memset(&config, 0, sizeof(config));
+	config.clock = 0;
+	config.data_out = 1;
+	config.data_in = -1;
+	config.flags = GPIOD_BITBANG_FLAG_CPOL | GPIOD_BITBANG_FLAG_LSB_FIRST;
+
+	bb = gpiod_bitbang_new(outputs, NULL, &config);
+	g_assert_nonnull(bb);
+	gpiod_test_return_if_failed();
+
+	/* The clock is idle right away. */
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 0), ==, 1);
+
+	ret = gpiod_bitbang_transfer(bb, tx, NULL, sizeof(tx));
+	g_assert_cmpint(ret, ==, 0);
+
+	/* The last bit shifted out was the MSB of 0x3c. */
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 0), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 0);
+
+	gpiod_bitbang_get_stats(bb, &stats);
+	g_assert_cmpuint(stats.num_bits, ==, 16);
+	g_assert_cmpuint(stats.last_bit_rate, >, 0);
+
+	gpiod_bitbang_free(bb);
+}
+
+GPIOD_TEST_CASE(receive, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) outputs = NULL;
+	g_autoptr(gpiod_line_bulk_struct) inputs = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_bitbang_config config;
+	unsigned int clock = 2, data_in = 5;
+	unsigned char rx[2];
+	struct gpiod_bitbang *bb;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	outputs = gpiod_chip_get_lines(chip, &clock, 1);
+	inputs = gpiod_chip_get_lines(chip, &data_in, 1);
+	g_assert_nonnull(outputs);
+	g_assert_nonnull(inputs);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_output(outputs, GPIOD_TEST_CONSUMER,
+					     NULL);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_input(inputs, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 5, 1);
+
+	memset(&config, 0, sizeof(config));
+	config.clock = 0;
+	config.data_out = -1;
+	config.data_in = 0;
+	config.half_period.tv_nsec = 1000;
+	config.flags = GPIOD_BITBANG_FLAG_CPHA;
+
+	bb = gpiod_bitbang_new(outputs, inputs, &config);
+	g_assert_nonnull(bb);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_bitbang_transfer(bb, NULL, rx, sizeof(rx));
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(rx[0], ==, 0xff);
+	g_assert_cmpuint(rx[1], ==, 0xff);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 0);
+
+	gpiod_bitbang_free(bb);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) outputs = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_bitbang_config config;
+	unsigned int offsets[] = { 0, 1 };
+	struct gpiod_bitbang *bb;
+	unsigned char rx;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	outputs = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(outputs);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_output(outputs, GPIOD_TEST_CONSUMER,
+					     NULL);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	memset(&config, 0, sizeof(config));
+	config.clock = 0;
+	config.data_out = 0;
+	config.data_in = -1;
+
+	/* Clock and data on the same line. */
+	bb = gpiod_bitbang_new(outputs, NULL, &config);
+	g_assert_null(bb);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Data input without a set of input lines. */
+	config.data_out = 1;
+	config.data_in = 0;
+	bb = gpiod_bitbang_new(outputs, NULL, &config);
+	g_assert_null(bb);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Receiving without a data input. */
+	config.data_in = -1;
+	bb = gpiod_bitbang_new(outputs, NULL, &config);
+	g_assert_nonnull(bb);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_bitbang_transfer(bb, NULL, &rx, 1);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	gpiod_bitbang_free(bb);
+
+	/* Clock and data not requested together. */
+	gpiod_line_release_bulk(outputs);
+	ret = gpiod_line_request_output(gpiod_line_bulk_get_line(outputs, 0),
+					GPIOD_TEST_CONSUMER, 0);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_output(gpiod_line_bulk_get_line(outputs, 1),
+					GPIOD_TEST_CONSUMER, 0);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	bb = gpiod_bitbang_new(outputs, NULL, &config);
+	g_assert_null(bb);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "capture"
+
+static void make_event(struct gpiod_line_event_ext *event, unsigned int offset,
+		       int event_type, time_t sec, long nsec)
+{
+	memset(event, 0, sizeof(*event));
+	event->offset = offset;
+	event->event_type = event_type;
+	event->ts.tv_sec = sec;
+	event->ts.tv_nsec = nsec;
+}
+
+GPIOD_TEST_CASE(record_and_read, 0, { 8 })
+{
+	g_autoptr(gpiod_capture_reader_struct) reader = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_capture_writer *writer;
+	unsigned int offsets[] = { 5, 2 };
+	struct gpiod_line_event_ext events[4];
+	struct gpiod_line_event_ext read[8];
+	gint ret, fds[2];
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = pipe(fds);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	writer = gpiod_capture_writer_new(fds[1], bulk);
+	g_assert_nonnull(writer);
+	gpiod_test_return_if_failed();
+
+	make_event(&events[0], 2, GPIOD_LINE_EVENT_RISING_EDGE, 100, 5);
+	make_event(&events[1], 5, GPIOD_LINE_EVENT_FALLING_EDGE, 100, 1005);
+	/* Events from separate file descriptors may go back in time. */
+	make_event(&events[2], 5, GPIOD_LINE_EVENT_RISING_EDGE, 100, 500);
+	make_event(&events[3], 2, GPIOD_LINE_EVENT_FALLING_EDGE, 101, 0);
+
+	ret = gpiod_capture_writer_add(writer, events, 4);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_capture_writer_flush(writer);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_capture_writer_free(writer);
+	close(fds[1]);
+
+	reader = gpiod_capture_reader_new(fds[0]);
+	g_assert_nonnull(reader);
+	gpiod_test_return_if_failed();
+
+	g_assert_cmpstr(gpiod_capture_reader_chip_name(reader), ==,
+			gpiod_chip_get_name(chip));
+	g_assert_cmpstr(gpiod_capture_reader_chip_label(reader), ==,
+			gpiod_chip_get_label(chip));
+	g_assert_cmpuint(gpiod_capture_reader_num_lines(reader), ==, 2);
+	g_assert_cmpuint(gpiod_capture_reader_line_offset(reader, 0), ==, 5);
+	g_assert_cmpuint(gpiod_capture_reader_line_offset(reader, 1), ==, 2);
+
+	ret = gpiod_capture_reader_read(reader, read, 8);
+	g_assert_cmpint(ret, ==, 4);
+	gpiod_test_return_if_failed();
+
+	g_assert_cmpint(read[0].offset, ==, 2);
+	g_assert_cmpint(read[0].event_type, ==, GPIOD_LINE_EVENT_RISING_EDGE);
+	g_assert_cmpint(read[0].ts.tv_sec, ==, 100);
+	g_assert_cmpint(read[0].ts.tv_nsec, ==, 5);
+	g_assert_cmpint(read[1].offset, ==, 5);
+	g_assert_cmpint(read[1].event_type, ==, GPIOD_LINE_EVENT_FALLING_EDGE);
+	g_assert_cmpint(read[1].ts.tv_nsec, ==, 1005);
+	g_assert_cmpint(read[2].offset, ==, 5);
+	g_assert_cmpint(read[2].ts.tv_nsec, ==, 500);
+	g_assert_cmpuint(read[2].line_seqno, ==, 2);
+	g_assert_cmpint(read[3].offset, ==, 2);
+	g_assert_cmpint(read[3].ts.tv_sec, ==, 101);
+	g_assert_cmpint(read[3].ts.tv_nsec, ==, 0);
+	g_assert_cmpuint(read[3].seqno, ==, 4);
+
+	ret = gpiod_capture_reader_read(reader, read, 8);
+	g_assert_cmpint(ret, ==, 0);
+
+	close(fds[0]);
+}
+
+GPIOD_TEST_CASE(lost_and_coalesced_events, 0, { 8 })
+{
+	g_autoptr(gpiod_capture_reader_struct) reader = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_capture_writer *writer;
+	unsigned int offsets[] = { 3 };
+	struct gpiod_line_event_ext events[3];
+	struct gpiod_line_event_ext read[4];
+	gint ret, fds[2];
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = pipe(fds);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	writer = gpiod_capture_writer_new(fds[1], bulk);
+	g_assert_nonnull(writer);
+	gpiod_test_return_if_failed();
+
+	make_event(&events[0], 3, GPIOD_LINE_EVENT_RISING_EDGE, 1, 10);
+	events[0].line_seqno = 1;
+	/* Two events lost by the kernel... */
+	make_event(&events[1], 3, GPIOD_LINE_EVENT_FALLING_EDGE, 1, 20);
+	events[1].line_seqno = 4;
+	/* ...and three edges coalesced into one event. */
+	make_event(&events[2], 3, GPIOD_LINE_EVENT_RISING_EDGE, 1, 30);
+	events[2].line_seqno = 7;
+	events[2].num_events = 3;
+	events[2].first_ts.tv_sec = 1;
+	events[2].first_ts.tv_nsec = 25;
+
+	ret = gpiod_capture_writer_add(writer, events, 3);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_capture_writer_free(writer);
+	close(fds[1]);
+
+	reader = gpiod_capture_reader_new(fds[0]);
+	g_assert_nonnull(reader);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_capture_reader_read(reader, read, 4);
+	g_assert_cmpint(ret, ==, 3);
+	gpiod_test_return_if_failed();
+
+	g_assert_cmpuint(read[0].seqno, ==, 1);
+	g_assert_cmpuint(read[0].line_seqno, ==, 1);
+	g_assert_cmpuint(read[0].num_events, ==, 1);
+	g_assert_cmpint(read[0].first_ts.tv_nsec, ==, 10);
+	g_assert_cmpuint(read[1].seqno, ==, 4);
+	g_assert_cmpuint(read[1].line_seqno, ==, 4);
+	g_assert_cmpuint(read[1].num_events, ==, 1);
+	g_assert_cmpuint(read[2].seqno, ==, 7);
+	g_assert_cmpuint(read[2].line_seqno, ==, 7);
+	g_assert_cmpuint(read[2].num_events, ==, 3);
+	g_assert_cmpint(read[2].ts.tv_nsec, ==, 30);
+	g_assert_cmpint(read[2].first_ts.tv_sec, ==, 1);
+	g_assert_cmpint(read[2].first_ts.tv_nsec, ==, 25);
+
+	close(fds[0]);
+}
+
+GPIOD_TEST_CASE(truncated_record, 0, { 8 })
+{
+	g_autoptr(gpiod_capture_reader_struct) reader = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_capture_writer *writer;
+	struct gpiod_line_event_ext events[2];
+	unsigned int offsets[] = { 3 };
+	guchar buf[256];
+	gint ret, fds[2];
+	gssize rd, wr;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = pipe(fds);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	writer = gpiod_capture_writer_new(fds[1], bulk);
+	g_assert_nonnull(writer);
+	gpiod_test_return_if_failed();
+
+	make_event(&events[0], 3, GPIOD_LINE_EVENT_RISING_EDGE, 1, 0);
+	make_event(&events[1], 3, GPIOD_LINE_EVENT_FALLING_EDGE, 2, 0);
+	ret = gpiod_capture_writer_add(writer, events, 2);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_capture_writer_free(writer);
+	close(fds[1]);
+
+	/* Cut the last byte off as if the recorder had been killed. */
+	rd = read(fds[0], buf, sizeof(buf));
+	close(fds[0]);
+	g_assert_cmpint(rd, >, 0);
+	gpiod_test_return_if_failed();
+
+	ret = pipe(fds);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	wr = write(fds[1], buf, rd - 1);
+	g_assert_cmpint(wr, ==, rd - 1);
+	close(fds[1]);
+
+	reader = gpiod_capture_reader_new(fds[0]);
+	g_assert_nonnull(reader);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_capture_reader_read(reader, events, 2);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].ts.tv_sec, ==, 1);
+
+	close(fds[0]);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_capture_reader_struct) reader = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_capture_writer *writer;
+	unsigned int offsets[] = { 3 };
+	struct gpiod_line_event_ext event;
+	gint ret, fds[2];
+	gssize wr;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = pipe(fds);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	writer = gpiod_capture_writer_new(fds[1], bulk);
+	g_assert_nonnull(writer);
+	gpiod_test_return_if_failed();
+
+	/* Event from a line not in the header. */
+	make_event(&event, 4, GPIOD_LINE_EVENT_RISING_EDGE, 1, 0);
+	ret = gpiod_capture_writer_add(writer, &event, 1);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	gpiod_capture_writer_free(writer);
+	close(fds[0]);
+	close(fds[1]);
+
+	ret = pipe(fds);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	wr = write(fds[1], "GPIOCAPX\1", 9);
+	g_assert_cmpint(wr, ==, 9);
+	close(fds[1]);
+
+	reader = gpiod_capture_reader_new(fds[0]);
+	g_assert_null(reader);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	close(fds[0]);
+}
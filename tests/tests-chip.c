@@ -193,6 +193,56 @@ GPIOD_TEST_CASE(get_all_lines, 0, { 4 })
 	g_assert_cmpuint(gpiod_line_offset(line3), ==, 3);
 }
 
+#define CHIP_THREADS_NUM_THREADS	8
+#define CHIP_THREADS_NUM_ITERATIONS	1000
+
+static gpointer chip_threads_func(gpointer data)
+{
+	struct gpiod_chip *chip = data;
+	struct gpiod_line **lines;
+	unsigned int i;
+
+	lines = g_new0(struct gpiod_line *, 16);
+
+	for (i = 0; i < CHIP_THREADS_NUM_ITERATIONS; i++) {
+		gpiod_chip_ref(chip);
+		lines[i % 16] = gpiod_chip_get_line(chip, i % 16);
+		gpiod_chip_unref(chip);
+	}
+
+	return lines;
+}
+
+GPIOD_TEST_CASE(get_line_threads, 0, { 16 })
+{
+	GThread *threads[CHIP_THREADS_NUM_THREADS];
+	struct gpiod_line **lines[CHIP_THREADS_NUM_THREADS];
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	guint i, j;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	for (i = 0; i < CHIP_THREADS_NUM_THREADS; i++)
+		threads[i] = g_thread_new("chip-user", chip_threads_func, chip);
+
+	for (i = 0; i < CHIP_THREADS_NUM_THREADS; i++)
+		lines[i] = g_thread_join(threads[i]);
+
+	/* Every thread must have seen the very same line objects. */
+	for (j = 0; j < 16; j++) {
+		g_assert_nonnull(lines[0][j]);
+		g_assert_cmpuint(gpiod_line_offset(lines[0][j]), ==, j);
+
+		for (i = 1; i < CHIP_THREADS_NUM_THREADS; i++)
+			g_assert_true(lines[i][j] == lines[0][j]);
+	}
+
+	for (i = 0; i < CHIP_THREADS_NUM_THREADS; i++)
+		g_free(lines[i]);
+}
+
 GPIOD_TEST_CASE(find_line_good, GPIOD_TEST_FLAG_NAMED_LINES, { 8, 8, 8 })
 {
 	g_autoptr(gpiod_chip_struct) chip = NULL;
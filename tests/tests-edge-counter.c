@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "edge-counter"
+
+static void wait_for_count(struct gpiod_edge_counter *cnt, guint line,
+			   unsigned long long expected)
+{
+	unsigned long long counts[3];
+	guint i;
+	gint ret;
+
+	/* The counting thread needs a moment to catch up. */
+	for (i = 0; i < 100; i++) {
+		ret = gpiod_edge_counter_read(cnt, counts, NULL);
+		g_assert_cmpint(ret, ==, 0);
+		if (counts[line] >= expected)
+			break;
+
+		g_usleep(10000);
+	}
+
+	g_assert_cmpuint(counts[line], ==, expected);
+}
+
+GPIOD_TEST_CASE(count_edges, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int offsets[] = { 1, 3, 5 };
+	struct timespec window = { 0, 50000000 };
+	unsigned long long counts[3];
+	struct gpiod_edge_counter *cnt;
+	double rates[3];
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 3);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	cnt = gpiod_edge_counter_new(bulk, &window);
+	g_assert_nonnull(cnt);
+	gpiod_test_return_if_failed();
+
+	g_assert_cmpuint(gpiod_edge_counter_num_lines(cnt), ==, 3);
+
+	gpiod_test_toggle_line(3, 5, 0);
+	wait_for_count(cnt, 1, 10);
+	gpiod_test_toggle_line(5, 2, 0);
+	wait_for_count(cnt, 2, 4);
+
+	ret = gpiod_edge_counter_read(cnt, counts, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(counts[0], ==, 0);
+	g_assert_cmpuint(counts[1], ==, 10);
+	g_assert_cmpuint(counts[2], ==, 4);
+
+	/* No edges during a full window bring the rates down to 0. */
+	g_usleep(150000);
+	ret = gpiod_edge_counter_read(cnt, NULL, rates);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_true(rates[0] == 0.0);
+	g_assert_true(rates[1] == 0.0);
+	g_assert_true(rates[2] == 0.0);
+
+	gpiod_edge_counter_free(cnt);
+}
+
+GPIOD_TEST_CASE(shared_event_fd, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int offsets[] = { 2, 4 };
+	struct timespec window = { 1, 0 };
+	struct gpiod_edge_counter *cnt;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_rising_edge_events_flags(bulk,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	cnt = gpiod_edge_counter_new(bulk, &window);
+	g_assert_nonnull(cnt);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_toggle_line(2, 3, 0);
+	wait_for_count(cnt, 0, 3);
+	gpiod_test_toggle_line(4, 1, 0);
+	wait_for_count(cnt, 1, 1);
+
+	gpiod_edge_counter_free(cnt);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_edge_counter_struct) cnt = NULL;
+	g_autoptr(gpiod_line_bulk_struct) empty = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int offsets[] = { 0, 1 };
+	struct timespec window = { 1, 0 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_input(bulk, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Not requested for events. */
+	cnt = gpiod_edge_counter_new(bulk, &window);
+	g_assert_null(cnt);
+	g_assert_cmpint(errno, ==, EPERM);
+
+	empty = gpiod_line_bulk_new(2);
+	g_assert_nonnull(empty);
+	gpiod_test_return_if_failed();
+
+	cnt = gpiod_edge_counter_new(empty, &window);
+	g_assert_null(cnt);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	window.tv_sec = 0;
+	cnt = gpiod_edge_counter_new(bulk, &window);
+	g_assert_null(cnt);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
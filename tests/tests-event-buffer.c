@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "event-buffer"
+
+static void wait_for_buffered(struct gpiod_event_buffer *buf,
+			      unsigned long long num)
+{
+	struct gpiod_event_buffer_stats stats;
+	guint i;
+
+	for (i = 0; i < 100; i++) {
+		gpiod_event_buffer_get_stats(buf, &stats);
+		if (stats.num_buffered + stats.num_dropped >= num)
+			return;
+
+		g_usleep(10000);
+	}
+}
+
+GPIOD_TEST_CASE(drop_oldest, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_event_buffer_stats stats;
+	struct gpiod_line_event_ext events[8];
+	struct gpiod_event_buffer *buf;
+	struct timespec ts = { 1, 0 };
+	unsigned int offset = 3;
+	gint ret, i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	buf = gpiod_event_buffer_new(4, GPIOD_EVENT_BUFFER_DROP_OLDEST);
+	g_assert_nonnull(buf);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_buffer_add(buf, bulk);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_buffer_start(buf);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_buffer_add(buf, bulk);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EBUSY);
+
+	for (i = 0; i < 6; i++) {
+		gpiod_test_chip_set_pull(0, 3, !(i % 2));
+		wait_for_buffered(buf, i + 1);
+	}
+
+	gpiod_event_buffer_get_stats(buf, &stats);
+	g_assert_cmpuint(stats.capacity, ==, 4);
+	g_assert_cmpuint(stats.num_pending, ==, 4);
+	g_assert_cmpuint(stats.high_watermark, ==, 4);
+	g_assert_cmpuint(stats.num_buffered, ==, 6);
+	g_assert_cmpuint(stats.num_dropped, ==, 2);
+
+	ret = gpiod_event_buffer_read(buf, &ts, events, 8);
+	g_assert_cmpint(ret, ==, 4);
+	g_assert_cmpuint(events[0].line_seqno, ==, 3);
+	g_assert_cmpuint(events[3].line_seqno, ==, 6);
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000;
+
+	ret = gpiod_event_buffer_read(buf, &ts, events, 8);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_event_buffer_free(buf);
+}
+
+GPIOD_TEST_CASE(drop_newest, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_event_buffer_stats stats;
+	struct gpiod_line_event_ext events[8];
+	struct gpiod_event_buffer *buf;
+	struct timespec ts = { 1, 0 };
+	unsigned int offset = 5;
+	gint ret, i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	buf = gpiod_event_buffer_new(2, GPIOD_EVENT_BUFFER_DROP_NEWEST);
+	g_assert_nonnull(buf);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_buffer_add(buf, bulk);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_buffer_start(buf);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	for (i = 0; i < 3; i++) {
+		gpiod_test_chip_set_pull(0, 5, !(i % 2));
+		wait_for_buffered(buf, i + 1);
+	}
+
+	ret = gpiod_event_buffer_read(buf, &ts, events, 8);
+	g_assert_cmpint(ret, ==, 2);
+	g_assert_cmpuint(events[0].line_seqno, ==, 1);
+	g_assert_cmpuint(events[1].line_seqno, ==, 2);
+
+	gpiod_event_buffer_get_stats(buf, &stats);
+	g_assert_cmpuint(stats.num_pending, ==, 0);
+	g_assert_cmpuint(stats.num_dropped, ==, 1);
+
+	gpiod_event_buffer_free(buf);
+}
+
+GPIOD_TEST_CASE(invalid_policy, 0, { 8 })
+{
+	struct gpiod_event_buffer *buf;
+
+	buf = gpiod_event_buffer_new(16, 0);
+	g_assert_null(buf);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
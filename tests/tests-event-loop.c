@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+#include <poll.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "event-loop"
+
+struct event_loop_counter {
+	guint num_events;
+	gint last_offset;
+	gint last_type;
+};
+
+static int event_loop_count(const struct gpiod_line_event_ext *events,
+			    unsigned int num_events, void *data)
+{
+	struct event_loop_counter *counter = data;
+
+	counter->num_events += num_events;
+	counter->last_offset = events[num_events - 1].offset;
+	counter->last_type = events[num_events - 1].event_type;
+
+	return GPIOD_EVENT_LOOP_CB_NEXT;
+}
+
+static int event_loop_stop(const struct gpiod_line_event_ext *events,
+			   unsigned int num_events, void *data)
+{
+	event_loop_count(events, num_events, data);
+
+	return GPIOD_EVENT_LOOP_CB_STOP;
+}
+
+GPIOD_TEST_CASE(dispatch_two_chips, 0, { 8, 8 })
+{
+	g_autoptr(gpiod_event_loop_struct) loop = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk0 = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk1 = NULL;
+	g_autoptr(gpiod_chip_struct) chip0 = NULL;
+	g_autoptr(gpiod_chip_struct) chip1 = NULL;
+	struct event_loop_counter cnt0 = { 0 }, cnt1 = { 0 };
+	struct timespec ts = { 1, 0 };
+	unsigned int offsets[] = { 1, 3 };
+	gint ret;
+
+	chip0 = gpiod_chip_open(gpiod_test_chip_path(0));
+	chip1 = gpiod_chip_open(gpiod_test_chip_path(1));
+	g_assert_nonnull(chip0);
+	g_assert_nonnull(chip1);
+	gpiod_test_return_if_failed();
+
+	bulk0 = gpiod_chip_get_lines(chip0, offsets, 2);
+	bulk1 = gpiod_chip_get_lines(chip1, offsets, 2);
+	g_assert_nonnull(bulk0);
+	g_assert_nonnull(bulk1);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk0,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_both_edges_events_flags(bulk1,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	loop = gpiod_event_loop_new();
+	g_assert_nonnull(loop);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_loop_add(loop, bulk0, event_loop_count, &cnt0);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_loop_add(loop, bulk1, event_loop_count, &cnt1);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(1, 3, 1);
+
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_DISPATCHED);
+	g_assert_cmpuint(cnt0.num_events, ==, 0);
+	g_assert_cmpuint(cnt1.num_events, ==, 1);
+	g_assert_cmpint(cnt1.last_offset, ==, 3);
+	g_assert_cmpint(cnt1.last_type, ==, GPIOD_LINE_EVENT_RISING_EDGE);
+
+	gpiod_test_chip_set_pull(0, 1, 1);
+
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_DISPATCHED);
+	g_assert_cmpuint(cnt0.num_events, ==, 1);
+	g_assert_cmpint(cnt0.last_offset, ==, 1);
+	g_assert_cmpuint(cnt1.num_events, ==, 1);
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000;
+
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_TIMEOUT);
+
+	ret = gpiod_event_loop_remove(loop, bulk0);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_loop_remove(loop, bulk1);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(add_twice, 0, { 8 })
+{
+	g_autoptr(gpiod_event_loop_struct) loop = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int offsets[] = { 2, 5 };
+	struct event_loop_counter cnt = { 0 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	loop = gpiod_event_loop_new();
+	g_assert_nonnull(loop);
+	gpiod_test_return_if_failed();
+
+	/* Lines not requested for events can't be watched. */
+	ret = gpiod_event_loop_add(loop, bulk, event_loop_count, &cnt);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EPERM);
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_loop_add(loop, bulk, event_loop_count, &cnt);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_event_loop_add(loop, bulk, event_loop_count, &cnt);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EBUSY);
+
+	ret = gpiod_event_loop_remove(loop, bulk);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(poll_loop_fd, 0, { 8 })
+{
+	g_autoptr(GpiodTestEventThread) ev_thread = NULL;
+	g_autoptr(gpiod_event_loop_struct) loop = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct event_loop_counter cnt = { 0 };
+	struct timespec ts = { 0, 0 };
+	unsigned int offset = 6;
+	struct pollfd pfd;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	loop = gpiod_event_loop_new();
+	g_assert_nonnull(loop);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_loop_add(loop, bulk, event_loop_count, &cnt);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ev_thread = gpiod_test_start_event_thread(0, 6, 100);
+
+	pfd.fd = gpiod_event_loop_get_fd(loop);
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	ret = poll(&pfd, 1, 1000);
+	g_assert_cmpint(ret, ==, 1);
+
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_DISPATCHED);
+	g_assert_cmpuint(cnt.num_events, ==, 1);
+	g_assert_cmpint(cnt.last_offset, ==, 6);
+
+	ret = gpiod_event_loop_remove(loop, bulk);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(wake_up_for_filtered_events, 0, { 8 })
+{
+	g_autoptr(gpiod_event_loop_struct) loop = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct event_loop_counter cnt = { 0 };
+	struct timespec stable = { 0, 100000000 };
+	struct timespec ts = { 0, 0 };
+	unsigned int offset = 2;
+	struct pollfd pfd;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_event_filter(gpiod_line_bulk_get_line(bulk, 0),
+					  &stable, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	loop = gpiod_event_loop_new();
+	g_assert_nonnull(loop);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_loop_add(loop, bulk, event_loop_count, &cnt);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 2, 1);
+
+	pfd.fd = gpiod_event_loop_get_fd(loop);
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+
+	/* The edge is read and held back until the line settles. */
+	ret = poll(&pfd, 1, 1000);
+	g_assert_cmpint(ret, ==, 1);
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_DISPATCHED);
+	g_assert_cmpuint(cnt.num_events, ==, 0);
+
+	/* The loop's descriptor becomes readable again once it's due. */
+	ret = poll(&pfd, 1, 1000);
+	g_assert_cmpint(ret, ==, 1);
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_DISPATCHED);
+	g_assert_cmpint(cnt.last_type, ==, GPIOD_LINE_EVENT_RISING_EDGE);
+}
+
+GPIOD_TEST_CASE(callback_stops_dispatch, 0, { 8 })
+{
+	g_autoptr(gpiod_event_loop_struct) loop = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct event_loop_counter cnt = { 0 };
+	struct timespec ts = { 1, 0 };
+	unsigned int offsets[] = { 1, 3 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	/* Separate descriptors - one per line. */
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	loop = gpiod_event_loop_new();
+	g_assert_nonnull(loop);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_loop_add(loop, bulk, event_loop_stop, &cnt);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 1, 1);
+	gpiod_test_chip_set_pull(0, 3, 1);
+	g_usleep(10000);
+
+	/* The second descriptor is left for the next call. */
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_STOPPED);
+	g_assert_cmpuint(cnt.num_events, ==, 1);
+
+	ret = gpiod_event_loop_dispatch(loop, &ts);
+	g_assert_cmpint(ret, ==, GPIOD_EVENT_LOOP_STOPPED);
+	g_assert_cmpuint(cnt.num_events, ==, 2);
+
+	ret = gpiod_event_loop_remove(loop, bulk);
+	g_assert_cmpint(ret, ==, 0);
+}
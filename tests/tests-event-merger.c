@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "event-merger"
+
+static guint64 event_ts_ns(const struct gpiod_line_event_ext *event)
+{
+	return event->ts.tv_sec * 1000000000ULL + event->ts.tv_nsec;
+}
+
+GPIOD_TEST_CASE(chronological_order, 0, { 8, 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk0 = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk1 = NULL;
+	g_autoptr(gpiod_chip_struct) chip0 = NULL;
+	g_autoptr(gpiod_chip_struct) chip1 = NULL;
+	struct timespec window = { 0, 50000000 };
+	struct gpiod_event_merger *merger;
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line_event_ext events[8];
+	unsigned int offsets0[] = { 0, 1 };
+	unsigned int offsets1[] = { 2, 3 };
+	gint ret, num = 0;
+
+	chip0 = gpiod_chip_open(gpiod_test_chip_path(0));
+	chip1 = gpiod_chip_open(gpiod_test_chip_path(1));
+	g_assert_nonnull(chip0);
+	g_assert_nonnull(chip1);
+	gpiod_test_return_if_failed();
+
+	bulk0 = gpiod_chip_get_lines(chip0, offsets0, 2);
+	bulk1 = gpiod_chip_get_lines(chip1, offsets1, 2);
+	g_assert_nonnull(bulk0);
+	g_assert_nonnull(bulk1);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk0,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_rising_edge_events_flags(bulk1,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	merger = gpiod_event_merger_new(&window);
+	g_assert_nonnull(merger);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_merger_add(merger, bulk1);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_merger_add(merger, bulk0);
+	g_assert_cmpint(ret, ==, 0);
+
+	/* Interleave events between the chips and lines. */
+	gpiod_test_chip_set_pull(0, 1, 1);
+	gpiod_test_chip_set_pull(1, 3, 1);
+	gpiod_test_chip_set_pull(0, 0, 1);
+	gpiod_test_chip_set_pull(1, 2, 1);
+
+	while (num < 4) {
+		ret = gpiod_event_merger_read(merger, &ts, &events[num],
+					      8 - num);
+		g_assert_cmpint(ret, >, 0);
+		if (ret <= 0)
+			break;
+
+		num += ret;
+	}
+
+	g_assert_cmpint(num, ==, 4);
+	g_assert_cmpint(events[0].offset, ==, 1);
+	g_assert_cmpint(events[1].offset, ==, 3);
+	g_assert_cmpint(events[2].offset, ==, 0);
+	g_assert_cmpint(events[3].offset, ==, 2);
+	g_assert_cmpuint(event_ts_ns(&events[0]), <=, event_ts_ns(&events[1]));
+	g_assert_cmpuint(event_ts_ns(&events[1]), <=, event_ts_ns(&events[2]));
+	g_assert_cmpuint(event_ts_ns(&events[2]), <=, event_ts_ns(&events[3]));
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000;
+
+	ret = gpiod_event_merger_read(merger, &ts, events, 8);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_event_merger_free(merger);
+}
+
+GPIOD_TEST_CASE(read_nothing_watched, 0, { 8 })
+{
+	g_autoptr(gpiod_event_merger_struct) merger = NULL;
+	struct gpiod_line_event_ext event;
+	gint ret;
+
+	merger = gpiod_event_merger_new(NULL);
+	g_assert_nonnull(merger);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_merger_read(merger, NULL, &event, 1);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
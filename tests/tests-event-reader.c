@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "event-reader"
+
+GPIOD_TEST_CASE(read_two_chips, 0, { 8, 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk0 = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk1 = NULL;
+	g_autoptr(gpiod_chip_struct) chip0 = NULL;
+	g_autoptr(gpiod_chip_struct) chip1 = NULL;
+	struct gpiod_event_reader *reader;
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line_event_ext events[8];
+	unsigned int offsets[] = { 0, 5 };
+	gint ret, backend;
+
+	chip0 = gpiod_chip_open(gpiod_test_chip_path(0));
+	chip1 = gpiod_chip_open(gpiod_test_chip_path(1));
+	g_assert_nonnull(chip0);
+	g_assert_nonnull(chip1);
+	gpiod_test_return_if_failed();
+
+	bulk0 = gpiod_chip_get_lines(chip0, offsets, 2);
+	bulk1 = gpiod_chip_get_lines(chip1, offsets, 2);
+	g_assert_nonnull(bulk0);
+	g_assert_nonnull(bulk1);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk0,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_both_edges_events(bulk1,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	reader = gpiod_event_reader_new();
+	g_assert_nonnull(reader);
+	gpiod_test_return_if_failed();
+
+	backend = gpiod_event_reader_backend(reader);
+	g_assert_true(backend == GPIOD_EVENT_READER_BACKEND_READ ||
+		      backend == GPIOD_EVENT_READER_BACKEND_IO_URING);
+
+	ret = gpiod_event_reader_add(reader, bulk0);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_reader_add(reader, bulk1);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_test_chip_set_pull(1, 5, 1);
+
+	ret = gpiod_event_reader_read(reader, &ts, events, 8);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].offset, ==, 5);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+
+	gpiod_test_chip_set_pull(0, 0, 1);
+	gpiod_test_chip_set_pull(0, 0, 0);
+
+	ret = gpiod_event_reader_read(reader, &ts, events, 1);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+
+	ret = gpiod_event_reader_read(reader, &ts, events, 8);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].offset, ==, 0);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_FALLING_EDGE);
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000;
+
+	ret = gpiod_event_reader_read(reader, &ts, events, 8);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_event_reader_free(reader);
+}
+
+GPIOD_TEST_CASE(read_nothing_watched, 0, { 8 })
+{
+	g_autoptr(gpiod_event_reader_struct) reader = NULL;
+	struct gpiod_line_event_ext event;
+	gint ret;
+
+	reader = gpiod_event_reader_new();
+	g_assert_nonnull(reader);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_reader_read(reader, NULL, &event, 1);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
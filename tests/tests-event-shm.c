@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+#include <string.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "event-shm"
+
+#define SHM_NAME "gpiod-test-event-shm"
+
+GPIOD_TEST_CASE(publish_lines, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_event_subscriber *sub1, *sub2;
+	struct gpiod_event_publisher *pub;
+	struct gpiod_line_event_ext events[4];
+	struct timespec ts = { 1, 0 };
+	unsigned int offset = 4;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	pub = gpiod_event_publisher_new(chip, SHM_NAME, 16);
+	g_assert_nonnull(pub);
+	gpiod_test_return_if_failed();
+
+	g_assert_null(gpiod_event_publisher_new(chip, SHM_NAME, 16));
+	g_assert_cmpint(errno, ==, EEXIST);
+
+	ret = gpiod_event_publisher_add(pub, bulk);
+	g_assert_cmpint(ret, ==, 0);
+
+	sub1 = gpiod_event_subscriber_open(SHM_NAME);
+	sub2 = gpiod_event_subscriber_open(SHM_NAME);
+	g_assert_nonnull(sub1);
+	g_assert_nonnull(sub2);
+	gpiod_test_return_if_failed();
+
+	g_assert_cmpstr(gpiod_event_subscriber_chip_name(sub1), ==,
+			gpiod_chip_get_name(chip));
+
+	gpiod_test_chip_set_pull(0, 4, 1);
+
+	ret = gpiod_event_publisher_dispatch(pub, &ts);
+	g_assert_cmpint(ret, ==, 1);
+
+	ret = gpiod_event_subscriber_read(sub1, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].offset, ==, 4);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+
+	ret = gpiod_event_subscriber_read(sub2, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].offset, ==, 4);
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000;
+
+	ret = gpiod_event_subscriber_read(sub1, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_event_subscriber_close(sub1);
+	gpiod_event_subscriber_close(sub2);
+	gpiod_event_publisher_free(pub);
+}
+
+GPIOD_TEST_CASE(slow_subscriber, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event_ext events[8], read[8];
+	struct gpiod_event_subscriber *sub;
+	struct gpiod_event_publisher *pub;
+	struct timespec ts = { 0, 100000 };
+	gint ret, i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	pub = gpiod_event_publisher_new(chip, SHM_NAME, 4);
+	g_assert_nonnull(pub);
+	gpiod_test_return_if_failed();
+
+	sub = gpiod_event_subscriber_open(SHM_NAME);
+	g_assert_nonnull(sub);
+	gpiod_test_return_if_failed();
+
+	memset(events, 0, sizeof(events));
+	for (i = 0; i < 6; i++) {
+		events[i].offset = i;
+		events[i].event_type = GPIOD_LINE_EVENT_RISING_EDGE;
+	}
+
+	ret = gpiod_event_publisher_publish(pub, events, 6);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_event_subscriber_read(sub, &ts, read, 8);
+	g_assert_cmpint(ret, ==, 4);
+	g_assert_cmpint(read[0].offset, ==, 2);
+	g_assert_cmpint(read[3].offset, ==, 5);
+	g_assert_cmpuint(gpiod_event_subscriber_num_lost(sub), ==, 2);
+
+	gpiod_event_subscriber_close(sub);
+	gpiod_event_publisher_free(pub);
+
+	g_assert_null(gpiod_event_subscriber_open(SHM_NAME));
+	g_assert_cmpint(errno, ==, ENOENT);
+}
@@ -0,0 +1,191 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "event-thread"
+
+static int count_events(const struct gpiod_line_event_ext *events G_GNUC_UNUSED,
+			unsigned int num_events, void *data)
+{
+	gint *count = data;
+
+	g_atomic_int_add(count, num_events);
+
+	return GPIOD_EVENT_LOOP_CB_NEXT;
+}
+
+static int stop_thread(const struct gpiod_line_event_ext *events G_GNUC_UNUSED,
+		       unsigned int num_events G_GNUC_UNUSED,
+		       void *data G_GNUC_UNUSED)
+{
+	return GPIOD_EVENT_LOOP_CB_STOP;
+}
+
+static void wait_for_count(gint *count, gint num)
+{
+	guint i;
+
+	for (i = 0; i < 100; i++) {
+		if (g_atomic_int_get(count) >= num)
+			return;
+
+		g_usleep(10000);
+	}
+}
+
+GPIOD_TEST_CASE(dispatch, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_event_thread_stats stats;
+	struct gpiod_event_thread *thread;
+	unsigned long long num_hist = 0;
+	unsigned int offset = 2;
+	gint ret, count = 0;
+	guint i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Whatever we're allowed to apply, the thread must run. */
+	thread = gpiod_event_thread_new(0, 1,
+					GPIOD_EVENT_THREAD_FLAG_LOCK_MEMORY);
+	g_assert_nonnull(thread);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_thread_add(thread, bulk, count_events, &count);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_thread_start(thread);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_thread_add(thread, bulk, count_events, &count);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EBUSY);
+
+	gpiod_test_chip_set_pull(0, 2, 1);
+	wait_for_count(&count, 1);
+	gpiod_test_chip_set_pull(0, 2, 0);
+	wait_for_count(&count, 2);
+
+	ret = gpiod_event_thread_stop(thread);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(count, ==, 2);
+
+	gpiod_event_thread_get_stats(thread, &stats);
+	g_assert_cmpuint(stats.num_events, ==, 2);
+	g_assert_cmpuint(stats.num_wakeups, >=, 1);
+	g_assert_cmpuint(stats.latency_min_ns, <=, stats.latency_avg_ns);
+	g_assert_cmpuint(stats.latency_avg_ns, <=, stats.latency_max_ns);
+
+	for (i = 0; i < GPIOD_EVENT_THREAD_NUM_BUCKETS; i++)
+		num_hist += stats.hist[i];
+	g_assert_cmpuint(num_hist, ==, 2);
+
+	gpiod_event_thread_free(thread);
+}
+
+GPIOD_TEST_CASE(no_rt_settings, 0, { 8 })
+{
+	g_autoptr(gpiod_event_thread_struct) thread = NULL;
+	gint ret;
+
+	thread = gpiod_event_thread_new(-1, 0, 0);
+	g_assert_nonnull(thread);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_thread_start(thread);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(gpiod_event_thread_rt_status(thread), ==, 0);
+
+	ret = gpiod_event_thread_stop(thread);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(callback_stops_thread, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_event_thread_stats stats;
+	struct gpiod_event_thread *thread;
+	unsigned int offset = 4;
+	gint ret;
+	guint i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	thread = gpiod_event_thread_new(-1, 0, 0);
+	g_assert_nonnull(thread);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_event_thread_add(thread, bulk, stop_thread, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_thread_start(thread);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 4, 1);
+
+	for (i = 0; i < 100; i++) {
+		gpiod_event_thread_get_stats(thread, &stats);
+		if (stats.num_events)
+			break;
+
+		g_usleep(10000);
+	}
+
+	/* The thread exited on its own - the next event isn't counted. */
+	g_usleep(10000);
+	gpiod_test_chip_set_pull(0, 4, 0);
+	gpiod_test_chip_set_pull(0, 4, 1);
+	g_usleep(10000);
+
+	gpiod_event_thread_get_stats(thread, &stats);
+	g_assert_cmpuint(stats.num_events, ==, 1);
+
+	ret = gpiod_event_thread_stop(thread);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_event_thread_free(thread);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	struct gpiod_event_thread *thread;
+
+	thread = gpiod_event_thread_new(-2, 0, 0);
+	g_assert_null(thread);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	thread = gpiod_event_thread_new(0, 100, 0);
+	g_assert_null(thread);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	thread = gpiod_event_thread_new(0, 0, GPIOD_BIT(7));
+	g_assert_null(thread);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
@@ -390,6 +390,113 @@ GPIOD_TEST_CASE(get_value, 0, { 8 })
 	g_assert_cmpint(ev.event_type, ==, GPIOD_LINE_EVENT_FALLING_EDGE);
 }
 
+GPIOD_TEST_CASE(get_value_input_cache, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line_event ev;
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 3);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 3, 0);
+
+	ret = gpiod_line_request_both_edges_events_flags(line,
+					GPIOD_TEST_CONSUMER,
+					GPIOD_LINE_REQUEST_FLAG_INPUT_CACHE);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_get_value(line);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_test_chip_set_pull(0, 3, 1);
+
+	ret = gpiod_line_event_wait(line, &ts);
+	g_assert_cmpint(ret, ==, 1);
+
+	/* The rising edge has not been consumed yet. */
+	ret = gpiod_line_get_value(line);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_line_event_read(line, &ev);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(ev.event_type, ==, GPIOD_LINE_EVENT_RISING_EDGE);
+
+	ret = gpiod_line_get_value(line);
+	g_assert_cmpint(ret, ==, 1);
+
+	gpiod_test_chip_set_pull(0, 3, 0);
+
+	ret = gpiod_line_event_wait(line, &ts);
+	g_assert_cmpint(ret, ==, 1);
+
+	ret = gpiod_line_event_read(line, &ev);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(ev.event_type, ==, GPIOD_LINE_EVENT_FALLING_EDGE);
+
+	ret = gpiod_line_get_value(line);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(get_value_input_cache_resync, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line_event ev;
+	struct gpiod_line *line;
+	gint ret, fd;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 3);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 3, 0);
+
+	ret = gpiod_line_request_both_edges_events_flags(line,
+					GPIOD_TEST_CONSUMER,
+					GPIOD_LINE_REQUEST_FLAG_INPUT_CACHE);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_get_value(line);
+	g_assert_cmpint(ret, ==, 0);
+
+	fd = gpiod_line_event_get_fd(line);
+	g_assert_cmpint(fd, >=, 0);
+
+	/* Consume the rising edge behind the library's back. */
+	gpiod_test_chip_set_pull(0, 3, 1);
+	ret = gpiod_line_event_wait(line, &ts);
+	g_assert_cmpint(ret, ==, 1);
+	ret = gpiod_line_event_read_fd(fd, &ev);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_test_chip_set_pull(0, 3, 0);
+	ret = gpiod_line_event_wait(line, &ts);
+	g_assert_cmpint(ret, ==, 1);
+	gpiod_test_chip_set_pull(0, 3, 1);
+
+	/* The seqno gap invalidates the cache and we query the kernel. */
+	ret = gpiod_line_event_read(line, &ev);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(ev.event_type, ==, GPIOD_LINE_EVENT_FALLING_EDGE);
+
+	ret = gpiod_line_get_value(line);
+	g_assert_cmpint(ret, ==, 1);
+}
+
 GPIOD_TEST_CASE(get_value_active_low, 0, { 8 })
 {
 	g_autoptr(GpiodTestEventThread) ev_thread = NULL;
@@ -595,6 +702,226 @@ GPIOD_TEST_CASE(wait_multiple, 0, { 8 })
 	g_assert_cmpint(ev.offset, ==, 4);
 }
 
+GPIOD_TEST_CASE(shared_event_fd, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event events[4];
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line *line0, *line1, *line2;
+	gint ret, fd;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line0 = gpiod_chip_get_line(chip, 1);
+	line1 = gpiod_chip_get_line(chip, 3);
+	line2 = gpiod_chip_get_line(chip, 5);
+	g_assert_nonnull(line0);
+	g_assert_nonnull(line1);
+	g_assert_nonnull(line2);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(3);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	gpiod_line_bulk_add_line(bulk, line0);
+	gpiod_line_bulk_add_line(bulk, line1);
+	gpiod_line_bulk_add_line(bulk, line2);
+
+	ret = gpiod_line_request_bulk_rising_edge_events_flags(bulk,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	fd = gpiod_line_event_get_fd(line0);
+	g_assert_cmpint(fd, >=, 0);
+	g_assert_cmpint(gpiod_line_event_get_fd(line1), ==, fd);
+	g_assert_cmpint(gpiod_line_event_get_fd(line2), ==, fd);
+
+	ret = gpiod_line_event_read_bulk(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_test_chip_set_pull(0, 5, 1);
+	gpiod_test_chip_set_pull(0, 1, 1);
+
+	ret = gpiod_line_event_read_bulk(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 2);
+	g_assert_cmpint(events[0].offset, ==, 5);
+	g_assert_cmpint(events[1].offset, ==, 1);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+	g_assert_cmpint(events[1].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+
+	gpiod_test_chip_set_pull(0, 3, 1);
+
+	ret = gpiod_line_event_read_bulk(bulk, NULL, events, 4);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].offset, ==, 3);
+}
+
+GPIOD_TEST_CASE(read_bulk_separate_fds, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event events[4];
+	struct timespec ts = { 1, 0 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 2));
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 4));
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 2, 1);
+	gpiod_test_chip_set_pull(0, 4, 1);
+
+	ret = gpiod_line_event_read_bulk(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 2);
+	g_assert_cmpint(events[0].offset, ==, 2);
+	g_assert_cmpint(events[1].offset, ==, 4);
+}
+
+GPIOD_TEST_CASE(nonblock_read_no_events, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event ev;
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 3);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_both_edges_events_flags(line,
+					GPIOD_TEST_CONSUMER,
+					GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_event_read(line, &ev);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EAGAIN);
+
+	gpiod_test_chip_set_pull(0, 3, 1);
+
+	ret = gpiod_line_event_read(line, &ev);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(ev.event_type, ==, GPIOD_LINE_EVENT_RISING_EDGE);
+}
+
+GPIOD_TEST_CASE(busy_poll, 0, { 8 })
+{
+	g_autoptr(GpiodTestEventThread) ev_thread = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec spin = { 0, 1000000 };
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line_event events[4];
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 2));
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 4));
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Blocking descriptors can't be busy-polled. */
+	ret = gpiod_line_event_read_bulk_busy_poll(bulk, &spin, &ts,
+						   events, 4);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	gpiod_line_release_bulk(bulk);
+
+	ret = gpiod_line_request_bulk_rising_edge_events_flags(bulk,
+					GPIOD_TEST_CONSUMER,
+					GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_event_read_bulk_busy_poll(bulk, &spin, &spin,
+						   events, 4);
+	g_assert_cmpint(ret, ==, 0);
+
+	ev_thread = gpiod_test_start_event_thread(0, 4, 100);
+
+	ret = gpiod_line_event_read_bulk_busy_poll(bulk, &spin, &ts,
+						   events, 4);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].offset, ==, 4);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+}
+
+GPIOD_TEST_CASE(seqno, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event_ext events[4];
+	unsigned int offsets[] = { 1, 6 };
+	struct timespec ts = { 1, 0 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events_flags(bulk,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 1, 1);
+	gpiod_test_chip_set_pull(0, 6, 1);
+	gpiod_test_chip_set_pull(0, 1, 0);
+
+	ret = gpiod_line_event_read_bulk_ext(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 3);
+	gpiod_test_return_if_failed();
+
+	g_assert_cmpuint(events[0].seqno, ==, 1);
+	g_assert_cmpuint(events[0].line_seqno, ==, 1);
+	g_assert_cmpuint(events[1].seqno, ==, 2);
+	g_assert_cmpuint(events[1].line_seqno, ==, 1);
+	g_assert_cmpuint(events[2].seqno, ==, 3);
+	g_assert_cmpuint(events[2].line_seqno, ==, 2);
+}
+
 GPIOD_TEST_CASE(get_fd_when_values_requested, 0, { 8 })
 {
 	g_autoptr(gpiod_chip_struct) chip = NULL;
@@ -906,3 +1233,382 @@ GPIOD_TEST_CASE(read_multiple_events_fd, 0, { 8 })
 	ret = gpiod_line_event_wait(line, &ts);
 	g_assert_cmpint(ret, ==, 0);
 }
+
+GPIOD_TEST_CASE(software_debounce, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event_filter_stats stats;
+	struct timespec stable = { 0, 200000000 };
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line_event_ext events[4];
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 2);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+	gpiod_line_bulk_add_line(bulk, line);
+
+	ret = gpiod_line_request_both_edges_events(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_event_filter(line, &stable, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Bounce before settling high. */
+	gpiod_test_chip_set_pull(0, 2, 1);
+	usleep(10000);
+	gpiod_test_chip_set_pull(0, 2, 0);
+	usleep(10000);
+	gpiod_test_chip_set_pull(0, 2, 1);
+
+	ret = gpiod_line_event_read_bulk_ext(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+	g_assert_cmpuint(events[0].line_seqno, ==, 3);
+
+	gpiod_line_get_event_filter_stats(line, &stats);
+	g_assert_cmpuint(stats.num_bounces, ==, 2);
+	g_assert_cmpuint(stats.num_glitches, ==, 0);
+
+	ts.tv_sec = 0;
+	ts.tv_nsec = 100000000;
+
+	ret = gpiod_line_event_read_bulk_ext(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(glitch_filter, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event_filter_stats stats;
+	struct timespec min_pulse = { 0, 200000000 };
+	struct timespec ts = { 0, 500000000 };
+	struct gpiod_line_event_ext events[4];
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 5);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+	gpiod_line_bulk_add_line(bulk, line);
+
+	ret = gpiod_line_request_both_edges_events(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_event_filter(line, NULL, &min_pulse);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* A short pulse never reaches the user. */
+	gpiod_test_chip_set_pull(0, 5, 1);
+	usleep(10000);
+	gpiod_test_chip_set_pull(0, 5, 0);
+
+	ret = gpiod_line_event_read_bulk_ext(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_line_get_event_filter_stats(line, &stats);
+	g_assert_cmpuint(stats.num_glitches, ==, 2);
+	g_assert_cmpuint(stats.num_bounces, ==, 0);
+
+	gpiod_test_chip_set_pull(0, 5, 1);
+
+	ret = gpiod_line_event_read_bulk_ext(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+	g_assert_cmpuint(events[0].line_seqno, ==, 3);
+}
+
+GPIOD_TEST_CASE(event_filter_deadline_nonblock, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec stable = { 0, 100000000 };
+	struct gpiod_line_event event;
+	struct timespec deadline, now;
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 4);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_both_edges_events_flags(line,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_event_filter(line, &stable, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_event_get_filter_deadline(line, &deadline);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_test_chip_set_pull(0, 4, 1);
+	usleep(10000);
+
+	/* The edge is held back and reading doesn't wait for it. */
+	ret = gpiod_line_event_read(line, &event);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EAGAIN);
+
+	ret = gpiod_line_event_get_filter_deadline(line, &deadline);
+	g_assert_cmpint(ret, ==, 1);
+	gpiod_test_return_if_failed();
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	g_assert_true(deadline.tv_sec > now.tv_sec ||
+		      (deadline.tv_sec == now.tv_sec &&
+		       deadline.tv_nsec > now.tv_nsec));
+
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+	ret = gpiod_line_event_read(line, &event);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(event.event_type, ==, GPIOD_LINE_EVENT_RISING_EDGE);
+
+	ret = gpiod_line_event_get_filter_deadline(line, &deadline);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(event_filter_not_requested_for_events, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec stable = { 0, 1000000 };
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 1);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_input(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_event_filter(line, &stable, NULL);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EPERM);
+}
+
+GPIOD_TEST_CASE(rate_limit, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event_limit_stats stats;
+	struct timespec ts = { 0, 100000000 };
+	struct gpiod_line_event_ext events[8];
+	struct gpiod_line *line;
+	guint i, num = 0;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 3);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+	gpiod_line_bulk_add_line(bulk, line);
+
+	ret = gpiod_line_request_both_edges_events(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_event_rate_limit(line, 1, 2);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	for (i = 0; i < 5; i++) {
+		gpiod_test_chip_set_pull(0, 3, !(i % 2));
+		usleep(10000);
+	}
+
+	do {
+		ret = gpiod_line_event_read_bulk_ext(bulk, &ts, events + num,
+						     8 - num);
+		g_assert_cmpint(ret, >=, 0);
+		num += ret;
+	} while (ret > 0 && num < 8);
+
+	/* The first two get through, the next ones exceed the limit. */
+	g_assert_cmpuint(num, ==, 2);
+	g_assert_cmpuint(events[0].line_seqno, ==, 1);
+	g_assert_cmpuint(events[1].line_seqno, ==, 2);
+
+	gpiod_line_get_event_limit_stats(line, &stats);
+	g_assert_cmpuint(stats.num_passed, ==, 2);
+	g_assert_cmpuint(stats.num_dropped, ==, 3);
+	g_assert_cmpuint(stats.num_coalesced, ==, 0);
+}
+
+GPIOD_TEST_CASE(coalescing, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_event_limit_stats stats;
+	struct timespec window = { 0, 200000000 };
+	struct timespec ts = { 1, 0 };
+	struct gpiod_line_event_ext events[4];
+	struct gpiod_line *line;
+	gint ret;
+	guint i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 6);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+	gpiod_line_bulk_add_line(bulk, line);
+
+	ret = gpiod_line_request_both_edges_events(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_event_coalescing(line, &window);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	for (i = 0; i < 3; i++) {
+		gpiod_test_chip_set_pull(0, 6, !(i % 2));
+		usleep(10000);
+	}
+
+	ret = gpiod_line_event_read_bulk_ext(bulk, &ts, events, 4);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(events[0].event_type, ==,
+			GPIOD_LINE_EVENT_RISING_EDGE);
+	g_assert_cmpuint(events[0].num_events, ==, 3);
+	g_assert_cmpuint(events[0].line_seqno, ==, 3);
+	g_assert_true(events[0].first_ts.tv_sec < events[0].ts.tv_sec ||
+		      (events[0].first_ts.tv_sec == events[0].ts.tv_sec &&
+		       events[0].first_ts.tv_nsec < events[0].ts.tv_nsec));
+
+	gpiod_line_get_event_limit_stats(line, &stats);
+	g_assert_cmpuint(stats.num_passed, ==, 1);
+	g_assert_cmpuint(stats.num_coalesced, ==, 2);
+	g_assert_cmpuint(stats.num_dropped, ==, 0);
+}
+
+GPIOD_TEST_CASE(wait_pattern, 0, { 8 })
+{
+	g_autoptr(GpiodTestEventThread) ev_thread = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec timeout = { 1, 0 }, ts = { 0, 0 };
+	unsigned int offsets[] = { 5, 7 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events(bulk,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 5, 1);
+
+	/* Matches right away. */
+	ret = gpiod_line_wait_pattern_bulk(bulk, 0x3, 0x1, &timeout, &ts);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_true(ts.tv_sec > 0 || ts.tv_nsec > 0);
+
+	/* Completed by the rising edge on line 7. */
+	ev_thread = gpiod_test_start_event_thread(0, 7, 100);
+
+	ret = gpiod_line_wait_pattern_bulk(bulk, 0x3, 0x3, &timeout, &ts);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 7), ==, 1);
+
+	/* Line 5 stays high. */
+	timeout.tv_sec = 0;
+	timeout.tv_nsec = 300000000;
+	ret = gpiod_line_wait_pattern_bulk(bulk, 0x1, 0x0, &timeout, NULL);
+	g_assert_cmpint(ret, ==, 0);
+}
+
+GPIOD_TEST_CASE(wait_pattern_invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec timeout = { 0, 10000000 };
+	unsigned int offsets[] = { 2, 3 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_rising_edge_events(bulk,
+							 GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Mask beyond the number of lines. */
+	ret = gpiod_line_wait_pattern_bulk(bulk, 0x4, 0x4, &timeout, NULL);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Bits outside of the mask. */
+	ret = gpiod_line_wait_pattern_bulk(bulk, 0x1, 0x2, &timeout, NULL);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Falling edges are not reported. */
+	ret = gpiod_line_wait_pattern_bulk(bulk, 0x1, 0x1, &timeout, NULL);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EPERM);
+}
@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "keypad"
+
+static void read_key_events(struct gpiod_keypad *keypad,
+			    struct gpiod_keypad_event *events, gint num)
+{
+	struct timespec timeout = { 1, 0 };
+	gint ret;
+
+	while (num > 0) {
+		ret = gpiod_keypad_read(keypad, &timeout, events, num);
+		g_assert_cmpint(ret, >, 0);
+		if (ret <= 0)
+			return;
+
+		events += ret;
+		num -= ret;
+	}
+}
+
+/*
+ * The mockup chip doesn't connect the rows with the columns, so a column
+ * pulled up reads as the keys in all rows of that column being pressed.
+ */
+GPIOD_TEST_CASE(press_and_release, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) rows = NULL;
+	g_autoptr(gpiod_line_bulk_struct) cols = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int row_offsets[] = { 0, 1 };
+	unsigned int col_offsets[] = { 4, 5, 6 };
+	struct timespec debounce = { 0, 5000000 };
+	struct gpiod_keypad_event events[2];
+	unsigned long long state[2];
+	struct gpiod_keypad *keypad;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	rows = gpiod_chip_get_lines(chip, row_offsets, 2);
+	cols = gpiod_chip_get_lines(chip, col_offsets, 3);
+	g_assert_nonnull(rows);
+	g_assert_nonnull(cols);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_output(rows, GPIOD_TEST_CONSUMER, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_both_edges_events_flags(cols,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	keypad = gpiod_keypad_new(rows, cols, &debounce);
+	g_assert_nonnull(keypad);
+	gpiod_test_return_if_failed();
+
+	/* All rows are active while idle. */
+	g_usleep(10000);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 0), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 1);
+
+	gpiod_test_chip_set_pull(0, 5, 1);
+	read_key_events(keypad, events, 2);
+
+	g_assert_cmpint(events[0].event_type, ==, GPIOD_KEYPAD_KEY_PRESS);
+	g_assert_cmpuint(events[0].row, ==, 0);
+	g_assert_cmpuint(events[0].col, ==, 1);
+	g_assert_cmpint(events[1].event_type, ==, GPIOD_KEYPAD_KEY_PRESS);
+	g_assert_cmpuint(events[1].row, ==, 1);
+	g_assert_cmpuint(events[1].col, ==, 1);
+
+	gpiod_keypad_get_state(keypad, state);
+	g_assert_cmpuint(state[0], ==, 2);
+	g_assert_cmpuint(state[1], ==, 2);
+
+	gpiod_test_chip_set_pull(0, 5, 0);
+	read_key_events(keypad, events, 2);
+
+	g_assert_cmpint(events[0].event_type, ==, GPIOD_KEYPAD_KEY_RELEASE);
+	g_assert_cmpuint(events[0].row, ==, 0);
+	g_assert_cmpuint(events[0].col, ==, 1);
+	g_assert_cmpint(events[1].event_type, ==, GPIOD_KEYPAD_KEY_RELEASE);
+	g_assert_cmpuint(events[1].row, ==, 1);
+	g_assert_cmpuint(events[1].col, ==, 1);
+
+	gpiod_keypad_get_state(keypad, state);
+	g_assert_cmpuint(state[0], ==, 0);
+	g_assert_cmpuint(state[1], ==, 0);
+
+	gpiod_keypad_free(keypad);
+
+	/* The rows are left active. */
+	g_assert_cmpint(gpiod_line_get_value(
+			gpiod_line_bulk_get_line(rows, 0)), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 1);
+}
+
+GPIOD_TEST_CASE(short_glitch_is_ignored, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) rows = NULL;
+	g_autoptr(gpiod_line_bulk_struct) cols = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int row_offsets[] = { 0 };
+	unsigned int col_offsets[] = { 4 };
+	struct timespec debounce = { 0, 200000000 };
+	struct timespec timeout = { 0, 300000000 };
+	struct gpiod_keypad_event event;
+	struct gpiod_keypad *keypad;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	rows = gpiod_chip_get_lines(chip, row_offsets, 1);
+	cols = gpiod_chip_get_lines(chip, col_offsets, 1);
+	g_assert_nonnull(rows);
+	g_assert_nonnull(cols);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_output(rows, GPIOD_TEST_CONSUMER, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_both_edges_events(cols,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	keypad = gpiod_keypad_new(rows, cols, &debounce);
+	g_assert_nonnull(keypad);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 4, 1);
+	g_usleep(20000);
+	gpiod_test_chip_set_pull(0, 4, 0);
+
+	ret = gpiod_keypad_read(keypad, &timeout, &event, 1);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_keypad_free(keypad);
+}
+
+GPIOD_TEST_CASE(lost_events_are_counted, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) rows = NULL;
+	g_autoptr(gpiod_line_bulk_struct) cols = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int row_offsets[] = { 0, 1 };
+	unsigned int col_offsets[] = { 4, 5, 6 };
+	struct timespec debounce = { 0, 5000000 };
+	struct timespec timeout = { 0, 0 };
+	struct gpiod_keypad_event events[80];
+	unsigned long long state[2];
+	struct gpiod_keypad *keypad;
+	gint ret, i, num = 0;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	rows = gpiod_chip_get_lines(chip, row_offsets, 2);
+	cols = gpiod_chip_get_lines(chip, col_offsets, 3);
+	g_assert_nonnull(rows);
+	g_assert_nonnull(cols);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_output(rows, GPIOD_TEST_CONSUMER, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_both_edges_events_flags(cols,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	keypad = gpiod_keypad_new(rows, cols, &debounce);
+	g_assert_nonnull(keypad);
+	gpiod_test_return_if_failed();
+
+	/* Each press and release of all columns queues six events. */
+	for (i = 0; i < 12; i++) {
+		gpiod_test_chip_set_pull(0, 4, !(i % 2));
+		gpiod_test_chip_set_pull(0, 5, !(i % 2));
+		gpiod_test_chip_set_pull(0, 6, !(i % 2));
+		g_usleep(30000);
+	}
+
+	gpiod_keypad_get_state(keypad, state);
+	g_assert_cmpuint(state[0], ==, 0);
+	g_assert_cmpuint(state[1], ==, 0);
+
+	do {
+		ret = gpiod_keypad_read(keypad, &timeout, events + num,
+					G_N_ELEMENTS(events) - num);
+		g_assert_cmpint(ret, >=, 0);
+		num += ret;
+	} while (ret > 0);
+
+	g_assert_cmpint(num, ==, 64);
+	g_assert_cmpuint(gpiod_keypad_num_lost(keypad), ==, 8);
+
+	gpiod_keypad_free(keypad);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_keypad_struct) keypad = NULL;
+	g_autoptr(gpiod_line_bulk_struct) rows = NULL;
+	g_autoptr(gpiod_line_bulk_struct) cols = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int row_offsets[] = { 0, 1 };
+	unsigned int col_offsets[] = { 4, 5 };
+	struct timespec debounce = { 0, 5000000 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	rows = gpiod_chip_get_lines(chip, row_offsets, 2);
+	cols = gpiod_chip_get_lines(chip, col_offsets, 2);
+	g_assert_nonnull(rows);
+	g_assert_nonnull(cols);
+	gpiod_test_return_if_failed();
+
+	/* Not requested. */
+	keypad = gpiod_keypad_new(rows, cols, &debounce);
+	g_assert_null(keypad);
+	g_assert_cmpint(errno, ==, EPERM);
+
+	ret = gpiod_line_request_bulk_output(rows, GPIOD_TEST_CONSUMER, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_line_request_bulk_both_edges_events(cols,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Columns not sharing a single file descriptor. */
+	keypad = gpiod_keypad_new(rows, cols, &debounce);
+	g_assert_null(keypad);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Rows and columns swapped. */
+	keypad = gpiod_keypad_new(cols, rows, &debounce);
+	g_assert_null(keypad);
+	g_assert_cmpint(errno, ==, EPERM);
+}
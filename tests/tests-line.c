@@ -305,6 +305,39 @@ GPIOD_TEST_CASE(set_value_bulk, 0, { 8 })
 	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 0);
 }
 
+GPIOD_TEST_CASE(set_value_bulk_mask, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int offsets[] = { 1, 3, 5 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 3);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_output(bulk, GPIOD_TEST_CONSUMER, NULL);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Bits outside of the mask are ignored. */
+	ret = gpiod_line_set_value_bulk_mask(bulk, 0x5, 0x7);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 3), ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 5), ==, 1);
+
+	ret = gpiod_line_set_value_bulk_mask(bulk, 0x3, 0x2);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 3), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 5), ==, 1);
+}
+
 GPIOD_TEST_CASE(set_config_bulk_null_values, 0, { 8 })
 {
 	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
@@ -656,6 +689,104 @@ GPIOD_TEST_CASE(output_value_caching, 0, { 8 })
 	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 0);
 }
 
+GPIOD_TEST_CASE(output_cache_skips_redundant_writes, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_request_config config;
+	struct gpiod_line_output_stats stats;
+	gint ret, vals[4];
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(4);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 0));
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 1));
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 2));
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 3));
+
+	memset(&config, 0, sizeof(config));
+	config.consumer = GPIOD_TEST_CONSUMER;
+	config.request_type = GPIOD_LINE_REQUEST_DIRECTION_OUTPUT;
+	config.flags = GPIOD_LINE_REQUEST_FLAG_OUTPUT_CACHE;
+
+	vals[0] = 0;
+	vals[1] = 1;
+	vals[2] = 0;
+	vals[3] = 1;
+
+	ret = gpiod_line_request_bulk(bulk, &config, vals);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Same values as requested - nothing should reach the kernel. */
+	ret = gpiod_line_set_value_bulk(bulk, vals);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_line_get_output_stats(gpiod_line_bulk_get_line(bulk, 0),
+					  &stats);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(stats.writes_issued, ==, 0);
+	g_assert_cmpuint(stats.writes_skipped, ==, 1);
+
+	/* Only the changed line is written, the other three are left alone. */
+	vals[2] = 1;
+	ret = gpiod_line_set_value_bulk(bulk, vals);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 0), ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 3), ==, 1);
+
+	ret = gpiod_line_get_output_stats(gpiod_line_bulk_get_line(bulk, 3),
+					  &stats);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(stats.writes_issued, ==, 1);
+	g_assert_cmpuint(stats.writes_skipped, ==, 1);
+}
+
+GPIOD_TEST_CASE(set_value_bulk_subset, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) subset = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	gint ret, vals[3];
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_line_bulk_new(3);
+	subset = gpiod_line_bulk_new(1);
+	g_assert_nonnull(bulk);
+	g_assert_nonnull(subset);
+	gpiod_test_return_if_failed();
+
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 1));
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 4));
+	gpiod_line_bulk_add_line(bulk, gpiod_chip_get_line(chip, 6));
+	gpiod_line_bulk_add_line(subset, gpiod_chip_get_line(chip, 6));
+
+	vals[0] = 1;
+	vals[1] = 1;
+	vals[2] = 0;
+
+	ret = gpiod_line_request_bulk_output(bulk, GPIOD_TEST_CONSUMER, vals);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_set_value_bulk(subset, vals);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 4), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 6), ==, 1);
+}
+
 GPIOD_TEST_CASE(direction, 0, { 8 })
 {
 	g_autoptr(gpiod_chip_struct) chip = NULL;
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "measurement"
+
+GPIOD_TEST_CASE(both_edges, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_measurement_data data;
+	struct gpiod_line_measurement *meas;
+	struct timespec window = { 10, 0 };
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 2);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_both_edges_events(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	meas = gpiod_line_measurement_new(line, &window);
+	g_assert_nonnull(meas);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_measurement_read(meas, &data);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(data.num_periods, ==, 0);
+	g_assert_true(data.frequency == 0.0);
+
+	/* Four rising edges delimit three periods of 20 ms. */
+	gpiod_test_toggle_line(2, 4, 10000);
+
+	ret = gpiod_line_measurement_read(meas, &data);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(data.num_periods, ==, 3);
+	g_assert_cmpuint(data.period_min_ns, >=, 20000000);
+	g_assert_cmpuint(data.period_min_ns, <=, data.period_avg_ns);
+	g_assert_cmpuint(data.period_avg_ns, <=, data.period_max_ns);
+	g_assert_true(data.frequency > 0.0 && data.frequency <= 50.0);
+	g_assert_true(data.duty_cycle > 0.0 && data.duty_cycle < 1.0);
+
+	gpiod_line_measurement_free(meas);
+}
+
+GPIOD_TEST_CASE(rising_edge_no_duty_cycle, 0, { 8 })
+{
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_line_measurement_data data;
+	struct gpiod_line_measurement *meas;
+	struct timespec window = { 10, 0 };
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 2);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_rising_edge_events(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	meas = gpiod_line_measurement_new(line, &window);
+	g_assert_nonnull(meas);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_toggle_line(2, 3, 10000);
+
+	ret = gpiod_line_measurement_read(meas, &data);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(data.num_periods, ==, 2);
+	g_assert_true(data.duty_cycle == 0.0);
+
+	gpiod_line_measurement_free(meas);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_line_measurement_struct) meas = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec window = { 0, 0 };
+	struct gpiod_line *line;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	line = gpiod_chip_get_line(chip, 2);
+	g_assert_nonnull(line);
+	gpiod_test_return_if_failed();
+
+	/* Not requested for events. */
+	window.tv_sec = 1;
+	meas = gpiod_line_measurement_new(line, &window);
+	g_assert_null(meas);
+	g_assert_cmpint(errno, ==, EPERM);
+
+	ret = gpiod_line_request_both_edges_events(line, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	window.tv_sec = 0;
+	meas = gpiod_line_measurement_new(line, &window);
+	g_assert_null(meas);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
+
+GPIOD_TEST_CASE(shared_event_fd, 0, { 8 })
+{
+	g_autoptr(gpiod_line_measurement_struct) meas = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec window = { 1, 0 };
+	guint offsets[] = { 2, 3 };
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_events(chip, offsets, 2);
+	gpiod_test_return_if_failed();
+
+	meas = gpiod_line_measurement_new(gpiod_line_bulk_get_line(bulk, 0),
+					  &window);
+	g_assert_null(meas);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
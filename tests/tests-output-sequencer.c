@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+#include <poll.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "output-sequencer"
+
+static guint output_offsets[] = { 2, 5 };
+
+static const struct gpiod_output_step test_steps[] = {
+	{
+		.time = { 0, 0 },
+		.mask = 0x3,
+		.bits = 0x1,
+	},
+	{
+		.time = { 0, 5000000 },
+		.mask = 0x1,
+		.bits = 0x0,
+	},
+	{
+		.time = { 0, 10000000 },
+		.mask = 0x2,
+		.bits = 0x2,
+	},
+};
+
+GPIOD_TEST_CASE(play_once, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_output_sequencer_stats stats;
+	struct gpiod_output_sequencer *seq;
+	struct timespec timeout = { 1, 0 };
+	struct pollfd pfd;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	seq = gpiod_output_sequencer_new(bulk, test_steps, 3, NULL);
+	g_assert_nonnull(seq);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_output_sequencer_start(seq, NULL, 1);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_output_sequencer_start(seq, NULL, 1);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EBUSY);
+
+	ret = gpiod_output_sequencer_wait(seq, &timeout);
+	g_assert_cmpint(ret, ==, 1);
+
+	pfd.fd = gpiod_output_sequencer_get_fd(seq);
+	pfd.events = POLLIN;
+	ret = poll(&pfd, 1, 0);
+	g_assert_cmpint(ret, ==, 1);
+
+	ret = gpiod_output_sequencer_stop(seq);
+	g_assert_cmpint(ret, ==, 0);
+
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 5), ==, 1);
+
+	gpiod_output_sequencer_get_stats(seq, &stats);
+	g_assert_cmpuint(stats.num_steps, ==, 3);
+	g_assert_cmpuint(stats.num_iterations, ==, 1);
+	g_assert_cmpuint(stats.lateness_avg_ns, <=, stats.lateness_max_ns);
+
+	gpiod_output_sequencer_free(seq);
+}
+
+GPIOD_TEST_CASE(loop, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_output_sequencer_stats stats;
+	struct timespec period = { 0, 15000000 };
+	struct timespec timeout = { 1, 0 };
+	struct gpiod_output_sequencer *seq;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	seq = gpiod_output_sequencer_new(bulk, test_steps, 3, &period);
+	g_assert_nonnull(seq);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_output_sequencer_start(seq, NULL, 3);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_output_sequencer_wait(seq, &timeout);
+	g_assert_cmpint(ret, ==, 1);
+	ret = gpiod_output_sequencer_stop(seq);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_output_sequencer_get_stats(seq, &stats);
+	g_assert_cmpuint(stats.num_steps, ==, 9);
+	g_assert_cmpuint(stats.num_iterations, ==, 3);
+
+	gpiod_output_sequencer_free(seq);
+}
+
+GPIOD_TEST_CASE(stop_endless_loop, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_output_sequencer_stats stats;
+	struct timespec period = { 0, 15000000 };
+	struct timespec timeout = { 0, 50000000 };
+	struct gpiod_output_sequencer *seq;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	seq = gpiod_output_sequencer_new(bulk, test_steps, 3, &period);
+	g_assert_nonnull(seq);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_output_sequencer_start(seq, NULL, 0);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_output_sequencer_wait(seq, &timeout);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_output_sequencer_stop(seq);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_output_sequencer_get_stats(seq, &stats);
+	g_assert_cmpuint(stats.num_iterations, >=, 1);
+
+	gpiod_output_sequencer_free(seq);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_output_sequencer_struct) seq = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 5000000 };
+	struct gpiod_output_step steps[2];
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	/* Steps out of order. */
+	steps[0] = test_steps[1];
+	steps[1] = test_steps[0];
+	seq = gpiod_output_sequencer_new(bulk, steps, 2, NULL);
+	g_assert_null(seq);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Mask selecting a line outside of the bulk. */
+	steps[0] = test_steps[0];
+	steps[0].mask = 0x4;
+	seq = gpiod_output_sequencer_new(bulk, steps, 1, NULL);
+	g_assert_null(seq);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Period shorter than the sequence. */
+	seq = gpiod_output_sequencer_new(bulk, test_steps, 3, &period);
+	g_assert_null(seq);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Looping without a period. */
+	seq = gpiod_output_sequencer_new(bulk, test_steps, 3, NULL);
+	g_assert_nonnull(seq);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_output_sequencer_start(seq, NULL, 0);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
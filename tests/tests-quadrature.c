@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+#include <poll.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "quadrature"
+
+static guint encoder_offsets[] = { 1, 2, 3 };
+
+static void decode_events(struct gpiod_quadrature_encoder *enc, gint num)
+{
+	struct pollfd pfd;
+	gint ret;
+
+	pfd.fd = gpiod_quadrature_encoder_get_fd(enc);
+	pfd.events = POLLIN;
+
+	while (num > 0) {
+		ret = poll(&pfd, 1, 1000);
+		g_assert_cmpint(ret, ==, 1);
+		if (ret != 1)
+			return;
+
+		ret = gpiod_quadrature_encoder_read(enc);
+		g_assert_cmpint(ret, >, 0);
+		if (ret <= 0)
+			return;
+
+		num -= ret;
+	}
+}
+
+GPIOD_TEST_CASE(count_both_directions, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_quadrature_snapshot snap;
+	struct gpiod_quadrature_encoder *enc;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_events(chip, encoder_offsets, 3);
+	gpiod_test_return_if_failed();
+
+	enc = gpiod_quadrature_encoder_new(bulk, 0, 1, 2);
+	g_assert_nonnull(enc);
+	gpiod_test_return_if_failed();
+
+	/* One full cycle forward... */
+	gpiod_test_chip_set_pull(0, 1, 1);
+	gpiod_test_chip_set_pull(0, 2, 1);
+	gpiod_test_chip_set_pull(0, 1, 0);
+	gpiod_test_chip_set_pull(0, 2, 0);
+	decode_events(enc, 4);
+
+	gpiod_quadrature_encoder_snapshot(enc, &snap);
+	g_assert_cmpint(snap.position, ==, 4);
+
+	/* ...an index pulse... */
+	gpiod_test_chip_set_pull(0, 3, 1);
+	gpiod_test_chip_set_pull(0, 3, 0);
+	decode_events(enc, 2);
+
+	/* ...and half a cycle back. */
+	gpiod_test_chip_set_pull(0, 2, 1);
+	gpiod_test_chip_set_pull(0, 1, 1);
+	decode_events(enc, 2);
+
+	gpiod_quadrature_encoder_snapshot(enc, &snap);
+	g_assert_cmpint(snap.position, ==, 2);
+	g_assert_cmpuint(snap.num_index, ==, 1);
+	g_assert_cmpint(snap.index_position, ==, 4);
+	g_assert_cmpuint(snap.num_invalid, ==, 0);
+	g_assert_cmpuint(snap.num_missed, ==, 0);
+
+	gpiod_quadrature_encoder_free(enc);
+}
+
+GPIOD_TEST_CASE(velocity_decays, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_quadrature_snapshot snap;
+	struct gpiod_quadrature_encoder *enc;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_events(chip, encoder_offsets, 3);
+	gpiod_test_return_if_failed();
+
+	enc = gpiod_quadrature_encoder_new(bulk, 0, 1, -1);
+	g_assert_nonnull(enc);
+	gpiod_test_return_if_failed();
+
+	/* Spread a full cycle over more than one velocity window. */
+	gpiod_test_chip_set_pull(0, 1, 1);
+	g_usleep(6000);
+	gpiod_test_chip_set_pull(0, 2, 1);
+	g_usleep(6000);
+	gpiod_test_chip_set_pull(0, 1, 0);
+	g_usleep(6000);
+	gpiod_test_chip_set_pull(0, 2, 0);
+	decode_events(enc, 4);
+
+	gpiod_quadrature_encoder_snapshot(enc, &snap);
+	g_assert_cmpint(snap.position, ==, 4);
+	g_assert_cmpint(snap.velocity, >, 0);
+
+	g_usleep(20000);
+
+	gpiod_quadrature_encoder_snapshot(enc, &snap);
+	g_assert_cmpint(snap.position, ==, 4);
+	g_assert_cmpint(snap.velocity, ==, 0);
+
+	gpiod_quadrature_encoder_free(enc);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_quadrature_encoder_struct) enc = NULL;
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int offsets[] = { 4, 5 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	enc = gpiod_quadrature_encoder_new(bulk, 0, 0, -1);
+	g_assert_null(enc);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Not requested for both edges. */
+	enc = gpiod_quadrature_encoder_new(bulk, 0, 1, -1);
+	g_assert_null(enc);
+	g_assert_cmpint(errno, ==, EPERM);
+
+	/* Not sharing a single file descriptor. */
+	ret = gpiod_line_request_bulk_both_edges_events(bulk,
+							GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	enc = gpiod_quadrature_encoder_new(bulk, 0, 1, -1);
+	g_assert_null(enc);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+#include <string.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "reflex"
+
+static gint read_log(struct gpiod_reflex *reflex,
+		     struct gpiod_reflex_trigger *triggers, gint num)
+{
+	gint ret, total = 0;
+	guint i;
+
+	/* The event thread needs a moment to react. */
+	for (i = 0; i < 100 && total < num; i++) {
+		ret = gpiod_reflex_read_log(reflex, triggers + total,
+					    num - total);
+		g_assert_cmpint(ret, >=, 0);
+		if (ret < 0)
+			break;
+
+		total += ret;
+		if (total < num)
+			g_usleep(10000);
+	}
+
+	return total;
+}
+
+GPIOD_TEST_CASE(drive_outputs, 0, { 8 })
+{
+	g_autoptr(gpiod_event_thread_struct) thread = NULL;
+	g_autoptr(gpiod_line_bulk_struct) outputs = NULL;
+	g_autoptr(gpiod_line_bulk_struct) inputs = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int in_offsets[] = { 0, 1 }, out_offsets[] = { 4, 5 };
+	struct gpiod_reflex_trigger triggers[4];
+	struct gpiod_reflex_rule rules[2];
+	struct gpiod_reflex_stats stats;
+	struct gpiod_reflex *reflex;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 0, 1);
+
+	inputs = gpiod_test_request_events(chip, in_offsets, 2);
+	outputs = gpiod_test_request_outputs(chip, out_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	memset(rules, 0, sizeof(rules));
+	/* When input 0 goes low, drive output 0 high... */
+	rules[0].input = 0;
+	rules[0].edge = GPIOD_LINE_EVENT_FALLING_EDGE;
+	rules[0].mask = 0x1;
+	rules[0].bits = 0x1;
+	/* ...and when it goes high again with input 1 high, drive it low. */
+	rules[1].input = 0;
+	rules[1].edge = GPIOD_LINE_EVENT_RISING_EDGE;
+	rules[1].in_mask = 0x2;
+	rules[1].in_bits = 0x2;
+	rules[1].mask = 0x3;
+	rules[1].bits = 0x2;
+
+	reflex = gpiod_reflex_new(inputs, outputs, rules, 2, 4);
+	g_assert_nonnull(reflex);
+	gpiod_test_return_if_failed();
+
+	thread = gpiod_event_thread_new(-1, 0, 0);
+	g_assert_nonnull(thread);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_reflex_attach(reflex, thread);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_thread_start(thread);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 0, 0);
+	ret = read_log(reflex, triggers, 1);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpuint(triggers[0].rule, ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 4), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 5), ==, 0);
+
+	/* Input 1 is low - the condition doesn't hold. */
+	gpiod_test_chip_set_pull(0, 0, 1);
+	gpiod_test_chip_set_pull(0, 0, 0);
+	ret = read_log(reflex, triggers, 1);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpuint(triggers[0].rule, ==, 0);
+
+	gpiod_test_chip_set_pull(0, 1, 1);
+	gpiod_test_chip_set_pull(0, 0, 1);
+	ret = read_log(reflex, triggers, 1);
+	g_assert_cmpint(ret, ==, 1);
+	g_assert_cmpuint(triggers[0].rule, ==, 1);
+	g_assert_true(triggers[0].output_ts.tv_sec > 0 ||
+		      triggers[0].output_ts.tv_nsec > 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 4), ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 5), ==, 1);
+
+	ret = gpiod_event_thread_stop(thread);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_reflex_get_stats(reflex, &stats);
+	g_assert_cmpuint(stats.num_triggers, ==, 3);
+	g_assert_cmpuint(stats.num_lost, ==, 0);
+	g_assert_cmpuint(stats.reaction_min_ns, <=, stats.reaction_avg_ns);
+	g_assert_cmpuint(stats.reaction_avg_ns, <=, stats.reaction_max_ns);
+
+	gpiod_reflex_free(reflex);
+}
+
+GPIOD_TEST_CASE(log_overflow, 0, { 8 })
+{
+	g_autoptr(gpiod_event_thread_struct) thread = NULL;
+	g_autoptr(gpiod_line_bulk_struct) outputs = NULL;
+	g_autoptr(gpiod_line_bulk_struct) inputs = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int in_offsets[] = { 0, 1 }, out_offsets[] = { 4, 5 };
+	struct gpiod_reflex_trigger triggers[4];
+	struct gpiod_reflex_rule rule;
+	struct gpiod_reflex_stats stats;
+	struct gpiod_reflex *reflex;
+	gint ret, i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	inputs = gpiod_test_request_events(chip, in_offsets, 2);
+	outputs = gpiod_test_request_outputs(chip, out_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	memset(&rule, 0, sizeof(rule));
+	rule.input = 0;
+	rule.edge = GPIOD_LINE_EVENT_RISING_EDGE;
+	rule.mask = 0x1;
+	rule.bits = 0x1;
+
+	reflex = gpiod_reflex_new(inputs, outputs, &rule, 1, 2);
+	g_assert_nonnull(reflex);
+	gpiod_test_return_if_failed();
+
+	thread = gpiod_event_thread_new(-1, 0, 0);
+	g_assert_nonnull(thread);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_reflex_attach(reflex, thread);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_event_thread_start(thread);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	/* Nobody reads the log - only the first two triggers fit in it. */
+	gpiod_test_toggle_line(0, 5, 5000);
+
+	for (i = 0; i < 100; i++) {
+		gpiod_reflex_get_stats(reflex, &stats);
+		if (stats.num_triggers == 5)
+			break;
+
+		g_usleep(10000);
+	}
+
+	ret = gpiod_event_thread_stop(thread);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_reflex_get_stats(reflex, &stats);
+	g_assert_cmpuint(stats.num_triggers, ==, 5);
+	g_assert_cmpuint(stats.num_lost, ==, 3);
+
+	ret = gpiod_reflex_read_log(reflex, triggers, 4);
+	g_assert_cmpint(ret, ==, 2);
+
+	/* The outputs were driven even though the triggers were lost. */
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 4), ==, 1);
+
+	gpiod_reflex_free(reflex);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) outputs = NULL;
+	g_autoptr(gpiod_line_bulk_struct) inputs = NULL;
+	g_autoptr(gpiod_reflex_struct) reflex = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int in_offsets[] = { 0, 1 }, out_offsets[] = { 4, 5 };
+	struct gpiod_reflex_rule rule;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	inputs = gpiod_test_request_events(chip, in_offsets, 2);
+	outputs = gpiod_test_request_outputs(chip, out_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	memset(&rule, 0, sizeof(rule));
+	rule.input = 2;
+	rule.edge = GPIOD_LINE_EVENT_RISING_EDGE;
+	rule.mask = 0x1;
+
+	/* No such input line. */
+	reflex = gpiod_reflex_new(inputs, outputs, &rule, 1, 4);
+	g_assert_null(reflex);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* No such output line. */
+	rule.input = 1;
+	rule.mask = 0x4;
+	reflex = gpiod_reflex_new(inputs, outputs, &rule, 1, 4);
+	g_assert_null(reflex);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Outputs as inputs. */
+	rule.mask = 0x1;
+	reflex = gpiod_reflex_new(outputs, inputs, &rule, 1, 4);
+	g_assert_null(reflex);
+	g_assert_cmpint(errno, ==, EPERM);
+}
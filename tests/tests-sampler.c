@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "sampler"
+
+GPIOD_TEST_CASE(sample_values, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 2000000 };
+	struct timespec timeout = { 1, 0 };
+	unsigned int offsets[] = { 1, 3, 6 };
+	struct gpiod_sampler_stats stats;
+	struct gpiod_sample samples[8];
+	struct gpiod_sampler *sampler;
+	gint ret, num = 0;
+	guint i;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 3);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_input(bulk, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 3, 1);
+	gpiod_test_chip_set_pull(0, 6, 1);
+
+	sampler = gpiod_sampler_new(bulk, &period, 64);
+	g_assert_nonnull(sampler);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_sampler_start(sampler);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_sampler_start(sampler);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EBUSY);
+
+	while (num < 8) {
+		ret = gpiod_sampler_read(sampler, &timeout,
+					 samples + num, 8 - num);
+		g_assert_cmpint(ret, >, 0);
+		if (ret <= 0)
+			break;
+
+		num += ret;
+	}
+
+	ret = gpiod_sampler_stop(sampler);
+	g_assert_cmpint(ret, ==, 0);
+
+	for (i = 0; i < 8; i++) {
+		g_assert_cmpuint(samples[i].bits, ==, 0x6);
+		if (i > 0)
+			g_assert_cmpuint(samples[i].timestamp_ns, >,
+					 samples[i - 1].timestamp_ns);
+	}
+
+	gpiod_sampler_get_stats(sampler, &stats);
+	g_assert_cmpuint(stats.num_samples, >=, 8);
+	g_assert_cmpuint(stats.jitter_avg_ns, <=, stats.jitter_max_ns);
+
+	gpiod_sampler_free(sampler);
+}
+
+GPIOD_TEST_CASE(ring_full, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 1000000 };
+	struct timespec timeout = { 0, 0 };
+	struct gpiod_sampler_stats stats;
+	struct gpiod_sample samples[8];
+	struct gpiod_sampler *sampler;
+	unsigned int offset = 2;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_input(bulk, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	sampler = gpiod_sampler_new(bulk, &period, 4);
+	g_assert_nonnull(sampler);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_sampler_start(sampler);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	g_usleep(50000);
+
+	ret = gpiod_sampler_stop(sampler);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_sampler_read(sampler, &timeout, samples, 8);
+	g_assert_cmpint(ret, ==, 4);
+	ret = gpiod_sampler_read(sampler, &timeout, samples, 8);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_sampler_get_stats(sampler, &stats);
+	g_assert_cmpuint(stats.num_dropped, >, 0);
+	g_assert_cmpuint(stats.num_dropped, ==, stats.num_samples - 4);
+
+	gpiod_sampler_free(sampler);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_sampler_struct) sampler = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 0 };
+	unsigned int offset = 2;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	sampler = gpiod_sampler_new(bulk, &period, 16);
+	g_assert_null(sampler);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	/* Not requested. */
+	period.tv_nsec = 1000000;
+	sampler = gpiod_sampler_new(bulk, &period, 16);
+	g_assert_null(sampler);
+	g_assert_cmpint(errno, ==, EPERM);
+}
@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "soft-pwm"
+
+static guint output_offsets[] = { 1, 2, 4, 6 };
+
+GPIOD_TEST_CASE(constant_levels, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 5000000 };
+	struct gpiod_soft_pwm_stats stats;
+	struct gpiod_soft_pwm *pwm;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 3);
+	gpiod_test_return_if_failed();
+
+	pwm = gpiod_soft_pwm_new(bulk, &period, NULL);
+	g_assert_nonnull(pwm);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_soft_pwm_set_duty(pwm, 0, GPIOD_SOFT_PWM_DUTY_MAX);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_soft_pwm_set_duty(pwm, 2, GPIOD_SOFT_PWM_DUTY_MAX / 2);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(gpiod_soft_pwm_get_duty(pwm, 2), ==,
+			 GPIOD_SOFT_PWM_DUTY_MAX / 2);
+
+	ret = gpiod_soft_pwm_start(pwm);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_soft_pwm_start(pwm);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EBUSY);
+
+	g_usleep(50000);
+
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 1);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 0);
+
+	ret = gpiod_soft_pwm_stop(pwm);
+	g_assert_cmpint(ret, ==, 0);
+
+	/* All channels are left inactive. */
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 4), ==, 0);
+
+	gpiod_soft_pwm_get_stats(pwm, &stats);
+	g_assert_cmpuint(stats.num_periods, >, 0);
+	g_assert_cmpuint(stats.jitter_avg_ns, <=, stats.jitter_max_ns);
+
+	gpiod_soft_pwm_free(pwm);
+}
+
+GPIOD_TEST_CASE(edges_merged, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 5000000 };
+	struct gpiod_soft_pwm_stats stats;
+	struct gpiod_soft_pwm *pwm;
+	guint i;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 4);
+	gpiod_test_return_if_failed();
+
+	pwm = gpiod_soft_pwm_new(bulk, &period, NULL);
+	g_assert_nonnull(pwm);
+	gpiod_test_return_if_failed();
+
+	for (i = 0; i < 4; i++)
+		gpiod_soft_pwm_set_duty(pwm, i, GPIOD_SOFT_PWM_DUTY_MAX / 4);
+
+	ret = gpiod_soft_pwm_start(pwm);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	g_usleep(50000);
+
+	ret = gpiod_soft_pwm_stop(pwm);
+	g_assert_cmpint(ret, ==, 0);
+
+	/* One write switching all lines on and one switching them off. */
+	gpiod_soft_pwm_get_stats(pwm, &stats);
+	g_assert_cmpuint(stats.num_periods, >, 0);
+	g_assert_cmpuint(stats.num_writes, <=, 2 * (stats.num_periods + 1));
+
+	gpiod_soft_pwm_free(pwm);
+}
+
+GPIOD_TEST_CASE(overruns_and_restart, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 2000 };
+	struct gpiod_soft_pwm_stats stats;
+	struct gpiod_soft_pwm *pwm;
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	pwm = gpiod_soft_pwm_new(bulk, &period, NULL);
+	g_assert_nonnull(pwm);
+	gpiod_test_return_if_failed();
+
+	/* Two writes per period can't keep up with a 2us period. */
+	ret = gpiod_soft_pwm_set_duty(pwm, 0, GPIOD_SOFT_PWM_DUTY_MAX / 2);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_soft_pwm_start(pwm);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	g_usleep(20000);
+
+	ret = gpiod_soft_pwm_stop(pwm);
+	g_assert_cmpint(ret, ==, 0);
+
+	gpiod_soft_pwm_get_stats(pwm, &stats);
+	g_assert_cmpuint(stats.num_overruns, >, 0);
+
+	/* Stopping twice is fine and the PWM can be started again. */
+	ret = gpiod_soft_pwm_stop(pwm);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_soft_pwm_set_duty(pwm, 0, 0);
+	g_assert_cmpint(ret, ==, 0);
+	ret = gpiod_soft_pwm_set_duty(pwm, 1, GPIOD_SOFT_PWM_DUTY_MAX);
+	g_assert_cmpint(ret, ==, 0);
+
+	ret = gpiod_soft_pwm_start(pwm);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	g_usleep(20000);
+
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 1), ==, 0);
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 1);
+
+	ret = gpiod_soft_pwm_stop(pwm);
+	g_assert_cmpint(ret, ==, 0);
+
+	g_assert_cmpint(gpiod_test_chip_get_value(0, 2), ==, 0);
+
+	gpiod_soft_pwm_free(pwm);
+}
+
+GPIOD_TEST_CASE(invalid_arguments, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_soft_pwm_struct) pwm = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct timespec period = { 0, 1000000 };
+	struct timespec resolution = { 0, 2000000 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_test_request_outputs(chip, output_offsets, 2);
+	gpiod_test_return_if_failed();
+
+	pwm = gpiod_soft_pwm_new(bulk, &period, &resolution);
+	g_assert_null(pwm);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	pwm = gpiod_soft_pwm_new(bulk, &period, NULL);
+	g_assert_nonnull(pwm);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_soft_pwm_set_duty(pwm, 2, 0);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+
+	ret = gpiod_soft_pwm_set_duty(pwm, 0, GPIOD_SOFT_PWM_DUTY_MAX + 1);
+	g_assert_cmpint(ret, ==, -1);
+	g_assert_cmpint(errno, ==, EINVAL);
+}
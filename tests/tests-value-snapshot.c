@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+// SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
+
+#include <errno.h>
+
+#include "gpiod-test.h"
+
+#define GPIOD_TEST_GROUP "value-snapshot"
+
+#define SHM_NAME "gpiod-test-value-snapshot"
+
+/* Wait until the snapshot has been updated with the expected bits. */
+static gboolean wait_for_bits(struct gpiod_value_snapshot *snap,
+			      unsigned long long bits)
+{
+	struct gpiod_value_snapshot_data data;
+	guint i;
+
+	for (i = 0; i < 100; i++) {
+		if (gpiod_value_snapshot_read(snap, &data))
+			return FALSE;
+		if (data.bits == bits)
+			return TRUE;
+
+		g_usleep(10000);
+	}
+
+	return FALSE;
+}
+
+GPIOD_TEST_CASE(periodic_shared, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_value_snapshot *snap, *view;
+	struct gpiod_value_snapshot_data data;
+	struct timespec period = { 0, 1000000 };
+	unsigned int offsets[] = { 1, 3, 6 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 3);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_input(bulk, GPIOD_TEST_CONSUMER);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	snap = gpiod_value_snapshot_new(bulk, GPIOD_VALUE_SNAPSHOT_PERIODIC,
+					&period, SHM_NAME);
+	g_assert_nonnull(snap);
+	gpiod_test_return_if_failed();
+
+	view = gpiod_value_snapshot_open(SHM_NAME);
+	g_assert_nonnull(view);
+	gpiod_test_return_if_failed();
+
+	g_assert_cmpstr(gpiod_value_snapshot_chip_name(view), ==,
+			gpiod_chip_get_name(chip));
+	g_assert_cmpint(gpiod_value_snapshot_offset(view, 1), ==, 3);
+	g_assert_cmpint(gpiod_value_snapshot_offset(view, 3), ==, -1);
+
+	ret = gpiod_value_snapshot_read(view, &data);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(data.num_lines, ==, 3);
+	g_assert_cmpuint(data.bits, ==, 0);
+	g_assert_cmpuint(data.generation, >, 0);
+
+	gpiod_test_chip_set_pull(0, 6, 1);
+	g_assert_true(wait_for_bits(view, 0x4));
+
+	gpiod_test_chip_set_pull(0, 1, 1);
+	g_assert_true(wait_for_bits(snap, 0x5));
+
+	/* A failed attempt to reuse the name must not unlink the object. */
+	g_assert_null(gpiod_value_snapshot_new(bulk,
+					       GPIOD_VALUE_SNAPSHOT_PERIODIC,
+					       &period, SHM_NAME));
+	g_assert_cmpint(errno, ==, EEXIST);
+	gpiod_value_snapshot_free(view);
+	view = gpiod_value_snapshot_open(SHM_NAME);
+	g_assert_nonnull(view);
+
+	gpiod_value_snapshot_free(view);
+	gpiod_value_snapshot_free(snap);
+}
+
+GPIOD_TEST_CASE(on_events, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	struct gpiod_value_snapshot_data data;
+	struct gpiod_value_snapshot *snap;
+	unsigned int offsets[] = { 2, 5 };
+	gint ret;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, offsets, 2);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	ret = gpiod_line_request_bulk_both_edges_events_flags(bulk,
+				GPIOD_TEST_CONSUMER,
+				GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD);
+	g_assert_cmpint(ret, ==, 0);
+	gpiod_test_return_if_failed();
+
+	snap = gpiod_value_snapshot_new(bulk, GPIOD_VALUE_SNAPSHOT_ON_EVENTS,
+					NULL, NULL);
+	g_assert_nonnull(snap);
+	gpiod_test_return_if_failed();
+
+	gpiod_test_chip_set_pull(0, 5, 1);
+	g_assert_true(wait_for_bits(snap, 0x2));
+
+	gpiod_test_chip_set_pull(0, 2, 1);
+	gpiod_test_chip_set_pull(0, 5, 0);
+	g_assert_true(wait_for_bits(snap, 0x1));
+
+	ret = gpiod_value_snapshot_read(snap, &data);
+	g_assert_cmpint(ret, ==, 0);
+	g_assert_cmpuint(data.generation, >=, 3);
+
+	gpiod_value_snapshot_free(snap);
+}
+
+GPIOD_TEST_CASE(periodic_needs_period, 0, { 8 })
+{
+	g_autoptr(gpiod_line_bulk_struct) bulk = NULL;
+	g_autoptr(gpiod_chip_struct) chip = NULL;
+	unsigned int offset = 0;
+
+	chip = gpiod_chip_open(gpiod_test_chip_path(0));
+	g_assert_nonnull(chip);
+	gpiod_test_return_if_failed();
+
+	bulk = gpiod_chip_get_lines(chip, &offset, 1);
+	g_assert_nonnull(bulk);
+	gpiod_test_return_if_failed();
+
+	g_assert_null(gpiod_value_snapshot_new(bulk,
+					       GPIOD_VALUE_SNAPSHOT_PERIODIC,
+					       NULL, NULL));
+	g_assert_cmpint(errno, ==, EINVAL);
+}
@@ -556,6 +556,51 @@ teardown() {
 	test "$status" -eq "0"
 }
 
+@test "gpioset: play a sequence and wait for SIGTERM" {
+	gpio_mockup_probe 8 8 8
+
+	cat > "$BATS_TMPDIR/gpioset-sequence" <<EOF
+# time[us] values
+0	2=1 5=1
+10000	2=0
+20000	7=1
+EOF
+
+	coproc_run_tool gpioset --mode=signal \
+			--sequence="$BATS_TMPDIR/gpioset-sequence" \
+			"$(gpio_mockup_chip_name 1)" 2=0 5=0 7=0
+
+	gpio_mockup_check_value 1 2 0
+	gpio_mockup_check_value 1 5 1
+	gpio_mockup_check_value 1 7 1
+
+	coproc_tool_kill
+	coproc_tool_wait
+
+	test "$status" -eq "0"
+}
+
+@test "gpioset: sequence with a line not given on the command line" {
+	gpio_mockup_probe 8 8 8
+
+	echo "0 3=1" > "$BATS_TMPDIR/gpioset-sequence"
+
+	run_tool gpioset --sequence="$BATS_TMPDIR/gpioset-sequence" \
+			"$(gpio_mockup_chip_name 1)" 2=0
+
+	test "$status" -eq "1"
+	output_regex_match ".*line 3 not given on the command line"
+}
+
+@test "gpioset: use --period without --sequence" {
+	gpio_mockup_probe 8 8 8
+
+	run_tool gpioset --period=1000 "$(gpio_mockup_chip_name 1)" 0=1
+
+	test "$status" -eq "1"
+	output_regex_match ".*can't specify the period without a sequence"
+}
+
 @test "gpioset: no arguments" {
 	run_tool gpioset
 
@@ -1043,3 +1088,74 @@ teardown() {
 	test "$status" -eq "0"
 	test "$output" = "%x"
 }
+
+@test "gpiomon: record events to a capture file" {
+	gpio_mockup_probe 8 8 8
+
+	CAPTURE="$BATS_TMPDIR/gpiomon-capture"
+
+	# Nothing but the header without any events.
+	coproc_run_tool gpiomon --output="$CAPTURE" "$(gpio_mockup_chip_name 1)" 4
+
+	coproc_tool_kill -SIGINT
+	coproc_tool_wait
+
+	test "$status" -eq "0"
+	test -z "$output"
+	test "$(head -c 8 "$CAPTURE")" = "GPIODCAP"
+	HEADER_SIZE=$(stat -c %s "$CAPTURE")
+
+	coproc_run_tool gpiomon --num-events=2 --output="$CAPTURE" \
+		"$(gpio_mockup_chip_name 1)" 4
+
+	gpio_mockup_set_pull 1 4 1
+	sleep 0.2
+	gpio_mockup_set_pull 1 4 0
+	sleep 0.2
+
+	coproc_tool_wait
+
+	test "$status" -eq "0"
+	test -z "$output"
+	test "$(head -c 8 "$CAPTURE")" = "GPIODCAP"
+	test "$(stat -c %s "$CAPTURE")" -gt "$HEADER_SIZE"
+
+	# Buffered events must be written out when killed.
+	coproc_run_tool gpiomon --output="$CAPTURE" "$(gpio_mockup_chip_name 1)" 4
+
+	gpio_mockup_set_pull 1 4 1
+	sleep 0.2
+
+	coproc_tool_kill -SIGTERM
+	coproc_tool_wait
+
+	test "$status" -eq "0"
+	test "$(stat -c %s "$CAPTURE")" -gt "$HEADER_SIZE"
+
+	rm -f "$CAPTURE"
+}
+
+@test "gpiomon: record events to an invalid path" {
+	gpio_mockup_probe 8 8 8
+
+	run_tool gpiomon --output=/nonexistent/capture "$(gpio_mockup_chip_name 1)" 4
+
+	test "$status" -eq "1"
+	output_regex_match ".*unable to open /nonexistent/capture"
+}
+
+@test "gpiomon: record events with printing options" {
+	gpio_mockup_probe 8 8 8
+
+	run_tool gpiomon --output=/dev/null --format=%o \
+		"$(gpio_mockup_chip_name 1)" 4
+
+	test "$status" -eq "1"
+	output_regex_match ".*--silent and --format can't be used with --output"
+
+	run_tool gpiomon --output=/dev/null --silent \
+		"$(gpio_mockup_chip_name 1)" 4
+
+	test "$status" -eq "1"
+	output_regex_match ".*--silent and --format can't be used with --output"
+}
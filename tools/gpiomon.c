@@ -2,11 +2,11 @@
 // SPDX-FileCopyrightText: 2017-2021 Bartosz Golaszewski <bartekgola@gmail.com>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <gpiod.h>
 #include <limits.h>
 #include <poll.h>
-#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -24,10 +24,11 @@ static const struct option longopts[] = {
 	{ "falling-edge",	no_argument,		NULL,	'f' },
 	{ "line-buffered",	no_argument,		NULL,	'b' },
 	{ "format",		required_argument,	NULL,	'F' },
+	{ "output",		required_argument,	NULL,	'o' },
 	{ GETOPT_NULL_LONGOPT },
 };
 
-static const char *const shortopts = "+hvlB:n:srfbF:";
+static const char *const shortopts = "+hvlB:n:srfbF:o:";
 
 static void print_help(void)
 {
@@ -48,6 +49,7 @@ static void print_help(void)
 	printf("  -f, --falling-edge:\tonly process falling edge events\n");
 	printf("  -b, --line-buffered:\tset standard output as line buffered\n");
 	printf("  -F, --format=FMT\tspecify custom output format\n");
+	printf("  -o, --output=FILE\trecord events to FILE in the binary capture format\n");
 	printf("\n");
 	print_bias_help();
 	printf("\n");
@@ -62,6 +64,7 @@ struct mon_ctx {
 	unsigned int offset;
 	bool silent;
 	char *fmt;
+	struct gpiod_capture_writer *writer;
 };
 
 static void event_print_custom(unsigned int offset,
@@ -146,33 +149,44 @@ static void handle_event(unsigned int line_offset, unsigned int event_type,
 	}
 }
 
-static void handle_signal(int signum UNUSED)
+/*
+ * Events are recorded in whole batches without being formatted, so recording
+ * keeps up with much higher event rates than printing.
+ */
+static void handle_events(struct gpiod_line_event_ext *events,
+			  unsigned int num_events, struct mon_ctx *ctx)
 {
-	exit(EXIT_SUCCESS);
+	unsigned int i;
+
+	if (ctx->writer) {
+		if (gpiod_capture_writer_add(ctx->writer, events, num_events))
+			die_perror("error recording line events");
+		return;
+	}
+
+	for (i = 0; i < num_events; i++)
+		handle_event(events[i].offset, events[i].event_type,
+			     &events[i].ts, ctx);
 }
 
 int main(int argc, char **argv)
 {
 	unsigned int offsets[64], num_lines = 0, offset,
-		     events_wanted = 0, events_done = 0, x;
+		     events_wanted = 0, events_done = 0;
 	bool watch_rising = false, watch_falling = false;
-	int flags = 0;
-	struct timespec timeout = { 10, 0 };
-	int optc, opti, rv, i, y, event_type;
+	int flags = GPIOD_LINE_REQUEST_FLAG_SHARED_EVENT_FD |
+		    GPIOD_LINE_REQUEST_FLAG_EVENT_NONBLOCK;
+	int optc, opti, rv, i, event_type, fd = -1;
 	struct mon_ctx ctx;
 	struct gpiod_chip *chip;
-	struct gpiod_line_bulk *lines, *evlines;
+	struct gpiod_line_bulk *lines;
+	struct gpiod_line *line;
 	char *end;
 	struct gpiod_line_request_config config;
-	struct gpiod_line *line;
-	struct gpiod_line_event events[16];
-
-	/*
-	 * FIXME: use signalfd once the API has been converted to using a single file
-	 * descriptor as provided by uAPI v2.
-	 */
-	signal(SIGINT, handle_signal);
-	signal(SIGTERM, handle_signal);
+	const char *output = NULL;
+	struct gpiod_line_event_ext events[64];
+	struct timespec timeout;
+	struct pollfd pfds[2];
 
 	memset(&ctx, 0, sizeof(ctx));
 
@@ -214,6 +228,9 @@ int main(int argc, char **argv)
 		case 'F':
 			ctx.fmt = optarg;
 			break;
+		case 'o':
+			output = optarg;
+			break;
 		case '?':
 			die("try %s --help", get_progname());
 		default:
@@ -224,6 +241,10 @@ int main(int argc, char **argv)
 	argc -= optind;
 	argv += optind;
 
+	/* Nothing is printed while recording, so these options make no sense. */
+	if (output && (ctx.silent || ctx.fmt))
+		die("--silent and --format can't be used with --output");
+
 	if (watch_rising && !watch_falling)
 		event_type = GPIOD_LINE_REQUEST_EVENT_RISING_EDGE;
 	else if (watch_falling && !watch_rising)
@@ -267,45 +288,65 @@ int main(int argc, char **argv)
 	if (rv)
 		die_perror("unable to request GPIO lines for events");
 
-	evlines = gpiod_line_bulk_new(num_lines);
-	if (!evlines)
-		die("out of memory");
+	if (output) {
+		fd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			  0644);
+		if (fd < 0)
+			die_perror("unable to open %s", output);
+
+		ctx.writer = gpiod_capture_writer_new(fd, lines);
+		if (!ctx.writer)
+			die_perror("unable to write the capture header");
+	}
+
+	/*
+	 * All lines share a single non-blocking file descriptor - wait for it
+	 * together with the signals so that we always exit cleanly and never
+	 * lose the buffered recording.
+	 */
+	line = gpiod_line_bulk_get_line(lines, 0);
+	pfds[0].fd = gpiod_line_event_get_fd(line);
+	pfds[0].events = POLLIN | POLLPRI;
+	pfds[1].fd = make_signalfd();
+	pfds[1].events = POLLIN;
+
+	memset(&timeout, 0, sizeof(timeout));
 
 	for (;;) {
-		gpiod_line_bulk_reset(evlines);
-		rv = gpiod_line_event_wait_bulk(lines, &timeout, evlines);
+		rv = poll(pfds, 2, -1);
 		if (rv < 0)
 			die_perror("error waiting for events");
-		if (rv == 0)
-			continue;
 
-		num_lines = gpiod_line_bulk_num_lines(evlines);
+		if (pfds[1].revents)
+			break;
+
+		rv = gpiod_line_event_read_bulk_ext(lines, &timeout, events,
+						    ARRAY_SIZE(events));
+		if (rv < 0)
+			die_perror("error reading line events");
+
+		if (events_wanted && events_done + rv > events_wanted)
+			rv = events_wanted - events_done;
+
+		handle_events(events, rv, &ctx);
 
-		for (x = 0; x < num_lines; x++) {
-			line = gpiod_line_bulk_get_line(evlines, x);
+		events_done += rv;
+		if (events_wanted && events_done >= events_wanted)
+			break;
+	}
 
-			rv = gpiod_line_event_read_multiple(line, events,
-							    ARRAY_SIZE(events));
-			if (rv < 0)
-				die_perror("error reading line events");
+	close(pfds[1].fd);
 
-			for (y = 0; y < rv; y++) {
-				handle_event(gpiod_line_offset(line),
-					     events[y].event_type,
-					     &events[y].ts, &ctx);
-				events_done++;
+	if (ctx.writer) {
+		if (gpiod_capture_writer_flush(ctx.writer))
+			die_perror("error recording line events");
 
-				if (events_wanted &&
-				    events_done >= events_wanted)
-					goto done;
-			}
-		}
+		gpiod_capture_writer_free(ctx.writer);
+		close(fd);
 	}
 
-done:
 	gpiod_line_release_bulk(lines);
 	gpiod_line_bulk_free(lines);
-	gpiod_line_bulk_free(evlines);
 	gpiod_chip_unref(chip);
 
 	return EXIT_SUCCESS;
@@ -23,10 +23,12 @@ static const struct option longopts[] = {
 	{ "sec",		required_argument,	NULL,	's' },
 	{ "usec",		required_argument,	NULL,	'u' },
 	{ "background",		no_argument,		NULL,	'b' },
+	{ "sequence",		required_argument,	NULL,	'S' },
+	{ "period",		required_argument,	NULL,	'p' },
 	{ GETOPT_NULL_LONGOPT },
 };
 
-static const char *const shortopts = "+hvlB:D:m:s:u:b";
+static const char *const shortopts = "+hvlB:D:m:s:u:bS:p:";
 
 static void print_help(void)
 {
@@ -48,6 +50,8 @@ static void print_help(void)
 	printf("  -s, --sec=SEC:\tspecify the number of seconds to wait (only valid for --mode=time)\n");
 	printf("  -u, --usec=USEC:\tspecify the number of microseconds to wait (only valid for --mode=time)\n");
 	printf("  -b, --background:\tafter setting values: detach from the controlling terminal\n");
+	printf("  -S, --sequence=FILE:\tafter setting values: play the sequence of value changes stored in FILE\n");
+	printf("  -p, --period=USEC:\tloop the sequence with given period in microseconds until SIGINT or SIGTERM\n");
 	printf("\n");
 	print_bias_help();
 	printf("\n");
@@ -62,6 +66,17 @@ static void print_help(void)
 	printf("  time:\t\tset values and sleep for a specified amount of time\n");
 	printf("  signal:\tset values and wait for SIGINT or SIGTERM\n");
 	printf("\n");
+	printf("Sequences:\n");
+	printf("  Every line of the sequence file holds a time in microseconds relative to the start of\n");
+	printf("  the sequence followed by <offset>=<value> mappings for lines given on the command line.\n");
+	printf("  Times must not decrease. Empty lines and lines starting with '#' are ignored, e.g.:\n");
+	printf("\n");
+	printf("    0    23=1 24=0\n");
+	printf("    500  23=0\n");
+	printf("    1000 24=1\n");
+	printf("\n");
+	printf("  The mode is applied once the sequence has been played.\n");
+	printf("\n");
 	printf("Note: the state of a GPIO line controlled over the character device reverts to default\n");
 	printf("when the last process referencing the file descriptor representing the device file exits.\n");
 	printf("This means that it's wrong to run gpioset, have it exit and expect the line to continue\n");
@@ -175,6 +190,141 @@ static const struct mode_mapping *parse_mode(const char *mode)
 	return NULL;
 }
 
+static int find_offset(const unsigned int *offsets, unsigned int num_lines,
+		       unsigned int offset)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_lines; i++) {
+		if (offsets[i] == offset)
+			return i;
+	}
+
+	return -1;
+}
+
+static struct gpiod_output_step *
+parse_sequence(const char *path, const unsigned int *offsets,
+	       unsigned int num_lines, unsigned int *num_steps)
+{
+	struct gpiod_output_step *steps = NULL, *step;
+	unsigned int linenum = 0, offset;
+	unsigned long long usec;
+	size_t bufsize = 0;
+	char *buf = NULL;
+	char *tok, *end;
+	int index, val;
+	FILE *fp;
+
+	if (num_lines > 64)
+		die("sequences can control at most 64 lines");
+
+	fp = fopen(path, "r");
+	if (!fp)
+		die_perror("unable to open %s", path);
+
+	*num_steps = 0;
+
+	while (getline(&buf, &bufsize, fp) > 0) {
+		linenum++;
+
+		tok = strtok(buf, " \t\r\n");
+		if (!tok || tok[0] == '#')
+			continue;
+
+		usec = strtoull(tok, &end, 10);
+		if (*end != '\0')
+			die("%s:%u: invalid time value: %s", path, linenum, tok);
+
+		steps = realloc(steps, sizeof(*steps) * (*num_steps + 1));
+		if (!steps)
+			die("out of memory");
+
+		step = &steps[(*num_steps)++];
+		memset(step, 0, sizeof(*step));
+		step->time.tv_sec = usec / 1000000;
+		step->time.tv_nsec = (usec % 1000000) * 1000;
+
+		while ((tok = strtok(NULL, " \t\r\n"))) {
+			if (sscanf(tok, "%u=%d", &offset, &val) != 2 ||
+			    (val != 0 && val != 1))
+				die("%s:%u: invalid offset<->value mapping: %s",
+				    path, linenum, tok);
+
+			index = find_offset(offsets, num_lines, offset);
+			if (index < 0)
+				die("%s:%u: line %u not given on the command line",
+				    path, linenum, offset);
+
+			step->mask |= 1ULL << index;
+			if (val)
+				step->bits |= 1ULL << index;
+		}
+	}
+
+	free(buf);
+	fclose(fp);
+
+	if (!*num_steps)
+		die("%s: no steps in sequence", path);
+
+	return steps;
+}
+
+/*
+ * Play the sequence once or - if the period is not zero - in a loop until
+ * signalled. Returns false if interrupted by a signal.
+ */
+static bool play_sequence(struct gpiod_line_bulk *lines,
+			  struct gpiod_output_step *steps,
+			  unsigned int num_steps, const struct timespec *period)
+{
+	bool loop = period->tv_sec || period->tv_nsec;
+	struct gpiod_output_sequencer_stats stats;
+	struct gpiod_output_sequencer *seq;
+	struct pollfd pfds[2];
+	bool finished;
+	int rv;
+
+	seq = gpiod_output_sequencer_new(lines, steps, num_steps,
+					 loop ? period : NULL);
+	if (!seq)
+		die_perror("unable to set up the sequence");
+
+	memset(pfds, 0, sizeof(pfds));
+	pfds[0].fd = gpiod_output_sequencer_get_fd(seq);
+	pfds[0].events = POLLIN;
+	pfds[1].fd = make_signalfd();
+	pfds[1].events = POLLIN | POLLPRI;
+
+	rv = gpiod_output_sequencer_start(seq, NULL, loop ? 0 : 1);
+	if (rv)
+		die_perror("unable to start the sequence");
+
+	do {
+		rv = poll(pfds, 2, -1);
+	} while (rv < 0 && errno == EINTR);
+	if (rv < 0)
+		die("error polling for events: %s", strerror(errno));
+
+	finished = pfds[0].revents;
+
+	rv = gpiod_output_sequencer_stop(seq);
+	if (rv)
+		die_perror("error playing the sequence");
+
+	gpiod_output_sequencer_get_stats(seq, &stats);
+	if (stats.num_late)
+		fprintf(stderr, "%s: %llu of %llu steps were late\n",
+			get_progname(), stats.num_late, stats.num_steps);
+
+	gpiod_output_sequencer_free(seq);
+	/* The wait modes need to be interruptible again. */
+	close_signalfd(pfds[1].fd);
+
+	return finished;
+}
+
 static int drive_flags(const char *option)
 {
 	if (strcmp(option, "open-drain") == 0)
@@ -189,13 +339,16 @@ static int drive_flags(const char *option)
 int main(int argc, char **argv)
 {
 	const struct mode_mapping *mode = &modes[MODE_EXIT];
+	unsigned int *offsets, num_lines, num_steps = 0, i;
+	struct gpiod_output_step *steps = NULL;
 	struct gpiod_line_request_config config;
 	int *values, rv, optc, opti, flags = 0;
-	unsigned int *offsets, num_lines, i;
+	struct timespec period = { 0, 0 };
+	char *device, *end, *seqfile = NULL;
 	struct gpiod_line_bulk *lines;
 	struct callback_data cbdata;
+	unsigned long long usec;
 	struct gpiod_chip *chip;
-	char *device, *end;
 
 	memset(&cbdata, 0, sizeof(cbdata));
 
@@ -239,6 +392,16 @@ int main(int argc, char **argv)
 		case 'b':
 			cbdata.daemonize = true;
 			break;
+		case 'S':
+			seqfile = optarg;
+			break;
+		case 'p':
+			usec = strtoull(optarg, &end, 10);
+			if (*end != '\0' || usec == 0)
+				die("invalid period: %s", optarg);
+			period.tv_sec = usec / 1000000;
+			period.tv_nsec = (usec % 1000000) * 1000;
+			break;
 		case '?':
 			die("try %s --help", get_progname());
 		default:
@@ -257,6 +420,9 @@ int main(int argc, char **argv)
 	    cbdata.daemonize)
 		die("can't daemonize in this mode");
 
+	if (!seqfile && (period.tv_sec || period.tv_nsec))
+		die("can't specify the period without a sequence");
+
 	if (argc < 1)
 		die("gpiochip must be specified");
 
@@ -284,6 +450,9 @@ int main(int argc, char **argv)
 			die("invalid offset: %s", argv[i + 1]);
 	}
 
+	if (seqfile)
+		steps = parse_sequence(seqfile, offsets, num_lines, &num_steps);
+
 	chip = chip_open_lookup(device);
 	if (!chip)
 		die_perror("unable to open %s", device);
@@ -302,6 +471,9 @@ int main(int argc, char **argv)
 	if (rv)
 		die_perror("unable to request lines");
 
+	if (steps && !play_sequence(lines, steps, num_steps, &period))
+		mode = &modes[MODE_EXIT];
+
 	if (mode->callback)
 		mode->callback(&cbdata);
 
@@ -310,6 +482,7 @@ int main(int argc, char **argv)
 	gpiod_line_bulk_free(lines);
 	free(offsets);
 	free(values);
+	free(steps);
 
 	return EXIT_SUCCESS;
 }
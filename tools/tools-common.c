@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/signalfd.h>
+#include <unistd.h>
 
 #include "tools-common.h"
 
@@ -99,6 +100,23 @@ int make_signalfd(void)
 	return sigfd;
 }
 
+/* Close a descriptor created by make_signalfd() and unblock the signals. */
+void close_signalfd(int sigfd)
+{
+	sigset_t sigmask;
+	int rv;
+
+	close(sigfd);
+
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIGTERM);
+	sigaddset(&sigmask, SIGINT);
+
+	rv = sigprocmask(SIG_UNBLOCK, &sigmask, NULL);
+	if (rv < 0)
+		die("error unmasking signals: %s", strerror(errno));
+}
+
 int chip_dir_filter(const struct dirent *entry)
 {
 	bool is_chip;